@@ -3,10 +3,15 @@
 
 #include <stdint.h>
 
+#include "i2c_queue.h"
+
 #define ACCEL_I2C_ADDR (0x19)
 
 #define ACCEL_ERROR -1
 #define ACCEL_SUCCESS 0
+#define ACCEL_DRDY_TIMEOUT -2
+
+#define ACCEL_FIFO_DEPTH 32     // Samples the LIS2DW12 FIFO holds
 
 /**
  * @brief Accelerometer data
@@ -33,6 +38,13 @@ int app_accel_whoami();
  */
 int app_accel_config ();
 
+/**
+ * @brief Set up the accelerometer configuration as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_config_txn(i2c_txn_t *txn);
+
 /**
  * @brief Accelerometer trigger enable function
  * 
@@ -47,6 +59,61 @@ void accel_trigger_enable(void);
  */
 int app_accel_read(accel_data_t *accel_data);
 
+/**
+ * @brief Read the accelerometer value of a conversion which is already done, without waiting for DRDY
+ * 
+ * @note For a caller which has seen DRDY, e.g. the sensor scheduler
+ * 
+ * @param accel_data Buffer to store current accelerometer data
+ * @return int error code
+ */
+int app_accel_fetch(accel_data_t *accel_data);
+
+/**
+ * @brief Start filling the FIFO: FIFO mode, then continuous conversions at ACCEL_FIFO_ODR_CODE
+ * 
+ * @return int error code
+ */
+int app_accel_fifo_start(void);
+
+/**
+ * @brief Set up the FIFO mode write as a transaction of an I2C queue chain, to go before app_accel_fifo_start_txn()
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_fifo_mode_txn(i2c_txn_t *txn);
+
+/**
+ * @brief Set up the continuous conversion configuration as a transaction of an I2C queue chain.
+ *        Call app_accel_fifo_mark_started() once it is done.
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_fifo_start_txn(i2c_txn_t *txn);
+
+/**
+ * @brief Record that the FIFO started filling, the fill time is counted from this call
+ * 
+ */
+void app_accel_fifo_mark_started(void);
+
+/**
+ * @brief Stop the capture: back to single conversions on demand, the FIFO is cleared
+ * 
+ * @return int error code
+ */
+int app_accel_fifo_stop(void);
+
+/**
+ * @brief Read a capture out of the FIFO with one I2C burst read, then stop the capture.
+ *        The capture is started first if it is not running.
+ * 
+ * @param samples Buffer to store the samples, m/s^2 * 1000
+ * @param num_samples Samples to read, ACCEL_FIFO_DEPTH at most
+ * @return int error code, ACCEL_DRDY_TIMEOUT if the FIFO did not fill in time
+ */
+int app_accel_fifo_read(accel_data_t *samples, uint8_t num_samples);
+
 #if (USE_ZEPHYR_SENSOR)
 /**
  * @brief Read Accelerometer data using Zephyr APIs
@@ -8,6 +8,7 @@
 
 #include "app_types.h"
 #include "i2c_sensors.h"
+#include "i2c_queue.h"
 #include "device_config.h"
 #include "config_commands.h"
 #include "app_gpio.h"
@@ -25,9 +26,20 @@ LOG_MODULE_DECLARE(wepower);
 #define ACC_CONFIG_REGISTER_CNTRL2_ADDR	0x22
 
 #define ACC_DRDY_READY_TIMEOUT		100
+#define ACC_DRDY_TIMEOUT_MSEC		10		// Same bound as the 100 polls of 100 us
 #define ACC_READ_DATA_BUFFER_SIZE	6
 #define ACC_READ_DATA_REG_ADDR		0x28
 
+#define ACC_FIFO_CTRL_REG_ADDR		0x2E
+#define ACC_FIFO_SAMPLES_REG_ADDR	0x2F
+#define ACC_FIFO_MODE_BYPASS		0x00	// FIFO off, writing it clears the FIFO
+#define ACC_FIFO_MODE_FIFO			0x20	// FIFO mode, collects until full
+#define ACC_FIFO_SAMPLES_DIFF_MASK	0x3F	// Unread samples in the FIFO
+#define ACC_FIFO_MODE_HIGH_PERF		0x04	// CTRL1 MODE, continuous high performance conversions
+#define ACC_FIFO_POLL_TIMEOUT_USEC	10000	// Longest wait past the expected fill time
+
+BUILD_ASSERT((ACCEL_FIFO_ODR_CODE >= 3) && (ACCEL_FIFO_ODR_CODE <= 9), "LIS2DW12 high performance ODR code out of range");
+
 /**
  * @brief Who am I for the accelerometer - Used as an Identification for the chip
  * 
@@ -38,7 +50,7 @@ int app_accel_whoami()
 	uint8_t whoami = 0;
 	int ret = 0;
     
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
 
 	if (!device_is_ready(i2c_dev))
 	{
@@ -57,6 +69,29 @@ int app_accel_whoami()
 	return ret;
 }
 
+// Reg 0x20 set mode to High-Performance / Low-Power mode 400/200 Hz 
+// Single data conversion on demand mode (12/14-bit resolution) [shutdown until told to trigger]
+// 12 bit precision
+// Reg 0x21 default, but chaper to send than make two writes 
+// Reg 0x22 0, use INT2 as TRIG
+// Reg 0x23 use INT1 as DRDY
+// Not const, an I2C queue transaction writes it in place
+static uint8_t accel_config[ACC_CONFIG_MSG_LEN] = {0x78, 0x04, 0x00, 0x01};
+
+// Reg 0x20 ACCEL_FIFO_ODR_CODE, High-Performance continuous conversions (14-bit resolution)
+// Reg 0x21 address auto increment, the FIFO read rolls back from 0x2D to 0x28
+// Reg 0x22 0, no trigger
+// Reg 0x23 0, no DRDY, the FIFO level is polled
+static uint8_t accel_fifo_config[ACC_CONFIG_MSG_LEN] = {(ACCEL_FIFO_ODR_CODE << 4) | ACC_FIFO_MODE_HIGH_PERF, 0x04, 0x00, 0x00};
+
+// FIFO_CTRL values, written by I2C queue transactions in place
+static uint8_t accel_fifo_mode = ACC_FIFO_MODE_FIFO;
+static uint8_t accel_fifo_bypass = ACC_FIFO_MODE_BYPASS;
+
+// k_cycle_get_32() when the capture started, valid while is_fifo_capturing is set
+static uint32_t fifo_start_cycles;
+static bool is_fifo_capturing = false;
+
 /**
  * @brief Set Accelerometer Configuration
  * 
@@ -64,19 +99,7 @@ int app_accel_whoami()
  */
 int app_accel_config ()
 {
-	uint8_t config[ACC_CONFIG_MSG_LEN] ;
-	// Reg 0x20 set mode to High-Performance / Low-Power mode 400/200 Hz 
-	// Single data conversion on demand mode (12/14-bit resolution) [shutdown until told to trigger]
-	// 12 bit precision
-	config[0] = 0x78;
-	// default, but chaper to send than make two writes 
-	config[1] = 0x04; 
-	// Reg 0x22 0, use INT2 as TRIG
-	config[2] = 0x00; 
-	// Reg 0x23 use INT1 as DRDY
-	config[3] = 0x01; 
-	
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
 
 	if (!device_is_ready(i2c_dev)) 
 	{
@@ -84,7 +107,17 @@ int app_accel_config ()
 		return ACCEL_ERROR;
 	}
 
-	return  i2c_write_bytes(i2c_dev, ACC_CONFIG_REGISTER_CNTRL1_ADDR, config, ACC_CONFIG_MSG_LEN, ACCEL_I2C_ADDR);	 
+	return  i2c_write_bytes(i2c_dev, ACC_CONFIG_REGISTER_CNTRL1_ADDR, accel_config, ACC_CONFIG_MSG_LEN, ACCEL_I2C_ADDR);	 
+}
+
+/**
+ * @brief Set up the accelerometer configuration as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_config_txn(i2c_txn_t *txn)
+{
+	i2c_txn_write(txn, DEVICE_DT_GET(SENSOR_I2C_NODE), ACCEL_I2C_ADDR, ACC_CONFIG_REGISTER_CNTRL1_ADDR, sizeof(uint8_t), accel_config, ACC_CONFIG_MSG_LEN);
 }
 
 /**
@@ -98,17 +131,17 @@ void accel_trigger_enable(void)
   set_imu_trigger_pin();
 }
 
+#if (IMU_I2C_DRDY)
 /**
- * @brief Read the Data ready register/pin status
+ * @brief Read the Data ready register status
  * 
  * @return int Current status or error code in case of failure
  */
 static int app_accel_drdy()
 {
-#if (IMU_I2C_DRDY)
 	uint8_t resp = 0;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
 	if (!device_is_ready(i2c_dev)) {
 		LOG_ERR("Umable to read IMU DRDY status - I2C device not ready");
 		return ACCEL_ERROR;
@@ -121,72 +154,289 @@ static int app_accel_drdy()
 	}
 
 	return ret;
-	#else
-	return !get_imu_drdy_pin_status();
-	#endif
+}
+#endif
+
+/**
+ * @brief Wait until the accelerometer data is ready
+ * 
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code otherwise
+ */
+static int app_accel_wait_drdy()
+{
+#if (IMU_I2C_DRDY)
+	uint16_t timeout = ACC_DRDY_READY_TIMEOUT;
 
+	while (app_accel_drdy() && timeout--)
+	{
+		k_usleep (100);
+	}
+	return (timeout == 0) ? -EAGAIN : 0;
+#else
+	// The CPU sleeps until the DRDY interrupt
+	return wait_for_imu_drdy(K_MSEC(ACC_DRDY_TIMEOUT_MSEC));
+#endif
 }
 
 /**
- * @brief Read accelerometer current value
+ * @brief Read the accelerometer value of a conversion which is already done, without waiting for DRDY
  * 
  * @param accel_data Buffer to store current accelerometer data
  * @return int error code
  */
-int app_accel_read(accel_data_t *accel_data)
+int app_accel_fetch(accel_data_t *accel_data)
 {
 	int accel_error = ACCEL_ERROR;
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
-
-	uint16_t timeout = ACC_DRDY_READY_TIMEOUT;
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
 
-	// Wait until DRDY pin is set, indicating the data is ready to read
-	while (app_accel_drdy() && timeout--)
+	if (!device_is_ready(i2c_dev)) 
 	{
-		k_usleep (100);
+		LOG_ERR("Unable to read IMU - I2C error");
+	}
+	else
+	{
+		uint8_t accel_sensor_data[ACC_READ_DATA_BUFFER_SIZE];
+		accel_data->x_accel = 0x8000;
+		accel_data->y_accel = 0x8000;
+		accel_data->z_accel = 0x8000;
+
+		int ret = i2c_read_bytes(i2c_dev, ACC_READ_DATA_REG_ADDR, accel_sensor_data, ACC_READ_DATA_BUFFER_SIZE, ACCEL_I2C_ADDR);
+
+		if (ret) 
+		{
+			LOG_ERR("Unable to read IMU - IMU read error");
+		} 
+		else 
+		{
+			accel_data->x_accel = (int16_t)((accel_sensor_data[1] << 8) | accel_sensor_data[0]);
+			accel_data->y_accel = (int16_t)((accel_sensor_data[3] << 8) | accel_sensor_data[2]);
+			accel_data->z_accel = (int16_t)((accel_sensor_data[5] << 8) | accel_sensor_data[4]);
+
+			LOG_INF("IMU: 0x%02X%02X 0x%02X%02X 0x%02X%02X", accel_sensor_data[1], accel_sensor_data[0], accel_sensor_data[3], accel_sensor_data[2], accel_sensor_data[5], accel_sensor_data[4]);
+			accel_data->x_accel = (int16_t)((19600*(int32_t)accel_data->x_accel)>>15);  // 2g full scale, signed binary fraction, *9.8 m/s^2 per g * 1000
+			accel_data->y_accel = (int16_t)((19600*(int32_t)accel_data->y_accel)>>15);
+			accel_data->z_accel = (int16_t)((19600*(int32_t)accel_data->z_accel)>>15);
+			//LOG_INF( "IMU: %d, %d, %d m/s^2 * 1000", accel_data->x_accel, accel_data->y_accel, accel_data->z_accel);
+			accel_error = ACCEL_SUCCESS;
+		}
 	}
+
+	clear_imu_trigger_pin();
+
+	return accel_error;
+}
+
+/**
+ * @brief Read accelerometer current value
+ * 
+ * @param accel_data Buffer to store current accelerometer data
+ * @return int error code
+ */
+int app_accel_read(accel_data_t *accel_data)
+{
+	// Wait until DRDY pin is set, indicating the data is ready to read
+	int drdy_ret = app_accel_wait_drdy();
 		
 	// Check if timer expired and DRDY Pin was not set
-	if (timeout == 0)
+	if (drdy_ret == -EAGAIN)
 	{
 		LOG_ERR("DRDY Timeout during IMU read");
+		clear_imu_trigger_pin();
+		return ACCEL_DRDY_TIMEOUT;
+	}
+	else if (drdy_ret)
+	{
+		LOG_ERR("Unable to wait for IMU DRDY, error code %d", drdy_ret);
+		clear_imu_trigger_pin();
+		return ACCEL_ERROR;
+	}
+
+	return app_accel_fetch(accel_data);
+}
+
+/**
+ * @brief Start filling the FIFO: FIFO mode, then continuous conversions at ACCEL_FIFO_ODR_CODE
+ * 
+ * @return int error code
+ */
+int app_accel_fifo_start(void)
+{
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
+	int ret;
+
+	if (!device_is_ready(i2c_dev)) 
+	{
+		LOG_ERR("Unable to start the IMU FIFO - I2C device not ready");
+		return ACCEL_ERROR;
+	}
+
+	ret = i2c_write_bytes(i2c_dev, ACC_FIFO_CTRL_REG_ADDR, &accel_fifo_mode, sizeof(accel_fifo_mode), ACCEL_I2C_ADDR);
+	if (ret == ACCEL_SUCCESS)
+	{
+		ret = i2c_write_bytes(i2c_dev, ACC_CONFIG_REGISTER_CNTRL1_ADDR, accel_fifo_config, ACC_CONFIG_MSG_LEN, ACCEL_I2C_ADDR);
+	}
+
+	if (ret == ACCEL_SUCCESS)
+	{
+		app_accel_fifo_mark_started();
 	}
 	else
 	{
-		if (!device_is_ready(i2c_dev)) 
+		LOG_ERR("Unable to start the IMU FIFO");
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Set up the FIFO mode write as a transaction of an I2C queue chain, to go before app_accel_fifo_start_txn()
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_fifo_mode_txn(i2c_txn_t *txn)
+{
+	i2c_txn_write(txn, DEVICE_DT_GET(SENSOR_I2C_NODE), ACCEL_I2C_ADDR, ACC_FIFO_CTRL_REG_ADDR, sizeof(uint8_t), &accel_fifo_mode, sizeof(accel_fifo_mode));
+}
+
+/**
+ * @brief Set up the continuous conversion configuration as a transaction of an I2C queue chain.
+ *        Call app_accel_fifo_mark_started() once it is done.
+ * 
+ * @param txn Transaction to set up
+ */
+void app_accel_fifo_start_txn(i2c_txn_t *txn)
+{
+	i2c_txn_write(txn, DEVICE_DT_GET(SENSOR_I2C_NODE), ACCEL_I2C_ADDR, ACC_CONFIG_REGISTER_CNTRL1_ADDR, sizeof(uint8_t), accel_fifo_config, ACC_CONFIG_MSG_LEN);
+}
+
+/**
+ * @brief Record that the FIFO started filling, the fill time is counted from this call
+ * 
+ */
+void app_accel_fifo_mark_started(void)
+{
+	// The next on demand conversion needs a rising edge of the trigger
+	clear_imu_trigger_pin();
+	fifo_start_cycles = k_cycle_get_32();
+	is_fifo_capturing = true;
+}
+
+/**
+ * @brief Stop the capture: back to single conversions on demand, the FIFO is cleared
+ * 
+ * @return int error code
+ */
+int app_accel_fifo_stop(void)
+{
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
+	int ret;
+
+	is_fifo_capturing = false;
+
+	ret = app_accel_config();
+	if (ret == ACCEL_SUCCESS)
+	{
+		ret = i2c_write_bytes(i2c_dev, ACC_FIFO_CTRL_REG_ADDR, &accel_fifo_bypass, sizeof(accel_fifo_bypass), ACCEL_I2C_ADDR);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Sleep until the FIFO holds a number of samples
+ * 
+ * @param i2c_dev I2C bus of the accelerometer
+ * @param num_samples Samples needed
+ * @return int 0 once they are there, -EAGAIN on timeout, other negative error code otherwise
+ */
+static int app_accel_fifo_wait(const struct device *i2c_dev, uint8_t num_samples)
+{
+	uint32_t fill_us = ((uint32_t)num_samples * USEC_PER_SEC) / ACCEL_FIFO_ODR_HZ;
+	uint32_t elapsed_us = k_cyc_to_us_floor32(k_cycle_get_32() - fifo_start_cycles);
+	uint8_t fifo_samples = 0;
+	int ret;
+
+	// The CPU sleeps through the expected fill time, the level is only polled at its end
+	if (elapsed_us < fill_us)
+	{
+		k_usleep(fill_us - elapsed_us);
+	}
+
+	do
+	{
+		ret = i2c_read_bytes(i2c_dev, ACC_FIFO_SAMPLES_REG_ADDR, &fifo_samples, sizeof(fifo_samples), ACCEL_I2C_ADDR);
+		if (ret)
 		{
-			LOG_ERR("Unable to read IMU - I2C error");
+			return ret;
 		}
-		else
+		if ((fifo_samples & ACC_FIFO_SAMPLES_DIFF_MASK) >= num_samples)
 		{
-			uint8_t accel_sensor_data[ACC_READ_DATA_BUFFER_SIZE];
-			accel_data->x_accel = 0x8000;
-			accel_data->y_accel = 0x8000;
-			accel_data->z_accel = 0x8000;
-
-			int ret = i2c_read_bytes(i2c_dev, ACC_READ_DATA_REG_ADDR, accel_sensor_data, ACC_READ_DATA_BUFFER_SIZE, ACCEL_I2C_ADDR);
-
-			if (ret) 
-			{
-				LOG_ERR("Unable to read IMU - IMU read error");
-			} 
-			else 
-			{
-				accel_data->x_accel = (int16_t)((accel_sensor_data[1] << 8) | accel_sensor_data[0]);
-				accel_data->y_accel = (int16_t)((accel_sensor_data[3] << 8) | accel_sensor_data[2]);
-				accel_data->z_accel = (int16_t)((accel_sensor_data[5] << 8) | accel_sensor_data[4]);
-
-				LOG_INF("IMU: 0x%02X%02X 0x%02X%02X 0x%02X%02X", accel_sensor_data[1], accel_sensor_data[0], accel_sensor_data[3], accel_sensor_data[2], accel_sensor_data[5], accel_sensor_data[4]);
-				accel_data->x_accel = (int16_t)((19600*(int32_t)accel_data->x_accel)>>15);  // 2g full scale, signed binary fraction, *9.8 m/s^2 per g * 1000
-				accel_data->y_accel = (int16_t)((19600*(int32_t)accel_data->y_accel)>>15);
-				accel_data->z_accel = (int16_t)((19600*(int32_t)accel_data->z_accel)>>15);
-				//LOG_INF( "IMU: %d, %d, %d m/s^2 * 1000", accel_data->x_accel, accel_data->y_accel, accel_data->z_accel);
-				accel_error = ACCEL_SUCCESS;
-			}
+			return 0;
 		}
+		// One sample period
+		k_usleep(USEC_PER_SEC / ACCEL_FIFO_ODR_HZ);
+	} while (k_cyc_to_us_floor32(k_cycle_get_32() - fifo_start_cycles) < (fill_us + ACC_FIFO_POLL_TIMEOUT_USEC));
+
+	return -EAGAIN;
+}
+
+/**
+ * @brief Read a capture out of the FIFO with one I2C burst read, then stop the capture.
+ *        The capture is started first if it is not running.
+ * 
+ * @param samples Buffer to store the samples, m/s^2 * 1000
+ * @param num_samples Samples to read, ACCEL_FIFO_DEPTH at most
+ * @return int error code, ACCEL_DRDY_TIMEOUT if the FIFO did not fill in time
+ */
+int app_accel_fifo_read(accel_data_t *samples, uint8_t num_samples)
+{
+	const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
+	uint8_t fifo_data[ACCEL_FIFO_DEPTH * ACC_READ_DATA_BUFFER_SIZE];
+	int accel_error = ACCEL_ERROR;
+	int ret;
+
+	if ((num_samples == 0) || (num_samples > ACCEL_FIFO_DEPTH))
+	{
+		return ACCEL_ERROR;
 	}
 
-	clear_imu_trigger_pin();
+	if (!is_fifo_capturing && (app_accel_fifo_start() != ACCEL_SUCCESS))
+	{
+		return ACCEL_ERROR;
+	}
+
+	ret = app_accel_fifo_wait(i2c_dev, num_samples);
+	if (ret == -EAGAIN)
+	{
+		LOG_ERR("IMU FIFO did not fill in time");
+		accel_error = ACCEL_DRDY_TIMEOUT;
+	}
+	else if (ret)
+	{
+		LOG_ERR("Unable to read the IMU FIFO level, error code %d", ret);
+	}
+	else if (i2c_read_bytes(i2c_dev, ACC_READ_DATA_REG_ADDR, fifo_data, num_samples * ACC_READ_DATA_BUFFER_SIZE, ACCEL_I2C_ADDR))
+	{
+		LOG_ERR("Unable to read the IMU FIFO");
+	}
+	else
+	{
+		for (uint8_t i = 0; i < num_samples; i++)
+		{
+			uint8_t *sample = &fifo_data[i * ACC_READ_DATA_BUFFER_SIZE];
+
+			// 2g full scale, signed binary fraction, *9.8 m/s^2 per g * 1000, as app_accel_read()
+			samples[i].x_accel = (int16_t)((19600*(int32_t)(int16_t)((sample[1] << 8) | sample[0]))>>15);
+			samples[i].y_accel = (int16_t)((19600*(int32_t)(int16_t)((sample[3] << 8) | sample[2]))>>15);
+			samples[i].z_accel = (int16_t)((19600*(int32_t)(int16_t)((sample[5] << 8) | sample[4]))>>15);
+		}
+		accel_error = ACCEL_SUCCESS;
+	}
+
+	if (app_accel_fifo_stop())
+	{
+		LOG_ERR("Unable to stop the IMU FIFO");
+	}
 
 	return accel_error;
 }
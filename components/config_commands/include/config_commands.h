@@ -46,13 +46,39 @@
 #define ISL9122_VOLTS_MAX_VALUE     0xFF
 #define ISL9122_VOLTS_DEFAULT_VALUE 0
 
+#define MIC_LEN_MIN_VALUE           0       // 0 keeps the ECB/CTR payload, else even 4 to 16 for AES-CCM
+#define MIC_LEN_MAX_VALUE           16
+#define MIC_LEN_DEFAULT_VALUE       0
+
+#define JITTER_POLICY_MS_MASK           0x7F    // Maximum random delay added before each repeat, in ms, bit 7 is reserved
+#define JITTER_POLICY_MAX_MS            50
+#define JITTER_POLICY_MIN_VALUE         0       // 0 keeps the fixed packet_interval on all three channels
+#define JITTER_POLICY_MAX_VALUE         JITTER_POLICY_MAX_MS
+#define JITTER_POLICY_DEFAULT_VALUE     0
+
+#define RBE_POLICY_MODE_MASK            0x03    // What an event sends when its readings are within the deadbands
+#define RBE_MODE_OFF                    0       // Every event is reported in full
+#define RBE_MODE_HEARTBEAT              1       // One packet
+#define RBE_MODE_SILENT                 2       // No packet
+#define RBE_POLICY_REFRESH_SHIFT        2       // Full report at least every N events, 0 only on a change
+#define RBE_POLICY_REFRESH_MAX          63
+#define RBE_POLICY_MIN_VALUE            0
+#define RBE_POLICY_MAX_VALUE            ((RBE_POLICY_REFRESH_MAX << RBE_POLICY_REFRESH_SHIFT) | RBE_MODE_SILENT)
+#define RBE_POLICY_DEFAULT_VALUE        RBE_MODE_OFF
+
+#define RBE_DEADBAND_MIN_VALUE          0       // 0 reports any change
+#define RBE_DEADBAND_MAX_VALUE          0x7FFF  // 0xFFFF is an erased FRAM
+#define RBE_DEADBAND_ACCEL_DEFAULT      100     // 0.1 m/s^2
+#define RBE_DEADBAND_TEMP_DEFAULT       5       // 0.5 C
+#define RBE_DEADBAND_PRESS_DEFAULT      8       // 0.5 kPa
+
 extern fram_data_t fram_data;
 
 typedef enum 
 {  
     DEVICE_TYPE_LEGACY = 0,         // Legacy but behaves same as 1
     DEVICE_TYPE_BUTTON,             // Button.  Intends to do one burst of packets per event with no polarity
-    DEVICE_TYPE_VIBRATION_MONITOR,  // Vibration monitor, periodic bursts of packets, no polarity.  Future --> pair and stream
+    DEVICE_TYPE_VIBRATION_MONITOR,  // Vibration monitor, periodic bursts of packets, no polarity.  Streams while the harvest keeps up
     DEVICE_TYPE_TWO_WAY_SWITCH,     // Two-way switch with polarity and name in payload
     DEVICE_TYPE_RELEASE_SENSOR,     // Prewound release sensor with just a name
     DEVICE_TYPE_MAX_VALUE           // Max number of Device Types
@@ -70,7 +96,10 @@ typedef enum
     COMMAND_TYPE_DUMP,
     COMMAND_TYPE_PRESET,
     COMMAND_TYPE_CLEAR,
-    COMMAND_TYPE_TESTS
+    COMMAND_TYPE_TESTS,
+    COMMAND_TYPE_BOOT_TRACE,
+    COMMAND_TYPE_BURST_HISTORY,
+    COMMAND_TYPE_ENERGY_LEDGER
 }command_type_t;
 
 /**
@@ -152,4 +181,22 @@ void process_command_fn(struct k_work *work);
  */
 int32_t dump_fram(uint8_t print);
 
+/**
+ * @brief Same as dump_fram(), with the FRAM read by a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction set up by app_fram_bulk_read_txn(), done
+ * @param print Flag to indicate if printing should be done
+ * @return int32_t error code
+ */
+int32_t dump_fram_from_txn(const i2c_txn_t *txn, uint8_t print);
+
+/**
+ * @brief Replace the fields added after the first FRAM layout by their default when they are out of
+ * the range of FRAM_INFO, e.g. the erased 0xFF of a device programmed by an older firmware
+ * 
+ * @param data FRAM data read from the FRAM
+ * @return uint8_t Number of fields which got their default
+ */
+uint8_t check_fram_field_ranges(fram_data_t *data);
+
 #endif // __CONFIG_COMMANDS__
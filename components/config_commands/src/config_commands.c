@@ -9,6 +9,9 @@
 
 #include "config_commands.h"
 #include "device_config.h"
+#include "app_boot_trace.h"
+#include "app_energy_burst.h"
+#include "app_energy_ledger.h"
 
 #define SIZE_OF_ENCRYPTED_KEY_STR   (3 * ENCRYPTED_KEY_NUM_BYTES) + 1
 #define NUMBER_OF_BITS_IN_A_BYTE    8
@@ -25,6 +28,12 @@
 #define PRESET0_DEFAULT_ENCRYPT_KEY         {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
 #define PRESET0_DEFAULT_TX_POWER            80
 #define PRESET0_DEFAULT_NAME                {'b','u','t','t', 'o', 'n', ' ', ' ', ' ', ' '}
+#define PRESET0_DEFAULT_MIC_LEN             MIC_LEN_DEFAULT_VALUE
+#define PRESET0_DEFAULT_JITTER_POLICY       JITTER_POLICY_DEFAULT_VALUE
+#define PRESET0_DEFAULT_RBE_POLICY          RBE_POLICY_DEFAULT_VALUE
+#define PRESET0_DEFAULT_RBE_DB_ACCEL        RBE_DEADBAND_ACCEL_DEFAULT
+#define PRESET0_DEFAULT_RBE_DB_TEMP         RBE_DEADBAND_TEMP_DEFAULT
+#define PRESET0_DEFAULT_RBE_DB_PRESS        RBE_DEADBAND_PRESS_DEFAULT
 
 #define PRESET1_DEFAULT_EVT_COUNTER         0
 #define PRESET1_DEFAULT_SERIAL_NUM          1
@@ -38,6 +47,12 @@
 #define PRESET1_DEFAULT_ENCRYPT_KEY         {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
 #define PRESET1_DEFAULT_TX_POWER            80
 #define PRESET1_DEFAULT_NAME                {'b','u','t','t', 'o', 'n', ' ', ' ', ' ', ' '}
+#define PRESET1_DEFAULT_MIC_LEN             MIC_LEN_DEFAULT_VALUE
+#define PRESET1_DEFAULT_JITTER_POLICY       JITTER_POLICY_DEFAULT_VALUE
+#define PRESET1_DEFAULT_RBE_POLICY          RBE_POLICY_DEFAULT_VALUE
+#define PRESET1_DEFAULT_RBE_DB_ACCEL        RBE_DEADBAND_ACCEL_DEFAULT
+#define PRESET1_DEFAULT_RBE_DB_TEMP         RBE_DEADBAND_TEMP_DEFAULT
+#define PRESET1_DEFAULT_RBE_DB_PRESS        RBE_DEADBAND_PRESS_DEFAULT
 
 #define PRESET2_DEFAULT_EVT_COUNTER         0
 #define PRESET2_DEFAULT_SERIAL_NUM          1
@@ -51,6 +66,12 @@
 #define PRESET2_DEFAULT_ENCRYPT_KEY         {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
 #define PRESET2_DEFAULT_TX_POWER            80
 #define PRESET2_DEFAULT_NAME                {'v','i','b','r', 'a', 't', 'i', 'o', 'n', ' '}
+#define PRESET2_DEFAULT_MIC_LEN             MIC_LEN_DEFAULT_VALUE
+#define PRESET2_DEFAULT_JITTER_POLICY       JITTER_POLICY_DEFAULT_VALUE
+#define PRESET2_DEFAULT_RBE_POLICY          ((30 << RBE_POLICY_REFRESH_SHIFT) | RBE_MODE_HEARTBEAT) // Heartbeat, full report every 5 minutes
+#define PRESET2_DEFAULT_RBE_DB_ACCEL        RBE_DEADBAND_ACCEL_DEFAULT
+#define PRESET2_DEFAULT_RBE_DB_TEMP         RBE_DEADBAND_TEMP_DEFAULT
+#define PRESET2_DEFAULT_RBE_DB_PRESS        RBE_DEADBAND_PRESS_DEFAULT
 
 #define PRESET3_DEFAULT_EVT_COUNTER         0
 #define PRESET3_DEFAULT_SERIAL_NUM          0
@@ -64,6 +85,12 @@
 #define PRESET3_DEFAULT_ENCRYPT_KEY         {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
 #define PRESET3_DEFAULT_TX_POWER            80
 #define PRESET3_DEFAULT_NAME                {'o','n','-','o', 'f', 'f', ' ', 's', 'w', ' '}
+#define PRESET3_DEFAULT_MIC_LEN             MIC_LEN_DEFAULT_VALUE
+#define PRESET3_DEFAULT_JITTER_POLICY       JITTER_POLICY_DEFAULT_VALUE
+#define PRESET3_DEFAULT_RBE_POLICY          RBE_POLICY_DEFAULT_VALUE
+#define PRESET3_DEFAULT_RBE_DB_ACCEL        RBE_DEADBAND_ACCEL_DEFAULT
+#define PRESET3_DEFAULT_RBE_DB_TEMP         RBE_DEADBAND_TEMP_DEFAULT
+#define PRESET3_DEFAULT_RBE_DB_PRESS        RBE_DEADBAND_PRESS_DEFAULT
 
 #define PRESET4_DEFAULT_EVT_COUNTER         0
 #define PRESET4_DEFAULT_SERIAL_NUM          0
@@ -77,6 +104,12 @@
 #define PRESET4_DEFAULT_ENCRYPT_KEY         {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15}
 #define PRESET4_DEFAULT_TX_POWER            80
 #define PRESET4_DEFAULT_NAME                {'l','e','a','k', ' ', 's', 'e', 'n', ' ', ' '}
+#define PRESET4_DEFAULT_MIC_LEN             MIC_LEN_DEFAULT_VALUE
+#define PRESET4_DEFAULT_JITTER_POLICY       JITTER_POLICY_DEFAULT_VALUE
+#define PRESET4_DEFAULT_RBE_POLICY          RBE_POLICY_DEFAULT_VALUE
+#define PRESET4_DEFAULT_RBE_DB_ACCEL        RBE_DEADBAND_ACCEL_DEFAULT
+#define PRESET4_DEFAULT_RBE_DB_TEMP         RBE_DEADBAND_TEMP_DEFAULT
+#define PRESET4_DEFAULT_RBE_DB_PRESS        RBE_DEADBAND_PRESS_DEFAULT
 
 #define COMMAND_TYPE_TO_STR(x)  (x == COMMAND_TYPE_SET)?    "SET":\
                                 (x == COMMAND_TYPE_GET)?    "GET":\
@@ -84,6 +117,10 @@
                                 (x == COMMAND_TYPE_RESET)?  "RESET":\
                                 (x == COMMAND_TYPE_PRESET)? "PRESET":\
                                 (x == COMMAND_TYPE_CLEAR)?  "CLEAR":\
+                                (x == COMMAND_TYPE_TESTS)?  "TESTS":\
+                                (x == COMMAND_TYPE_BOOT_TRACE)? "BOOT TRACE":\
+                                (x == COMMAND_TYPE_BURST_HISTORY)? "BURST HISTORY":\
+                                (x == COMMAND_TYPE_ENERGY_LEDGER)? "ENERGY LEDGER":\
                                 "UNKNOWN CMD RECEIVED"
 
 LOG_MODULE_DECLARE(wepower);
@@ -116,7 +153,13 @@ const fram_info_t FRAM_INFO[MAX_FRAM_FIELDS] =
     {"unused",                  DATA_NUMBER, POL_MET_NUM_BYTES,      POL_METHOD_MIN_VALUE, POL_METHOD_MAX_VALUE, POL_METHOD_DEFAULT_VALUE},
     {"ENCRYPTED KEY",       DATA_BYTE_ARRAY, ENCRYPTED_KEY_NUM_BYTES, 0, 0,0}, // Since this is a byte array, mix max values do not matter
     {"TX dBm 10 (R.F.U.)",      DATA_NUMBER, TX_DBM_NUM_BYTES,       TX_POWER_MIN_VALUE, TX_POWER_MAX_VALUE, TX_POWER_DEFAULT_VALUE},
-    {"Device NAME",             DATA_STRING, NAME_NUM_BYTES,         0, 0,0} // Since this is astring, max and min values do not matter
+    {"Device NAME",             DATA_STRING, NAME_NUM_BYTES,         0, 0,0}, // Since this is astring, max and min values do not matter
+    {"CCM MIC LENGTH",          DATA_NUMBER, MIC_LEN_NUM_BYTES,      MIC_LEN_MIN_VALUE, MIC_LEN_MAX_VALUE, MIC_LEN_DEFAULT_VALUE},
+    {"REPEAT JITTER POLICY",    DATA_NUMBER, JITTER_NUM_BYTES,       JITTER_POLICY_MIN_VALUE, JITTER_POLICY_MAX_VALUE, JITTER_POLICY_DEFAULT_VALUE},
+    {"RBE POLICY",              DATA_NUMBER, RBE_POLICY_NUM_BYTES,   RBE_POLICY_MIN_VALUE,    RBE_POLICY_MAX_VALUE,    RBE_POLICY_DEFAULT_VALUE},
+    {"RBE DEADBAND ACCEL",      DATA_NUMBER, RBE_DB_ACCEL_NUM_BYTES, RBE_DEADBAND_MIN_VALUE,  RBE_DEADBAND_MAX_VALUE,  RBE_DEADBAND_ACCEL_DEFAULT},
+    {"RBE DEADBAND TEMP",       DATA_NUMBER, RBE_DB_TEMP_NUM_BYTES,  RBE_DEADBAND_MIN_VALUE,  RBE_DEADBAND_MAX_VALUE,  RBE_DEADBAND_TEMP_DEFAULT},
+    {"RBE DEADBAND PRESSURE",   DATA_NUMBER, RBE_DB_PRESS_NUM_BYTES, RBE_DEADBAND_MIN_VALUE,  RBE_DEADBAND_MAX_VALUE,  RBE_DEADBAND_PRESS_DEFAULT}
 };
 
 /**
@@ -136,7 +179,13 @@ static fram_data_t Preset0 =
     PRESET0_DEFAULT_POL_METHOD,
     PRESET0_DEFAULT_ENCRYPT_KEY,
     PRESET0_DEFAULT_TX_POWER,
-    PRESET0_DEFAULT_NAME
+    PRESET0_DEFAULT_NAME,
+    PRESET0_DEFAULT_MIC_LEN,
+    PRESET0_DEFAULT_JITTER_POLICY,
+    PRESET0_DEFAULT_RBE_POLICY,
+    PRESET0_DEFAULT_RBE_DB_ACCEL,
+    PRESET0_DEFAULT_RBE_DB_TEMP,
+    PRESET0_DEFAULT_RBE_DB_PRESS
 };
 
 /**
@@ -156,7 +205,13 @@ static fram_data_t Preset1 =
     PRESET1_DEFAULT_POL_METHOD,
     PRESET1_DEFAULT_ENCRYPT_KEY,
     PRESET1_DEFAULT_TX_POWER,
-    PRESET1_DEFAULT_NAME
+    PRESET1_DEFAULT_NAME,
+    PRESET1_DEFAULT_MIC_LEN,
+    PRESET1_DEFAULT_JITTER_POLICY,
+    PRESET1_DEFAULT_RBE_POLICY,
+    PRESET1_DEFAULT_RBE_DB_ACCEL,
+    PRESET1_DEFAULT_RBE_DB_TEMP,
+    PRESET1_DEFAULT_RBE_DB_PRESS
 };
 
  /**
@@ -176,7 +231,13 @@ static fram_data_t Preset2 =
     PRESET2_DEFAULT_POL_METHOD,
     PRESET2_DEFAULT_ENCRYPT_KEY,
     PRESET2_DEFAULT_TX_POWER,
-    PRESET2_DEFAULT_NAME
+    PRESET2_DEFAULT_NAME,
+    PRESET2_DEFAULT_MIC_LEN,
+    PRESET2_DEFAULT_JITTER_POLICY,
+    PRESET2_DEFAULT_RBE_POLICY,
+    PRESET2_DEFAULT_RBE_DB_ACCEL,
+    PRESET2_DEFAULT_RBE_DB_TEMP,
+    PRESET2_DEFAULT_RBE_DB_PRESS
 };
 
  /**
@@ -196,7 +257,13 @@ static fram_data_t Preset3 =
     PRESET3_DEFAULT_POL_METHOD,
     PRESET3_DEFAULT_ENCRYPT_KEY,
     PRESET3_DEFAULT_TX_POWER,
-    PRESET3_DEFAULT_NAME
+    PRESET3_DEFAULT_NAME,
+    PRESET3_DEFAULT_MIC_LEN,
+    PRESET3_DEFAULT_JITTER_POLICY,
+    PRESET3_DEFAULT_RBE_POLICY,
+    PRESET3_DEFAULT_RBE_DB_ACCEL,
+    PRESET3_DEFAULT_RBE_DB_TEMP,
+    PRESET3_DEFAULT_RBE_DB_PRESS
 };
 
  /**
@@ -216,7 +283,13 @@ static fram_data_t Preset4 =
     PRESET4_DEFAULT_POL_METHOD,
     PRESET4_DEFAULT_ENCRYPT_KEY,
     PRESET4_DEFAULT_TX_POWER,
-    PRESET4_DEFAULT_NAME
+    PRESET4_DEFAULT_NAME,
+    PRESET4_DEFAULT_MIC_LEN,
+    PRESET4_DEFAULT_JITTER_POLICY,
+    PRESET4_DEFAULT_RBE_POLICY,
+    PRESET4_DEFAULT_RBE_DB_ACCEL,
+    PRESET4_DEFAULT_RBE_DB_TEMP,
+    PRESET4_DEFAULT_RBE_DB_PRESS
 };
 
 /**
@@ -273,6 +346,12 @@ void preset_fram_by_type(uint8_t preset_type)
             app_fram_write_field(ENCRYPTED_KEY, (uint8_t*) &Preset0.encrypted_key);
             app_fram_write_field(TX_DBM, (uint8_t*) &Preset0.tx_dbm_10);
             app_fram_write_field(NAME, (uint8_t*) &Preset0.cName);
+            app_fram_write_field(MIC_LEN, (uint8_t*) &Preset0.mic_len);
+            app_fram_write_field(JITTER, (uint8_t*) &Preset0.jitter_policy);
+            app_fram_write_field(RBE_POLICY, (uint8_t*) &Preset0.rbe_policy);
+            app_fram_write_field(RBE_DB_ACCEL, (uint8_t*) &Preset0.rbe_deadband_accel);
+            app_fram_write_field(RBE_DB_TEMP, (uint8_t*) &Preset0.rbe_deadband_temp);
+            app_fram_write_field(RBE_DB_PRESS, (uint8_t*) &Preset0.rbe_deadband_pressure);
             break;
             
         case PRESET_TYPE_BUTTON_1:
@@ -288,6 +367,12 @@ void preset_fram_by_type(uint8_t preset_type)
             app_fram_write_field(ENCRYPTED_KEY, (uint8_t*) &Preset1.encrypted_key);
             app_fram_write_field(TX_DBM, (uint8_t*) &Preset1.tx_dbm_10);
             app_fram_write_field(NAME, (uint8_t*) &Preset1.cName);
+            app_fram_write_field(MIC_LEN, (uint8_t*) &Preset1.mic_len);
+            app_fram_write_field(JITTER, (uint8_t*) &Preset1.jitter_policy);
+            app_fram_write_field(RBE_POLICY, (uint8_t*) &Preset1.rbe_policy);
+            app_fram_write_field(RBE_DB_ACCEL, (uint8_t*) &Preset1.rbe_deadband_accel);
+            app_fram_write_field(RBE_DB_TEMP, (uint8_t*) &Preset1.rbe_deadband_temp);
+            app_fram_write_field(RBE_DB_PRESS, (uint8_t*) &Preset1.rbe_deadband_pressure);
             break;
             
         case PRESET_TYPE_VIB_SENS:
@@ -303,6 +388,12 @@ void preset_fram_by_type(uint8_t preset_type)
             app_fram_write_field(ENCRYPTED_KEY, (uint8_t*) &Preset2.encrypted_key);
             app_fram_write_field(TX_DBM, (uint8_t*) &Preset2.tx_dbm_10);
             app_fram_write_field(NAME, (uint8_t*) &Preset2.cName);
+            app_fram_write_field(MIC_LEN, (uint8_t*) &Preset2.mic_len);
+            app_fram_write_field(JITTER, (uint8_t*) &Preset2.jitter_policy);
+            app_fram_write_field(RBE_POLICY, (uint8_t*) &Preset2.rbe_policy);
+            app_fram_write_field(RBE_DB_ACCEL, (uint8_t*) &Preset2.rbe_deadband_accel);
+            app_fram_write_field(RBE_DB_TEMP, (uint8_t*) &Preset2.rbe_deadband_temp);
+            app_fram_write_field(RBE_DB_PRESS, (uint8_t*) &Preset2.rbe_deadband_pressure);
             break;
             
         case PRESET_TYPE_ON_OFF_SW:
@@ -318,6 +409,12 @@ void preset_fram_by_type(uint8_t preset_type)
             app_fram_write_field(ENCRYPTED_KEY, (uint8_t*) &Preset3.encrypted_key);
             app_fram_write_field(TX_DBM, (uint8_t*) &Preset3.tx_dbm_10);
             app_fram_write_field(NAME, (uint8_t*) &Preset3.cName);
+            app_fram_write_field(MIC_LEN, (uint8_t*) &Preset3.mic_len);
+            app_fram_write_field(JITTER, (uint8_t*) &Preset3.jitter_policy);
+            app_fram_write_field(RBE_POLICY, (uint8_t*) &Preset3.rbe_policy);
+            app_fram_write_field(RBE_DB_ACCEL, (uint8_t*) &Preset3.rbe_deadband_accel);
+            app_fram_write_field(RBE_DB_TEMP, (uint8_t*) &Preset3.rbe_deadband_temp);
+            app_fram_write_field(RBE_DB_PRESS, (uint8_t*) &Preset3.rbe_deadband_pressure);
             break;
             
         case PRESET_TYPE_GENERATOR:
@@ -333,6 +430,12 @@ void preset_fram_by_type(uint8_t preset_type)
             app_fram_write_field(ENCRYPTED_KEY, (uint8_t*) &Preset4.encrypted_key);
             app_fram_write_field(TX_DBM, (uint8_t*) &Preset4.tx_dbm_10);
             app_fram_write_field(NAME, (uint8_t*) &Preset4.cName);
+            app_fram_write_field(MIC_LEN, (uint8_t*) &Preset4.mic_len);
+            app_fram_write_field(JITTER, (uint8_t*) &Preset4.jitter_policy);
+            app_fram_write_field(RBE_POLICY, (uint8_t*) &Preset4.rbe_policy);
+            app_fram_write_field(RBE_DB_ACCEL, (uint8_t*) &Preset4.rbe_deadband_accel);
+            app_fram_write_field(RBE_DB_TEMP, (uint8_t*) &Preset4.rbe_deadband_temp);
+            app_fram_write_field(RBE_DB_PRESS, (uint8_t*) &Preset4.rbe_deadband_pressure);
             break;
         default:
             break; 
@@ -340,36 +443,100 @@ void preset_fram_by_type(uint8_t preset_type)
 }
 
 /**
- * @brief Function to dump content to FRAM
+ * @brief Print the FRAM content held in fram_data
+ * 
+ */
+static void print_fram_data(void)
+{
+    LOG_RAW("%s",">> ------- Reading FRAM Data -------");
+
+    LOG_RAW("FRAM Index [0]->Event Counter: %d", fram_data.event_counter);            
+    LOG_RAW("FRAM Index [1]->Serial Number: %d", fram_data.serial_number);
+    LOG_RAW("FRAM Index [2]->Device Type: %d", fram_data.type);
+    LOG_RAW("FRAM Index [3]->Packet Repeat Interval: %d ms", fram_data.packet_interval);
+    LOG_RAW("FRAM Index [4]->Maximum Packets per Event: %d", fram_data.event_max_packets);
+    LOG_RAW("FRAM Index [5]->Sleep Between Events: %d", fram_data.sleep_between_events);
+    LOG_RAW("FRAM Index [6]->Sleep Before Testing Polarity: %d", fram_data.sleep_after_wake);
+    LOG_RAW("FRAM Index [7]->Reserved Byte: %d", fram_data.u8_voltsISL9122);
+    LOG_RAW("FRAM Index [8]->Reserved Byte: %d", fram_data.u8_POLmethod);
+    LOG_RAW("FRAM Index [9]->Reserved for Programmable Encrypted Key:  %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d", 
+            fram_data.encrypted_key[0], fram_data.encrypted_key[1], fram_data.encrypted_key[2], fram_data.encrypted_key[3], 
+            fram_data.encrypted_key[4], fram_data.encrypted_key[5], fram_data.encrypted_key[6], fram_data.encrypted_key[7], 
+            fram_data.encrypted_key[8], fram_data.encrypted_key[9], fram_data.encrypted_key[10], fram_data.encrypted_key[11], 
+            fram_data.encrypted_key[12], fram_data.encrypted_key[13], fram_data.encrypted_key[14], fram_data.encrypted_key[15]);
+    LOG_RAW("FRAM Index [10]->Reserved for adjustable TX dBm 10: %d", fram_data.tx_dbm_10);
+    LOG_RAW("FRAM Index [11]->cName: %s", fram_data.cName);
+    LOG_RAW("FRAM Index [12]->CCM MIC Length: %d", fram_data.mic_len);
+    LOG_RAW("FRAM Index [13]->Repeat Jitter: %d ms", fram_data.jitter_policy & JITTER_POLICY_MS_MASK);
+    LOG_RAW("FRAM Index [14]->Report by Exception: mode %d, full report every %d events", fram_data.rbe_policy & RBE_POLICY_MODE_MASK,
+            fram_data.rbe_policy >> RBE_POLICY_REFRESH_SHIFT);
+    LOG_RAW("FRAM Index [15]->Deadband Accel: %d", fram_data.rbe_deadband_accel);
+    LOG_RAW("FRAM Index [16]->Deadband Temperature: %d", fram_data.rbe_deadband_temp);
+    LOG_RAW("FRAM Index [17]->Deadband Pressure: %d", fram_data.rbe_deadband_pressure);
+    LOG_RAW("Last Reported Values: %d %d %d %d %d", fram_data.rbe_last_values[0], fram_data.rbe_last_values[1],
+            fram_data.rbe_last_values[2], fram_data.rbe_last_values[3], fram_data.rbe_last_values[4]);
+}
+
+/**
+ * @brief Value of a FRAM field, or its default when it is out of the range of FRAM_INFO
+ * 
+ * @param field_index Index of the field in FRAM_INFO
+ * @param value Value read from the FRAM
+ * @param fallbacks Counter of the fields which got their default
+ * @return uint32_t Value to use
+ */
+static uint32_t check_fram_field_range(uint8_t field_index, uint32_t value, uint8_t *fallbacks)
+{
+    if ((value >= FRAM_INFO[field_index].min_value) && (value <= FRAM_INFO[field_index].max_value))
+    {
+        return value;
+    }
+
+    LOG_WRN("FRAM field [%d] %s is %d, out of range, the default %d is used", field_index,
+            FRAM_INFO[field_index].name, value, FRAM_INFO[field_index].default_value);
+    (*fallbacks)++;
+    return FRAM_INFO[field_index].default_value;
+}
+
+/**
+ * @brief Replace the fields added after the first FRAM layout by their default when they are out of
+ * the range of FRAM_INFO, e.g. the erased 0xFF of a device programmed by an older firmware
+ * 
+ * @param data FRAM data read from the FRAM
+ * @return uint8_t Number of fields which got their default
+ */
+uint8_t check_fram_field_ranges(fram_data_t *data)
+{
+    uint8_t fallbacks = 0;
+
+    data->mic_len = check_fram_field_range(MIC_LEN, data->mic_len, &fallbacks);
+    data->jitter_policy = check_fram_field_range(JITTER, data->jitter_policy, &fallbacks);
+    data->rbe_policy = check_fram_field_range(RBE_POLICY, data->rbe_policy, &fallbacks);
+    data->rbe_deadband_accel = check_fram_field_range(RBE_DB_ACCEL, data->rbe_deadband_accel, &fallbacks);
+    data->rbe_deadband_temp = check_fram_field_range(RBE_DB_TEMP, data->rbe_deadband_temp, &fallbacks);
+    data->rbe_deadband_pressure = check_fram_field_range(RBE_DB_PRESS, data->rbe_deadband_pressure, &fallbacks);
+
+    return fallbacks;
+}
+
+/**
+ * @brief Print the result of a FRAM read
  * 
+ * @param ret Error code of the read
  * @param print Flag to indicate if printing should be done
  * @return int32_t error code
  */
-int32_t dump_fram(uint8_t print)
-{    
-    uint32_t ret = app_fram_read_data(&fram_data);
+static int32_t report_fram_read(int32_t ret, uint8_t print)
+{
+    if(ret == FRAM_SUCCESS)
+    {
+        (void)check_fram_field_ranges(&fram_data);
+    }
+
     if((ret == FRAM_SUCCESS) && print)
-        {
-            // Success! Add it to the payload
-            LOG_RAW("%s",">> ------- Reading FRAM Data -------");
-
-		    LOG_RAW("FRAM Index [0]->Event Counter: %d", fram_data.event_counter);            
-            LOG_RAW("FRAM Index [1]->Serial Number: %d", fram_data.serial_number);
-            LOG_RAW("FRAM Index [2]->Device Type: %d", fram_data.type);
-		    LOG_RAW("FRAM Index [3]->Packet Repeat Interval: %d ms", fram_data.packet_interval);
-		    LOG_RAW("FRAM Index [4]->Maximum Packets per Event: %d", fram_data.event_max_packets);
-		    LOG_RAW("FRAM Index [5]->Sleep Between Events: %d", fram_data.sleep_between_events);
-		    LOG_RAW("FRAM Index [6]->Sleep Before Testing Polarity: %d", fram_data.sleep_after_wake);
-		    LOG_RAW("FRAM Index [7]->Reserved Byte: %d", fram_data.u8_voltsISL9122);
-		    LOG_RAW("FRAM Index [8]->Reserved Byte: %d", fram_data.u8_POLmethod);
-            LOG_RAW("FRAM Index [9]->Reserved for Programmable Encrypted Key:  %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d", 
-                    fram_data.encrypted_key[0], fram_data.encrypted_key[1], fram_data.encrypted_key[2], fram_data.encrypted_key[3], 
-                    fram_data.encrypted_key[4], fram_data.encrypted_key[5], fram_data.encrypted_key[6], fram_data.encrypted_key[7], 
-                    fram_data.encrypted_key[8], fram_data.encrypted_key[9], fram_data.encrypted_key[10], fram_data.encrypted_key[11], 
-                    fram_data.encrypted_key[12], fram_data.encrypted_key[13], fram_data.encrypted_key[14], fram_data.encrypted_key[15]);
-            LOG_RAW("FRAM Index [10]->Reserved for adjustable TX dBm 10: %d", fram_data.tx_dbm_10);
-		    LOG_RAW("FRAM Index [11]->cName: %s", fram_data.cName);
-        }
+    {
+        print_fram_data();
+    }
 
     if (ret != FRAM_SUCCESS) 
     {
@@ -378,6 +545,29 @@ int32_t dump_fram(uint8_t print)
     return ret;
 }
 
+/**
+ * @brief Function to dump content to FRAM
+ * 
+ * @param print Flag to indicate if printing should be done
+ * @return int32_t error code
+ */
+int32_t dump_fram(uint8_t print)
+{    
+    return report_fram_read(app_fram_read_data(&fram_data), print);
+}
+
+/**
+ * @brief Same as dump_fram(), with the FRAM read by a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction set up by app_fram_bulk_read_txn(), done
+ * @param print Flag to indicate if printing should be done
+ * @return int32_t error code
+ */
+int32_t dump_fram_from_txn(const i2c_txn_t *txn, uint8_t print)
+{    
+    return report_fram_read(app_fram_load_bulk_read(txn, &fram_data), print);
+}
+
 /**
  * @brief Handle "get" command from the user
  * 
@@ -748,9 +938,24 @@ void process_command_fn(struct k_work *work)
         LOG_INF( "Running the test command received");
         handle_tests_command(command_data.field_index);
         break;
+    case COMMAND_TYPE_BOOT_TRACE:
+        LOG_INF( "Boot trace: B/b Command Received with sub command %d", command_data.field_index);
+        handle_boot_trace_command(command_data.field_index);
+        break;
+    case COMMAND_TYPE_BURST_HISTORY:
+        LOG_INF( "Burst history: H/h Command Received with sub command %d", command_data.field_index);
+        handle_burst_history_command(command_data.field_index);
+        break;
+    case COMMAND_TYPE_ENERGY_LEDGER:
+        LOG_INF( "Energy ledger: E/e Command Received with sub command %d", command_data.field_index);
+        handle_energy_ledger_command(command_data.field_index);
+        break;
     default:
         break;
     }
+
+    // Every field changed by the command goes to the FRAM in as few writes as possible
+    (void)app_fram_flush();
     
     memset(&command_data,0, sizeof(command_data));
     return;
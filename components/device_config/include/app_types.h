@@ -6,6 +6,11 @@
 #define DATA_SIZE_BYTES 16
 #define EVENT_COUNTER_NUM_BYTES 3
 
+#define VIBRATION_PAGE_SPECTRUM     0x80    // Bit of the vibration odr_code byte, the payload is a we_power_spectrum_data_t
+#define VIBRATION_AXIS_SHIFT        4       // Axis of the spectrum in the odr_code byte, 0 for X, 1 for Y, 2 for Z
+#define SPECTRUM_PAYLOAD_BANDS      3
+#define SPECTRUM_PAYLOAD_PEAKS      3
+
 /**
  * @brief Union for uint32_t and uint8_t * 4.
  * This will be used for FRAM data
@@ -63,6 +68,40 @@ typedef struct
     u16_u8_t id;                                        // ID
 } we_power_data_t;
 
+/**
+ * @brief Vibration monitor data, the features of an accelerometer FIFO capture replace the sample,
+ *        the temperature and the pressure. Peak = rms * crest factor.
+ * 
+ */
+typedef struct 
+{
+	uint8_t type;                                       // Type of the sensor
+    uint8_t event_counter24[EVENT_COUNTER_NUM_BYTES];   // Number of events counter
+    u16_u8_t rms_x;                                     // RMS of X around its mean, m/s^2 * 1000
+    u16_u8_t rms_y;                                     // RMS of Y around its mean, m/s^2 * 1000
+    u16_u8_t rms_z;                                     // RMS of Z around its mean, m/s^2 * 1000
+    uint8_t crest_x;                                    // Crest factor of X, Q4.4
+    uint8_t crest_y;                                    // Crest factor of Y, Q4.4
+    uint8_t crest_z;                                    // Crest factor of Z, Q4.4
+    uint8_t odr_code;                                   // LIS2DW12 ODR code of the capture, VIBRATION_PAGE_SPECTRUM clear
+    u16_u8_t id;                                        // ID
+} we_power_vibration_data_t;
+
+/**
+ * @brief Vibration monitor spectrum, sent instead of the features every other event. The odr_code byte is at the
+ *        same place in both, VIBRATION_PAGE_SPECTRUM tells them apart. Peak frequency = bin * ODR / 32.
+ * 
+ */
+typedef struct 
+{
+	uint8_t type;                                       // Type of the sensor
+    uint8_t event_counter24[EVENT_COUNTER_NUM_BYTES];   // Number of events counter
+    u16_u8_t band_rms[SPECTRUM_PAYLOAD_BANDS];          // RMS of the bands of SPECTRUM_BAND_EDGES_HZ, m/s^2 * 1000
+    uint8_t peak_bin[SPECTRUM_PAYLOAD_PEAKS];           // FFT bins of the strongest peaks, 0 if none
+    uint8_t odr_code;                                   // ODR code | VIBRATION_PAGE_SPECTRUM | axis << VIBRATION_AXIS_SHIFT
+    u16_u8_t id;                                        // ID
+} we_power_spectrum_data_t;
+
 /**
  * @brief Union for sending the we power data over BLE Advertising. 
  * The reason for using the uninon is to make the byte array accessible instead of type casting
@@ -70,6 +109,8 @@ typedef struct
  */
 typedef union {
     we_power_data_t data_fields;
+    we_power_vibration_data_t vibration_fields;
+    we_power_spectrum_data_t spectrum_fields;
     uint8_t data_bytes[DATA_SIZE_BYTES];
 } we_power_data_ble_adv_t;
 
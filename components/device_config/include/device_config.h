@@ -12,6 +12,14 @@
 /**********  TEMP PRESSURE CONFIG  *********/
 #define TPS_DRDY_PIN    DT_GPIO_PIN(DT_NODELABEL(lps_drdy),gpios)
 
+/**********  BOARD GPIO CONFIGURATION  ***********/
+// The GPIO emulator of the simulated board is only ready at CONFIG_GPIO_INIT_PRIORITY of POST_KERNEL
+#if defined(CONFIG_GPIO_EMUL)
+#define BOARD_GPIOS_INIT_PRIORITY   CONFIG_APPLICATION_INIT_PRIORITY
+#else
+#define BOARD_GPIOS_INIT_PRIORITY   0
+#endif
+
 /**********  CONNECTOR CONFIGURATION  ************/
 #define POL_GPIO_PIN    DT_GPIO_PIN(DT_NODELABEL(polarity),gpios)
 #define CN1_4_PIN       DT_GPIO_PIN(DT_NODELABEL(connector4),gpios)
@@ -33,20 +41,118 @@
 #define PAYLOAD_STATUS_BYTE_INDEX       20      // 0 if encrypted, 1 if AES128, 2... RFU
 #define PAYLOAD_ENCRYPTION_STATUS_ENC   0
 #define PAYLOAD_ENCRYPTION_STATUS_CLEAR 1
-#define PAYLOAD_DATA_SIZE_BYTES         16
+#define PAYLOAD_ENCRYPTION_STATUS_CTR   2     // AES-CTR, event counter bytes left in clear
+#define PAYLOAD_CIPHER_ECB              0     // Payload is one AES-ECB block
+#define PAYLOAD_CIPHER_CTR              1     // Payload is XORed with AES(serial | event counter), keystream computed between events
+#define PAYLOAD_CIPHER_MODE             PAYLOAD_CIPHER_ECB
 #define PAYLOAD_TX_REPEAT_COUNTER_INDEX 21
 #define PAYLOAD_DATA_START_INDEX        2
 #define PAYLOAD_FRAME_LENGTH            22
 #define PAYLOAD_SERIAL_NUMBER_SIZE      2     
+#define USE_PREBUILT_FIRST_FRAME        1     // Button and two-way switch send the first packet built by the previous event
+#define PAYLOAD_ENCRYPTION_STATUS_CCM   3     // AES-CCM when fram_data.mic_len is set, 32 bit event counter and MIC follow the frame
+#define PAYLOAD_CCM_COUNTER_INDEX       PAYLOAD_FRAME_LENGTH
+#define PAYLOAD_CCM_COUNTER_SIZE        4
+#define PAYLOAD_CCM_MIC_INDEX           (PAYLOAD_CCM_COUNTER_INDEX + PAYLOAD_CCM_COUNTER_SIZE)
+#define PAYLOAD_CCM_MIC_MAX_LENGTH      16
+#define PAYLOAD_FRAME_MAX_LENGTH        (PAYLOAD_CCM_MIC_INDEX + PAYLOAD_CCM_MIC_MAX_LENGTH)
+#define PAYLOAD_DATA_SIZE_BYTES         16
 
 
 /******** TX REPEAT COUNTER CONFIG ***************/
 #define TX_REPEAT_COUNTER_DEFAULT_VALUE     1
 
 /******** BLUETOOTH CONFIG ***********************/
-#define BLE_ADV_INTERVAL_MIN            (32) // N * 0.625. corresponds to dec. 32; 32*0.625 = 20ms
-#define BLE_ADV_INTERVAL_MAX            (36) // N * 0.625. corresponds to dec. 36; 36*0.625 = 22.5ms
+#define USE_CONTROLLER_BURST            1    // 1: controller sends the whole event burst, 0: host re-arms advertising on every k_timer tick
+#define BLE_ADV_INTERVAL_UNIT_US        (625) // Advertising interval unit, N * 0.625ms
+#define BLE_ADV_INTERVAL_MIN_UNITS      (32) // 32*0.625 = 20ms, lowest interval accepted for the advertising set
+#define BLE_ADV_INTERVAL_SPREAD_UNITS   (4)  // max interval is min + 4*0.625 = 2.5ms, same spread as the old 20ms/22.5ms pair
+#define BLE_ADV_MS_TO_INTERVAL(ms)      ((((uint32_t)(ms)) * 1000U) / BLE_ADV_INTERVAL_UNIT_US)
 #define BLE_ADV_TIMEOUT                 (0)  // N * 10ms for advertiser timeout
-#define BLE_ADV_EVENTS                  (1)
+#define BLE_ADV_EVENTS                  (1)  // advertising events per start when the host re-arms every packet
+#define BLE_ADV_BURST_CHUNK_EVENTS      (10) // advertising events per controller burst, the repeat counter is the number of the first packet of the chunk
+#define USE_ASYNC_BT_ENABLE             1    // 1: bt_enable runs while the I2C devices are serviced, 0: bt_enable after them
+#define BT_READY_TIMEOUT_MSEC           (500) // Maximum wait for the asynchronous bt_enable
+
+/******** SENSOR SCHEDULER CONFIG ****************/
+#define SENSOR_ACCEL_CONVERSION_USEC            (2500)  // LIS2DW12 on demand conversion at 400 Hz
+#define SENSOR_TEMP_PRESSURE_CONVERSION_USEC    (6000)  // LPS22 one shot conversion
+#define SENSOR_DRDY_MARGIN_USEC                 (10000) // DRDY deadline after the expected conversion time
+#define USE_I2C_BOOT_CHAIN                      1       // Sensor config and trigger, and the FRAM read, are I2C queue chains at boot
+
+/******** ACCEL FIFO CAPTURE CONFIG **************/
+#define USE_ACCEL_FIFO_CAPTURE                  1       // Vibration monitor sends the features of a FIFO capture instead of one sample
+#define ACCEL_FIFO_ODR_CODE                     (7)     // LIS2DW12 ODR of the capture: 3=25 Hz 4=50 Hz 5=100 Hz 6=200 Hz 7=400 Hz 8=800 Hz 9=1600 Hz
+#define ACCEL_FIFO_ODR_HZ                       (25U << (ACCEL_FIFO_ODR_CODE - 3))
+#define ACCEL_FIFO_CAPTURE_SAMPLES              (32)    // Samples of one capture, the FIFO depth
+
+/******** ACCEL SPECTRUM CONFIG *******************/
+#define USE_ACCEL_SPECTRUM                      USE_ACCEL_FIFO_CAPTURE  // Every other vibration payload carries the spectrum of the capture, see app_accel_features.c
+#define SPECTRUM_BAND_EDGES_HZ                  {10, 50, 100, 250}      // Band b holds the bins from edge b to edge b + 1 excluded, SPECTRUM_PAYLOAD_BANDS + 1 edges
+
+/******** BOOT TRACE CONFIG ***********************/
+#define USE_BOOT_TRACE                  1    // Timestamp the boot stages and keep the last boots in FRAM
+#define BOOT_TRACE_RING_SIZE            (8)  // Number of boots kept in the FRAM ring
+
+/******** VBULK MEASUREMENT CONFIG ****************/
+#if defined(CONFIG_ADC)
+#define USE_VBULK_ADC                   1    // VBULK is measured by the SAADC channel@1, see app_vbulk.c
+#else
+#define USE_VBULK_ADC                   0    // No SAADC, VBULK reads as unknown
+#endif
+#define VBULK_DIVIDER_NUM               (93) // VBULK = pin * 93 / 40, the 0.8V COMP threshold is the 1.86V brown-out
+#define VBULK_DIVIDER_DEN               (40)
+#define VBULK_BROWN_OUT_MV              (1860) // UVLO of the supply, the board dies below it
+#define VBULK_CAPACITANCE_UF            (100)  // Storage capacitor on VBULK, the stored energy is C/2 * VBULK^2
+
+/******** ENERGY ADAPTIVE BURST CONFIG ************/
+#define USE_ENERGY_ADAPTIVE_BURST       USE_VBULK_ADC // Burst length follows VBULK, see app_energy_burst.c
+#define VBULK_STOP_MARGIN_MV            (100)  // The burst stops this far above the brown-out
+#define ENERGY_BURST_MAX_PACKETS        (254)  // Longest single event, the repeat counter is one byte
+#define ENERGY_BURST_RESERVE_PACKETS    (2)    // Packets of energy kept for the history write and the estimate error
+#define ENERGY_BURST_PROBE_PACKETS      (2)    // Packets sent before the first VBULK measurement of the event
+#define ENERGY_BURST_HISTORY_SIZE       (16)   // Number of events kept in the FRAM ring
+
+/******** REPORT BY EXCEPTION CONFIG *************/
+#define USE_REPORT_BY_EXCEPTION         1    // Sensor events within the FRAM deadbands send a heartbeat or nothing, never a button press, see app_report_by_exception.c
+
+/******** ENERGY LEDGER CONFIG ********************/
+#define USE_ENERGY_LEDGER               1    // Energy of every event per stage in FRAM, see app_energy_ledger.c
+#define ENERGY_LEDGER_RING_SIZE         (8)  // Number of events kept in the FRAM ring
+// Cost model in nJ, for a 3V supply. Radio TX from the nRF52840 TX current at 0, +4 and +8 dBm.
+#define ENERGY_COST_I2C_BYTE_NJ         (70)    // 22.5us of TWIM and device current per byte at 400 kHz
+#define ENERGY_COST_AES_BLOCK_NJ        (60)    // Controller ECB, a TinyCrypt block is CPU time
+#define ENERGY_COST_CPU_US_NJ           (10)    // 3.3mA of the CPU running from flash
+#define ENERGY_COST_GPIO_TOGGLE_NJ      (1)     // Trace pin and the load of the test point
+#define ENERGY_RADIO_SUPPLY_MV          (3000)
+#define ENERGY_RADIO_TX_0DBM_UA         (4800)
+#define ENERGY_RADIO_TX_4DBM_UA         (9600)
+#define ENERGY_RADIO_TX_8DBM_UA         (14800)
+#define ENERGY_RADIO_RAMP_US            (140)   // Radio ramp up before each PDU
+#define ENERGY_RADIO_EXT_IND_BYTES      (17)    // ADV_EXT_IND on each primary channel, 1M: preamble, access address, header, ADI, AuxPtr and CRC, no AD data
+#define ENERGY_RADIO_AUX_FRAME_BYTES    (20)    // AUX_ADV_IND around the AD data, 1M: preamble, access address, header, AdvA, ADI and CRC
+
+/******** PERIODIC STREAM CONFIG ******************/
+#if defined(CONFIG_BT_PER_ADV)
+#define USE_PERIODIC_STREAM             1    // Vibration monitor streams accelerometer frames after its burst, see app_stream.c
+#else
+#define USE_PERIODIC_STREAM             0
+#endif
+#define BLE_PER_ADV_INTERVAL_UNIT_US    (1250) // Periodic advertising interval unit, N * 1.25ms
+#define BLE_PER_ADV_MS_TO_INTERVAL(ms)  ((((uint32_t)(ms)) * 1000U) / BLE_PER_ADV_INTERVAL_UNIT_US)
+#define STREAM_PER_ADV_INTERVAL_MS      (100)  // One frame per periodic advertising event
+#define STREAM_EXT_ADV_INTERVAL_MS      (1000) // Extended advertising carrying the sync info while streaming
+#define STREAM_SAMPLES_PER_FRAME        (32)   // Accelerometer samples of one frame, one FIFO capture, 6 bytes each
+#define STREAM_MIC_LENGTH               (4)    // MIC of the stream frames when fram_data.mic_len is not a CCM length
+#define STREAM_VBULK_START_MV           (2700) // The harvest has to hold VBULK this high after the burst to start a stream
+#define STREAM_VBULK_STOP_MV            (2300) // The stream stops once VBULK falls below this
+#define STREAM_FRAMES_WITHOUT_VBULK     (16)   // Length of a stream when VBULK can not be measured
+
+/******** SIMULATION BENCHMARK CONFIG *************/
+#if defined(CONFIG_ARCH_POSIX) && defined(CONFIG_I2C_EMUL)
+#define USE_SIM_BENCH                   1    // -wepower_bench prints the event metrics and ends the run, see scripts/sim_bench
+#else
+#define USE_SIM_BENCH                   0
+#endif
 
 #endif // __DEVICE_CONFIG__
@@ -2,6 +2,28 @@
 #define __ENCRYPT__
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/device.h>
+
+// The Bluetooth controller owns the ECB peripheral, the payload reaches it through bt_encrypt_le()
+#if defined(CONFIG_CRYPTO_MBEDTLS_SHIM)
+#include <zephyr/crypto/crypto.h>
+#define ENCRYPT_USE_CRYPTO_DRIVER   1       // Zephyr crypto API, mbedTLS shim
+#define ENCRYPT_USE_BT_ECB          0
+#define ENCRYPT_BACKEND_NAME        "mbedTLS shim"
+#elif defined(CONFIG_TINYCRYPT_AES)
+#include <tinycrypt/aes.h>
+#define ENCRYPT_USE_CRYPTO_DRIVER   0       // TinyCrypt software AES
+#define ENCRYPT_USE_BT_ECB          0
+#define ENCRYPT_BACKEND_NAME        "TinyCrypt"
+#elif defined(CONFIG_BT)
+#include <zephyr/bluetooth/crypto.h>
+#define ENCRYPT_USE_CRYPTO_DRIVER   0
+#define ENCRYPT_USE_BT_ECB          1       // ECB peripheral shared with the controller, CONFIG_BT_CTLR_CRYPTO
+#define ENCRYPT_BACKEND_NAME        "Bluetooth controller ECB"
+#else
+#error "No AES backend, enable CONFIG_BT or CONFIG_TINYCRYPT_AES"
+#endif
 
 #define ENCRYPTED_KEY_SIZE 16
 
@@ -10,9 +32,78 @@ extern uint8_t ecb_key[ENCRYPTED_KEY_SIZE];
 #define ENCRYPTION_ERROR -1
 #define ENCRYPTION_SUCCESS 0
 
+/**
+ * @brief Encryption context, holds an open AES-ECB session of the selected backend
+ * 
+ */
+typedef struct
+{
+#if (ENCRYPT_USE_CRYPTO_DRIVER)
+    const struct device *dev;       // Crypto device the session is opened on
+    struct cipher_ctx    cipher;    // Session, key schedule included
+#elif (ENCRYPT_USE_BT_ECB)
+    uint8_t key_le[16];             // Key least significant byte first, as bt_encrypt_le() takes it
+#else
+    struct tc_aes_key_sched_struct key_schedule;   // Expanded key
+#endif
+    bool                 is_ready;  // true while the session is open
+} encrypt_ctx_t;
+
+/**
+ * @brief Open an AES-ECB encryption session on a context with the given key
+ * 
+ * @param ctx   Context to initialize, freed first if it already holds a session
+ * @param key   AES-128 key, ENCRYPTED_KEY_SIZE bytes. Must stay valid while the session is open.
+ * @return int  error code
+ */
+int app_encrypt_ctx_init(encrypt_ctx_t *ctx, uint8_t *key);
+
+/**
+ * @brief Close the session held by a context
+ * 
+ * @param ctx   Context to free, nothing is done if it holds no session
+ */
+void app_encrypt_ctx_free(encrypt_ctx_t *ctx);
+
+/**
+ * @brief Encrypt one block with an open context
+ * 
+ * @param ctx           Context opened by app_encrypt_ctx_init()
+ * @param cleartext     Un-encrypted text
+ * @param cleartext_len Un-encrypted text length 
+ * @param encrypted     Encrypted text
+ * @param encrypted_len Encrypted text length
+ * @return int  error code 
+ */
+int app_encrypt_ctx_block(encrypt_ctx_t *ctx, uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len);
+
+/**
+ * @brief Get the number of blocks encrypted since boot, by every context
+ * 
+ * @return uint32_t  Number of AES blocks
+ */
+uint32_t app_encrypt_get_block_count(void);
+
+/**
+ * @brief Open the payload encryption session with ecb_key. Call again whenever ecb_key changes.
+ * 
+ * @return int  error code 
+ */
+int app_encrypt_init(void);
+
+/**
+ * @brief Close the payload encryption session
+ * 
+ * @note The next payload encryption opens the session again
+ * 
+ */
+void app_encrypt_deinit(void);
+
 /**
  * @brief Encrypt the input text into encrypted text
  * 
+ * @note Uses the session opened by app_encrypt_init(), opened on first use otherwise
+ * 
  * @param cleartext     Un-encrypted text
  * @param cleartext_len Un-encrypted text length 
  * @param encrypted     Encrypted text
@@ -21,5 +112,38 @@ extern uint8_t ecb_key[ENCRYPTED_KEY_SIZE];
  */
 int app_encrypt_payload(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len);
 
+/**
+ * @brief Encrypt the input text with a session opened and freed for this call only
+ * 
+ * @note Former per-packet path, kept to benchmark against app_encrypt_payload()
+ * 
+ * @param cleartext     Un-encrypted text
+ * @param cleartext_len Un-encrypted text length 
+ * @param encrypted     Encrypted text
+ * @param encrypted_len Encrypted text length
+ * @return int  error code 
+ */
+int app_encrypt_payload_oneshot(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len);
+
+/**
+ * @brief Encrypt and authenticate with AES-CCM (RFC 3610), built on the payload ECB session
+ * 
+ * @note The MIC covers the associated data and the clear text. Message and associated data are
+ *       limited to 255 bytes, which is plenty for an advertising payload.
+ * 
+ * @param nonce         Nonce, unique for every message sent with the key
+ * @param nonce_len     Nonce length, 7 to 13 bytes
+ * @param aad           Associated data, authenticated but sent in clear
+ * @param aad_len       Associated data length, 0 if there is none
+ * @param cleartext     Un-encrypted text
+ * @param encrypted     Encrypted text, same length as the clear text
+ * @param len           Length of the text to encrypt
+ * @param mic           Buffer for the message integrity code
+ * @param mic_len       MIC length, even from 4 to 16 bytes
+ * @return int  error code 
+ */
+int app_encrypt_payload_ccm(const uint8_t *nonce, uint8_t nonce_len, const uint8_t *aad, uint8_t aad_len,
+                            uint8_t *cleartext, uint8_t *encrypted, uint8_t len, uint8_t *mic, uint8_t mic_len);
+
 
 #endif // __ENCRYPT__
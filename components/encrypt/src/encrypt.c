@@ -4,13 +4,19 @@
 #include <zephyr/kernel.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/logging/log.h>
-#include <zephyr/crypto/crypto.h>
+
+#if (ENCRYPT_USE_BT_ECB)
+#include <zephyr/sys/byteorder.h>
+#elif !(ENCRYPT_USE_CRYPTO_DRIVER)
+#include <tinycrypt/constants.h>
+#endif
 
 #include "device_config.h"
 #include "app_types.h"
 
+#if defined(CONFIG_CRYPTO_MBEDTLS_SHIM)
 #define CRYPTO_DRV_NAME CONFIG_CRYPTO_MBEDTLS_SHIM_DRV_NAME
-#define CRYPTO_DEV_COMPAT nordic_nrf_ecb
+#endif
 
 LOG_MODULE_DECLARE(wepower);
 
@@ -24,6 +30,30 @@ uint8_t ecb_key[ENCRYPTED_KEY_SIZE] = {
 	0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
 };
 
+// Session used for the payload, kept open for the lifetime of the boot
+static encrypt_ctx_t payload_ctx;
+
+// Blocks encrypted since boot, read by the benchmarks
+static uint32_t encrypted_block_count = 0;
+
+#define CCM_BLOCK_SIZE          16
+#define CCM_NONCE_MIN_LENGTH    7
+#define CCM_NONCE_MAX_LENGTH    13
+#define CCM_MIC_MIN_LENGTH      4
+#define CCM_MIC_MAX_LENGTH      16
+#define CCM_AAD_LENGTH_SIZE     2
+
+#if (ENCRYPT_USE_CRYPTO_DRIVER)
+/**
+ * @brief Get the crypto device of the selected backend
+ * 
+ * @return const struct device* Crypto device, NULL if not available
+ */
+static const struct device *get_crypto_device(void)
+{
+	return device_get_binding(CRYPTO_DRV_NAME);
+}
+
 /**
  * @brief Routine used to query hardware caps and check for compatibility
  * 
@@ -58,40 +88,97 @@ static int8_t validate_hw_compatibility(const struct device *dev)
 	}
 	return ENCRYPTION_SUCCESS;
 }
+#endif // ENCRYPT_USE_CRYPTO_DRIVER
 
 /**
- * @brief Encrypt the input text into encrypted text
+ * @brief Open an AES-ECB encryption session on a context with the given key
  * 
- * @param cleartext     Un-encrypted text
- * @param cleartext_len Un-encrypted text length 
- * @param encrypted     Encrypted text
- * @param encrypted_len Encrypted text length
- * @return int 			error code
- **/
-int app_encrypt_payload(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len)
+ * @param ctx 		Context to initialize, freed first if it already holds a session
+ * @param key 		AES-128 key, ENCRYPTED_KEY_SIZE bytes. Must stay valid while the session is open.
+ * @return int 		error code
+ */
+int app_encrypt_ctx_init(encrypt_ctx_t *ctx, uint8_t *key)
 {
-    const struct device *dev_crypto = device_get_binding(CRYPTO_DRV_NAME);
+	app_encrypt_ctx_free(ctx);
 
-	if (!dev_crypto) 
+#if (ENCRYPT_USE_CRYPTO_DRIVER)
+	ctx->dev = get_crypto_device();
+	if (!ctx->dev) 
 	{
-		LOG_ERR("%s crypto device not found", CRYPTO_DRV_NAME);
+		LOG_ERR("%s crypto device not found", ENCRYPT_BACKEND_NAME);
 		return ENCRYPTION_ERROR;
 	}
 
-    if (validate_hw_compatibility(dev_crypto)) 
+	if (validate_hw_compatibility(ctx->dev)) 
 	{
 		LOG_ERR("Hardware compatibility check failed");
 		return ENCRYPTION_ERROR;
 	}
 
-    LOG_INF("Crypto initialization successful");
+	memset(&ctx->cipher, 0, sizeof(ctx->cipher));
+	ctx->cipher.keylen = ENCRYPTED_KEY_SIZE;
+	ctx->cipher.key.bit_stream = key;
+	ctx->cipher.flags = CAP_RAW_KEY | CAP_SYNC_OPS | CAP_SEPARATE_IO_BUFS;
+
+	if (cipher_begin_session(ctx->dev, &ctx->cipher, CRYPTO_CIPHER_ALGO_AES,
+				 CRYPTO_CIPHER_MODE_ECB,
+				 CRYPTO_CIPHER_OP_ENCRYPT) != 0)
+	{
+		LOG_ERR("Failed to open the crypto session");
+		return ENCRYPTION_ERROR;
+	}
+#elif (ENCRYPT_USE_BT_ECB)
+	sys_memcpy_swap(ctx->key_le, key, sizeof(ctx->key_le));
+#else
+	if (tc_aes128_set_encrypt_key(&ctx->key_schedule, key) != TC_CRYPTO_SUCCESS)
+	{
+		LOG_ERR("Failed to expand the AES key");
+		return ENCRYPTION_ERROR;
+	}
+#endif
+
+	ctx->is_ready = true;
+	return ENCRYPTION_SUCCESS;
+}
 
-	struct cipher_ctx init_context =
+/**
+ * @brief Close the session held by a context
+ * 
+ * @param ctx 		Context to free, nothing is done if it holds no session
+ */
+void app_encrypt_ctx_free(encrypt_ctx_t *ctx)
+{
+	if (ctx->is_ready)
 	{
-		.keylen = sizeof(ecb_key),
-		.key.bit_stream = ecb_key,
-		.flags = CAP_RAW_KEY | CAP_SYNC_OPS | CAP_SEPARATE_IO_BUFS,
-	};
+#if (ENCRYPT_USE_CRYPTO_DRIVER)
+		cipher_free_session(ctx->dev, &ctx->cipher);
+#elif (ENCRYPT_USE_BT_ECB)
+		memset(ctx->key_le, 0, sizeof(ctx->key_le));
+#else
+		memset(&ctx->key_schedule, 0, sizeof(ctx->key_schedule));
+#endif
+		ctx->is_ready = false;
+	}
+}
+
+/**
+ * @brief Encrypt one block with an open context
+ * 
+ * @param ctx           Context opened by app_encrypt_ctx_init()
+ * @param cleartext     Un-encrypted text
+ * @param cleartext_len Un-encrypted text length 
+ * @param encrypted     Encrypted text
+ * @param encrypted_len Encrypted text length
+ * @return int 			error code
+ */
+int app_encrypt_ctx_block(encrypt_ctx_t *ctx, uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len)
+{
+	if (!ctx->is_ready)
+	{
+		return ENCRYPTION_ERROR;
+	}
+
+#if (ENCRYPT_USE_CRYPTO_DRIVER)
 	struct cipher_pkt encrypt_pkt = 
 	{
 		.in_buf = cleartext,
@@ -100,33 +187,245 @@ int app_encrypt_payload(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encr
 		.out_buf = encrypted,
 	};
 
-    if (cipher_begin_session(dev_crypto, &init_context, CRYPTO_CIPHER_ALGO_AES,
-				 CRYPTO_CIPHER_MODE_ECB,
-				 CRYPTO_CIPHER_OP_ENCRYPT) != 0)
+	if (cipher_block_op(&ctx->cipher, &encrypt_pkt)) 
+	{
+		LOG_ERR("ERROR: ECB mode ENCRYPT - Failed\n");
+		return ENCRYPTION_ERROR;
+	}
+#elif (ENCRYPT_USE_BT_ECB)
+	// The controller schedules the block between its own ECB uses. The payload is standard AES byte order, bt_encrypt_le() is not.
+	uint8_t cleartext_le[ENCRYPTED_KEY_SIZE];
+	uint8_t encrypted_le[ENCRYPTED_KEY_SIZE];
+
+	if ((cleartext_len != ENCRYPTED_KEY_SIZE) || (encrypted_len < ENCRYPTED_KEY_SIZE))
 	{
+		LOG_ERR("ERROR: ECB mode ENCRYPT - Failed\n");
 		return ENCRYPTION_ERROR;
 	}
 
-	if (cipher_block_op(&init_context, &encrypt_pkt)) 
+	sys_memcpy_swap(cleartext_le, cleartext, ENCRYPTED_KEY_SIZE);
+	if (bt_encrypt_le(ctx->key_le, cleartext_le, encrypted_le))
 	{
 		LOG_ERR("ERROR: ECB mode ENCRYPT - Failed\n");
-		goto out;
+		return ENCRYPTION_ERROR;
+	}
+	sys_memcpy_swap(encrypted, encrypted_le, ENCRYPTED_KEY_SIZE);
+#else
+	if ((cleartext_len != TC_AES_BLOCK_SIZE) || (encrypted_len < TC_AES_BLOCK_SIZE) ||
+	    (tc_aes_encrypt(encrypted, cleartext, &ctx->key_schedule) != TC_CRYPTO_SUCCESS))
+	{
+		LOG_ERR("ERROR: ECB mode ENCRYPT - Failed\n");
+		return ENCRYPTION_ERROR;
+	}
+#endif
+
+	encrypted_block_count++;
+
+	return ENCRYPTION_SUCCESS;
+}
+
+/**
+ * @brief Get the number of blocks encrypted since boot, by every context
+ * 
+ * @return uint32_t 	Number of AES blocks
+ */
+uint32_t app_encrypt_get_block_count(void)
+{
+	return encrypted_block_count;
+}
+
+/**
+ * @brief Open the payload encryption session with ecb_key. Call again whenever ecb_key changes.
+ * 
+ * @return int 			error code
+ */
+int app_encrypt_init(void)
+{
+	return app_encrypt_ctx_init(&payload_ctx, ecb_key);
+}
+
+/**
+ * @brief Close the payload encryption session
+ * 
+ * @note The next payload encryption opens the session again
+ * 
+ */
+void app_encrypt_deinit(void)
+{
+	app_encrypt_ctx_free(&payload_ctx);
+}
+
+/**
+ * @brief Encrypt the input text into encrypted text
+ * 
+ * @note Uses the session opened by app_encrypt_init(), opened here on first use otherwise
+ * 
+ * @param cleartext     Un-encrypted text
+ * @param cleartext_len Un-encrypted text length 
+ * @param encrypted     Encrypted text
+ * @param encrypted_len Encrypted text length
+ * @return int 			error code
+ **/
+int app_encrypt_payload(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len)
+{
+	if (!payload_ctx.is_ready && (app_encrypt_init() != ENCRYPTION_SUCCESS))
+	{
+		return ENCRYPTION_ERROR;
 	}
 
-    LOG_INF("Output length (encryption): %d\n", encrypt_pkt.out_len);
+	return app_encrypt_ctx_block(&payload_ctx, cleartext, cleartext_len, encrypted, encrypted_len);
+}
 
-	if (memcmp(encrypt_pkt.out_buf, encrypted, encrypted_len)) 
+/**
+ * @brief Encrypt the input text with a session opened and freed for this call only
+ * 
+ * @note Former per-packet path, kept to benchmark against app_encrypt_payload()
+ * 
+ * @param cleartext     Un-encrypted text
+ * @param cleartext_len Un-encrypted text length 
+ * @param encrypted     Encrypted text
+ * @param encrypted_len Encrypted text length
+ * @return int 			error code
+ **/
+int app_encrypt_payload_oneshot(uint8_t *cleartext, uint8_t cleartext_len, uint8_t *encrypted, uint8_t encrypted_len)
+{
+	encrypt_ctx_t oneshot_ctx = {0};
+	int ret;
+
+	if (app_encrypt_ctx_init(&oneshot_ctx, ecb_key) != ENCRYPTION_SUCCESS)
 	{
-		LOG_ERR("ERROR: ECB mode ENCRYPT - Mismatch between expected and "
-			    "returned cipher text\n");
-		goto out;
+		return ENCRYPTION_ERROR;
 	}
 
-	LOG_INF("ECB mode ENCRYPT - Match\n");
-    cipher_free_session(dev_crypto, &init_context);
-    return ENCRYPTION_SUCCESS;
+	ret = app_encrypt_ctx_block(&oneshot_ctx, cleartext, cleartext_len, encrypted, encrypted_len);
+	app_encrypt_ctx_free(&oneshot_ctx);
+
+	return ret;
+}
 
-out:
-	cipher_free_session(dev_crypto, &init_context);
-    return ENCRYPTION_ERROR;
-}
\ No newline at end of file
+/**
+ * @brief Fold one block into the CCM CBC-MAC
+ * 
+ * @param mac 			Running MAC, updated in place
+ * @param block 		Block to authenticate, zero padded
+ * @return int 			error code
+ */
+static int ccm_mac_block(uint8_t *mac, const uint8_t *block)
+{
+	uint8_t chained[CCM_BLOCK_SIZE];
+
+	for (uint8_t i = 0; i < CCM_BLOCK_SIZE; i++)
+	{
+		chained[i] = mac[i] ^ block[i];
+	}
+
+	return app_encrypt_payload(chained, CCM_BLOCK_SIZE, mac, CCM_BLOCK_SIZE);
+}
+
+/**
+ * @brief Encrypt and authenticate with AES-CCM (RFC 3610), built on the payload ECB session
+ * 
+ * @note The MIC covers the associated data and the clear text. Message and associated data are
+ *       limited to 255 bytes, which is plenty for an advertising payload.
+ * 
+ * @param nonce 		Nonce, unique for every message sent with the key
+ * @param nonce_len 	Nonce length, 7 to 13 bytes
+ * @param aad 			Associated data, authenticated but sent in clear
+ * @param aad_len 		Associated data length, 0 if there is none
+ * @param cleartext 	Un-encrypted text
+ * @param encrypted 	Encrypted text, same length as the clear text
+ * @param len 			Length of the text to encrypt
+ * @param mic 			Buffer for the message integrity code
+ * @param mic_len 		MIC length, even from 4 to 16 bytes
+ * @return int 			error code
+ */
+int app_encrypt_payload_ccm(const uint8_t *nonce, uint8_t nonce_len, const uint8_t *aad, uint8_t aad_len,
+							uint8_t *cleartext, uint8_t *encrypted, uint8_t len, uint8_t *mic, uint8_t mic_len)
+{
+	uint8_t block[CCM_BLOCK_SIZE];
+	uint8_t mac[CCM_BLOCK_SIZE];
+	uint8_t keystream[CCM_BLOCK_SIZE];
+	uint8_t length_field_size = CCM_BLOCK_SIZE - 1 - nonce_len;
+	uint8_t block_pos;
+	uint8_t chunk;
+
+	if ((nonce_len < CCM_NONCE_MIN_LENGTH) || (nonce_len > CCM_NONCE_MAX_LENGTH) ||
+		(mic_len < CCM_MIC_MIN_LENGTH) || (mic_len > CCM_MIC_MAX_LENGTH) || (mic_len & 0x01))
+	{
+		LOG_ERR("Invalid CCM nonce length %d or MIC length %d", nonce_len, mic_len);
+		return ENCRYPTION_ERROR;
+	}
+
+	// B0: flags | nonce | message length, the length fits the last byte
+	memset(block, 0, sizeof(block));
+	block[0] = ((aad_len > 0) ? 0x40 : 0x00) | (((mic_len - 2) / 2) << 3) | (length_field_size - 1);
+	memcpy(&block[1], nonce, nonce_len);
+	block[CCM_BLOCK_SIZE - 1] = len;
+	if (app_encrypt_payload(block, CCM_BLOCK_SIZE, mac, CCM_BLOCK_SIZE) != ENCRYPTION_SUCCESS)
+	{
+		return ENCRYPTION_ERROR;
+	}
+
+	// Associated data, prefixed with its 16 bit length
+	if (aad_len > 0)
+	{
+		memset(block, 0, sizeof(block));
+		block[1] = aad_len;
+		block_pos = CCM_AAD_LENGTH_SIZE;
+		for (uint8_t offset = 0; offset < aad_len; offset += chunk)
+		{
+			chunk = MIN(aad_len - offset, CCM_BLOCK_SIZE - block_pos);
+			memcpy(&block[block_pos], &aad[offset], chunk);
+			if (ccm_mac_block(mac, block) != ENCRYPTION_SUCCESS)
+			{
+				return ENCRYPTION_ERROR;
+			}
+			memset(block, 0, sizeof(block));
+			block_pos = 0;
+		}
+	}
+
+	for (uint16_t offset = 0; offset < len; offset += CCM_BLOCK_SIZE)
+	{
+		chunk = MIN(len - offset, CCM_BLOCK_SIZE);
+		memset(block, 0, sizeof(block));
+		memcpy(block, &cleartext[offset], chunk);
+		if (ccm_mac_block(mac, block) != ENCRYPTION_SUCCESS)
+		{
+			return ENCRYPTION_ERROR;
+		}
+	}
+
+	// Counter blocks A_i: flags | nonce | i, A_0 encrypts the MIC
+	memset(block, 0, sizeof(block));
+	block[0] = length_field_size - 1;
+	memcpy(&block[1], nonce, nonce_len);
+
+	for (uint16_t offset = 0; offset < len; offset += CCM_BLOCK_SIZE)
+	{
+		block[CCM_BLOCK_SIZE - 1] = (uint8_t)((offset / CCM_BLOCK_SIZE) + 1);
+		if (app_encrypt_payload(block, CCM_BLOCK_SIZE, keystream, CCM_BLOCK_SIZE) != ENCRYPTION_SUCCESS)
+		{
+			return ENCRYPTION_ERROR;
+		}
+
+		chunk = MIN(len - offset, CCM_BLOCK_SIZE);
+		for (uint8_t i = 0; i < chunk; i++)
+		{
+			encrypted[offset + i] = cleartext[offset + i] ^ keystream[i];
+		}
+	}
+
+	block[CCM_BLOCK_SIZE - 1] = 0;
+	if (app_encrypt_payload(block, CCM_BLOCK_SIZE, keystream, CCM_BLOCK_SIZE) != ENCRYPTION_SUCCESS)
+	{
+		return ENCRYPTION_ERROR;
+	}
+
+	for (uint8_t i = 0; i < mic_len; i++)
+	{
+		mic[i] = mac[i] ^ keystream[i];
+	}
+
+	return ENCRYPTION_SUCCESS;
+}
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "i2c_queue.h"
+
 #define FRAM_ERROR  -1              // FRAM Error Code
 #define FRAM_SUCCESS 0              // FRAM Success Code
 
@@ -30,6 +32,28 @@
 #define TX_DBM_NUM_BYTES			(1)
 #define NAME_ADDR					(TX_DBM_ADDR+TX_DBM_NUM_BYTES)
 #define NAME_NUM_BYTES				(10)
+#define MIC_LEN_ADDR				(NAME_ADDR+NAME_NUM_BYTES)
+#define MIC_LEN_NUM_BYTES			(1)
+#define JITTER_ADDR					(MIC_LEN_ADDR+MIC_LEN_NUM_BYTES)
+#define JITTER_NUM_BYTES			(1)
+#define RBE_POLICY_ADDR				(JITTER_ADDR+JITTER_NUM_BYTES)
+#define RBE_POLICY_NUM_BYTES		(1)
+#define RBE_DB_ACCEL_ADDR			(RBE_POLICY_ADDR+RBE_POLICY_NUM_BYTES)
+#define RBE_DB_ACCEL_NUM_BYTES		(2)
+#define RBE_DB_TEMP_ADDR			(RBE_DB_ACCEL_ADDR+RBE_DB_ACCEL_NUM_BYTES)
+#define RBE_DB_TEMP_NUM_BYTES		(2)
+#define RBE_DB_PRESS_ADDR			(RBE_DB_TEMP_ADDR+RBE_DB_TEMP_NUM_BYTES)
+#define RBE_DB_PRESS_NUM_BYTES		(2)
+#define RBE_LAST_ADDR				(RBE_DB_PRESS_ADDR+RBE_DB_PRESS_NUM_BYTES)
+#define RBE_LAST_VALUES				(5)
+#define RBE_LAST_NUM_BYTES			(RBE_LAST_VALUES * 2)
+
+// FRAM regions outside of fram_data_t
+#define FRAM_COUNTER_JOURNAL_ADDR	(0x0040)	// Double buffered event counter, see fram.c
+#define FRAM_PREBUILT_FRAME_ADDR	(0x0080)	// First packet of the next event, see app_prebuilt_frame.c
+#define FRAM_BOOT_TRACE_ADDR		(0x0100)	// Boot-to-first-packet trace ring, see app_boot_trace.c
+#define FRAM_BURST_HISTORY_ADDR		(0x0300)	// Packets and VBULK of the last events, see app_energy_burst.c
+#define FRAM_ENERGY_LEDGER_ADDR		(0x0400)	// Energy of the last events per stage, see app_energy_ledger.c
 
 /**
  * @brief Structure representing the data format which is stored inside the FRAM
@@ -49,8 +73,36 @@ typedef struct
 	uint8_t  encrypted_key[ENCRYPTED_KEY_NUM_BYTES];        // Encrypted key - AES -128
 	uint8_t  tx_dbm_10;                                     // TX power in 0.1dBm
 	uint8_t  cName[NAME_NUM_BYTES];                         // Name for the alert sensor types
+	uint8_t  mic_len;                                       // AES-CCM MIC length in bytes, 0 for the ECB/CTR payload
+	uint8_t  jitter_policy;                                 // Random extra delay before each repeat in ms
+	uint8_t  rbe_policy;                                    // Report by exception mode in bits 0-1, full report every N events in bits 2-7
+	uint16_t rbe_deadband_accel;                            // Change of an accel value or vibration RMS which is reported, m/s^2 * 1000
+	uint16_t rbe_deadband_temp;                             // Change of the temperature which is reported, C x 10
+	uint16_t rbe_deadband_pressure;                         // Change of the pressure which is reported, kPa x16
+	int16_t  rbe_last_values[RBE_LAST_VALUES];              // Values of the last full report, see app_report_by_exception.c
 } fram_data_t;
 
+/**
+ * @brief I2C traffic to the FRAM
+ * 
+ */
+typedef struct
+{
+    uint32_t transactions;                                  // Number of I2C transfers
+    uint32_t bytes;                                         // FRAM address and data bytes sent or received
+} fram_i2c_stats_t;
+
+/**
+ * @brief I2C traffic counters of the FRAM, an event ends with app_fram_flush()
+ * 
+ */
+typedef struct
+{
+    fram_i2c_stats_t current;                               // Since the last flush
+    fram_i2c_stats_t last_event;                            // Between the last two flushes, flush included
+    fram_i2c_stats_t total;                                 // Since boot, up to the last flush
+} fram_stats_t;
+
 /**
  * @brief Enumeration for the type of feilds in FRAM
  * 
@@ -69,11 +121,18 @@ enum FRAM_FIELDS
     ENCRYPTED_KEY,       // Encrypted Key
     TX_DBM,              // TX Power dbm
     NAME,                //  Name
-    MAX_FRAM_FIELDS      // Maximum FRAM fields
+    MIC_LEN,             // CCM MIC Length
+    JITTER,              // Repeat jitter policy
+    RBE_POLICY,          // Report by exception policy
+    RBE_DB_ACCEL,        // Report by exception accel deadband
+    RBE_DB_TEMP,         // Report by exception temperature deadband
+    RBE_DB_PRESS,        // Report by exception pressure deadband
+    MAX_FRAM_FIELDS,     // Maximum FRAM fields
+    RBE_LAST = MAX_FRAM_FIELDS, // Last reported values, kept by the firmware and not a command field
 };
 
 /**
- * @brief Method to read a particular field in FRAM
+ * @brief Method to read a particular field in FRAM, served from the shadow once it is loaded
  * 
  * @param field Field number in FRAM to read the data
  * @param read_buffer Buffer containing the read data
@@ -82,7 +141,18 @@ enum FRAM_FIELDS
 int app_fram_read_field(uint8_t field, uint8_t *read_buffer);
 
 /**
- * @brief Method to write data to a certain feild in FRAM
+ * @brief Read a field straight from the chip, only its bytes, as long as the shadow is not loaded.
+ *        Once it is loaded the shadow is served, as by app_fram_read_field().
+ * 
+ * @param field Field number in FRAM to read the data
+ * @param read_buffer Buffer containing the read data
+ * @return int Error code
+ */
+int app_fram_peek_field(uint8_t field, uint8_t *read_buffer);
+
+/**
+ * @brief Method to write data to a certain feild in FRAM.
+ *        Only the shadow is updated, the changed bytes are written by the next app_fram_flush().
  * 
  * @param field Feild in FRAM to write the data
  * @param data_to_write Data to write in FRAM
@@ -99,7 +169,8 @@ int app_fram_write_field(uint8_t field,  uint8_t *data_to_write);
 int app_fram_service(uint32_t *counter);
 
 /**
- * @brief Method to the data from FRAM via I2C and store it in fram_data_t buffer
+ * @brief Method to the data from FRAM via I2C and store it in fram_data_t buffer.
+ *        The one bulk read also reloads the shadow.
  * 
  * @param read_buffer Buffer containing the read data from FRAM
  * @return int error code
@@ -107,7 +178,24 @@ int app_fram_service(uint32_t *counter);
 int app_fram_read_data(fram_data_t *read_buffer);
 
 /**
- * @brief Methode to write the fram_data_t buffer in the FRAM via I2C
+ * @brief Set up the bulk read of fram_data_t and the counter journal as a transaction of an I2C queue chain.
+ *        The FRAM is locked until app_fram_load_bulk_read(), call both from the same thread.
+ * 
+ * @param txn Transaction to set up, it reads into the FRAM driver buffer
+ */
+void app_fram_bulk_read_txn(i2c_txn_t *txn);
+
+/**
+ * @brief Load the shadow from a bulk read transaction which is done, and unlock the FRAM
+ * 
+ * @param txn Transaction set up by app_fram_bulk_read_txn()
+ * @param read_buffer Buffer containing the read data from FRAM
+ * @return int error code
+ */
+int app_fram_load_bulk_read(const i2c_txn_t *txn, fram_data_t *read_buffer);
+
+/**
+ * @brief Methode to write the fram_data_t buffer in the FRAM via I2C. Only the bytes which differ from the shadow are written.
  * 
  * @param buffer_to_write Buffer containing the data to write
  * @return int error code
@@ -115,7 +203,28 @@ int app_fram_read_data(fram_data_t *read_buffer);
 int app_fram_write_data( fram_data_t *buffer_to_write);
 
 /**
- * @brief Read event counter value from FRAM
+ * @brief Read raw bytes from FRAM, used for the regions outside of fram_data_t
+ * 
+ * @param addr FRAM address to read from
+ * @param read_buffer Buffer to store the read data
+ * @param num_bytes Number of bytes to read
+ * @return int error code
+ */
+int app_fram_read_bytes(uint16_t addr, uint8_t *read_buffer, uint32_t num_bytes);
+
+/**
+ * @brief Write raw bytes to FRAM, used for the regions outside of fram_data_t
+ * 
+ * @param addr FRAM address to write to
+ * @param data_to_write Data to write in FRAM
+ * @param num_bytes Number of bytes to write
+ * @return int error code
+ */
+int app_fram_write_bytes(uint16_t addr, uint8_t *data_to_write, uint32_t num_bytes);
+
+/**
+ * @brief Read event counter value from FRAM, from the shadow once it is loaded.
+ *        Before that only the counter journal is read, in one transaction.
  * 
  * @param fram_buffer fram_data_t buffer to store the new counter value
  * @return int error code
@@ -123,11 +232,40 @@ int app_fram_write_data( fram_data_t *buffer_to_write);
 int app_fram_read_counter(fram_data_t *fram_buffer);
 
 /**
- * @brief Write event counter value in FRAM
+ * @brief Write event counter value in FRAM. The counter is committed to the journal by the next app_fram_flush().
  * 
  * @param new_fram_buffer Buffer containing the new counter value to be stored in FRAM 
  * @return int error code
  */
 int app_fram_write_counter( fram_data_t *new_fram_buffer);
 
+/**
+ * @brief Commit the event counter to the journal right away, for a counter which goes on air before the next flush
+ * 
+ * @param new_fram_buffer Buffer containing the new counter value to be stored in FRAM 
+ * @return int error code
+ */
+int app_fram_commit_counter(fram_data_t *new_fram_buffer);
+
+/**
+ * @brief Tell if the last event counter written is in the FRAM journal, or still waits for a flush
+ * 
+ * @return true if no counter is waiting to be committed
+ */
+bool app_fram_is_counter_committed(void);
+
+/**
+ * @brief Write every byte changed in the shadow since the last flush, and close the I2C statistics of the event
+ * 
+ * @return int error code
+ */
+int app_fram_flush(void);
+
+/**
+ * @brief Get the I2C traffic counters of the FRAM
+ * 
+ * @param stats Buffer to store the counters
+ */
+void app_fram_get_stats(fram_stats_t *stats);
+
 #endif // __FRAM__
@@ -10,23 +10,84 @@
 #include <string.h>
 #include <zephyr/sys/printk.h>
 #include <zephyr/sys/util.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/drivers/i2c.h>
 
 #include "device_config.h"
 #include "app_types.h"
 #include "config_commands.h"
+#include "i2c_queue.h"
+#include "i2c_sensors.h"
 
 // FRAM Defines
 #define FRAM_I2C_ADDR 0x50
+#define FRAM_I2C_NODE DT_CHOSEN(wepower_fram_i2c)
 
 #define FRAM_WRITE_ADDR_BYTES		2
 #define FRAM_I2C_MSG_BYTES			2
 #define FRAM_I2C_WRITE_NO_OF_MSGS	2
 
+// TWIM joins the address and data messages of a write in the concat buffer of the FRAM bus, longer writes are split.
+// The emulated bus of the simulation has none, it gets the wp_rev1 size so writes are split the same way.
+#define FRAM_I2C_DEFAULT_CONCAT_BUF_SIZE	128
+#define FRAM_WRITE_MAX_BYTES		(DT_PROP_OR(FRAM_I2C_NODE, zephyr_concat_buf_size, FRAM_I2C_DEFAULT_CONCAT_BUF_SIZE) - FRAM_WRITE_ADDR_BYTES)
+
+// A new write transaction costs the device address and the FRAM address bytes, clean gaps up to that size are rewritten
+#define FRAM_FLUSH_MAX_GAP_BYTES	(1 + FRAM_WRITE_ADDR_BYTES)
+
+#define FRAM_SHADOW_NUM_BYTES		sizeof(fram_data_t)
+
+#define FRAM_COUNTER_JOURNAL_SLOTS		2
+#define FRAM_COUNTER_JOURNAL_NUM_BYTES	(FRAM_COUNTER_JOURNAL_SLOTS * sizeof(fram_counter_record_t))
+#define FRAM_COUNTER_RECORD_CRC_SEED	0xFFFF
+
+// fram_data_t and the counter journal are read together at boot
+#define FRAM_BULK_READ_NUM_BYTES		(FRAM_COUNTER_JOURNAL_ADDR + FRAM_COUNTER_JOURNAL_NUM_BYTES - FRAM_COUNTER_ADDR)
+
 LOG_MODULE_DECLARE(wepower);
 
 /**
- * @brief I2C FRAM Write bytes
+ * @brief One copy of the event counter. A commit writes a whole record in one transaction, in the slot of the
+ *        oldest copy, so a torn write never damages the newest valid counter.
+ * 
+ */
+typedef struct
+{
+    uint32_t sequence;                                      // Incremented by every commit, the slot is sequence % FRAM_COUNTER_JOURNAL_SLOTS
+    uint32_t event_counter;                                 // Committed event counter
+    uint16_t crc;                                           // CRC16-CCITT of the fields above
+    uint16_t reserved;
+} fram_counter_record_t;
+
+BUILD_ASSERT(sizeof(fram_data_t) <= 64, "The shadow dirty bitmap holds 64 bytes");
+BUILD_ASSERT(offsetof(fram_data_t, rbe_last_values) == RBE_LAST_ADDR - FRAM_COUNTER_ADDR, "fram_data_t does not match the FRAM layout");
+BUILD_ASSERT(FRAM_COUNTER_ADDR + sizeof(fram_data_t) <= FRAM_COUNTER_JOURNAL_ADDR, "fram_data_t overlaps the counter journal");
+BUILD_ASSERT(FRAM_COUNTER_JOURNAL_ADDR + FRAM_COUNTER_JOURNAL_NUM_BYTES <= FRAM_PREBUILT_FRAME_ADDR, "The counter journal overlaps the prebuilt frame");
+BUILD_ASSERT(sizeof(fram_counter_record_t) <= FRAM_WRITE_MAX_BYTES, "A counter record has to be committed in one transaction");
+
+static const struct device *const fram_i2c_dev = DEVICE_DT_GET(FRAM_I2C_NODE);
+
+// RAM copy of fram_data_t as it is in the FRAM, plus the bytes changed since the last flush
+static fram_data_t fram_shadow;
+static uint64_t fram_shadow_dirty;
+static bool is_fram_shadow_loaded;
+
+// Counter journal, the event counter of fram_data_t is only written by the CLI and kept for older firmware
+static uint8_t fram_bulk_read[FRAM_BULK_READ_NUM_BYTES] __aligned(4);
+static uint32_t journal_sequence;                           // Sequence of the newest valid record
+static uint32_t journal_pending_counter;                    // Counter waiting for the next flush
+static bool is_journal_read;
+static bool is_journal_valid;
+static bool is_journal_pending;
+
+// I2C traffic since the last flush, of the last flushed event and since boot
+static fram_stats_t fram_stats;
+
+// The shadow is shared by the main thread, the system work queue and the CLI
+static K_MUTEX_DEFINE(fram_lock);
+
+/**
+ * @brief I2C FRAM Write bytes. Writes longer than the concat buffer of the bus are split in several transactions.
  * 
  * @param i2c_dev   I2C Device to send data
  * @param addr      Address to write
@@ -37,26 +98,41 @@ LOG_MODULE_DECLARE(wepower);
  */
 static int i2c_fram_write_bytes(const struct device *i2c_dev, uint16_t addr, uint8_t *data, uint32_t num_bytes, uint8_t device_addr)
 {
+	int ret = 0;
 	uint8_t wr_addr[FRAM_WRITE_ADDR_BYTES];
 	struct i2c_msg msgs[FRAM_I2C_MSG_BYTES];
 
-	/* FRAM address */
-	wr_addr[0] = (addr >> 8) & 0xFF;
-	wr_addr[1] = addr & 0xFF;
-    
-	/* Setup I2C messages */
+	while ((ret == 0) && (num_bytes > 0))
+	{
+		uint32_t chunk_bytes = MIN(num_bytes, FRAM_WRITE_MAX_BYTES);
 
-	/* Send the address to write to */
-	msgs[0].buf = wr_addr;
-	msgs[0].len = FRAM_WRITE_ADDR_BYTES;
-	msgs[0].flags = I2C_MSG_WRITE;
+		/* FRAM address */
+		wr_addr[0] = (addr >> 8) & 0xFF;
+		wr_addr[1] = addr & 0xFF;
 
-	/* Data to be written, and STOP after this. */
-	msgs[1].buf = data;
-	msgs[1].len = num_bytes;
-	msgs[1].flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+		/* Setup I2C messages */
+
+		/* Send the address to write to */
+		msgs[0].buf = wr_addr;
+		msgs[0].len = FRAM_WRITE_ADDR_BYTES;
+		msgs[0].flags = I2C_MSG_WRITE;
+
+		/* Data to be written, and STOP after this. */
+		msgs[1].buf = data;
+		msgs[1].len = chunk_bytes;
+		msgs[1].flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+
+		fram_stats.current.transactions++;
+		fram_stats.current.bytes += FRAM_WRITE_ADDR_BYTES + chunk_bytes;
 
-	return i2c_transfer(i2c_dev, &msgs[0], FRAM_I2C_WRITE_NO_OF_MSGS, device_addr);
+		ret = i2c_counted_transfer(i2c_dev, &msgs[0], FRAM_I2C_WRITE_NO_OF_MSGS, device_addr);
+
+		addr += chunk_bytes;
+		data += chunk_bytes;
+		num_bytes -= chunk_bytes;
+	}
+
+	return ret;
 }
 
 /**
@@ -90,7 +166,10 @@ static int i2c_fram_read_bytes(const struct device *i2c_dev, uint16_t addr, uint
 	msgs[1].len = num_bytes;
 	msgs[1].flags = I2C_MSG_READ | I2C_MSG_STOP;
 
-	return i2c_transfer(i2c_dev, &msgs[0], FRAM_I2C_WRITE_NO_OF_MSGS, device_addr);
+	fram_stats.current.transactions++;
+	fram_stats.current.bytes += FRAM_WRITE_ADDR_BYTES + num_bytes;
+
+	return i2c_counted_transfer(i2c_dev, &msgs[0], FRAM_I2C_WRITE_NO_OF_MSGS, device_addr);
 }
 
 /**
@@ -152,6 +231,34 @@ static void get_field_addr_and_length_based_on_type(uint8_t field_type, uint16_t
 			*field_addr = NAME_ADDR;
 			*field_length = NAME_NUM_BYTES;
 			break;
+		case MIC_LEN:
+			*field_addr = MIC_LEN_ADDR;
+			*field_length = MIC_LEN_NUM_BYTES;
+			break;
+		case JITTER:
+			*field_addr = JITTER_ADDR;
+			*field_length = JITTER_NUM_BYTES;
+			break;
+		case RBE_POLICY:
+			*field_addr = RBE_POLICY_ADDR;
+			*field_length = RBE_POLICY_NUM_BYTES;
+			break;
+		case RBE_DB_ACCEL:
+			*field_addr = RBE_DB_ACCEL_ADDR;
+			*field_length = RBE_DB_ACCEL_NUM_BYTES;
+			break;
+		case RBE_DB_TEMP:
+			*field_addr = RBE_DB_TEMP_ADDR;
+			*field_length = RBE_DB_TEMP_NUM_BYTES;
+			break;
+		case RBE_DB_PRESS:
+			*field_addr = RBE_DB_PRESS_ADDR;
+			*field_length = RBE_DB_PRESS_NUM_BYTES;
+			break;
+		case RBE_LAST:
+			*field_addr = RBE_LAST_ADDR;
+			*field_length = RBE_LAST_NUM_BYTES;
+			break;
 		default:
 			*field_addr = 0;
 			*field_length = 0;
@@ -159,127 +266,486 @@ static void get_field_addr_and_length_based_on_type(uint8_t field_type, uint16_t
 	}
 }
 
+
 /**
- * @brief Method to read a particular field in FRAM
+ * @brief CRC of a counter record
  * 
- * @param field Field number in FRAM to read the data
- * @param read_buffer Buffer containing the read data
- * @return int Error code
+ * @param record Record to check or commit
+ * @return uint16_t CRC16-CCITT of the record fields before the CRC
  */
-int app_fram_read_field(uint8_t field, uint8_t *read_buffer)
+static uint16_t fram_counter_record_crc(const fram_counter_record_t *record)
 {
-	int ret;
-	uint16_t addr = 0;
-	uint32_t length = 0;
+	return crc16_ccitt(FRAM_COUNTER_RECORD_CRC_SEED, (const uint8_t*)record, offsetof(fram_counter_record_t, crc));
+}
+
+/**
+ * @brief Pick the newest valid copy of the counter journal.
+ *        A record is valid when its CRC matches and it sits in the slot of its sequence.
+ * 
+ * @note call with fram_lock held
+ * 
+ * @param records Both slots of the journal as read from FRAM
+ * @param event_counter Buffer to store the recovered counter, untouched if no copy is valid
+ */
+static void fram_journal_recover(const fram_counter_record_t *records, uint32_t *event_counter)
+{
+	is_journal_valid = false;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	for (uint32_t slot = 0; slot < FRAM_COUNTER_JOURNAL_SLOTS; slot++)
+	{
+		const fram_counter_record_t *record = &records[slot];
+
+		if ((record->crc != fram_counter_record_crc(record)) ||
+			((record->sequence % FRAM_COUNTER_JOURNAL_SLOTS) != slot))
+		{
+			continue;
+		}
+
+		if (!is_journal_valid || ((int32_t)(record->sequence - journal_sequence) > 0))
+		{
+			journal_sequence = record->sequence;
+			*event_counter = record->event_counter;
+			is_journal_valid = true;
+		}
+	}
 
-	if (!device_is_ready(i2c_dev)) 
+	if (!is_journal_valid)
 	{
-		LOG_ERR("Reading from FRAM failed - I2C device is not ready");
-		return FRAM_ERROR;
+		LOG_INF(">>[FRAM INFO]->No valid counter journal, using the counter of fram_data_t");
 	}
+	is_journal_read = true;
+}
 
-	get_field_addr_and_length_based_on_type(field, &addr, &length);
+/**
+ * @brief Read both copies of the counter journal in one transaction and recover the newest one
+ * 
+ * @note call with fram_lock held
+ * 
+ * @param event_counter Buffer to store the recovered counter, untouched if no copy is valid
+ * @return int error code
+ */
+static int fram_journal_read(uint32_t *event_counter)
+{
+	int ret;
+	fram_counter_record_t records[FRAM_COUNTER_JOURNAL_SLOTS];
 
-	ret = i2c_fram_read_bytes(i2c_dev, addr, read_buffer, length, FRAM_I2C_ADDR);
+	if (!device_is_ready(fram_i2c_dev)) 
+	{
+		LOG_ERR("Reading FRAM counter journal failed - I2C device not ready");
+		return FRAM_ERROR;
+	}
+
+	ret = i2c_fram_read_bytes(fram_i2c_dev, FRAM_COUNTER_JOURNAL_ADDR, (uint8_t*)records, sizeof(records), FRAM_I2C_ADDR);
 	if (ret) 
 	{
-        LOG_ERR("Error reading from FRAM! error code (%d)\n", ret);
+		LOG_ERR("Error reading FRAM counter journal error code %d", ret);
 		return FRAM_ERROR;
 	} 
-	else
-	{
-        LOG_INF(">>Read the data successfully\n");
-	}
 
+	fram_journal_recover(records, event_counter);
 	return FRAM_SUCCESS;
 }
 
 /**
- * @brief Method to write data to a certain feild in FRAM
+ * @brief Queue a counter for the journal, the shadow shows it right away
+ * 
+ * @note call with fram_lock held
+ * 
+ * @param event_counter Counter to commit on the next flush
+ */
+static void fram_journal_stage(uint32_t event_counter)
+{
+	journal_pending_counter = event_counter;
+	is_journal_pending = true;
+	fram_shadow.event_counter = event_counter;
+}
+
+/**
+ * @brief Commit the pending counter in one write, in the slot of the oldest copy
+ * 
+ * @note call with fram_lock held
  * 
- * @param field Feild in FRAM to write the data
- * @param data_to_write Data to write in FRAM
  * @return int error code
  */
-int app_fram_write_field(uint8_t field,  uint8_t *data_to_write)
+static int fram_journal_commit(void)
 {
 	int ret;
-	uint16_t addr = 0;
-	uint32_t num_bytes = 0;
+	uint32_t recovered_counter;
+	fram_counter_record_t record;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	if (!is_journal_pending)
+	{
+		return FRAM_SUCCESS;
+	}
 
-	if (!device_is_ready(i2c_dev)) 
+	// The next sequence must follow the newest copy in FRAM, never overwrite it
+	if (!is_journal_read && (fram_journal_read(&recovered_counter) != FRAM_SUCCESS))
 	{
-		LOG_ERR("Writing to FRAM failed - I2C device is not ready");
 		return FRAM_ERROR;
 	}
 
-	get_field_addr_and_length_based_on_type(field, &addr, &num_bytes);
+	record.sequence = is_journal_valid ? (journal_sequence + 1) : 0;
+	record.event_counter = journal_pending_counter;
+	record.reserved = 0;
+	record.crc = fram_counter_record_crc(&record);
 
-	ret = i2c_fram_write_bytes(i2c_dev, addr, data_to_write, num_bytes, FRAM_I2C_ADDR);
+	ret = i2c_fram_write_bytes(fram_i2c_dev,
+							   FRAM_COUNTER_JOURNAL_ADDR + ((record.sequence % FRAM_COUNTER_JOURNAL_SLOTS) * sizeof(record)),
+							   (uint8_t*)&record, sizeof(record), FRAM_I2C_ADDR);
 	if (ret)
 	{
-        LOG_ERR("Error writing from FRAM! error code (%d)", ret);
+		LOG_ERR("Writing FRAM counter failed, error code %d", ret);
+		return FRAM_ERROR;
 	}
-	else 
+
+	journal_sequence = record.sequence;
+	is_journal_valid = true;
+	is_journal_pending = false;
+
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Copy the bulk read into the shadow and recover the counter journal. Bytes waiting for a flush keep their RAM value.
+ * 
+ * @note call with fram_lock held
+ */
+static void fram_shadow_apply_bulk_read(void)
+{
+	uint32_t recovered_counter;
+	uint8_t *shadow_bytes = (uint8_t*)&fram_shadow;
+
+	for (uint32_t idx = 0; idx < FRAM_SHADOW_NUM_BYTES; idx++)
 	{
-		LOG_INF(">>Write the data successfully");
+		if ((fram_shadow_dirty & BIT64(idx)) == 0)
+		{
+			shadow_bytes[idx] = fram_bulk_read[idx];
+		}
 	}
-	return FRAM_SUCCESS;
+	is_fram_shadow_loaded = true;
+
+	recovered_counter = fram_shadow.event_counter;
+	fram_journal_recover((const fram_counter_record_t*)&fram_bulk_read[FRAM_COUNTER_JOURNAL_ADDR - FRAM_COUNTER_ADDR], &recovered_counter);
+	fram_shadow.event_counter = is_journal_pending ? journal_pending_counter : recovered_counter;
 }
 
 /**
- * @brief Method to the data from FRAM via I2C and store it in fram_data_t buffer
+ * @brief Load the shadow and recover the counter journal with one bulk read. Bytes waiting for a flush keep their RAM value.
+ * 
+ * @note call with fram_lock held
  * 
- * @param read_buffer Buffer containing the read data from FRAM
  * @return int error code
  */
-int app_fram_read_data(fram_data_t *read_buffer)
+static int fram_shadow_load(void)
 {
 	int ret;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
-
-	if (!device_is_ready(i2c_dev)) 
+	if (!device_is_ready(fram_i2c_dev)) 
 	{
 		LOG_ERR("Reading FRAM data failed - I2C device not ready");
 		return FRAM_ERROR;
 	}
 
-	ret = i2c_fram_read_bytes(i2c_dev, FRAM_COUNTER_ADDR, (uint8_t*)read_buffer, sizeof(fram_data_t), FRAM_I2C_ADDR);
+	ret = i2c_fram_read_bytes(fram_i2c_dev, FRAM_COUNTER_ADDR, fram_bulk_read, sizeof(fram_bulk_read), FRAM_I2C_ADDR);
 	if (ret) 
 	{
         LOG_ERR("Error reading from FRAM! error code (%d)", ret);
 		return FRAM_ERROR;
 	} 
+
+	fram_shadow_apply_bulk_read();
+
 	return FRAM_SUCCESS;
 }
 
 /**
- * @brief Methode to write the fram_data_t buffer in the FRAM via I2C
+ * @brief Copy bytes in the shadow and mark the ones which changed as dirty.
+ *        Before the shadow is loaded every written byte is dirty, its FRAM value is unknown.
+ * 
+ * @note call with fram_lock held
+ * 
+ * @param addr FRAM address of the first byte, inside fram_data_t
+ * @param data Bytes to write
+ * @param num_bytes Number of bytes to write
+ */
+static void fram_shadow_write(uint16_t addr, const uint8_t *data, uint32_t num_bytes)
+{
+	uint8_t *shadow_bytes = (uint8_t*)&fram_shadow;
+
+	for (uint32_t idx = 0; idx < num_bytes; idx++)
+	{
+		uint32_t offset = (addr - FRAM_COUNTER_ADDR) + idx;
+
+		if ((shadow_bytes[offset] != data[idx]) || !is_fram_shadow_loaded)
+		{
+			shadow_bytes[offset] = data[idx];
+			fram_shadow_dirty |= BIT64(offset);
+		}
+	}
+}
+
+/**
+ * @brief Commit the pending counter, then write the dirty bytes of the shadow back to FRAM, one transaction per run of dirty bytes.
+ *        Runs closer than the cost of a new transaction are merged, the clean bytes between them are rewritten.
+ * 
+ * @note call with fram_lock held
  * 
- * @param buffer_to_write Buffer containing the data to write
  * @return int error code
  */
-int app_fram_write_data( fram_data_t *buffer_to_write)
+static int fram_shadow_flush(void)
 {
 	int ret;
+	uint32_t idx = 0;
+	uint8_t *shadow_bytes = (uint8_t*)&fram_shadow;
+
+	// The counter goes first, it is the only byte range the receivers depend on
+	if (fram_journal_commit() != FRAM_SUCCESS)
+	{
+		return FRAM_ERROR;
+	}
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	if (fram_shadow_dirty == 0)
+	{
+		return FRAM_SUCCESS;
+	}
 
-	if (!device_is_ready(i2c_dev))
+	if (!device_is_ready(fram_i2c_dev))
 	{
-		LOG_ERR("FRAM write data failed - I2C device not ready");
+		LOG_ERR("FRAM flush failed - I2C device not ready");
 		return FRAM_ERROR;
 	}
 
-	ret = i2c_fram_write_bytes(i2c_dev, FRAM_COUNTER_ADDR, (uint8_t*)buffer_to_write, sizeof(fram_data_t), FRAM_I2C_ADDR);
-	if (ret) 
+	while (idx < FRAM_SHADOW_NUM_BYTES)
+	{
+		uint32_t start = idx;
+		uint32_t end;
+
+		if ((fram_shadow_dirty & BIT64(idx)) == 0)
+		{
+			idx++;
+			continue;
+		}
+
+		// Extend the run up to the last dirty byte which is not worth a transaction of its own
+		end = start + 1;
+		for (uint32_t next = end; next < FRAM_SHADOW_NUM_BYTES; next++)
+		{
+			if ((fram_shadow_dirty & BIT64(next)) == 0)
+			{
+				continue;
+			}
+			if ((next - end) > FRAM_FLUSH_MAX_GAP_BYTES)
+			{
+				break;
+			}
+			end = next + 1;
+		}
+
+		ret = i2c_fram_write_bytes(fram_i2c_dev, FRAM_COUNTER_ADDR + start, &shadow_bytes[start], end - start, FRAM_I2C_ADDR);
+		if (ret)
+		{
+			LOG_ERR("Error writing %d bytes at 0x%04X to FRAM! error code (%d)", end - start, FRAM_COUNTER_ADDR + start, ret);
+			return FRAM_ERROR;
+		}
+
+		fram_shadow_dirty &= ~(BIT64_MASK(end) & ~BIT64_MASK(start));
+		idx = end;
+	}
+
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Method to read a particular field in FRAM, served from the shadow once it is loaded
+ * 
+ * @param field Field number in FRAM to read the data
+ * @param read_buffer Buffer containing the read data
+ * @return int Error code
+ */
+int app_fram_read_field(uint8_t field, uint8_t *read_buffer)
+{
+	int ret = FRAM_SUCCESS;
+	uint16_t addr = 0;
+	uint32_t length = 0;
+
+	get_field_addr_and_length_based_on_type(field, &addr, &length);
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	if (!is_fram_shadow_loaded)
+	{
+		ret = fram_shadow_load();
+	}
+	if (ret == FRAM_SUCCESS)
+	{
+		memcpy(read_buffer, (uint8_t*)&fram_shadow + (addr - FRAM_COUNTER_ADDR), length);
+        LOG_INF(">>Read the data successfully\n");
+	}
+	k_mutex_unlock(&fram_lock);
+
+	return ret;
+}
+
+/**
+ * @brief Read a field straight from the chip, only its bytes, as long as the shadow is not loaded.
+ *        Once it is loaded the shadow is served, as by app_fram_read_field().
+ * 
+ * @param field Field number in FRAM to read the data
+ * @param read_buffer Buffer containing the read data
+ * @return int Error code
+ */
+int app_fram_peek_field(uint8_t field, uint8_t *read_buffer)
+{
+	int ret = FRAM_SUCCESS;
+	uint16_t addr = 0;
+	uint32_t length = 0;
+
+	get_field_addr_and_length_based_on_type(field, &addr, &length);
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	if (!is_fram_shadow_loaded)
+	{
+		if (!device_is_ready(fram_i2c_dev)) 
+		{
+			LOG_ERR("Reading FRAM field failed - I2C device not ready");
+			ret = FRAM_ERROR;
+		}
+		else if (i2c_fram_read_bytes(fram_i2c_dev, addr, read_buffer, length, FRAM_I2C_ADDR))
+		{
+			LOG_ERR("Error reading from FRAM!");
+			ret = FRAM_ERROR;
+		}
+		else
+		{
+			// Bytes waiting for a flush are newer than the chip
+			for (uint32_t idx = 0; idx < length; idx++)
+			{
+				if (fram_shadow_dirty & BIT64(addr - FRAM_COUNTER_ADDR + idx))
+				{
+					read_buffer[idx] = ((uint8_t*)&fram_shadow)[addr - FRAM_COUNTER_ADDR + idx];
+				}
+			}
+		}
+	}
+	else
+	{
+		memcpy(read_buffer, (uint8_t*)&fram_shadow + (addr - FRAM_COUNTER_ADDR), length);
+	}
+	k_mutex_unlock(&fram_lock);
+
+	return ret;
+}
+
+/**
+ * @brief Method to write data to a certain feild in FRAM.
+ *        Only the shadow is updated, the changed bytes are written by the next app_fram_flush().
+ * 
+ * @param field Feild in FRAM to write the data
+ * @param data_to_write Data to write in FRAM
+ * @return int error code
+ */
+int app_fram_write_field(uint8_t field,  uint8_t *data_to_write)
+{
+	uint16_t addr = 0;
+	uint32_t num_bytes = 0;
+
+	get_field_addr_and_length_based_on_type(field, &addr, &num_bytes);
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	fram_shadow_write(addr, data_to_write, num_bytes);
+	if (field == EV_CTR)
+	{
+		u32_u8_t event_counter;
+		memcpy(event_counter.u8, data_to_write, FRAM_COUNTER_NUM_BYTES);
+		fram_journal_stage(event_counter.u32);
+	}
+	k_mutex_unlock(&fram_lock);
+
+	LOG_INF(">>Write the data successfully");
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Method to the data from FRAM via I2C and store it in fram_data_t buffer.
+ *        The one bulk read also reloads the shadow.
+ * 
+ * @param read_buffer Buffer containing the read data from FRAM
+ * @return int error code
+ */
+int app_fram_read_data(fram_data_t *read_buffer)
+{
+	int ret;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	ret = fram_shadow_load();
+	if (ret == FRAM_SUCCESS)
+	{
+		memcpy(read_buffer, &fram_shadow, sizeof(fram_data_t));
+	}
+	k_mutex_unlock(&fram_lock);
+
+	return ret;
+}
+
+/**
+ * @brief Set up the bulk read of fram_data_t and the counter journal as a transaction of an I2C queue chain.
+ *        The FRAM is locked until app_fram_load_bulk_read(), call both from the same thread.
+ * 
+ * @param txn Transaction to set up, it reads into the FRAM driver buffer
+ */
+void app_fram_bulk_read_txn(i2c_txn_t *txn)
+{
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	i2c_txn_read(txn, fram_i2c_dev, FRAM_I2C_ADDR, FRAM_COUNTER_ADDR, FRAM_WRITE_ADDR_BYTES, fram_bulk_read, sizeof(fram_bulk_read));
+
+	fram_stats.current.transactions++;
+	fram_stats.current.bytes += FRAM_WRITE_ADDR_BYTES + sizeof(fram_bulk_read);
+}
+
+/**
+ * @brief Load the shadow from a bulk read transaction which is done, and unlock the FRAM
+ * 
+ * @param txn Transaction set up by app_fram_bulk_read_txn()
+ * @param read_buffer Buffer containing the read data from FRAM
+ * @return int error code
+ */
+int app_fram_load_bulk_read(const i2c_txn_t *txn, fram_data_t *read_buffer)
+{
+	int ret = FRAM_SUCCESS;
+
+	if (txn->result)
+	{
+		LOG_ERR("Error reading from FRAM! error code (%d)", txn->result);
+		ret = FRAM_ERROR;
+	}
+	else
+	{
+		fram_shadow_apply_bulk_read();
+		memcpy(read_buffer, &fram_shadow, sizeof(fram_data_t));
+	}
+	k_mutex_unlock(&fram_lock);
+
+	return ret;
+}
+
+/**
+ * @brief Methode to write the fram_data_t buffer in the FRAM via I2C. Only the bytes which differ from the shadow are written.
+ * 
+ * @param buffer_to_write Buffer containing the data to write
+ * @return int error code
+ */
+int app_fram_write_data( fram_data_t *buffer_to_write)
+{
+	int ret;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	fram_shadow_write(FRAM_COUNTER_ADDR, (uint8_t*)buffer_to_write, sizeof(fram_data_t));
+	fram_journal_stage(buffer_to_write->event_counter);
+	is_fram_shadow_loaded = true;
+	ret = fram_shadow_flush();
+	k_mutex_unlock(&fram_lock);
+
+	if (ret != FRAM_SUCCESS) 
 	{
-		LOG_ERR("Error writing to FRAM! error code (%d)", ret);
 		return FRAM_ERROR;
 	} 
 	else
@@ -297,121 +763,247 @@ int app_fram_write_data( fram_data_t *buffer_to_write)
 		LOG_INF(">>[FRAM INFO]->Encrypted Key: ");
 		LOG_INF(">>[FRAM INFO]->TX dBM 10: %d", buffer_to_write->tx_dbm_10);
 		LOG_INF(">>[FRAM INFO]->cName: %s", buffer_to_write->cName); 
+		LOG_INF(">>[FRAM INFO]->MIC Length: %d", buffer_to_write->mic_len);
+		LOG_INF(">>[FRAM INFO]->Jitter Policy: 0x%02X", buffer_to_write->jitter_policy);
+		LOG_INF(">>[FRAM INFO]->Report by Exception Policy: 0x%02X", buffer_to_write->rbe_policy);
+		LOG_INF(">>[FRAM INFO]->Deadbands: accel %d, temp %d, pressure %d", buffer_to_write->rbe_deadband_accel,
+				buffer_to_write->rbe_deadband_temp, buffer_to_write->rbe_deadband_pressure);
 		return FRAM_SUCCESS;
 	}
 }
 
 /**
- * @brief Read event counter value from FRAM
+ * @brief Read raw bytes from FRAM, used for the regions outside of fram_data_t
  * 
- * @param fram_buffer fram_data_t buffer to store the new counter value
+ * @param addr FRAM address to read from
+ * @param read_buffer Buffer to store the read data
+ * @param num_bytes Number of bytes to read
  * @return int error code
  */
-int app_fram_read_counter(fram_data_t *fram_buffer)
+int app_fram_read_bytes(uint16_t addr, uint8_t *read_buffer, uint32_t num_bytes)
 {
 	int ret;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
-
-	if (!device_is_ready(i2c_dev)) 
+	if (!device_is_ready(fram_i2c_dev)) 
 	{
-		LOG_ERR("Reading FRAM counter value failed - I2C device not ready");
+		LOG_ERR("Reading FRAM bytes failed - I2C device not ready");
 		return FRAM_ERROR;
 	}
 
-	ret = i2c_fram_read_bytes(i2c_dev, FRAM_COUNTER_ADDR, (uint8_t*)fram_buffer, FRAM_COUNTER_NUM_BYTES, FRAM_I2C_ADDR);
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	ret = i2c_fram_read_bytes(fram_i2c_dev, addr, read_buffer, num_bytes, FRAM_I2C_ADDR);
+	k_mutex_unlock(&fram_lock);
 	if (ret) 
 	{
-		LOG_ERR("Error reading FRAM counter value error code %d",ret);
+		LOG_ERR("Error reading %d bytes at 0x%04X from FRAM! error code (%d)", num_bytes, addr, ret);
 		return FRAM_ERROR;
 	} 
-	else 
-	{
-        LOG_PRINTK(">>[FRAM INFO]->Frame Counter: 0x%08X", fram_buffer->event_counter);
-	}
-
 	return FRAM_SUCCESS;
 }
 
 /**
- * @brief Write event counter value in FRAM
+ * @brief Write raw bytes to FRAM, used for the regions outside of fram_data_t
  * 
- * @param new_fram_buffer Buffer containing the new counter value to be stored in FRAM 
+ * @param addr FRAM address to write to
+ * @param data_to_write Data to write in FRAM
+ * @param num_bytes Number of bytes to write
  * @return int error code
  */
-int app_fram_write_counter( fram_data_t *new_fram_buffer)
+int app_fram_write_bytes(uint16_t addr, uint8_t *data_to_write, uint32_t num_bytes)
 {
 	int ret;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
-
-	if (!device_is_ready(i2c_dev))
+	if (!device_is_ready(fram_i2c_dev)) 
 	{
-		LOG_ERR("Writing FRAM counter value failed - I2C device not ready");
+		LOG_ERR("Writing FRAM bytes failed - I2C device not ready");
 		return FRAM_ERROR;
 	}
 
-	ret = i2c_fram_write_bytes(i2c_dev, FRAM_COUNTER_ADDR, (uint8_t*)new_fram_buffer, FRAM_COUNTER_NUM_BYTES, FRAM_I2C_ADDR);
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	ret = i2c_fram_write_bytes(fram_i2c_dev, addr, data_to_write, num_bytes, FRAM_I2C_ADDR);
+	k_mutex_unlock(&fram_lock);
 	if (ret) 
 	{
-		LOG_ERR("Writing FRAM counter failed, error code %d", ret);
+		LOG_ERR("Error writing %d bytes at 0x%04X to FRAM! error code (%d)", num_bytes, addr, ret);
 		return FRAM_ERROR;
+	} 
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Read event counter value from FRAM, from the shadow once it is loaded.
+ *        Before that only the counter journal is read, in one transaction.
+ * 
+ * @param fram_buffer fram_data_t buffer to store the new counter value
+ * @return int error code
+ */
+int app_fram_read_counter(fram_data_t *fram_buffer)
+{
+	int ret = FRAM_SUCCESS;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	if (is_fram_shadow_loaded)
+	{
+		fram_buffer->event_counter = fram_shadow.event_counter;
 	}
 	else
 	{
-        LOG_PRINTK(">>[FRAM INFO]->Frame Counter: 0x%08X", new_fram_buffer->event_counter);
+		ret = fram_journal_read(&fram_buffer->event_counter);
+		if ((ret == FRAM_SUCCESS) && !is_journal_valid)
+		{
+			// No journal yet, the counter is still in fram_data_t
+			ret = fram_shadow_load();
+			fram_buffer->event_counter = fram_shadow.event_counter;
+		}
+		else if ((ret == FRAM_SUCCESS) && is_journal_pending)
+		{
+			fram_buffer->event_counter = journal_pending_counter;
+		}
+	}
+	k_mutex_unlock(&fram_lock);
+
+	if (ret != FRAM_SUCCESS) 
+	{
+		LOG_ERR("Error reading FRAM counter value");
+		return FRAM_ERROR;
+	} 
+	else 
+	{
+        LOG_PRINTK(">>[FRAM INFO]->Frame Counter: 0x%08X", fram_buffer->event_counter);
 	}
 
 	return FRAM_SUCCESS;
 }
 
 /**
- * @brief FRAM service funtion used to increment the event counter independently 
+ * @brief Write event counter value in FRAM. The counter is committed to the journal by the next app_fram_flush().
  * 
- * @param counter New counter value - after increment 
+ * @param new_fram_buffer Buffer containing the new counter value to be stored in FRAM 
  * @return int error code
  */
-int app_fram_service(uint32_t *counter)
+int app_fram_write_counter( fram_data_t *new_fram_buffer)
+{
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	fram_journal_stage(new_fram_buffer->event_counter);
+	k_mutex_unlock(&fram_lock);
+
+    LOG_PRINTK(">>[FRAM INFO]->Frame Counter: 0x%08X", new_fram_buffer->event_counter);
+
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Commit the event counter to the journal right away, for a counter which goes on air before the next flush
+ * 
+ * @param new_fram_buffer Buffer containing the new counter value to be stored in FRAM 
+ * @return int error code
+ */
+int app_fram_commit_counter(fram_data_t *new_fram_buffer)
 {
 	int ret;
-    u32_u8_t fram_data;
-    fram_data.u32 = 0;
 
-	const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	fram_journal_stage(new_fram_buffer->event_counter);
+	ret = fram_journal_commit();
+	k_mutex_unlock(&fram_lock);
 
-	if (!device_is_ready(i2c_dev)) 
+	if (ret != FRAM_SUCCESS)
 	{
-		LOG_ERR("FRAM service error - I2C device not ready");
+		LOG_ERR("Error committing FRAM counter value");
 		return FRAM_ERROR;
 	}
 
-    // Read the 4 data bytes at this address
-	ret = i2c_fram_read_bytes(i2c_dev, FRAM_COUNTER_ADDR, &fram_data.u8[0], FRAM_COUNTER_NUM_BYTES, FRAM_I2C_ADDR);
-	if (ret) 
+	LOG_PRINTK(">>[FRAM INFO]->Frame Counter committed: 0x%08X", new_fram_buffer->event_counter);
+
+	return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Tell if the last event counter written is in the FRAM journal, or still waits for a flush
+ * 
+ * @return true if no counter is waiting to be committed
+ */
+bool app_fram_is_counter_committed(void)
+{
+	bool is_committed;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	is_committed = !is_journal_pending;
+	k_mutex_unlock(&fram_lock);
+
+	return is_committed;
+}
+
+/**
+ * @brief Write every byte changed in the shadow since the last flush, and close the I2C statistics of the event
+ * 
+ * @return int error code
+ */
+int app_fram_flush(void)
+{
+	int ret;
+	fram_i2c_stats_t event;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	ret = fram_shadow_flush();
+
+	event = fram_stats.current;
+	fram_stats.last_event = event;
+	fram_stats.total.transactions += fram_stats.current.transactions;
+	fram_stats.total.bytes += fram_stats.current.bytes;
+	memset(&fram_stats.current, 0, sizeof(fram_stats.current));
+	k_mutex_unlock(&fram_lock);
+
+	LOG_INF(">>[FRAM INFO]->Event I2C: %d transactions, %d bytes", event.transactions, event.bytes);
+
+	return ret;
+}
+
+/**
+ * @brief Get the I2C traffic counters of the FRAM
+ * 
+ * @param stats Buffer to store the counters
+ */
+void app_fram_get_stats(fram_stats_t *stats)
+{
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	*stats = fram_stats;
+	k_mutex_unlock(&fram_lock);
+}
+
+/**
+ * @brief FRAM service funtion used to increment the event counter independently 
+ * 
+ * @param counter New counter value - after increment 
+ * @return int error code
+ */
+int app_fram_service(uint32_t *counter)
+{
+	int ret = FRAM_SUCCESS;
+	uint32_t new_counter;
+
+	k_mutex_lock(&fram_lock, K_FOREVER);
+	if (!is_fram_shadow_loaded)
 	{
-		LOG_ERR("Error reading FRAM counter value in FRAM service, error code %d", ret);
-		return FRAM_ERROR;
-	} 
-	else 
+		ret = fram_shadow_load();
+	}
+	if (ret == FRAM_SUCCESS)
 	{
-        LOG_INF("Read %u (%08X)from address %u.", fram_data.u32, fram_data.u32, FRAM_COUNTER_ADDR);
+	    // Increment count
+		new_counter = fram_shadow.event_counter + 1;
+		fram_journal_stage(new_counter);
+		ret = fram_shadow_flush();
 	}
+	k_mutex_unlock(&fram_lock);
 
-    // Increment count
-    fram_data.u32++;
-
-	ret = i2c_fram_write_bytes(i2c_dev, FRAM_COUNTER_ADDR, &fram_data.u8[0], FRAM_COUNTER_NUM_BYTES, FRAM_I2C_ADDR);
-	if (ret) 
+	if (ret != FRAM_SUCCESS) 
 	{
-		LOG_ERR("Error writing FRAM counter value in FRAM service, error code %d", ret);
+		LOG_ERR("Error writing FRAM counter value in FRAM service");
 		return FRAM_ERROR;
 	}
-	else
-	{
-        LOG_INF("Wrote %u (%08X) to address %u.", fram_data.u32, fram_data.u32, FRAM_COUNTER_ADDR);
-	}
 
-    *counter = fram_data.u32;
+    LOG_INF("Wrote %u (%08X) to address %u.", new_counter, new_counter, FRAM_COUNTER_ADDR);
+    *counter = new_counter;
 
     return FRAM_SUCCESS;
-}
\ No newline at end of file
+}
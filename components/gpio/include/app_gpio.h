@@ -2,6 +2,18 @@
 #define __APP_GPIO__
 
 #include <stdint.h>
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Sensor DRDY pins with an interrupt
+ * 
+ */
+typedef enum
+{
+    DRDY_PIN_IMU = 0,       // Accelerometer
+    DRDY_PIN_TPS,           // Temperature and pressure sensor
+    DRDY_PIN_MAX
+}drdy_pin_t;
 
 /**
  * @brief Initialize the GPIOs of the WePower Board
@@ -72,6 +84,46 @@ uint8_t get_imu_drdy_pin_status();
  */
 uint8_t get_tps_drdy_pin_status();
 
+/**
+ * @brief Arm the DRDY interrupt of a sensor. The level interrupt goes through the low power PORT sense
+ *        of the GPIO and fires right away if the data was ready before the call.
+ * 
+ * @param pin DRDY pin to arm
+ * @return int 0 on success, negative error code if the interrupt can't be set
+ */
+int arm_drdy_interrupt(drdy_pin_t pin);
+
+/**
+ * @brief Disarm the DRDY interrupt of a sensor, the interrupt also disarms itself when it fires
+ * 
+ * @param pin DRDY pin to disarm
+ */
+void disarm_drdy_interrupt(drdy_pin_t pin);
+
+/**
+ * @brief Get the semaphore given by the DRDY interrupt of a sensor, to wait on it with k_poll
+ * 
+ * @param pin DRDY pin of the sensor
+ * @return struct k_sem* Semaphore given by the interrupt
+ */
+struct k_sem *get_drdy_sem(drdy_pin_t pin);
+
+/**
+ * @brief Sleep until the DRDY pin of the IMU is active
+ * 
+ * @param timeout Maximum time to wait
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code if the interrupt can't be set
+ */
+int wait_for_imu_drdy(k_timeout_t timeout);
+
+/**
+ * @brief Sleep until the DRDY pin of the temperature and pressure sensor is active
+ * 
+ * @param timeout Maximum time to wait
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code if the interrupt can't be set
+ */
+int wait_for_tps_drdy(k_timeout_t timeout);
+
 /**
  * @brief Set the Connector 1 pin #7
  * 
@@ -120,4 +172,11 @@ void clear_CN1_4();
  */
 void set_CN1_4();
 
+/**
+ * @brief Get the number of writes of the connector trace pins since boot
+ * 
+ * @return uint32_t Number of set, clear and toggle calls
+ */
+uint32_t get_trace_pin_write_count(void);
+
 #endif // __APP_GPIO__
@@ -53,6 +53,109 @@ static const struct gpio_dt_spec connector_pin_7 = GPIO_DT_SPEC_GET(DT_NODELABEL
  */
 static const struct gpio_dt_spec tps_drdy = GPIO_DT_SPEC_GET(DT_NODELABEL(lps_drdy),gpios);
 
+// Writes of the connector trace pins since boot, each one costs the energy of the test point load
+static atomic_t trace_pin_writes = ATOMIC_INIT(0);
+
+/**
+ * @brief Given from the DRDY interrupts, taken by the thread reading the sensor
+ * 
+ */
+static K_SEM_DEFINE(imu_drdy_sem, 0, 1);
+static K_SEM_DEFINE(tps_drdy_sem, 0, 1);
+
+static struct gpio_callback imu_drdy_cb_data;
+static struct gpio_callback tps_drdy_cb_data;
+
+/**
+ * @brief IMU DRDY interrupt, disarms the level interrupt and wakes the reading thread
+ * 
+ * @param port GPIO port of the pin
+ * @param cb Callback data of the pin
+ * @param pins Pins which triggered the interrupt
+ */
+static void imu_drdy_isr(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+    gpio_pin_interrupt_configure_dt(&imu_drdy, GPIO_INT_DISABLE);
+    k_sem_give(&imu_drdy_sem);
+}
+
+/**
+ * @brief Temperature and pressure sensor DRDY interrupt, disarms the level interrupt and wakes the reading thread
+ * 
+ * @param port GPIO port of the pin
+ * @param cb Callback data of the pin
+ * @param pins Pins which triggered the interrupt
+ */
+static void tps_drdy_isr(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+    gpio_pin_interrupt_configure_dt(&tps_drdy, GPIO_INT_DISABLE);
+    k_sem_give(&tps_drdy_sem);
+}
+
+/**
+ * @brief DRDY pins and the semaphores given by their interrupts, indexed by drdy_pin_t
+ * 
+ */
+static const struct gpio_dt_spec *const drdy_pins[DRDY_PIN_MAX] = {&imu_drdy, &tps_drdy};
+static struct k_sem *const drdy_sems[DRDY_PIN_MAX] = {&imu_drdy_sem, &tps_drdy_sem};
+
+/**
+ * @brief Arm the DRDY interrupt of a sensor. The level interrupt goes through the low power PORT sense
+ *        of the GPIO and fires right away if the data was ready before the call.
+ * 
+ * @param pin DRDY pin to arm
+ * @return int 0 on success, negative error code if the interrupt can't be set
+ */
+int arm_drdy_interrupt(drdy_pin_t pin)
+{
+    k_sem_reset(drdy_sems[pin]);
+    return gpio_pin_interrupt_configure_dt(drdy_pins[pin], GPIO_INT_LEVEL_ACTIVE);
+}
+
+/**
+ * @brief Disarm the DRDY interrupt of a sensor, the interrupt also disarms itself when it fires
+ * 
+ * @param pin DRDY pin to disarm
+ */
+void disarm_drdy_interrupt(drdy_pin_t pin)
+{
+    gpio_pin_interrupt_configure_dt(drdy_pins[pin], GPIO_INT_DISABLE);
+}
+
+/**
+ * @brief Get the semaphore given by the DRDY interrupt of a sensor, to wait on it with k_poll
+ * 
+ * @param pin DRDY pin of the sensor
+ * @return struct k_sem* Semaphore given by the interrupt
+ */
+struct k_sem *get_drdy_sem(drdy_pin_t pin)
+{
+    return drdy_sems[pin];
+}
+
+/**
+ * @brief Sleep until a DRDY pin is active, the interrupt is only armed while waiting
+ * 
+ * @param pin DRDY pin to wait for
+ * @param timeout Maximum time to wait
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code if the interrupt can't be set
+ */
+static int wait_for_drdy(drdy_pin_t pin, k_timeout_t timeout)
+{
+    int ret;
+
+    ret = arm_drdy_interrupt(pin);
+    if (ret)
+    {
+        return ret;
+    }
+
+    ret = k_sem_take(drdy_sems[pin], timeout);
+    disarm_drdy_interrupt(pin);
+
+    return ret;
+}
+
 /**
  * @brief Initialize the GPIOs of the WePower Board
  * 
@@ -63,6 +166,11 @@ int init_we_power_board_gpios(void)
     gpio_pin_configure_dt(&imu_drdy, GPIO_INPUT);
     gpio_pin_configure_dt(&tps_drdy, GPIO_INPUT);
 
+    gpio_init_callback(&imu_drdy_cb_data, imu_drdy_isr, BIT(imu_drdy.pin));
+    gpio_add_callback(imu_drdy.port, &imu_drdy_cb_data);
+    gpio_init_callback(&tps_drdy_cb_data, tps_drdy_isr, BIT(tps_drdy.pin));
+    gpio_add_callback(tps_drdy.port, &tps_drdy_cb_data);
+
     gpio_pin_configure_dt(&imu_trig, GPIO_OUTPUT);
     clear_imu_trigger_pin();
 
@@ -108,6 +216,7 @@ uint8_t read_polarity(uint16_t sleep_time)
  */
 void set_CN1_5()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_5, 1);
 }
 
@@ -117,6 +226,7 @@ void set_CN1_5()
  */
 void clear_CN1_5()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_5, 0);
 }
 
@@ -127,6 +237,7 @@ void clear_CN1_5()
  */
 void set_CN1_6()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_6, 1);
 }
 
@@ -136,6 +247,7 @@ void set_CN1_6()
  */
 void clear_CN1_6()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_6, 0);
 }
 
@@ -146,6 +258,7 @@ void clear_CN1_6()
  */
 void set_CN1_7()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_7, 1);
 }
 
@@ -155,6 +268,7 @@ void set_CN1_7()
  */
 void clear_CN1_7()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_7, 0);
 }
 
@@ -164,6 +278,7 @@ void clear_CN1_7()
  */
 void set_CN1_4()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_4, 1);
 }
 
@@ -173,6 +288,7 @@ void set_CN1_4()
  */
 void clear_CN1_4()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_set_dt(&connector_pin_4, 0);
 }
 
@@ -182,6 +298,7 @@ void clear_CN1_4()
  */
 void toggle_CN_1_6()
 {
+    atomic_inc(&trace_pin_writes);
    gpio_pin_toggle_dt(&connector_pin_6);
 }
 
@@ -191,6 +308,7 @@ void toggle_CN_1_6()
  */
 void toggle_CN_1_4()
 {
+    atomic_inc(&trace_pin_writes);
     gpio_pin_toggle_dt(&connector_pin_4);
 }
 
@@ -200,6 +318,7 @@ void toggle_CN_1_4()
  */
 void toggle_CN_1_7()
 {
+    atomic_inc(&trace_pin_writes);
    gpio_pin_toggle_dt(&connector_pin_7);
 }
 
@@ -209,6 +328,7 @@ void toggle_CN_1_7()
  */
 void toggle_CN_1_5()
 {
+    atomic_inc(&trace_pin_writes);
    gpio_pin_toggle_dt(&connector_pin_5);
 }
 
@@ -248,4 +368,36 @@ uint8_t get_imu_drdy_pin_status()
 uint8_t get_tps_drdy_pin_status()
 {
     return gpio_pin_get_dt(&tps_drdy);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Sleep until the DRDY pin of the IMU is active
+ * 
+ * @param timeout Maximum time to wait
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code if the interrupt can't be set
+ */
+int wait_for_imu_drdy(k_timeout_t timeout)
+{
+    return wait_for_drdy(DRDY_PIN_IMU, timeout);
+}
+
+/**
+ * @brief Sleep until the DRDY pin of the temperature and pressure sensor is active
+ * 
+ * @param timeout Maximum time to wait
+ * @return int 0 when the data is ready, -EAGAIN on timeout, other negative error code if the interrupt can't be set
+ */
+int wait_for_tps_drdy(k_timeout_t timeout)
+{
+    return wait_for_drdy(DRDY_PIN_TPS, timeout);
+}
+
+/**
+ * @brief Get the number of writes of the connector trace pins since boot
+ * 
+ * @return uint32_t Number of set, clear and toggle calls
+ */
+uint32_t get_trace_pin_write_count(void)
+{
+    return (uint32_t)atomic_get(&trace_pin_writes);
+}
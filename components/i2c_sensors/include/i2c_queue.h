@@ -0,0 +1,142 @@
+#ifndef __I2C_QUEUE__
+#define __I2C_QUEUE__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+#define I2C_QUEUE_SUCCESS           0
+#define I2C_QUEUE_MAX_BUSES         2       // Sensor bus and FRAM bus, each bus has its own queue thread
+
+#define I2C_TXN_MAX_ADDR_BYTES      2       // Sensors use 1 byte register addresses, the FRAM 2 byte memory addresses
+
+typedef struct i2c_txn i2c_txn_t;
+
+/**
+ * @brief Called from the I2C queue thread once a transaction is done
+ *
+ * @param txn Transaction which is done, result and timing are set
+ */
+typedef void (*i2c_txn_done_cb_t)(i2c_txn_t *txn);
+
+/**
+ * @brief One register or memory access. The data buffer is used in place, it must live until the chain is done.
+ *
+ */
+struct i2c_txn
+{
+    const struct device *bus;                       // I2C controller of the device
+    uint8_t  device_addr;                           // 7 bit device address
+    uint8_t  reg_addr[I2C_TXN_MAX_ADDR_BYTES];      // Register or memory address, most significant byte first
+    uint8_t  reg_addr_len;                          // Number of address bytes
+    bool     is_read;                               // Read num_bytes into data, write them otherwise
+    uint8_t *data;                                  // Caller buffer
+    uint32_t num_bytes;                             // Number of data bytes
+    i2c_txn_done_cb_t done_cb;                      // Optional, called when the transaction is done
+    int      result;                                // i2c_transfer() result
+    uint32_t latency_us;                            // From the submit of the chain to the end of this transaction
+    uint32_t busy_us;                               // Time this transaction held the bus
+};
+
+/**
+ * @brief Transactions run back to back, in order, by the queue thread of the bus of the first transaction.
+ *        Chains on different buses run in parallel.
+ *
+ * @note A thread runs the chains because the nRF TWIM driver of the sdk-nrf revision pinned in west.yml
+ *       (0677b0991e4c3ea58efd14e9e33b6c29a1919113) was taken to offer neither i2c_transfer_cb() nor RTIO.
+ *       With CONFIG_I2C_CALLBACK the queue logs at boot a bus whose driver has i2c_transfer_cb().
+ *
+ */
+typedef struct
+{
+    i2c_txn_t   *txns;                              // Transactions of the chain
+    uint8_t      num_txns;                          // Number of transactions
+    int          result;                            // First error of the chain, I2C_QUEUE_SUCCESS if every transaction succeeded
+    uint32_t     submit_cycles;                     // k_cycle_get_32() at submit
+    struct k_work work;                             // Work item of the queue thread
+    struct k_sem  done;                             // Given when the whole chain is done
+} i2c_chain_t;
+
+/**
+ * @brief Bus statistics of the I2C queue
+ *
+ */
+typedef struct
+{
+    uint32_t chains;                                // Chains run
+    uint32_t transactions;                          // Transactions run
+    uint32_t errors;                                // Transactions which failed
+    uint32_t busy_us;                               // Time the transactions held their bus, summed over the buses
+    uint32_t window_us;                             // Time since the statistics were reset
+    uint32_t max_latency_us;                        // Longest submit to chain done
+}i2c_queue_stats_t;
+
+/**
+ * @brief Set up a register or memory write
+ *
+ * @param txn Transaction to set up
+ * @param bus I2C controller of the device
+ * @param device_addr 7 bit device address
+ * @param reg_addr Register or memory address
+ * @param reg_addr_len Number of address bytes, 1 or 2
+ * @param data Data to write, used in place
+ * @param num_bytes Number of bytes to write
+ */
+void i2c_txn_write(i2c_txn_t *txn, const struct device *bus, uint8_t device_addr, uint16_t reg_addr, uint8_t reg_addr_len, uint8_t *data, uint32_t num_bytes);
+
+/**
+ * @brief Set up a register or memory read
+ *
+ * @param txn Transaction to set up
+ * @param bus I2C controller of the device
+ * @param device_addr 7 bit device address
+ * @param reg_addr Register or memory address
+ * @param reg_addr_len Number of address bytes, 1 or 2
+ * @param data Buffer to read into
+ * @param num_bytes Number of bytes to read
+ */
+void i2c_txn_read(i2c_txn_t *txn, const struct device *bus, uint8_t device_addr, uint16_t reg_addr, uint8_t reg_addr_len, uint8_t *data, uint32_t num_bytes);
+
+/**
+ * @brief Queue a chain of transactions, they run back to back on the queue thread of the bus of the first transaction
+ *
+ * @param chain Chain to submit, must live until it is done
+ * @param txns Transactions of the chain
+ * @param num_txns Number of transactions
+ * @return int I2C_QUEUE_SUCCESS or negative error code if the chain can't be queued
+ */
+int i2c_queue_submit(i2c_chain_t *chain, i2c_txn_t *txns, uint8_t num_txns);
+
+/**
+ * @brief Sleep until a submitted chain is done
+ *
+ * @param chain Chain to wait for
+ * @param timeout Maximum time to wait
+ * @return int Result of the chain, -EAGAIN on timeout
+ */
+int i2c_queue_wait(i2c_chain_t *chain, k_timeout_t timeout);
+
+/**
+ * @brief Run a chain of transactions and sleep until it is done
+ *
+ * @param txns Transactions of the chain
+ * @param num_txns Number of transactions
+ * @return int I2C_QUEUE_SUCCESS or the first error of the chain
+ */
+int i2c_queue_transfer(i2c_txn_t *txns, uint8_t num_txns);
+
+/**
+ * @brief Get the bus statistics of the I2C queue
+ *
+ * @param stats Buffer to store the statistics
+ */
+void i2c_queue_get_stats(i2c_queue_stats_t *stats);
+
+/**
+ * @brief Reset the bus statistics of the I2C queue
+ *
+ */
+void i2c_queue_reset_stats(void);
+
+#endif // __I2C_QUEUE__
@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/i2c.h>
+
+#define SENSOR_I2C_NODE     DT_CHOSEN(wepower_sensor_i2c)   // Bus of the accelerometer and the temperature and pressure sensor
 
 /**
  * @brief Write I2C bytes
@@ -29,4 +33,22 @@ int i2c_write_bytes(const struct device *i2c_dev, uint8_t addr, uint8_t *data, u
  */
 int i2c_read_bytes(const struct device *i2c_dev, uint8_t addr, uint8_t *data, uint32_t num_bytes, uint8_t devaddr7);
 
+/**
+ * @brief Run an I2C transfer and add its bytes to the bus traffic count. Every I2C access of the firmware goes through it.
+ * 
+ * @param i2c_dev I2C peripheral to use
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @param devaddr7 Address of the device
+ * @return int i2c_transfer() result
+ */
+int i2c_counted_transfer(const struct device *i2c_dev, struct i2c_msg *msgs, uint8_t num_msgs, uint16_t devaddr7);
+
+/**
+ * @brief Get the bytes on the I2C buses since boot, device address bytes included
+ * 
+ * @return uint32_t Number of bytes
+ */
+uint32_t i2c_get_bus_byte_count(void);
+
 #endif // __I2C_SENSORS__
@@ -0,0 +1,328 @@
+#include "i2c_queue.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/logging/log.h>
+
+#include "device_config.h"
+#include "i2c_sensors.h"
+
+#define I2C_QUEUE_STACK_SIZE        768
+#define I2C_QUEUE_THREAD_PRIORITY   K_PRIO_COOP(4)  // Above the system work queue, the chains are on the boot path
+
+#define I2C_TXN_NO_OF_MSGS          2
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief Queue thread of one bus
+ *
+ */
+typedef struct
+{
+    const struct device *bus;                       // I2C controller, NULL if the bus is not used
+    const char *name;                               // Thread name
+    struct k_work_q work_q;                         // Runs the chains of the bus
+}i2c_bus_queue_t;
+
+#define SENSOR_BUS_NODE             DT_CHOSEN(wepower_sensor_i2c)
+#define FRAM_BUS_NODE               DT_CHOSEN(wepower_fram_i2c)
+
+// One queue per bus in use, the FRAM bus has no queue of its own when it is the sensor bus
+static i2c_bus_queue_t bus_queues[I2C_QUEUE_MAX_BUSES] =
+{
+    {.bus = DEVICE_DT_GET(SENSOR_BUS_NODE), .name = "sensor_i2c_queue"},
+    {.bus = DT_SAME_NODE(FRAM_BUS_NODE, SENSOR_BUS_NODE) ? NULL : DEVICE_DT_GET(FRAM_BUS_NODE), .name = "fram_i2c_queue"},
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(i2c_queue_stacks, I2C_QUEUE_MAX_BUSES, I2C_QUEUE_STACK_SIZE);
+
+// Shared by the queue threads, they are cooperative and never preempt each other while updating it
+static i2c_queue_stats_t queue_stats;
+static uint32_t stats_reset_cycles;
+
+/**
+ * @brief Fill the common fields of a transaction
+ *
+ * @param txn Transaction to set up
+ * @param bus I2C controller of the device
+ * @param device_addr 7 bit device address
+ * @param reg_addr Register or memory address
+ * @param reg_addr_len Number of address bytes, 1 or 2
+ * @param data Caller buffer
+ * @param num_bytes Number of data bytes
+ * @param is_read Read transaction if set
+ */
+static void i2c_txn_init(i2c_txn_t *txn, const struct device *bus, uint8_t device_addr, uint16_t reg_addr,
+                         uint8_t reg_addr_len, uint8_t *data, uint32_t num_bytes, bool is_read)
+{
+    memset(txn, 0, sizeof(*txn));
+    txn->bus = bus;
+    txn->device_addr = device_addr;
+    txn->reg_addr_len = MIN(reg_addr_len, I2C_TXN_MAX_ADDR_BYTES);
+    if (txn->reg_addr_len == I2C_TXN_MAX_ADDR_BYTES)
+    {
+        txn->reg_addr[0] = (reg_addr >> 8) & 0xFF;
+        txn->reg_addr[1] = reg_addr & 0xFF;
+    }
+    else
+    {
+        txn->reg_addr[0] = reg_addr & 0xFF;
+    }
+    txn->data = data;
+    txn->num_bytes = num_bytes;
+    txn->is_read = is_read;
+}
+
+/**
+ * @brief Set up a register or memory write
+ *
+ * @param txn Transaction to set up
+ * @param bus I2C controller of the device
+ * @param device_addr 7 bit device address
+ * @param reg_addr Register or memory address
+ * @param reg_addr_len Number of address bytes, 1 or 2
+ * @param data Data to write, used in place
+ * @param num_bytes Number of bytes to write
+ */
+void i2c_txn_write(i2c_txn_t *txn, const struct device *bus, uint8_t device_addr, uint16_t reg_addr, uint8_t reg_addr_len, uint8_t *data, uint32_t num_bytes)
+{
+    i2c_txn_init(txn, bus, device_addr, reg_addr, reg_addr_len, data, num_bytes, false);
+}
+
+/**
+ * @brief Set up a register or memory read
+ *
+ * @param txn Transaction to set up
+ * @param bus I2C controller of the device
+ * @param device_addr 7 bit device address
+ * @param reg_addr Register or memory address
+ * @param reg_addr_len Number of address bytes, 1 or 2
+ * @param data Buffer to read into
+ * @param num_bytes Number of bytes to read
+ */
+void i2c_txn_read(i2c_txn_t *txn, const struct device *bus, uint8_t device_addr, uint16_t reg_addr, uint8_t reg_addr_len, uint8_t *data, uint32_t num_bytes)
+{
+    i2c_txn_init(txn, bus, device_addr, reg_addr, reg_addr_len, data, num_bytes, true);
+}
+
+/**
+ * @brief Run one transaction on the bus. The address and the data are two messages, no copy is made here.
+ *
+ * @param txn Transaction to run
+ * @return int i2c_transfer() result
+ */
+static int i2c_txn_run(i2c_txn_t *txn)
+{
+    struct i2c_msg msgs[I2C_TXN_NO_OF_MSGS];
+
+    msgs[0].buf = txn->reg_addr;
+    msgs[0].len = txn->reg_addr_len;
+    msgs[0].flags = I2C_MSG_WRITE;
+
+    msgs[1].buf = txn->data;
+    msgs[1].len = txn->num_bytes;
+    msgs[1].flags = (txn->is_read ? I2C_MSG_READ : I2C_MSG_WRITE) | I2C_MSG_STOP;
+
+    return i2c_counted_transfer(txn->bus, msgs, I2C_TXN_NO_OF_MSGS, txn->device_addr);
+}
+
+/**
+ * @brief Run every transaction of a chain back to back, then wake the submitter
+ *
+ * @param work Work item of the chain
+ */
+static void i2c_chain_work_fn(struct k_work *work)
+{
+    i2c_chain_t *chain = CONTAINER_OF(work, i2c_chain_t, work);
+    uint32_t chain_latency_us;
+
+    chain->result = I2C_QUEUE_SUCCESS;
+
+    for (uint8_t idx = 0; idx < chain->num_txns; idx++)
+    {
+        i2c_txn_t *txn = &chain->txns[idx];
+        uint32_t start_cycles = k_cycle_get_32();
+
+        txn->result = i2c_txn_run(txn);
+
+        uint32_t end_cycles = k_cycle_get_32();
+        txn->busy_us = k_cyc_to_us_floor32(end_cycles - start_cycles);
+        txn->latency_us = k_cyc_to_us_floor32(end_cycles - chain->submit_cycles);
+
+        queue_stats.transactions++;
+        queue_stats.busy_us += txn->busy_us;
+        if (txn->result)
+        {
+            queue_stats.errors++;
+            if (chain->result == I2C_QUEUE_SUCCESS)
+            {
+                chain->result = txn->result;
+            }
+        }
+
+        if (txn->done_cb != NULL)
+        {
+            txn->done_cb(txn);
+        }
+    }
+
+    chain_latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - chain->submit_cycles);
+    queue_stats.chains++;
+    queue_stats.max_latency_us = MAX(queue_stats.max_latency_us, chain_latency_us);
+
+    k_sem_give(&chain->done);
+}
+
+/**
+ * @brief Find the queue thread of a bus
+ *
+ * @param bus I2C controller
+ * @return i2c_bus_queue_t* Queue of the bus, NULL if the bus has no queue
+ */
+static i2c_bus_queue_t *get_bus_queue(const struct device *bus)
+{
+    for (uint8_t idx = 0; idx < I2C_QUEUE_MAX_BUSES; idx++)
+    {
+        if ((bus_queues[idx].bus != NULL) && (bus_queues[idx].bus == bus))
+        {
+            return &bus_queues[idx];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Queue a chain of transactions, they run back to back on the queue thread of the bus of the first transaction
+ *
+ * @param chain Chain to submit, must live until it is done
+ * @param txns Transactions of the chain
+ * @param num_txns Number of transactions
+ * @return int I2C_QUEUE_SUCCESS or negative error code if the chain can't be queued
+ */
+int i2c_queue_submit(i2c_chain_t *chain, i2c_txn_t *txns, uint8_t num_txns)
+{
+    i2c_bus_queue_t *queue = (num_txns > 0) ? get_bus_queue(txns[0].bus) : NULL;
+
+    if (queue == NULL)
+    {
+        LOG_ERR("I2C queue submit failed - no queue for the bus");
+        return -EINVAL;
+    }
+
+    for (uint8_t idx = 0; idx < num_txns; idx++)
+    {
+        if (!device_is_ready(txns[idx].bus))
+        {
+            LOG_ERR("I2C queue submit failed - I2C device not ready");
+            return -ENODEV;
+        }
+    }
+
+    chain->txns = txns;
+    chain->num_txns = num_txns;
+    chain->result = I2C_QUEUE_SUCCESS;
+    k_work_init(&chain->work, i2c_chain_work_fn);
+    k_sem_init(&chain->done, 0, 1);
+
+    chain->submit_cycles = k_cycle_get_32();
+    if (k_work_submit_to_queue(&queue->work_q, &chain->work) < 0)
+    {
+        LOG_ERR("I2C queue submit failed");
+        return -EBUSY;
+    }
+
+    return I2C_QUEUE_SUCCESS;
+}
+
+/**
+ * @brief Sleep until a submitted chain is done
+ *
+ * @param chain Chain to wait for
+ * @param timeout Maximum time to wait
+ * @return int Result of the chain, -EAGAIN on timeout
+ */
+int i2c_queue_wait(i2c_chain_t *chain, k_timeout_t timeout)
+{
+    int ret = k_sem_take(&chain->done, timeout);
+
+    return (ret == 0) ? chain->result : ret;
+}
+
+/**
+ * @brief Run a chain of transactions and sleep until it is done
+ *
+ * @param txns Transactions of the chain
+ * @param num_txns Number of transactions
+ * @return int I2C_QUEUE_SUCCESS or the first error of the chain
+ */
+int i2c_queue_transfer(i2c_txn_t *txns, uint8_t num_txns)
+{
+    i2c_chain_t chain;
+    int ret;
+
+    ret = i2c_queue_submit(&chain, txns, num_txns);
+    if (ret == I2C_QUEUE_SUCCESS)
+    {
+        ret = i2c_queue_wait(&chain, K_FOREVER);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Get the bus statistics of the I2C queue
+ *
+ * @param stats Buffer to store the statistics
+ */
+void i2c_queue_get_stats(i2c_queue_stats_t *stats)
+{
+    *stats = queue_stats;
+    stats->window_us = k_cyc_to_us_floor32(k_cycle_get_32() - stats_reset_cycles);
+}
+
+/**
+ * @brief Reset the bus statistics of the I2C queue
+ *
+ */
+void i2c_queue_reset_stats(void)
+{
+    memset(&queue_stats, 0, sizeof(queue_stats));
+    stats_reset_cycles = k_cycle_get_32();
+}
+
+/**
+ * @brief Start the queue thread of every bus in use
+ *
+ * @return int 0
+ */
+static int i2c_queue_init(void)
+{
+    for (uint8_t idx = 0; idx < I2C_QUEUE_MAX_BUSES; idx++)
+    {
+        if (bus_queues[idx].bus == NULL)
+        {
+            continue;
+        }
+#if defined(CONFIG_I2C_CALLBACK)
+        // The chains would not need a thread on a bus with an asynchronous driver, tell when an SDK update brings one
+        if (((const struct i2c_driver_api *)bus_queues[idx].bus->api)->transfer_cb != NULL)
+        {
+            LOG_INF("%s: the I2C driver has i2c_transfer_cb(), the chains still run on the queue thread",
+                    bus_queues[idx].name);
+        }
+#endif
+        k_work_queue_start(&bus_queues[idx].work_q, i2c_queue_stacks[idx], K_THREAD_STACK_SIZEOF(i2c_queue_stacks[idx]),
+                           I2C_QUEUE_THREAD_PRIORITY, NULL);
+        k_thread_name_set(&bus_queues[idx].work_q.thread, bus_queues[idx].name);
+    }
+
+    return 0;
+}
+
+SYS_INIT(i2c_queue_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
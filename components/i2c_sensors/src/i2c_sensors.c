@@ -8,7 +8,8 @@
 
 #include "device_config.h"
 
-#define I2C_MSG_CONTIGOUS_WRITE_MAX_BYTES	64
+// Bytes on the I2C buses since boot, the queue threads of both buses add to it
+static atomic_t i2c_bus_bytes = ATOMIC_INIT(0);
 
 /**
  * @brief Write I2C bytes
@@ -24,16 +25,17 @@ int i2c_write_bytes(const struct device *i2c_dev, uint8_t addr, uint8_t *data, u
 {
 	struct i2c_msg msgs[2];
 
-	uint8_t buf[64];
-	buf[0] = addr;
-	memcpy (&buf[1], data, num_bytes);
-
-	/* Send the buffer to write to */
-	msgs[0].buf = buf;
-	msgs[0].len = num_bytes+1;
+	/* Send the register address to write to */
+	msgs[0].buf = &addr;
+	msgs[0].len = 1U;
 	msgs[0].flags = I2C_MSG_WRITE;
 
-	return i2c_transfer(i2c_dev, &msgs[0], 1, devaddr7);
+	/* Data is sent from the caller buffer, TWIM joins both messages in its concatenation buffer. STOP after this. */
+	msgs[1].buf = data;
+	msgs[1].len = num_bytes;
+	msgs[1].flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+
+	return i2c_counted_transfer(i2c_dev, &msgs[0], 2, devaddr7);
 }
 
 /**
@@ -62,5 +64,42 @@ int i2c_read_bytes(const struct device *i2c_dev, uint8_t addr, uint8_t *data, ui
 	msgs[1].len = num_bytes;
 	msgs[1].flags = I2C_MSG_READ | I2C_MSG_STOP;
 
-	return i2c_transfer(i2c_dev, &msgs[0], 2, devaddr7);
-}
\ No newline at end of file
+	return i2c_counted_transfer(i2c_dev, &msgs[0], 2, devaddr7);
+}
+
+/**
+ * @brief Run an I2C transfer and add its bytes to the bus traffic count. Every I2C access of the firmware goes through it.
+ * 
+ * @param i2c_dev I2C peripheral to use
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @param devaddr7 Address of the device
+ * @return int i2c_transfer() result
+ */
+int i2c_counted_transfer(const struct device *i2c_dev, struct i2c_msg *msgs, uint8_t num_msgs, uint16_t devaddr7)
+{
+	uint32_t num_bytes = 0;
+
+	for (uint8_t idx = 0; idx < num_msgs; idx++)
+	{
+		// A device address byte on the start and on every change of direction
+		if ((idx == 0) || ((msgs[idx].flags & I2C_MSG_RW_MASK) != (msgs[idx - 1].flags & I2C_MSG_RW_MASK)))
+		{
+			num_bytes++;
+		}
+		num_bytes += msgs[idx].len;
+	}
+	(void)atomic_add(&i2c_bus_bytes, num_bytes);
+
+	return i2c_transfer(i2c_dev, msgs, num_msgs, devaddr7);
+}
+
+/**
+ * @brief Get the bytes on the I2C buses since boot, device address bytes included
+ * 
+ * @return uint32_t Number of bytes
+ */
+uint32_t i2c_get_bus_byte_count(void)
+{
+	return (uint32_t)atomic_get(&i2c_bus_bytes);
+}
@@ -0,0 +1,54 @@
+#ifndef __SIM_I2C_EMUL__
+#define __SIM_I2C_EMUL__
+
+#include <stdint.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+
+#define SIM_I2C_ACK_BITS        9       // 8 data bits and the ACK of every byte on the bus
+#define SIM_I2C_START_STOP_BITS 2       // START and STOP conditions, counted as one bit each
+
+/**
+ * @brief Register or memory map behind an emulated I2C device
+ *
+ */
+typedef struct
+{
+    uint8_t  addr_bytes;                                                // Register or memory address bytes sent first, 1 or 2
+    uint32_t bitrate;                                                   // clock-frequency of the bus, the transfer takes as long as on wp_rev1
+    uint8_t  (*read)(const struct emul *target, uint32_t addr);         // Read one byte
+    void     (*write)(const struct emul *target, uint32_t addr, uint8_t value); // Write one byte
+    uint32_t (*next_addr)(const struct emul *target, uint32_t addr);    // Address of the next byte of the same transfer
+}sim_i2c_map_t;
+
+/**
+ * @brief I2C traffic of every emulated device since boot
+ *
+ */
+typedef struct
+{
+    uint32_t transfers;                 // i2c_transfer() calls
+    uint32_t bytes;                     // Register or memory address and data bytes
+    uint32_t bus_us;                    // Time the transfers held the bus
+}sim_i2c_traffic_t;
+
+/**
+ * @brief Run an I2C transfer on a register or memory map. The first written bytes are the address,
+ *        the following bytes are written or read from there on. Returns once the bus time of the transfer has passed.
+ *
+ * @param target Emulated device
+ * @param map Register or memory map of the device
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @return int 0 on success, -EIO if data is read before the address is complete
+ */
+int sim_i2c_map_transfer(const struct emul *target, const sim_i2c_map_t *map, struct i2c_msg *msgs, int num_msgs);
+
+/**
+ * @brief Get the I2C traffic of every emulated device since boot
+ *
+ * @param traffic Buffer to store the traffic
+ */
+void sim_i2c_get_traffic(sim_i2c_traffic_t *traffic);
+
+#endif // __SIM_I2C_EMUL__
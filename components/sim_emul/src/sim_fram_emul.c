@@ -0,0 +1,230 @@
+#define DT_DRV_COMPAT wepower_sim_fram
+
+#include <string.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+
+#include "sim_i2c_emul.h"
+
+#if defined(CONFIG_ARCH_POSIX)
+#include "cmdline.h"
+#include "soc.h"
+#include "nsi_host_trampolines.h"
+#endif
+
+#define SIM_FRAM_ADDR_BYTES     2       // Memory address, most significant byte first
+
+#define SIM_FRAM_HOST_O_RDONLY  0       // nsi_host_open() takes the open() flags of the host
+#define SIM_FRAM_HOST_O_WRONLY  1
+
+/**
+ * @brief Emulated FRAM, the memory is RAM of the simulation. It starts blank on every run,
+ *        unless -fram_file names a file which keeps it from one run to the next.
+ *
+ */
+struct sim_fram_config
+{
+    sim_i2c_map_t map;                  // Memory map of the FRAM
+    uint32_t size;                      // Memory size in bytes
+};
+
+struct sim_fram_data
+{
+    uint8_t *mem;                       // Memory of the FRAM
+};
+
+#if defined(CONFIG_ARCH_POSIX)
+// -fram_file=<path>, every run is one event of the device, the FRAM keeps its content in between as on wp_rev1
+static char *fram_file_path;
+
+// FRAM saved to the file at exit, the first one of the devicetree
+static const struct emul *persisted_fram;
+
+/**
+ * @brief Add the command line options of the emulated FRAM
+ *
+ */
+static void sim_fram_add_options(void)
+{
+    static struct args_struct_t fram_options[] =
+    {
+        {
+            .option = "fram_file",
+            .name = "path",
+            .type = 's',
+            .dest = (void *)&fram_file_path,
+            .descript = "File holding the FRAM memory between runs, loaded at boot and saved at exit. "
+                        "The file must exist, an empty file is a blank FRAM",
+        },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(fram_options);
+}
+
+/**
+ * @brief Load the memory from the FRAM file, a short or missing file leaves the rest blank
+ *
+ * @param target Emulated FRAM
+ */
+static void sim_fram_load_file(const struct emul *target)
+{
+    const struct sim_fram_config *config = target->cfg;
+    struct sim_fram_data *data = target->data;
+    int fd;
+
+    if ((fram_file_path == NULL) || (persisted_fram != NULL))
+    {
+        return;
+    }
+
+    persisted_fram = target;
+    fd = nsi_host_open(fram_file_path, SIM_FRAM_HOST_O_RDONLY);
+    if (fd >= 0)
+    {
+        (void)nsi_host_read(fd, data->mem, config->size);
+        (void)nsi_host_close(fd);
+    }
+}
+
+/**
+ * @brief Save the memory to the FRAM file when the simulation exits
+ *
+ */
+static void sim_fram_save_file(void)
+{
+    const struct sim_fram_config *config;
+    const struct sim_fram_data *data;
+    int fd;
+
+    if (persisted_fram == NULL)
+    {
+        return;
+    }
+
+    config = persisted_fram->cfg;
+    data = persisted_fram->data;
+    fd = nsi_host_open(fram_file_path, SIM_FRAM_HOST_O_WRONLY);
+    if (fd >= 0)
+    {
+        (void)nsi_host_write(fd, data->mem, config->size);
+        (void)nsi_host_close(fd);
+    }
+}
+
+NATIVE_TASK(sim_fram_add_options, PRE_BOOT_1, 10);
+NATIVE_TASK(sim_fram_save_file, ON_EXIT, 10);
+#endif // CONFIG_ARCH_POSIX
+
+/**
+ * @brief Read one byte of the memory
+ *
+ * @param target Emulated FRAM
+ * @param addr Memory address, the upper bits beyond the memory size are ignored as by the chip
+ * @return uint8_t Byte at the address
+ */
+static uint8_t sim_fram_read(const struct emul *target, uint32_t addr)
+{
+    const struct sim_fram_config *config = target->cfg;
+    const struct sim_fram_data *data = target->data;
+
+    return data->mem[addr % config->size];
+}
+
+/**
+ * @brief Write one byte of the memory, the FRAM has no write time
+ *
+ * @param target Emulated FRAM
+ * @param addr Memory address, the upper bits beyond the memory size are ignored as by the chip
+ * @param value Byte to write
+ */
+static void sim_fram_write(const struct emul *target, uint32_t addr, uint8_t value)
+{
+    const struct sim_fram_config *config = target->cfg;
+    struct sim_fram_data *data = target->data;
+
+    data->mem[addr % config->size] = value;
+}
+
+/**
+ * @brief The address counter rolls over at the end of the memory
+ *
+ * @param target Emulated FRAM
+ * @param addr Current memory address
+ * @return uint32_t Next memory address
+ */
+static uint32_t sim_fram_next_addr(const struct emul *target, uint32_t addr)
+{
+    const struct sim_fram_config *config = target->cfg;
+
+    return (addr + 1) % config->size;
+}
+
+/**
+ * @brief I2C transfer addressed to the FRAM
+ *
+ * @param target Emulated FRAM
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @param addr Device address
+ * @return int 0 on success, negative error code otherwise
+ */
+static int sim_fram_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+    const struct sim_fram_config *config = target->cfg;
+
+    ARG_UNUSED(addr);
+
+    return sim_i2c_map_transfer(target, &config->map, msgs, num_msgs);
+}
+
+static const struct i2c_emul_api sim_fram_api =
+{
+    .transfer = sim_fram_transfer,
+};
+
+/**
+ * @brief Blank the memory, or load it from the FRAM file
+ *
+ * @param target Emulated FRAM
+ * @param parent Emulated I2C controller
+ * @return int 0
+ */
+static int sim_fram_init(const struct emul *target, const struct device *parent)
+{
+    const struct sim_fram_config *config = target->cfg;
+    struct sim_fram_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    memset(data->mem, 0, config->size);
+#if defined(CONFIG_ARCH_POSIX)
+    sim_fram_load_file(target);
+#endif
+
+    return 0;
+}
+
+#define SIM_FRAM_DEFINE(n)                                                                      \
+    static uint8_t sim_fram_mem_##n[DT_INST_PROP(n, size)];                                     \
+    static struct sim_fram_data sim_fram_data_##n = {.mem = sim_fram_mem_##n};                  \
+    static const struct sim_fram_config sim_fram_config_##n =                                   \
+    {                                                                                           \
+        .map =                                                                                  \
+        {                                                                                       \
+            .addr_bytes = SIM_FRAM_ADDR_BYTES,                                                  \
+            .bitrate = DT_PROP(DT_INST_BUS(n), clock_frequency),                                \
+            .read = sim_fram_read,                                                              \
+            .write = sim_fram_write,                                                            \
+            .next_addr = sim_fram_next_addr,                                                    \
+        },                                                                                      \
+        .size = DT_INST_PROP(n, size),                                                          \
+    };                                                                                          \
+    EMUL_DT_INST_DEFINE(n, sim_fram_init, &sim_fram_data_##n, &sim_fram_config_##n,             \
+                        &sim_fram_api, NULL);                                                   \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,                               \
+                          CONFIG_APPLICATION_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(SIM_FRAM_DEFINE)
@@ -0,0 +1,431 @@
+#define DT_DRV_COMPAT wepower_sim_lis2dw12
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "sim_i2c_emul.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+#define LIS2DW12_NUM_REGS           0x40
+#define LIS2DW12_REG_WHO_AM_I       0x0F
+#define LIS2DW12_REG_CTRL1          0x20
+#define LIS2DW12_REG_CTRL2          0x21
+#define LIS2DW12_REG_CTRL3          0x22
+#define LIS2DW12_REG_CTRL4_INT1     0x23
+#define LIS2DW12_REG_STATUS         0x27
+#define LIS2DW12_REG_OUT_X_L        0x28
+#define LIS2DW12_REG_OUT_Z_H        0x2D
+#define LIS2DW12_REG_FIFO_CTRL      0x2E
+#define LIS2DW12_REG_FIFO_SAMPLES   0x2F
+
+#define LIS2DW12_WHO_AM_I_VALUE     0x44
+#define LIS2DW12_CTRL1_MODE_MASK    0x0C
+#define LIS2DW12_CTRL1_MODE_ON_DEMAND 0x08  // Single data conversion on demand
+#define LIS2DW12_CTRL1_ODR_SHIFT    4
+#define LIS2DW12_FIFO_MODE_SHIFT    5
+#define LIS2DW12_FIFO_MODE_FIFO     1       // Collects until full
+#define LIS2DW12_FIFO_DEPTH         32
+#define LIS2DW12_CTRL2_IF_ADD_INC   0x04
+#define LIS2DW12_CTRL3_SLP_MODE_SEL 0x02    // Conversion started by SLP_MODE_1 instead of INT2
+#define LIS2DW12_CTRL3_SLP_MODE_1   0x01
+#define LIS2DW12_INT1_DRDY          0x01
+#define LIS2DW12_STATUS_DRDY        0x01
+
+#define LIS2DW12_1G                 0x4000  // 1 g at 2 g full scale, left aligned 14 bit
+#define LIS2DW12_VIBRATION_AMPLITUDE 0x0400 // 1/16 g triangle on X while converting continuously
+#define LIS2DW12_VIBRATION_PERIOD   8       // Samples of one period of the triangle
+
+/**
+ * @brief Emulated LIS2DW12, a conversion started by a rising edge of the trigger pin raises DRDY after the conversion time.
+ *        Reading OUT_Z_H clears DRDY. The sample is the board lying flat, 1 g on Z.
+ *        In continuous mode with the FIFO in FIFO mode, samples are queued at the ODR until the FIFO is full,
+ *        with a triangle vibration on X. Reading OUT_Z_H pops a sample and the read rolls back to OUT_X_L.
+ *
+ */
+struct sim_lis2dw12_config
+{
+    sim_i2c_map_t map;                  // Register map of the accelerometer
+    struct gpio_dt_spec trigger;        // INT2, driven by the firmware
+    struct gpio_dt_spec drdy;           // INT1, driven by the emulator
+    uint32_t conversion_us;             // Trigger to DRDY
+};
+
+struct sim_lis2dw12_data
+{
+    const struct emul *target;          // Emulator owning this data
+    uint8_t regs[LIS2DW12_NUM_REGS];    // Register file
+    int16_t sample[3];                  // X, Y, Z of the next conversion
+    bool is_trigger_armed;              // Rising edges of the trigger pin start conversions
+    struct gpio_callback trigger_cb;    // Rising edge of the trigger pin
+    struct k_work_delayable conversion; // Fires when the conversion is done
+    struct k_work_delayable odr_tick;   // Fires at the ODR in continuous mode
+    int16_t fifo[LIS2DW12_FIFO_DEPTH][3]; // Queued samples, X, Y, Z
+    uint8_t fifo_head;                  // Oldest queued sample
+    uint8_t fifo_count;                 // Number of queued samples
+    uint32_t odr_ticks;                 // Samples converted since continuous mode started, phase of the vibration
+};
+
+/**
+ * @brief Drive the DRDY pin from the status register, when DRDY is routed to INT1
+ *
+ * @param target Emulated accelerometer
+ */
+static void sim_lis2dw12_update_drdy(const struct emul *target)
+{
+    const struct sim_lis2dw12_config *config = target->cfg;
+    struct sim_lis2dw12_data *data = target->data;
+    int level = (data->regs[LIS2DW12_REG_STATUS] & LIS2DW12_STATUS_DRDY) &&
+                (data->regs[LIS2DW12_REG_CTRL4_INT1] & LIS2DW12_INT1_DRDY);
+
+    (void)gpio_emul_input_set(config->drdy.port, config->drdy.pin, level);
+}
+
+/**
+ * @brief Conversion done, latch the sample into the output registers and raise DRDY
+ *
+ * @param work Conversion work item
+ */
+static void sim_lis2dw12_conversion_done(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct sim_lis2dw12_data *data = CONTAINER_OF(dwork, struct sim_lis2dw12_data, conversion);
+
+    for (uint8_t axis = 0; axis < ARRAY_SIZE(data->sample); axis++)
+    {
+        sys_put_le16((uint16_t)data->sample[axis], &data->regs[LIS2DW12_REG_OUT_X_L + (2 * axis)]);
+    }
+    data->regs[LIS2DW12_REG_STATUS] |= LIS2DW12_STATUS_DRDY;
+    sim_lis2dw12_update_drdy(data->target);
+}
+
+/**
+ * @brief Tell if the FIFO is in FIFO mode, the OUT registers then read the FIFO
+ *
+ * @param data Emulator data
+ * @return true in FIFO mode
+ */
+static bool sim_lis2dw12_is_fifo_mode(const struct sim_lis2dw12_data *data)
+{
+    return (data->regs[LIS2DW12_REG_FIFO_CTRL] >> LIS2DW12_FIFO_MODE_SHIFT) == LIS2DW12_FIFO_MODE_FIFO;
+}
+
+/**
+ * @brief Sample period of the continuous mode, from the ODR code of CTRL1
+ *
+ * @param data Emulator data
+ * @return uint32_t Period in us, 0 when powered down or in on demand mode
+ */
+static uint32_t sim_lis2dw12_odr_period_us(const struct sim_lis2dw12_data *data)
+{
+    uint8_t odr_code = data->regs[LIS2DW12_REG_CTRL1] >> LIS2DW12_CTRL1_ODR_SHIFT;
+
+    if (((data->regs[LIS2DW12_REG_CTRL1] & LIS2DW12_CTRL1_MODE_MASK) == LIS2DW12_CTRL1_MODE_ON_DEMAND) || (odr_code < 2))
+    {
+        return 0;
+    }
+
+    // Code 2 is 12.5 Hz, every code doubles the rate
+    return 80000U >> (odr_code - 2);
+}
+
+/**
+ * @brief Continuous conversion done, queue the sample while the FIFO is in FIFO mode and not full
+ *
+ * @param work ODR work item
+ */
+static void sim_lis2dw12_odr_tick(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct sim_lis2dw12_data *data = CONTAINER_OF(dwork, struct sim_lis2dw12_data, odr_tick);
+    uint32_t period_us = sim_lis2dw12_odr_period_us(data);
+    uint32_t phase = data->odr_ticks++ % LIS2DW12_VIBRATION_PERIOD;
+    int32_t triangle = (phase < (LIS2DW12_VIBRATION_PERIOD / 2)) ? (int32_t)phase : (int32_t)(LIS2DW12_VIBRATION_PERIOD - phase);
+
+    if (period_us == 0)
+    {
+        return;
+    }
+
+    if (sim_lis2dw12_is_fifo_mode(data) && (data->fifo_count < LIS2DW12_FIFO_DEPTH))
+    {
+        int16_t *entry = data->fifo[(data->fifo_head + data->fifo_count) % LIS2DW12_FIFO_DEPTH];
+
+        memcpy(entry, data->sample, sizeof(data->sample));
+        // -A to +A over half a period and back
+        entry[0] += (int16_t)(((triangle * 4 * LIS2DW12_VIBRATION_AMPLITUDE) / LIS2DW12_VIBRATION_PERIOD) - LIS2DW12_VIBRATION_AMPLITUDE);
+        data->fifo_count++;
+    }
+
+    k_work_reschedule(&data->odr_tick, K_USEC(period_us));
+}
+
+/**
+ * @brief Start a conversion, ignored unless the accelerometer is in on demand mode
+ *
+ * @param target Emulated accelerometer
+ */
+static void sim_lis2dw12_start_conversion(const struct emul *target)
+{
+    const struct sim_lis2dw12_config *config = target->cfg;
+    struct sim_lis2dw12_data *data = target->data;
+
+    if ((data->regs[LIS2DW12_REG_CTRL1] & LIS2DW12_CTRL1_MODE_MASK) == LIS2DW12_CTRL1_MODE_ON_DEMAND)
+    {
+        k_work_reschedule(&data->conversion, K_USEC(config->conversion_us));
+    }
+}
+
+/**
+ * @brief Rising edge of the trigger pin
+ *
+ * @param port GPIO port of the pin
+ * @param cb Callback data of the pin
+ * @param pins Pins which triggered the interrupt
+ */
+static void sim_lis2dw12_trigger_isr(const struct device *port, struct gpio_callback *cb, gpio_port_pins_t pins)
+{
+    struct sim_lis2dw12_data *data = CONTAINER_OF(cb, struct sim_lis2dw12_data, trigger_cb);
+
+    ARG_UNUSED(port);
+    ARG_UNUSED(pins);
+
+    if ((data->regs[LIS2DW12_REG_CTRL3] & LIS2DW12_CTRL3_SLP_MODE_SEL) == 0)
+    {
+        sim_lis2dw12_start_conversion(data->target);
+    }
+}
+
+/**
+ * @brief Loop the trigger pin back to the emulator. The firmware configures it as an output at boot,
+ *        it is made an input too once the accelerometer is put in on demand mode, the output level is kept.
+ *
+ * @param target Emulated accelerometer
+ */
+static void sim_lis2dw12_arm_trigger(const struct emul *target)
+{
+    const struct sim_lis2dw12_config *config = target->cfg;
+    struct sim_lis2dw12_data *data = target->data;
+
+    if (data->is_trigger_armed)
+    {
+        return;
+    }
+
+    if ((gpio_pin_configure_dt(&config->trigger, GPIO_INPUT | GPIO_OUTPUT) != 0) ||
+        (gpio_pin_interrupt_configure_dt(&config->trigger, GPIO_INT_EDGE_RISING) != 0))
+    {
+        LOG_ERR("Emulated accelerometer - unable to loop back the trigger pin");
+        return;
+    }
+    data->is_trigger_armed = true;
+}
+
+/**
+ * @brief Read one register, reading OUT_Z_H ends the read of a sample and clears DRDY
+ *
+ * @param target Emulated accelerometer
+ * @param addr Register address
+ * @return uint8_t Register value
+ */
+static uint8_t sim_lis2dw12_read(const struct emul *target, uint32_t addr)
+{
+    struct sim_lis2dw12_data *data = target->data;
+    uint8_t value = data->regs[addr % LIS2DW12_NUM_REGS];
+
+    if (sim_lis2dw12_is_fifo_mode(data))
+    {
+        if (addr == LIS2DW12_REG_FIFO_SAMPLES)
+        {
+            return data->fifo_count;
+        }
+
+        if ((addr >= LIS2DW12_REG_OUT_X_L) && (addr <= LIS2DW12_REG_OUT_Z_H))
+        {
+            uint8_t offset = addr - LIS2DW12_REG_OUT_X_L;
+
+            if (data->fifo_count == 0)
+            {
+                return 0;
+            }
+
+            value = (uint8_t)((uint16_t)data->fifo[data->fifo_head][offset / 2] >> ((offset % 2) * 8));
+            if (addr == LIS2DW12_REG_OUT_Z_H)
+            {
+                data->fifo_head = (data->fifo_head + 1) % LIS2DW12_FIFO_DEPTH;
+                data->fifo_count--;
+            }
+            return value;
+        }
+    }
+
+    if (addr == LIS2DW12_REG_OUT_Z_H)
+    {
+        data->regs[LIS2DW12_REG_STATUS] &= ~LIS2DW12_STATUS_DRDY;
+        sim_lis2dw12_update_drdy(target);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Write one register, read only registers are left alone
+ *
+ * @param target Emulated accelerometer
+ * @param addr Register address
+ * @param value Register value
+ */
+static void sim_lis2dw12_write(const struct emul *target, uint32_t addr, uint8_t value)
+{
+    struct sim_lis2dw12_data *data = target->data;
+
+    switch (addr)
+    {
+        case LIS2DW12_REG_CTRL1:
+            data->regs[addr] = value;
+            sim_lis2dw12_arm_trigger(target);
+            if (sim_lis2dw12_odr_period_us(data) != 0)
+            {
+                data->odr_ticks = 0;
+                k_work_reschedule(&data->odr_tick, K_USEC(sim_lis2dw12_odr_period_us(data)));
+            }
+            else
+            {
+                (void)k_work_cancel_delayable(&data->odr_tick);
+            }
+            break;
+        case LIS2DW12_REG_FIFO_CTRL:
+            data->regs[addr] = value;
+            if (!sim_lis2dw12_is_fifo_mode(data))
+            {
+                // Bypass and the other modes empty the FIFO
+                data->fifo_head = 0;
+                data->fifo_count = 0;
+            }
+            break;
+        case LIS2DW12_REG_CTRL3:
+            data->regs[addr] = value & ~LIS2DW12_CTRL3_SLP_MODE_1;
+            if ((value & LIS2DW12_CTRL3_SLP_MODE_SEL) && (value & LIS2DW12_CTRL3_SLP_MODE_1))
+            {
+                sim_lis2dw12_start_conversion(target);
+            }
+            break;
+        case LIS2DW12_REG_CTRL2:
+        case LIS2DW12_REG_CTRL4_INT1:
+            data->regs[addr] = value;
+            sim_lis2dw12_update_drdy(target);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief The register address increments only when IF_ADD_INC is set, the FIFO read rolls back from OUT_Z_H to OUT_X_L
+ *
+ * @param target Emulated accelerometer
+ * @param addr Current register address
+ * @return uint32_t Next register address
+ */
+static uint32_t sim_lis2dw12_next_addr(const struct emul *target, uint32_t addr)
+{
+    const struct sim_lis2dw12_data *data = target->data;
+
+    if ((data->regs[LIS2DW12_REG_CTRL2] & LIS2DW12_CTRL2_IF_ADD_INC) == 0)
+    {
+        return addr;
+    }
+
+    // A burst read of the FIFO goes through the OUT registers again for every sample
+    if (sim_lis2dw12_is_fifo_mode(data) && (addr == LIS2DW12_REG_OUT_Z_H))
+    {
+        return LIS2DW12_REG_OUT_X_L;
+    }
+
+    return (addr + 1) % LIS2DW12_NUM_REGS;
+}
+
+/**
+ * @brief I2C transfer addressed to the accelerometer
+ *
+ * @param target Emulated accelerometer
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @param addr Device address
+ * @return int 0 on success, negative error code otherwise
+ */
+static int sim_lis2dw12_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+    const struct sim_lis2dw12_config *config = target->cfg;
+
+    ARG_UNUSED(addr);
+
+    return sim_i2c_map_transfer(target, &config->map, msgs, num_msgs);
+}
+
+static const struct i2c_emul_api sim_lis2dw12_api =
+{
+    .transfer = sim_lis2dw12_transfer,
+};
+
+/**
+ * @brief Power on reset of the registers. DRDY starts low, the firmware configures the pins later.
+ *
+ * @param target Emulated accelerometer
+ * @param parent Emulated I2C controller
+ * @return int 0 on success, negative error code if a pin is not ready
+ */
+static int sim_lis2dw12_init(const struct emul *target, const struct device *parent)
+{
+    const struct sim_lis2dw12_config *config = target->cfg;
+    struct sim_lis2dw12_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    if (!gpio_is_ready_dt(&config->trigger) || !gpio_is_ready_dt(&config->drdy))
+    {
+        return -ENODEV;
+    }
+
+    data->target = target;
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[LIS2DW12_REG_WHO_AM_I] = LIS2DW12_WHO_AM_I_VALUE;
+    data->regs[LIS2DW12_REG_CTRL2] = LIS2DW12_CTRL2_IF_ADD_INC;
+    data->sample[2] = LIS2DW12_1G;
+    k_work_init_delayable(&data->conversion, sim_lis2dw12_conversion_done);
+    k_work_init_delayable(&data->odr_tick, sim_lis2dw12_odr_tick);
+
+    gpio_init_callback(&data->trigger_cb, sim_lis2dw12_trigger_isr, BIT(config->trigger.pin));
+    return gpio_add_callback(config->trigger.port, &data->trigger_cb);
+}
+
+#define SIM_LIS2DW12_DEFINE(n)                                                                  \
+    static struct sim_lis2dw12_data sim_lis2dw12_data_##n;                                      \
+    static const struct sim_lis2dw12_config sim_lis2dw12_config_##n =                           \
+    {                                                                                           \
+        .map =                                                                                  \
+        {                                                                                       \
+            .addr_bytes = 1,                                                                    \
+            .bitrate = DT_PROP(DT_INST_BUS(n), clock_frequency),                                \
+            .read = sim_lis2dw12_read,                                                          \
+            .write = sim_lis2dw12_write,                                                        \
+            .next_addr = sim_lis2dw12_next_addr,                                                \
+        },                                                                                      \
+        .trigger = GPIO_DT_SPEC_INST_GET(n, trigger_gpios),                                     \
+        .drdy = GPIO_DT_SPEC_INST_GET(n, drdy_gpios),                                           \
+        .conversion_us = DT_INST_PROP(n, conversion_time_us),                                   \
+    };                                                                                          \
+    EMUL_DT_INST_DEFINE(n, sim_lis2dw12_init, &sim_lis2dw12_data_##n, &sim_lis2dw12_config_##n, \
+                        &sim_lis2dw12_api, NULL);                                               \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,                               \
+                          CONFIG_APPLICATION_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(SIM_LIS2DW12_DEFINE)
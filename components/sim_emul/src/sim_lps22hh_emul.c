@@ -0,0 +1,235 @@
+#define DT_DRV_COMPAT wepower_sim_lps22hh
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "sim_i2c_emul.h"
+
+#define LPS22HH_NUM_REGS            0x80
+#define LPS22HH_REG_WHO_AM_I        0x0F
+#define LPS22HH_REG_CTRL1           0x10
+#define LPS22HH_REG_CTRL2           0x11
+#define LPS22HH_REG_CTRL3           0x12
+#define LPS22HH_REG_STATUS          0x27
+#define LPS22HH_REG_PRESS_OUT_XL    0x28
+#define LPS22HH_REG_PRESS_OUT_H     0x2A
+#define LPS22HH_REG_TEMP_OUT_L      0x2B
+#define LPS22HH_REG_TEMP_OUT_H      0x2C
+
+#define LPS22HH_WHO_AM_I_VALUE      0xB3
+#define LPS22HH_CTRL2_ONE_SHOT      0x01
+#define LPS22HH_CTRL2_IF_ADD_INC    0x10
+#define LPS22HH_CTRL3_DRDY          0x04
+#define LPS22HH_STATUS_P_DA         0x01
+#define LPS22HH_STATUS_T_DA         0x02
+
+#define LPS22HH_PRESSURE_RAW        (101325 * 4096 / 100)   // 1013.25 hPa, 4096 LSB/hPa
+#define LPS22HH_TEMP_RAW            2500                    // 25.00 C, 100 LSB/C
+
+/**
+ * @brief Emulated LPS22HH, a one shot raises DRDY after the conversion time.
+ *        Reading PRESS_OUT_H and TEMP_OUT_H clears the data available flags, DRDY falls with the last one.
+ *
+ */
+struct sim_lps22hh_config
+{
+    sim_i2c_map_t map;                  // Register map of the sensor
+    struct gpio_dt_spec drdy;           // INT_DRDY, driven by the emulator
+    uint32_t conversion_us;             // One shot to DRDY
+};
+
+struct sim_lps22hh_data
+{
+    const struct emul *target;          // Emulator owning this data
+    uint8_t regs[LPS22HH_NUM_REGS];     // Register file
+    uint32_t pressure_raw;              // Pressure of the next conversion, 24 bit
+    int16_t temp_raw;                   // Temperature of the next conversion
+    struct k_work_delayable conversion; // Fires when the conversion is done
+};
+
+/**
+ * @brief Drive the DRDY pin from the status register, when DRDY is enabled
+ *
+ * @param target Emulated sensor
+ */
+static void sim_lps22hh_update_drdy(const struct emul *target)
+{
+    const struct sim_lps22hh_config *config = target->cfg;
+    struct sim_lps22hh_data *data = target->data;
+    int level = (data->regs[LPS22HH_REG_STATUS] & (LPS22HH_STATUS_P_DA | LPS22HH_STATUS_T_DA)) &&
+                (data->regs[LPS22HH_REG_CTRL3] & LPS22HH_CTRL3_DRDY);
+
+    (void)gpio_emul_input_set(config->drdy.port, config->drdy.pin, level);
+}
+
+/**
+ * @brief One shot done, latch the sample into the output registers, clear ONE_SHOT and raise DRDY
+ *
+ * @param work Conversion work item
+ */
+static void sim_lps22hh_conversion_done(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct sim_lps22hh_data *data = CONTAINER_OF(dwork, struct sim_lps22hh_data, conversion);
+
+    sys_put_le24(data->pressure_raw, &data->regs[LPS22HH_REG_PRESS_OUT_XL]);
+    sys_put_le16((uint16_t)data->temp_raw, &data->regs[LPS22HH_REG_TEMP_OUT_L]);
+    data->regs[LPS22HH_REG_CTRL2] &= ~LPS22HH_CTRL2_ONE_SHOT;
+    data->regs[LPS22HH_REG_STATUS] |= LPS22HH_STATUS_P_DA | LPS22HH_STATUS_T_DA;
+    sim_lps22hh_update_drdy(data->target);
+}
+
+/**
+ * @brief Read one register, reading the high byte of a result clears its data available flag
+ *
+ * @param target Emulated sensor
+ * @param addr Register address
+ * @return uint8_t Register value
+ */
+static uint8_t sim_lps22hh_read(const struct emul *target, uint32_t addr)
+{
+    struct sim_lps22hh_data *data = target->data;
+    uint8_t value = data->regs[addr % LPS22HH_NUM_REGS];
+
+    if (addr == LPS22HH_REG_PRESS_OUT_H)
+    {
+        data->regs[LPS22HH_REG_STATUS] &= ~LPS22HH_STATUS_P_DA;
+        sim_lps22hh_update_drdy(target);
+    }
+    else if (addr == LPS22HH_REG_TEMP_OUT_H)
+    {
+        data->regs[LPS22HH_REG_STATUS] &= ~LPS22HH_STATUS_T_DA;
+        sim_lps22hh_update_drdy(target);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Write one register, setting ONE_SHOT starts a conversion, read only registers are left alone
+ *
+ * @param target Emulated sensor
+ * @param addr Register address
+ * @param value Register value
+ */
+static void sim_lps22hh_write(const struct emul *target, uint32_t addr, uint8_t value)
+{
+    const struct sim_lps22hh_config *config = target->cfg;
+    struct sim_lps22hh_data *data = target->data;
+
+    switch (addr)
+    {
+        case LPS22HH_REG_CTRL1:
+            data->regs[addr] = value;
+            break;
+        case LPS22HH_REG_CTRL2:
+            data->regs[addr] = value;
+            if (value & LPS22HH_CTRL2_ONE_SHOT)
+            {
+                k_work_reschedule(&data->conversion, K_USEC(config->conversion_us));
+            }
+            break;
+        case LPS22HH_REG_CTRL3:
+            data->regs[addr] = value;
+            sim_lps22hh_update_drdy(target);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief The register address increments only when IF_ADD_INC is set
+ *
+ * @param target Emulated sensor
+ * @param addr Current register address
+ * @return uint32_t Next register address
+ */
+static uint32_t sim_lps22hh_next_addr(const struct emul *target, uint32_t addr)
+{
+    const struct sim_lps22hh_data *data = target->data;
+
+    return (data->regs[LPS22HH_REG_CTRL2] & LPS22HH_CTRL2_IF_ADD_INC) ? ((addr + 1) % LPS22HH_NUM_REGS) : addr;
+}
+
+/**
+ * @brief I2C transfer addressed to the sensor
+ *
+ * @param target Emulated sensor
+ * @param msgs Messages of the transfer
+ * @param num_msgs Number of messages
+ * @param addr Device address
+ * @return int 0 on success, negative error code otherwise
+ */
+static int sim_lps22hh_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs, int addr)
+{
+    const struct sim_lps22hh_config *config = target->cfg;
+
+    ARG_UNUSED(addr);
+
+    return sim_i2c_map_transfer(target, &config->map, msgs, num_msgs);
+}
+
+static const struct i2c_emul_api sim_lps22hh_api =
+{
+    .transfer = sim_lps22hh_transfer,
+};
+
+/**
+ * @brief Power on reset of the registers. DRDY starts low, the firmware configures the pin later.
+ *
+ * @param target Emulated sensor
+ * @param parent Emulated I2C controller
+ * @return int 0 on success, -ENODEV if the DRDY pin is not ready
+ */
+static int sim_lps22hh_init(const struct emul *target, const struct device *parent)
+{
+    const struct sim_lps22hh_config *config = target->cfg;
+    struct sim_lps22hh_data *data = target->data;
+
+    ARG_UNUSED(parent);
+
+    if (!gpio_is_ready_dt(&config->drdy))
+    {
+        return -ENODEV;
+    }
+
+    data->target = target;
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[LPS22HH_REG_WHO_AM_I] = LPS22HH_WHO_AM_I_VALUE;
+    data->regs[LPS22HH_REG_CTRL2] = LPS22HH_CTRL2_IF_ADD_INC;
+    data->pressure_raw = LPS22HH_PRESSURE_RAW;
+    data->temp_raw = LPS22HH_TEMP_RAW;
+    k_work_init_delayable(&data->conversion, sim_lps22hh_conversion_done);
+
+    return 0;
+}
+
+#define SIM_LPS22HH_DEFINE(n)                                                                   \
+    static struct sim_lps22hh_data sim_lps22hh_data_##n;                                        \
+    static const struct sim_lps22hh_config sim_lps22hh_config_##n =                             \
+    {                                                                                           \
+        .map =                                                                                  \
+        {                                                                                       \
+            .addr_bytes = 1,                                                                    \
+            .bitrate = DT_PROP(DT_INST_BUS(n), clock_frequency),                                \
+            .read = sim_lps22hh_read,                                                           \
+            .write = sim_lps22hh_write,                                                         \
+            .next_addr = sim_lps22hh_next_addr,                                                 \
+        },                                                                                      \
+        .drdy = GPIO_DT_SPEC_INST_GET(n, drdy_gpios),                                           \
+        .conversion_us = DT_INST_PROP(n, conversion_time_us),                                   \
+    };                                                                                          \
+    EMUL_DT_INST_DEFINE(n, sim_lps22hh_init, &sim_lps22hh_data_##n, &sim_lps22hh_config_##n,    \
+                        &sim_lps22hh_api, NULL);                                                \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,                               \
+                          CONFIG_APPLICATION_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(SIM_LPS22HH_DEFINE)
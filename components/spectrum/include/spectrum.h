@@ -0,0 +1,54 @@
+#ifndef __SPECTRUM__
+#define __SPECTRUM__
+
+#include <stdint.h>
+
+#define SPECTRUM_FFT_SIZE           32                          // Samples of one window, one accelerometer FIFO capture
+#define SPECTRUM_BINS               (SPECTRUM_FFT_SIZE / 2 + 1) // One sided spectrum, DC to Nyquist
+#define SPECTRUM_MAX_BANDS          8
+#define SPECTRUM_MAX_PEAKS          8
+
+#define SPECTRUM_SUCCESS            0
+#define SPECTRUM_ERROR_CONFIG       -1
+
+#if defined(__ARM_FEATURE_SIMD32)
+#define SPECTRUM_KERNEL_NAME        "q15 SIMD"
+#else
+#define SPECTRUM_KERNEL_NAME        "q15 C"
+#endif
+
+/**
+ * @brief Bands and peaks to extract from a window
+ *
+ */
+typedef struct
+{
+    uint32_t odr_hz;                                    // Sample rate of the window
+    uint16_t band_edges_hz[SPECTRUM_MAX_BANDS + 1];     // Band b holds the bins from edge b included to edge b + 1 excluded
+    uint8_t  num_bands;                                 // Number of bands, up to SPECTRUM_MAX_BANDS
+    uint8_t  num_peaks;                                 // Number of peaks, up to SPECTRUM_MAX_PEAKS
+}spectrum_config_t;
+
+/**
+ * @brief Spectrum of a window, in the units of the samples
+ *
+ */
+typedef struct
+{
+    uint16_t band_rms[SPECTRUM_MAX_BANDS];              // RMS of the band, sqrt of its power
+    uint8_t  peak_bin[SPECTRUM_MAX_PEAKS];              // Largest local maxima first, frequency = bin * odr_hz / SPECTRUM_FFT_SIZE, 0 if none
+}spectrum_result_t;
+
+/**
+ * @brief Compute the band RMS and the peak frequencies of one window: the mean is removed, a Hann window applied and
+ *        a radix-2 q15 FFT run with block scaling. On cores with the DSP extension the butterflies use the SIMD
+ *        instructions, the result is bit exact with the portable C of other cores.
+ *
+ * @param samples SPECTRUM_FFT_SIZE samples of one axis
+ * @param config Bands and peaks to extract
+ * @param result Buffer to store the spectrum
+ * @return int SPECTRUM_SUCCESS or SPECTRUM_ERROR_CONFIG
+ */
+int spectrum_analyze(const int16_t *samples, const spectrum_config_t *config, spectrum_result_t *result);
+
+#endif // __SPECTRUM__
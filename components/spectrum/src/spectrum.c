@@ -0,0 +1,384 @@
+#include "spectrum.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#define SPECTRUM_USE_SIMD           1   // Cortex-M4 DSP extension: SHADD16, SHSUB16, SMLAD, SMLSDX
+#else
+#define SPECTRUM_USE_SIMD           0
+#endif
+
+#define SPECTRUM_FFT_STAGES         5
+#define Q15_SHIFT                   15
+#define Q15_ROUND                   (1L << (Q15_SHIFT - 1))
+
+// Largest input of the FFT. A stage never grows the complex magnitude, only the rounding of the twiddle multiply adds
+// at most one per stage, the lanes stay in the q15 range.
+#define SPECTRUM_INPUT_LIMIT        0x7800
+
+// The power of a Hann window is 3/8, the band power is scaled back by 8/3
+#define HANN_POWER_NUM              8
+#define HANN_POWER_DEN              3
+
+// A peak below 1/16 of the strongest (-12 dB) is leakage or rounding noise, it is not reported
+#define SPECTRUM_PEAK_FLOOR_SHIFT   4
+
+// Complex q15 packed in 32 bits, real in the low half, imaginary in the high half, the layout of the SIMD instructions
+#define PACK_Q15(re, im)            ((uint32_t)(uint16_t)(re) | ((uint32_t)(uint16_t)(im) << 16))
+
+_Static_assert((1 << SPECTRUM_FFT_STAGES) == SPECTRUM_FFT_SIZE, "FFT stages do not match the FFT size");
+
+// Periodic Hann window in q15, symmetric, w[n] = w[SPECTRUM_FFT_SIZE - n]
+static const int16_t hann_q15[SPECTRUM_FFT_SIZE / 2 + 1] =
+{
+    0, 315, 1247, 2761, 4799, 7282, 10114, 13188, 16384, 19580, 22654, 25486, 27969, 30007, 31521, 32453, 32767
+};
+
+// W^m = cos(2*pi*m/N) - j*sin(2*pi*m/N), packed as cos | sin
+static const uint32_t twiddle_q15[SPECTRUM_FFT_SIZE / 2] =
+{
+    PACK_Q15(32767, 0),      PACK_Q15(32138, 6393),   PACK_Q15(30274, 12540),  PACK_Q15(27246, 18205),
+    PACK_Q15(23170, 23170),  PACK_Q15(18205, 27246),  PACK_Q15(12540, 30274),  PACK_Q15(6393, 32138),
+    PACK_Q15(0, 32767),      PACK_Q15(-6393, 32138),  PACK_Q15(-12540, 30274), PACK_Q15(-18205, 27246),
+    PACK_Q15(-23170, 23170), PACK_Q15(-27246, 18205), PACK_Q15(-30274, 12540), PACK_Q15(-32138, 6393),
+};
+
+/**
+ * @brief Real part of a packed complex
+ *
+ * @param value Packed complex
+ * @return int32_t Real part
+ */
+static inline int32_t lane_re(uint32_t value)
+{
+    return (int16_t)(value & 0xFFFF);
+}
+
+/**
+ * @brief Imaginary part of a packed complex
+ *
+ * @param value Packed complex
+ * @return int32_t Imaginary part
+ */
+static inline int32_t lane_im(uint32_t value)
+{
+    return (int16_t)(value >> 16);
+}
+
+/**
+ * @brief (a + b) / 2 of two packed complex, rounded down
+ *
+ * @param a First complex
+ * @param b Second complex
+ * @return uint32_t Packed result
+ */
+static inline uint32_t halving_add(uint32_t a, uint32_t b)
+{
+#if (SPECTRUM_USE_SIMD)
+    return (uint32_t)__shadd16((int16x2_t)a, (int16x2_t)b);
+#else
+    return PACK_Q15((lane_re(a) + lane_re(b)) >> 1, (lane_im(a) + lane_im(b)) >> 1);
+#endif
+}
+
+/**
+ * @brief (a - b) / 2 of two packed complex, rounded down
+ *
+ * @param a First complex
+ * @param b Second complex
+ * @return uint32_t Packed result
+ */
+static inline uint32_t halving_sub(uint32_t a, uint32_t b)
+{
+#if (SPECTRUM_USE_SIMD)
+    return (uint32_t)__shsub16((int16x2_t)a, (int16x2_t)b);
+#else
+    return PACK_Q15((lane_re(a) - lane_re(b)) >> 1, (lane_im(a) - lane_im(b)) >> 1);
+#endif
+}
+
+/**
+ * @brief x * W of a packed complex and a packed twiddle, rounded to the nearest q15
+ *
+ * @param x Complex
+ * @param twiddle cos | sin of the twiddle
+ * @return uint32_t Packed result
+ */
+static inline uint32_t twiddle_multiply(uint32_t x, uint32_t twiddle)
+{
+    int32_t re;
+    int32_t im;
+
+#if (SPECTRUM_USE_SIMD)
+    re = __smlad((int16x2_t)x, (int16x2_t)twiddle, Q15_ROUND);
+    im = __smlsdx((int16x2_t)twiddle, (int16x2_t)x, Q15_ROUND);
+#else
+    re = (lane_re(x) * lane_re(twiddle)) + (lane_im(x) * lane_im(twiddle)) + Q15_ROUND;
+    im = (lane_re(twiddle) * lane_im(x)) - (lane_im(twiddle) * lane_re(x)) + Q15_ROUND;
+#endif
+
+    return PACK_Q15(re >> Q15_SHIFT, im >> Q15_SHIFT);
+}
+
+/**
+ * @brief Reverse the SPECTRUM_FFT_STAGES low bits of an index
+ *
+ * @param index Index
+ * @return uint8_t Bit reversed index
+ */
+static uint8_t bit_reverse(uint8_t index)
+{
+    uint8_t reversed = 0;
+
+    for (uint8_t bit = 0; bit < SPECTRUM_FFT_STAGES; bit++)
+    {
+        reversed = (uint8_t)((reversed << 1) | (index & 1));
+        index >>= 1;
+    }
+
+    return reversed;
+}
+
+/**
+ * @brief Integer square root, rounded down
+ *
+ * @param value Value
+ * @return uint32_t floor(sqrt(value))
+ */
+static uint32_t isqrt64(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+/**
+ * @brief Remove the mean, apply the window and scale the window up to SPECTRUM_INPUT_LIMIT
+ *
+ * @param samples SPECTRUM_FFT_SIZE samples
+ * @param data Buffer of SPECTRUM_FFT_SIZE packed complex for the FFT
+ * @return int8_t Block exponent, the FFT input is the windowed samples * 2^exponent
+ */
+static int8_t load_window(const int16_t *samples, uint32_t *data)
+{
+    int32_t windowed[SPECTRUM_FFT_SIZE];
+    int32_t sum = 0;
+    int32_t mean;
+    uint32_t peak = 0;
+    int8_t exponent = 0;
+
+    for (uint8_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+    {
+        sum += samples[n];
+    }
+    mean = (sum + ((sum >= 0) ? (SPECTRUM_FFT_SIZE / 2) : -(SPECTRUM_FFT_SIZE / 2))) / SPECTRUM_FFT_SIZE;
+
+    for (uint8_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+    {
+        int32_t window = hann_q15[(n <= SPECTRUM_FFT_SIZE / 2) ? n : (SPECTRUM_FFT_SIZE - n)];
+        uint32_t magnitude;
+
+        // A deviation is below 2^16, the product fits 32 bits
+        windowed[n] = (((samples[n] - mean) * window) + Q15_ROUND) >> Q15_SHIFT;
+        magnitude = (uint32_t)((windowed[n] < 0) ? -windowed[n] : windowed[n]);
+        if (magnitude > peak)
+        {
+            peak = magnitude;
+        }
+    }
+
+    if (peak == 0)
+    {
+        memset(data, 0, SPECTRUM_FFT_SIZE * sizeof(data[0]));
+        return 0;
+    }
+
+    // Block floating point: small vibrations use the whole q15 range, large ones are scaled down
+    while (peak > SPECTRUM_INPUT_LIMIT)
+    {
+        peak = (peak + 1) >> 1;
+        exponent--;
+    }
+    while ((peak << 1) <= SPECTRUM_INPUT_LIMIT)
+    {
+        peak <<= 1;
+        exponent++;
+    }
+
+    for (uint8_t n = 0; n < SPECTRUM_FFT_SIZE; n++)
+    {
+        int32_t value = (exponent >= 0) ? (windowed[n] * (1L << exponent)) :
+                                          ((windowed[n] + (1L << (-exponent - 1))) >> -exponent);
+
+        data[n] = PACK_Q15(value, 0);
+    }
+
+    return exponent;
+}
+
+/**
+ * @brief Radix-2 decimation in frequency FFT, every stage is scaled by 1/2, the output is X / SPECTRUM_FFT_SIZE in
+ *        bit reversed order
+ *
+ * @param data SPECTRUM_FFT_SIZE packed complex, transformed in place
+ */
+static void fft_q15(uint32_t *data)
+{
+    for (uint8_t span = SPECTRUM_FFT_SIZE / 2, step = 1; span > 0; span >>= 1, step <<= 1)
+    {
+        for (uint8_t start = 0; start < SPECTRUM_FFT_SIZE; start += 2 * span)
+        {
+            uint32_t a = data[start];
+            uint32_t b = data[start + span];
+
+            // W^0 = 1, no multiply
+            data[start] = halving_add(a, b);
+            data[start + span] = halving_sub(a, b);
+
+            for (uint8_t j = 1; j < span; j++)
+            {
+                a = data[start + j];
+                b = data[start + j + span];
+                data[start + j] = halving_add(a, b);
+                data[start + j + span] = twiddle_multiply(halving_sub(a, b), twiddle_q15[j * step]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Check the bands and peaks asked for
+ *
+ * @param config Bands and peaks to extract
+ * @return true if they can be extracted
+ */
+static bool is_config_valid(const spectrum_config_t *config)
+{
+    if ((config->odr_hz == 0) || (config->num_bands > SPECTRUM_MAX_BANDS) || (config->num_peaks > SPECTRUM_MAX_PEAKS))
+    {
+        return false;
+    }
+
+    for (uint8_t band = 0; band < config->num_bands; band++)
+    {
+        if (config->band_edges_hz[band] >= config->band_edges_hz[band + 1])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Compute the band RMS and the peak frequencies of one window: the mean is removed, a Hann window applied and
+ *        a radix-2 q15 FFT run with block scaling. On cores with the DSP extension the butterflies use the SIMD
+ *        instructions, the result is bit exact with the portable C of other cores.
+ *
+ * @param samples SPECTRUM_FFT_SIZE samples of one axis
+ * @param config Bands and peaks to extract
+ * @param result Buffer to store the spectrum
+ * @return int SPECTRUM_SUCCESS or SPECTRUM_ERROR_CONFIG
+ */
+int spectrum_analyze(const int16_t *samples, const spectrum_config_t *config, spectrum_result_t *result)
+{
+    uint32_t data[SPECTRUM_FFT_SIZE];
+    uint64_t power[SPECTRUM_BINS + 1] = {0};   // Scaled one sided power, DC and the bin past Nyquist stay 0
+    bool taken[SPECTRUM_BINS] = {false};
+    int8_t exponent;
+
+    memset(result, 0, sizeof(*result));
+
+    if (!is_config_valid(config))
+    {
+        return SPECTRUM_ERROR_CONFIG;
+    }
+
+    exponent = load_window(samples, data);
+    fft_q15(data);
+
+    for (uint8_t bin = 1; bin < SPECTRUM_BINS; bin++)
+    {
+        uint32_t value = data[bit_reverse(bin)];
+        uint64_t magnitude = (uint64_t)((int64_t)lane_re(value) * lane_re(value) + (int64_t)lane_im(value) * lane_im(value));
+
+        // The negative frequencies fold onto the positive ones, Nyquist has no twin
+        power[bin] = (bin < SPECTRUM_FFT_SIZE / 2) ? (2 * magnitude) : magnitude;
+    }
+
+    for (uint8_t band = 0; band < config->num_bands; band++)
+    {
+        uint64_t band_power = 0;
+        uint32_t rms;
+
+        for (uint8_t bin = 1; bin < SPECTRUM_BINS; bin++)
+        {
+            uint32_t frequency_x_size = bin * config->odr_hz;
+
+            if ((frequency_x_size >= (uint32_t)config->band_edges_hz[band] * SPECTRUM_FFT_SIZE) &&
+                (frequency_x_size < (uint32_t)config->band_edges_hz[band + 1] * SPECTRUM_FFT_SIZE))
+            {
+                band_power += power[bin];
+            }
+        }
+
+        // Square root before the block exponent is removed, the fraction bits of the scaled window are kept
+        rms = isqrt64((band_power * HANN_POWER_NUM) / HANN_POWER_DEN);
+        if (exponent >= 0)
+        {
+            rms = (exponent > 0) ? ((rms + (1UL << (exponent - 1))) >> exponent) : rms;
+        }
+        else
+        {
+            rms <<= -exponent;
+        }
+        result->band_rms[band] = (uint16_t)((rms > UINT16_MAX) ? UINT16_MAX : rms);
+    }
+
+    // Largest local maxima first, a tone between two bins shows as one peak
+    for (uint8_t peak = 0; peak < config->num_peaks; peak++)
+    {
+        uint8_t best_bin = 0;
+
+        for (uint8_t bin = 1; bin < SPECTRUM_BINS; bin++)
+        {
+            if (!taken[bin] && (power[bin] != 0) && (power[bin] >= power[bin - 1]) && (power[bin] > power[bin + 1]) &&
+                ((best_bin == 0) || (power[bin] > power[best_bin])))
+            {
+                best_bin = bin;
+            }
+        }
+
+        if ((best_bin == 0) ||
+            ((peak > 0) && (power[best_bin] < (power[result->peak_bin[0]] >> SPECTRUM_PEAK_FLOOR_SHIFT))))
+        {
+            break;
+        }
+        taken[best_bin] = true;
+        result->peak_bin[peak] = best_bin;
+    }
+
+    return SPECTRUM_SUCCESS;
+}
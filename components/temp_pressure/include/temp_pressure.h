@@ -3,8 +3,11 @@
 
 #include <stdint.h>
 
+#include "i2c_queue.h"
+
 #define TEMP_PRESSURE_ERROR 		-1
 #define TEMP_PRESSURE_SUCCESS 		 0
+#define TEMP_PRESSURE_DRDY_TIMEOUT 	-2
 
 /**
  * @brief Temperature and Pressure sensor data
@@ -25,6 +28,13 @@ typedef struct
  */
 int app_temp_pressure_trigger(void);
 
+/**
+ * @brief Set up the one shot trigger as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void app_temp_pressure_trigger_txn(i2c_txn_t *txn);
+
 /**
  * @brief Read temperature and pressure sensor
  * 
@@ -33,6 +43,16 @@ int app_temp_pressure_trigger(void);
  */
 int app_temp_pressure_read(temp_pressure_data_t *temp_pressure_data);
 
+/**
+ * @brief Read the temperature and pressure of a conversion which is already done, without waiting for DRDY
+ * 
+ * @note For a caller which has seen DRDY, e.g. the sensor scheduler
+ * 
+ * @param temp_pressure_data Buffer to store temperature and pressure data
+ * @return int error code
+ */
+int app_temp_pressure_fetch(temp_pressure_data_t *temp_pressure_data);
+
 /**
  * @brief Configure temperature and pressure sensor to enable interrupt on DRDY pin
  * 
@@ -40,5 +60,12 @@ int app_temp_pressure_read(temp_pressure_data_t *temp_pressure_data);
  */
 int enable_temp_pressure_sensor_interrupt_config(void);
 
+/**
+ * @brief Set up the DRDY interrupt configuration as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void temp_pressure_interrupt_config_txn(i2c_txn_t *txn);
+
 
 #endif // __TEMP_PRESSURE__
@@ -18,6 +18,7 @@
 #include "device_config.h"
 #include "config_commands.h"
 #include "i2c_sensors.h"
+#include "i2c_queue.h"
 #include "app_gpio.h"
 
 LOG_MODULE_DECLARE(wepower);
@@ -31,12 +32,16 @@ LOG_MODULE_DECLARE(wepower);
 #define ENABLE_DRDY_INTERRUPT_COMMAND			0x04
 #define ENABLE_ONE_SHOT_AND_ADDR_INC_COMMAND	0x11
 
-#define TEMP_PRESSURE_SENSOR_DATA_READY_TIMEOUT		100
+#define TEMP_PRESSURE_SENSOR_DATA_READY_TIMEOUT_MSEC	10
 #define TEMP_PRESSURE_SENSOR_READING_BUFFER_SIZE 	5
 
 #define TEMP_PRESSURE_SENSOR_READ_REG_START_ADDR	0x28
 
-const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
+const struct device *const i2c_dev = DEVICE_DT_GET(SENSOR_I2C_NODE);
+
+// Not const, I2C queue transactions write them in place
+static uint8_t interrupt_config_command = ENABLE_DRDY_INTERRUPT_COMMAND;
+static uint8_t trigger_command = ENABLE_ONE_SHOT_AND_ADDR_INC_COMMAND;
 
 /**
  * @brief Configure temperature and pressure sensor to enable interrupt on DRDY pin
@@ -45,15 +50,13 @@ const struct device *const i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
  */
 int enable_temp_pressure_sensor_interrupt_config(void)
 {
-	uint8_t config = ENABLE_DRDY_INTERRUPT_COMMAND;
-
 	if (!device_is_ready(i2c_dev)) 
 	{
 		LOG_ERR("Temperatue and pressure sensor interrupt config failed - I2C device is not ready");
 		return TEMP_PRESSURE_ERROR;
 	}
 
-	return i2c_write_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_CNTRL_REG3_ADDR, &config, sizeof(config), TEMP_PRESSURE_SENSOR_I2C_ADDR);
+	return i2c_write_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_CNTRL_REG3_ADDR, &interrupt_config_command, sizeof(interrupt_config_command), TEMP_PRESSURE_SENSOR_I2C_ADDR);
 }
 
 /**
@@ -63,14 +66,32 @@ int enable_temp_pressure_sensor_interrupt_config(void)
  */
 int app_temp_pressure_trigger(void)
 {
-	uint8_t trigger = ENABLE_ONE_SHOT_AND_ADDR_INC_COMMAND; 
-
 	if (!device_is_ready(i2c_dev)) {
 		LOG_ERR("Temperature and Pressure sensor trigger config failed - I2C device not ready");
 		return TEMP_PRESSURE_ERROR;
 	}
 
-	return i2c_write_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_CNTRL_REG2_ADDR, &trigger, sizeof(trigger), TEMP_PRESSURE_SENSOR_I2C_ADDR);
+	return i2c_write_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_CNTRL_REG2_ADDR, &trigger_command, sizeof(trigger_command), TEMP_PRESSURE_SENSOR_I2C_ADDR);
+}
+
+/**
+ * @brief Set up the DRDY interrupt configuration as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void temp_pressure_interrupt_config_txn(i2c_txn_t *txn)
+{
+	i2c_txn_write(txn, i2c_dev, TEMP_PRESSURE_SENSOR_I2C_ADDR, TEMP_PRESSURE_SENSOR_CNTRL_REG3_ADDR, sizeof(uint8_t), &interrupt_config_command, sizeof(interrupt_config_command));
+}
+
+/**
+ * @brief Set up the one shot trigger as a transaction of an I2C queue chain
+ * 
+ * @param txn Transaction to set up
+ */
+void app_temp_pressure_trigger_txn(i2c_txn_t *txn)
+{
+	i2c_txn_write(txn, i2c_dev, TEMP_PRESSURE_SENSOR_I2C_ADDR, TEMP_PRESSURE_SENSOR_CNTRL_REG2_ADDR, sizeof(uint8_t), &trigger_command, sizeof(trigger_command));
 }
 
 
@@ -82,19 +103,34 @@ int app_temp_pressure_trigger(void)
  */
 int app_temp_pressure_read(temp_pressure_data_t *temp_pressure_data)
 {
-	uint8_t buffer_to_read_data[TEMP_PRESSURE_SENSOR_READING_BUFFER_SIZE];
-	uint16_t timeout = TEMP_PRESSURE_SENSOR_DATA_READY_TIMEOUT;
-	while (!get_tps_drdy_pin_status() && timeout--)
-	{
-		k_usleep (100);
-	}
+	// The CPU sleeps until the DRDY interrupt
+	int ret = wait_for_tps_drdy(K_MSEC(TEMP_PRESSURE_SENSOR_DATA_READY_TIMEOUT_MSEC));
 
-	if (timeout == 0)
+	if (ret == -EAGAIN)
 	{	
 		LOG_ERR("Temperature and Pressure sensor DRDY timeout");
+		return TEMP_PRESSURE_DRDY_TIMEOUT;
+	}
+	else if (ret)
+	{
+		LOG_ERR("Unable to wait for Temperature and Pressure sensor DRDY, error code %d", ret);
 		return TEMP_PRESSURE_ERROR;
 	}
 
+	return app_temp_pressure_fetch(temp_pressure_data);
+}
+
+/**
+ * @brief Read the temperature and pressure of a conversion which is already done, without waiting for DRDY
+ * 
+ * @param temp_pressure_data Buffer to store temperature and pressure data
+ * @return int error code
+ */
+int app_temp_pressure_fetch(temp_pressure_data_t *temp_pressure_data)
+{
+	uint8_t buffer_to_read_data[TEMP_PRESSURE_SENSOR_READING_BUFFER_SIZE];
+	int ret;
+
 	if (!device_is_ready(i2c_dev)) 
 	{
 		LOG_ERR("Temperature and Pressure sensor reading failed - I2C device not ready");
@@ -105,7 +141,7 @@ int app_temp_pressure_read(temp_pressure_data_t *temp_pressure_data)
 	temp_pressure_data->pressure = 0x8000;
 	temp_pressure_data->temp = 0x8000;
 	
-	int ret = i2c_read_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_READ_REG_START_ADDR, buffer_to_read_data, TEMP_PRESSURE_SENSOR_READING_BUFFER_SIZE, TEMP_PRESSURE_SENSOR_I2C_ADDR);
+	ret = i2c_read_bytes(i2c_dev, TEMP_PRESSURE_SENSOR_READ_REG_START_ADDR, buffer_to_read_data, TEMP_PRESSURE_SENSOR_READING_BUFFER_SIZE, TEMP_PRESSURE_SENSOR_I2C_ADDR);
     if (ret) 
     {
 		LOG_ERR("Temprature and Pressure sensor reading failed - I2C reading failed");
@@ -0,0 +1,57 @@
+#ifndef __APP_ACCEL_FEATURES__
+#define __APP_ACCEL_FEATURES__
+
+#include <stdint.h>
+
+#include "accel.h"
+#include "device_config.h"
+#include "spectrum.h"
+
+#define ACCEL_AXES  3
+
+/**
+ * @brief Features of one axis of a capture, fixed point
+ *
+ */
+typedef struct
+{
+    int16_t  mean;          // DC of the axis, gravity and tilt, m/s^2 * 1000
+    uint16_t rms;           // RMS around the mean, m/s^2 * 1000
+    uint16_t peak;          // Largest distance from the mean, m/s^2 * 1000
+    uint8_t  crest_q4;      // peak / rms in Q4.4, saturated at 0xFF, 0 when rms is 0
+}accel_axis_features_t;
+
+/**
+ * @brief Features of a capture, X, Y and Z
+ *
+ */
+typedef struct
+{
+    accel_axis_features_t axis[ACCEL_AXES];
+}accel_features_t;
+
+/**
+ * @brief Compute the per axis mean, RMS, peak and crest factor of a capture, in fixed point
+ *
+ * @param samples Samples of the capture
+ * @param num_samples Number of samples, at least 1
+ * @param features Buffer to store the features
+ */
+void accel_compute_features(const accel_data_t *samples, uint8_t num_samples, accel_features_t *features);
+
+#if (USE_ACCEL_SPECTRUM)
+/**
+ * @brief Compute the spectrum of the axis of a capture with the largest RMS: RMS of the SPECTRUM_BAND_EDGES_HZ bands
+ *        and the strongest SPECTRUM_PAYLOAD_PEAKS peaks
+ *
+ * @param samples SPECTRUM_FFT_SIZE samples of the capture
+ * @param features Features of the capture, from accel_compute_features()
+ * @param axis Buffer to store the axis of the spectrum, 0 for X, 1 for Y, 2 for Z
+ * @param spectrum Buffer to store the spectrum
+ * @return int SPECTRUM_SUCCESS or the error of spectrum_analyze()
+ */
+int accel_compute_spectrum(const accel_data_t *samples, const accel_features_t *features, uint8_t *axis,
+                           spectrum_result_t *spectrum);
+#endif
+
+#endif // __APP_ACCEL_FEATURES__
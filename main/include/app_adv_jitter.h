@@ -0,0 +1,30 @@
+#ifndef __APP_ADV_JITTER__
+#define __APP_ADV_JITTER__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Seed the repeat jitter of an event. The same serial number and event counter
+ *        always give the same sequence, so receivers and simulations can replay it.
+ *
+ * @param serial_number Serial number of the device
+ * @param event_counter Event counter sent in the payload of the event
+ */
+void adv_jitter_seed(uint32_t serial_number, uint32_t event_counter);
+
+/**
+ * @brief Tell if fram_data.jitter_policy changes the advertising parameters of each start
+ *
+ * @return true if a jitter is set
+ */
+bool is_adv_jitter_enabled(void);
+
+/**
+ * @brief Spacing before the next repeat, fram_data.packet_interval plus a draw up to the jitter of the policy
+ *
+ * @return uint32_t Interval in ms
+ */
+uint32_t adv_jitter_next_interval_ms(void);
+
+#endif // __APP_ADV_JITTER__
@@ -0,0 +1,68 @@
+#ifndef __APP_BOOT_TRACE__
+#define __APP_BOOT_TRACE__
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Stages of the business boot, from reset to the first packet on air.
+ *        Each stage is timestamped when it ends, and lasts from the end of the stage reached just before it.
+ *
+ */
+typedef enum
+{
+    BOOT_STAGE_KERNEL = 0,          // Reset until main() is entered
+    BOOT_STAGE_COMPARATOR,          // init_comparator_1_vext_and_read_value
+    BOOT_STAGE_ACCEL_CONFIG,        // app_accel_config
+    BOOT_STAGE_TPS_CONFIG,          // enable_temp_pressure_sensor_interrupt_config
+    BOOT_STAGE_SENSOR_TRIGGER,      // sensor_scheduler_trigger_all
+    BOOT_STAGE_FRAM_READ,           // dump_fram
+    BOOT_STAGE_POLARITY,            // read_polarity
+    BOOT_STAGE_BT_INIT,             // initialize_bluetooth, or the wait for the asynchronous bt_enable
+    BOOT_STAGE_MANUF_DATA,          // update_manufacture_data
+    BOOT_STAGE_ADV_SUBMIT,          // first advertising work submitted
+    BOOT_STAGE_ADV_START,           // first bt_le_ext_adv_start returned, packet is with the controller
+    BOOT_STAGE_MAX                  // Number of boot stages
+}boot_stage_t;
+
+/**
+ * @brief Boot trace sub commands of the b/B CLI command
+ *
+ */
+typedef enum
+{
+    BOOT_TRACE_COMMAND_DUMP  = 0,
+    BOOT_TRACE_COMMAND_CLEAR = 1,
+}boot_trace_command_t;
+
+#if (USE_BOOT_TRACE)
+/**
+ * @brief Timestamp the end of a boot stage. Only the first mark of a stage in a boot is kept.
+ *        Marking BOOT_STAGE_ADV_START queues the write of the trace to the FRAM ring.
+ *
+ * @param stage Stage which just ended
+ */
+void boot_trace_mark(boot_stage_t stage);
+
+/**
+ * @brief Get the timestamp of the end of a boot stage in the current boot
+ *
+ * @param stage Boot stage
+ * @return uint32_t k_cycle_get_32() at the end of the stage, 0 if not reached yet
+ */
+uint32_t boot_trace_get_stage_cycles(boot_stage_t stage);
+#else
+static inline void boot_trace_mark(boot_stage_t stage) { ARG_UNUSED(stage); }
+static inline uint32_t boot_trace_get_stage_cycles(boot_stage_t stage) { ARG_UNUSED(stage); return 0; }
+#endif
+
+/**
+ * @brief Handle the boot trace command from the CLI
+ *
+ * @param sub_command Sub command to run (boot_trace_command_t)
+ */
+void handle_boot_trace_command(uint8_t sub_command);
+
+#endif // __APP_BOOT_TRACE__
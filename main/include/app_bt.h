@@ -4,8 +4,16 @@
 #include <stdio.h>
 #include <zephyr/kernel.h>
 
+#include "device_config.h"
+
 extern struct k_work start_advertising_work_item;
 
+/**
+ * @brief Callback type for the end of an advertising burst
+ * 
+ */
+typedef void (*adv_burst_complete_cb_t)(void);
+
 /**
  * @brief BT ready function. Should be called after bluetooth is enabled
  *        successfully. 
@@ -21,6 +29,13 @@ int bt_ready(void);
  */
 void start_advertising_handler(struct k_work *work);
 
+/**
+ * @brief Register the function called when the controller has sent the whole event burst
+ * 
+ * @param cb Callback, called from the system work queue
+ */
+void register_adv_burst_complete_cb(adv_burst_complete_cb_t cb);
+
 /**
  * @brief Initialize Bluetooth for WePower Board
  * 
@@ -28,4 +43,65 @@ void start_advertising_handler(struct k_work *work);
  */
 uint8_t initialize_bluetooth();
 
+/**
+ * @brief Wait until Bluetooth is enabled and the advertising set is created, then apply the
+ *        advertising interval from FRAM. Only applies the interval when bt_enable is synchronous.
+ * 
+ * @note fram_data has to be read before calling this
+ * 
+ * @return uint8_t error code, 0 if successful
+ */
+uint8_t wait_for_bluetooth_ready(void);
+
+/**
+ * @brief Get the number of packets the controller has sent since boot
+ * 
+ * @return uint32_t Number of advertising packets
+ */
+uint32_t get_adv_packets_sent(void);
+
+/**
+ * @brief Get the number of primary channels the advertising options leave on
+ * 
+ * @return uint8_t Primary channels carrying the ADV_EXT_IND of a packet, 1 to 3
+ */
+uint8_t get_adv_primary_channel_count(void);
+
+/**
+ * @brief Tell if the AUX_ADV_IND of a packet goes on the 2M PHY
+ * 
+ * @return true on 2M, false on 1M
+ */
+bool is_adv_aux_phy_2m(void);
+
+#if (USE_PERIODIC_STREAM)
+/**
+ * @brief Set the frame sent by the following periodic advertising events
+ * 
+ * @param frame Manufacturer data of the frame
+ * @param frame_len Length of the frame
+ * @return int error code, 0 if successful
+ */
+int update_stream_advertising(uint8_t *frame, uint8_t frame_len);
+
+/**
+ * @brief Start the periodic advertising train with its first frame. The extended advertising runs along at
+ *        STREAM_EXT_ADV_INTERVAL_MS, scanners find the train through its sync info.
+ * 
+ * @note Call once the burst of the event is over, the set is stopped
+ * 
+ * @param frame Manufacturer data of the first frame
+ * @param frame_len Length of the frame
+ * @return int error code, 0 if successful
+ */
+int start_stream_advertising(uint8_t *frame, uint8_t frame_len);
+
+/**
+ * @brief Stop the periodic advertising train and the extended advertising along with it. The set is left with
+ *        the interval from FRAM for the next event.
+ * 
+ */
+void stop_stream_advertising(void);
+#endif
+
 #endif // __APP_BT__
@@ -0,0 +1,32 @@
+#ifndef __APP_DEVICE_CAPS__
+#define __APP_DEVICE_CAPS__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/sys/util.h>
+
+#define DEVICE_CAP_ACCEL            BIT(0)      // Payload carries the accelerometer data
+#define DEVICE_CAP_TEMP_PRESSURE    BIT(1)      // Payload carries the temperature and pressure
+#define DEVICE_CAP_POLARITY         BIT(2)      // Payload carries the polarity read at boot
+#define DEVICE_CAP_STREAM           BIT(3)      // Streams accelerometer frames on periodic advertising after the burst
+#define DEVICE_CAP_ACCEL_FIFO       BIT(4)      // Payload carries the features of an accelerometer FIFO capture
+#define DEVICE_CAP_SENSORS          (DEVICE_CAP_ACCEL | DEVICE_CAP_TEMP_PRESSURE)
+
+/**
+ * @brief Get the peripherals the payload of a device type needs
+ *
+ * @param type Device type from FRAM
+ * @return uint8_t DEVICE_CAP_* mask, 0 for unknown types
+ */
+uint8_t get_device_capabilities(uint8_t type);
+
+/**
+ * @brief Read the device type without loading the whole FRAM, from the prebuilt frame when it is already loaded
+ *
+ * @param is_prebuilt_frame_loaded fram_data.type was set by load_prebuilt_frame()
+ * @param type Buffer to store the device type
+ * @return int FRAM_SUCCESS or FRAM_ERROR
+ */
+int read_boot_device_type(bool is_prebuilt_frame_loaded, uint8_t *type);
+
+#endif // __APP_DEVICE_CAPS__
@@ -1,6 +1,7 @@
 #ifndef __APP_ENCRYPT__
 #define __APP_ENCRYPT__
 
+#include <stdbool.h>
 #include <zephyr/kernel.h>
 
 
@@ -10,7 +11,69 @@
  * @param clear_text_buf     Buffer containing un-encrypted text
  * @param encrypted_text_buf Buffer containing encrypted text
  * @param len                Length of the text to encrypt 
+ * @param event_counter      Event counter of the payload, used by the CTR mode
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_ENC, PAYLOAD_ENCRYPTION_STATUS_CTR or PAYLOAD_ENCRYPTION_STATUS_CLEAR
  */
-void encrypt_data(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len );
+uint8_t encrypt_data(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter);
+
+/**
+ * @brief Compute the keystream of an upcoming event, so encrypt_data() only has to XOR.
+ *        Does nothing unless PAYLOAD_CIPHER_MODE is PAYLOAD_CIPHER_CTR.
+ * 
+ * @param event_counter Event counter of the upcoming event
+ */
+void prepare_payload_keystream(uint32_t event_counter);
+
+/**
+ * @brief Tell if the payload cipher can send an event counter. The CTR payload stops at the end of its 24 bit
+ *        counter field, a wrapped counter would repeat the keystream of an earlier event. A new key is needed then.
+ * 
+ * @param event_counter Event counter of the payload
+ * @return true if a payload can be sent for the counter
+ */
+bool is_event_counter_usable(uint32_t event_counter);
+
+/**
+ * @brief Tell if a MIC length from FRAM selects the AES-CCM payload
+ * 
+ * @param mic_len MIC length in bytes
+ * @return true for the even lengths from 4 to 16 bytes defined by CCM
+ */
+bool is_ccm_mic_length(uint8_t mic_len);
+
+/**
+ * @brief Encrypt and authenticate the data with AES-CCM.
+ *        Nonce: event counter (LE) | serial number (LE) | 'W' 'P' 0 0 0
+ * 
+ * @param clear_text_buf     Buffer containing un-encrypted text
+ * @param encrypted_text_buf Buffer containing encrypted text
+ * @param len                Length of the text to encrypt 
+ * @param event_counter      Event counter of the payload
+ * @param aad                Frame bytes sent in clear and covered by the MIC
+ * @param aad_len            Length of aad
+ * @param mic                Buffer for the MIC
+ * @param mic_len            MIC length, see is_ccm_mic_length()
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_CCM or PAYLOAD_ENCRYPTION_STATUS_CLEAR
+ */
+uint8_t encrypt_data_ccm(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter,
+                         uint8_t* aad, uint8_t aad_len, uint8_t* mic, uint8_t mic_len);
+
+/**
+ * @brief Encrypt and authenticate a frame of the periodic advertising stream with AES-CCM.
+ *        Nonce: event counter (LE) | serial number (LE) | 'W' 'S' | frame sequence (LE) | 0
+ * 
+ * @param clear_text_buf     Buffer containing un-encrypted samples
+ * @param encrypted_text_buf Buffer containing encrypted samples
+ * @param len                Length of the samples to encrypt
+ * @param event_counter      Event counter of the event the stream follows
+ * @param sequence           Sequence number of the frame in the stream
+ * @param aad                Frame bytes sent in clear and covered by the MIC
+ * @param aad_len            Length of aad
+ * @param mic                Buffer for the MIC
+ * @param mic_len            MIC length, see is_ccm_mic_length()
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_CCM or PAYLOAD_ENCRYPTION_STATUS_CLEAR
+ */
+uint8_t encrypt_stream_data_ccm(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter,
+                                uint16_t sequence, uint8_t* aad, uint8_t aad_len, uint8_t* mic, uint8_t mic_len);
 
 #endif // __APP_ENCRYPT__
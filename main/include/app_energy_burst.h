@@ -0,0 +1,68 @@
+#ifndef __APP_ENERGY_BURST__
+#define __APP_ENERGY_BURST__
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Burst history sub commands of the h/H CLI command
+ *
+ */
+typedef enum
+{
+    BURST_HISTORY_COMMAND_DUMP  = 0,
+    BURST_HISTORY_COMMAND_CLEAR = 1,
+}burst_history_command_t;
+
+/**
+ * @brief Start the burst of an event, before its first packet is queued. With the SAADC only ENERGY_BURST_PROBE_PACKETS
+ *        packets are allowed until VBULK has been measured.
+ *
+ * @param event_counter Event counter sent in the payload of the event, kept in the burst history
+ */
+void energy_burst_begin(uint32_t event_counter);
+
+/**
+ * @brief Report the progress of the burst and get the number of packets the event may send.
+ *        From a thread VBULK is measured and the limit follows the energy left above the brown-out,
+ *        from an interrupt the last limit is returned.
+ *
+ * @note The packets sent so far are the packets before the one TX_Repeat_Counter numbers,
+ *       TX_Repeat_Counter - TX_REPEAT_COUNTER_DEFAULT_VALUE, whichever context reports them.
+ *
+ * @return uint16_t Packets the event may send, the burst stops once the repeat counter goes beyond it
+ */
+uint16_t energy_burst_update(void);
+
+/**
+ * @brief Cap the packets of the event, whatever the energy left. The cap holds for the following events until it is set again.
+ *        Set before energy_burst_begin() it applies to the whole burst, set during the burst the packets already sent stay sent.
+ *
+ * @param max_packets Most packets the event may send, UINT16_MAX for no cap
+ */
+void energy_burst_limit_packets(uint16_t max_packets);
+
+/**
+ * @brief Get the number of packets the event may send, as of the last measurement
+ *
+ * @return uint16_t Packets the event may send
+ */
+uint16_t energy_burst_get_packet_limit(void);
+
+/**
+ * @brief End the burst of the event: VBULK is measured once more and the event is written to the FRAM burst history.
+ *        Must be called from a thread, the FRAM is written.
+ *
+ */
+void energy_burst_end(void);
+
+/**
+ * @brief Handle the burst history command from the CLI
+ *
+ * @param sub_command Sub command to run (burst_history_command_t)
+ */
+void handle_burst_history_command(uint8_t sub_command);
+
+#endif // __APP_ENERGY_BURST__
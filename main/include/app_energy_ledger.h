@@ -0,0 +1,67 @@
+#ifndef __APP_ENERGY_LEDGER__
+#define __APP_ENERGY_LEDGER__
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Stages of an event in the energy ledger. A stage holds everything from the previous mark to its own mark,
+ *        the stages of a boot and of a repeat event are not reached in the same order.
+ *
+ */
+typedef enum
+{
+    ENERGY_STAGE_STARTUP = 0,       // Wake up until the first packet is queued: comparator, BT bring up, sensor config
+    ENERGY_STAGE_PAYLOAD,           // Payload of the event: sensor reads, encryption, FRAM update
+    ENERGY_STAGE_BURST,             // Rest of the event until the last packet is sent
+    ENERGY_STAGE_MAX                // Number of ledger stages
+}energy_stage_t;
+
+/**
+ * @brief Energy ledger sub commands of the e/E CLI command
+ *
+ */
+typedef enum
+{
+    ENERGY_LEDGER_COMMAND_DUMP  = 0,
+    ENERGY_LEDGER_COMMAND_CLEAR = 1,
+    ENERGY_LEDGER_COMMAND_MODEL = 2,
+}energy_ledger_command_t;
+
+#if (USE_ENERGY_LEDGER)
+/**
+ * @brief Open the ledger of an event: VBULK and the operation counters are the start of its first stage
+ *
+ */
+void energy_ledger_begin(void);
+
+/**
+ * @brief End a stage of the event: VBULK is measured, the time, the energy and the operations since the previous mark
+ *        are added to the stage
+ *
+ * @param stage Stage which just ended
+ */
+void energy_ledger_mark(energy_stage_t stage);
+
+/**
+ * @brief End the burst stage and write the ledger of the event in the next slot of the FRAM ring.
+ *        Must be called from a thread, the FRAM is written.
+ *
+ */
+void energy_ledger_end(void);
+#else
+static inline void energy_ledger_begin(void) { }
+static inline void energy_ledger_mark(energy_stage_t stage) { ARG_UNUSED(stage); }
+static inline void energy_ledger_end(void) { }
+#endif
+
+/**
+ * @brief Handle the energy ledger command from the CLI
+ *
+ * @param sub_command Sub command to run (energy_ledger_command_t)
+ */
+void handle_energy_ledger_command(uint8_t sub_command);
+
+#endif // __APP_ENERGY_LEDGER__
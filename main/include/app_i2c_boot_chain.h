@@ -0,0 +1,68 @@
+#ifndef __APP_I2C_BOOT_CHAIN__
+#define __APP_I2C_BOOT_CHAIN__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Transactions of the boot chains. The sensor chain runs on the sensor bus, the FRAM chain on the FRAM bus.
+ *
+ */
+typedef enum
+{
+    BOOT_CHAIN_ACCEL_CONFIG = 0,    // app_accel_config, the accelerometer is triggered once it is done
+    BOOT_CHAIN_ACCEL_FIFO_MODE,     // FIFO mode of the accelerometer capture
+    BOOT_CHAIN_ACCEL_FIFO_START,    // Continuous conversions, the FIFO fills from then on
+    BOOT_CHAIN_TPS_CONFIG,          // enable_temp_pressure_sensor_interrupt_config
+    BOOT_CHAIN_TPS_TRIGGER,         // app_temp_pressure_trigger
+    BOOT_CHAIN_SENSOR_MAX,          // Number of transactions of the sensor chain
+    BOOT_CHAIN_FRAM_READ = BOOT_CHAIN_SENSOR_MAX,   // fram_data_t and the counter journal, alone in the FRAM chain
+    BOOT_CHAIN_MAX                  // Number of transactions
+}boot_chain_step_t;
+
+/**
+ * @brief Timing of the last boot chains, all in us
+ *
+ */
+typedef struct
+{
+    uint8_t  step_mask;                     // BIT(step) of every transaction run, the others were not needed by the device type
+    int      result[BOOT_CHAIN_MAX];        // i2c_transfer() result of every transaction
+    uint32_t latency_us[BOOT_CHAIN_MAX];    // Submit of its chain to the end of every transaction
+    uint32_t busy_us[BOOT_CHAIN_MAX];       // Time every transaction held its bus
+    uint32_t wall_us;                       // First submit to the caller woken up by the last chain
+    bool     is_split_bus;                  // FRAM and sensors are on different buses
+    bool     is_serial;                     // The FRAM chain was only submitted once the sensor chain was done
+}boot_chain_report_t;
+
+/**
+ * @brief Configure and trigger the sensors a device type needs and read the FRAM, sleeping until it is done.
+ *        The sensor chain and the FRAM chain run in parallel when the devicetree puts them on different buses.
+ *        fram_data is loaded as by dump_fram().
+ *
+ * @param print Flag to indicate if the FRAM content should be printed
+ * @param capabilities DEVICE_CAP_* mask of the sensors to configure and trigger, see get_device_capabilities()
+ * @return int32_t FRAM_SUCCESS or FRAM_ERROR, sensor errors are left to sensor_scheduler_collect()
+ */
+int32_t i2c_boot_chain_run(uint8_t print, uint8_t capabilities);
+
+/**
+ * @brief Same as i2c_boot_chain_run(), with the FRAM chain submitted once the sensor chain is done.
+ *        Takes the time of a one bus layout, used to benchmark the bus layouts.
+ *
+ * @param print Flag to indicate if the FRAM content should be printed
+ * @param capabilities DEVICE_CAP_* mask of the sensors to configure and trigger
+ * @return int32_t FRAM_SUCCESS or FRAM_ERROR
+ */
+int32_t i2c_boot_chain_run_serial(uint8_t print, uint8_t capabilities);
+
+/**
+ * @brief Get the timing of the last boot chains
+ *
+ * @param report Buffer to store the timing
+ */
+void i2c_boot_chain_get_report(boot_chain_report_t *report);
+
+#endif // __APP_I2C_BOOT_CHAIN__
@@ -3,16 +3,39 @@
 
 #include <zephyr/kernel.h>
 #include "device_config.h"
+#include "app_types.h"
 
-extern uint8_t manufacture_data[PAYLOAD_FRAME_LENGTH];
+extern uint8_t manufacture_data[PAYLOAD_FRAME_MAX_LENGTH];
+extern uint8_t manufacture_data_len;
 extern uint8_t TX_Repeat_Counter;
 
 /**
  * @brief Update the manufacture data
  * 
- * @note only call this ONCE per EventCounter (FRAM[0:3])
+ * @note only call this ONCE per EventCounter (FRAM[0:3]). When the prebuilt frame is on air a measured payload
+ *       replaces it under the next event counter, the event then ends with a counter two above the last one.
  * 
+ * @return true if the event has a frame to send, false if the payload cipher can't take the next event counter
  */
-void update_manufacture_data(void);
+bool update_manufacture_data(void);
+
+/**
+ * @brief Build a complete advertising frame from a clear payload
+ * 
+ * @param payload       Clear payload, type dependent bytes already filled
+ * @param event_counter Event counter the frame is sent for
+ * @param frame         Buffer of PAYLOAD_FRAME_MAX_LENGTH bytes for the frame, must not be manufacture_data
+ * @return uint8_t      Length of the frame
+ */
+uint8_t build_manufacture_frame(we_power_data_ble_adv_t *payload, uint32_t event_counter, uint8_t *frame);
+
+/**
+ * @brief Build the first packet of the next event (event counter + 1) and store it in FRAM,
+ *        so the next boot can send it before the sensors and FRAM are serviced
+ * 
+ * @note call after update_manufacture_data(), once the current event is advertising
+ * 
+ */
+void prebuild_next_manufacture_data(void);
 
 #endif // __APP_MANUF_DATA__
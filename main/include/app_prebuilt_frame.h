@@ -0,0 +1,56 @@
+#ifndef __APP_PREBUILT_FRAME__
+#define __APP_PREBUILT_FRAME__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+#define PREBUILT_FRAME_VARIANTS     2   // One frame per polarity, the two-way switch picks it once the polarity is read
+
+/**
+ * @brief Tell if the first packet of a device type can be built by the previous event
+ * 
+ * @param type Device type from FRAM
+ * @return true if the type sends a prebuilt first packet
+ */
+bool is_prebuilt_frame_type(uint8_t type);
+
+/**
+ * @brief Store the first packet of the next event in FRAM
+ * 
+ * @param event_counter Event counter the frames were built for
+ * @param frames        One complete frame per polarity
+ * @param frame_lens    Length of each frame
+ * @return int FRAM_SUCCESS or FRAM_ERROR
+ */
+int store_prebuilt_frame(uint32_t event_counter, uint8_t frames[PREBUILT_FRAME_VARIANTS][PAYLOAD_FRAME_MAX_LENGTH], uint8_t *frame_lens);
+
+/**
+ * @brief Read the prebuilt frame stored by the previous event. When it is valid, the fields
+ *        needed to advertise it are copied into fram_data until dump_fram() reads the whole FRAM.
+ * 
+ * @return true if a valid prebuilt frame was loaded
+ */
+bool load_prebuilt_frame(void);
+
+/**
+ * @brief Commit the event counter of the loaded prebuilt frame, then copy the frame into manufacture_data,
+ *        ready for the first packet. A reset during the event never sends the counter again.
+ * 
+ * @param polarity Polarity read at boot, selects the frame variant
+ * @return int FRAM_SUCCESS, or FRAM_ERROR if the counter could not be committed and the frame must not be sent
+ */
+int apply_prebuilt_frame(uint8_t polarity);
+
+/**
+ * @brief Tell if the current event is the one of the prebuilt frame, only the first call after apply_prebuilt_frame() does
+ * 
+ * @note call once per event, from update_manufacture_data()
+ * 
+ * @return true if the prebuilt frame is on air, its counter is already committed
+ */
+bool take_prebuilt_frame_event(void);
+
+#endif // __APP_PREBUILT_FRAME__
@@ -0,0 +1,40 @@
+#ifndef __APP_REPORT_BY_EXCEPTION__
+#define __APP_REPORT_BY_EXCEPTION__
+
+#include <stdint.h>
+
+#include "device_config.h"
+#include "app_sensors.h"
+
+/**
+ * @brief What an event sends, decided by rbe_check_reading()
+ *
+ */
+typedef enum
+{
+    RBE_REPORT_FULL = 0,        // The whole burst of the event
+    RBE_REPORT_HEARTBEAT,       // One packet, the readings are within the deadbands
+    RBE_REPORT_NONE,            // No packet, the readings are within the deadbands
+}rbe_report_t;
+
+/**
+ * @brief Compare the reading of the event with the last full report and decide what the event sends.
+ *        A full report keeps the reading in FRAM as the new reference, written by the next app_fram_flush().
+ *        The burst of the event is capped to the packets of the decision, also when it is already on air.
+ *        Without fram_data.sleep_between_events (button) every event is a full report.
+ *
+ * @note call once per event, after the measurement and the event counter step
+ *
+ * @param reading Reading of the event, NULL if the payload of the device type has none
+ * @param event_counter Event counter sent in the payload of the event
+ */
+void rbe_check_reading(const sensor_reading_t *reading, uint32_t event_counter);
+
+/**
+ * @brief Get what the current event sends
+ *
+ * @return rbe_report_t Decision of the last rbe_check_reading()
+ */
+rbe_report_t rbe_get_report(void);
+
+#endif // __APP_REPORT_BY_EXCEPTION__
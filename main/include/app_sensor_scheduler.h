@@ -0,0 +1,73 @@
+#ifndef __APP_SENSOR_SCHEDULER__
+#define __APP_SENSOR_SCHEDULER__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "accel.h"
+#include "temp_pressure.h"
+
+/**
+ * @brief Sensors handled by the scheduler
+ *
+ */
+typedef enum
+{
+    SENSOR_ACCEL = 0,               // Accelerometer
+    SENSOR_TEMP_PRESSURE,           // Temperature and pressure sensor
+    SENSOR_MAX                      // Number of sensors
+}sensor_id_t;
+
+/**
+ * @brief Timing of the last measurement of every sensor, all in us
+ *
+ */
+typedef struct
+{
+    uint32_t conversion_us[SENSOR_MAX];     // Trigger to DRDY seen by the scheduler, 0 if the sensor timed out
+    uint32_t read_us[SENSOR_MAX];           // I2C read of the result
+    uint32_t collect_us;                    // Time spent collecting, what the event pays for the sensors
+    uint32_t serial_us;                     // Expected conversion plus read of every sensor read, one after the other
+    uint8_t  completion_order[SENSOR_MAX];  // Sensors in the order their data was read
+}sensor_schedule_report_t;
+
+/**
+ * @brief Record that a sensor was triggered outside of the scheduler, e.g. by a transaction of an I2C queue chain.
+ *        The conversion time is counted from this call.
+ *
+ * @param sensor Sensor which is converting
+ */
+void sensor_scheduler_mark_triggered(sensor_id_t sensor);
+
+/**
+ * @brief Trigger the conversion of one sensor, unless it is already converting
+ *
+ * @param sensor Sensor to trigger
+ * @return int 0 on success, error code otherwise
+ */
+int sensor_scheduler_trigger(sensor_id_t sensor);
+
+/**
+ * @brief Trigger the conversion of every sensor which is not already converting.
+ *        Call as early as possible, the sensors convert while the boot goes on.
+ *
+ */
+void sensor_scheduler_trigger_all(void);
+
+/**
+ * @brief Collect the results of every triggered sensor, in completion order. Sensors not triggered yet are triggered first.
+ *
+ * @param accel_data Buffer to store the accelerometer data, left untouched on error
+ * @param temp_pressure_data Buffer to store the temperature and pressure data, left untouched on error
+ * @return int 0 if every sensor was read, ACCEL_DRDY_TIMEOUT/TEMP_PRESSURE_DRDY_TIMEOUT or error code of the first failing sensor
+ */
+int sensor_scheduler_collect(accel_data_t *accel_data, temp_pressure_data_t *temp_pressure_data);
+
+/**
+ * @brief Get the timing of the last collect
+ *
+ * @param report Buffer to store the timing
+ */
+void sensor_scheduler_get_report(sensor_schedule_report_t *report);
+
+#endif // __APP_SENSOR_SCHEDULER__
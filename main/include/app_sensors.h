@@ -3,14 +3,41 @@
 
 #include <stdio.h>
 #include "app_types.h"
+#include "device_config.h"
 
-extern bool is_temp_pressure_sensor_triggered; 
+#define SENSOR_READING_ACCEL_X      0
+#define SENSOR_READING_ACCEL_Y      1
+#define SENSOR_READING_ACCEL_Z      2
+#define SENSOR_READING_TEMP         3
+#define SENSOR_READING_PRESSURE     4
+#define SENSOR_READING_VALUES       5
+
+/**
+ * @brief Values of a measurement, compared with the last report by the report by exception stage
+ * 
+ */
+typedef struct
+{
+    int16_t value[SENSOR_READING_VALUES];   // Accel in m/s^2 * 1000, or the RMS of each axis of a capture, then temp and pressure
+    uint8_t valid_mask;                     // BIT(index) of the values the measurement has set
+}sensor_reading_t;
 
 /**
  * @brief Routine used to measure the sensors data and store it in the buffer
  * 
  * @param we_power_data The pointer to the buffer on which the data is stored
+ * @param reading Buffer to store the values of the measurement
+ */
+void measure_sensor_data(we_power_data_ble_adv_t *we_power_data, sensor_reading_t *reading);
+
+#if (USE_ACCEL_FIFO_CAPTURE)
+/**
+ * @brief Routine used to capture the accelerometer FIFO and store the features of the capture in the buffer
+ * 
+ * @param we_power_data The pointer to the buffer on which the data is stored
+ * @param reading Buffer to store the RMS of each axis, set whichever page the buffer carries
  */
-void measure_sensor_data(we_power_data_ble_adv_t *we_power_data);
+void measure_vibration_features(we_power_data_ble_adv_t *we_power_data, sensor_reading_t *reading);
+#endif
 
 #endif // __APP_SENSORS__
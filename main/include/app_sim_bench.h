@@ -0,0 +1,19 @@
+#ifndef __APP_SIM_BENCH__
+#define __APP_SIM_BENCH__
+
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+#if (USE_SIM_BENCH)
+/**
+ * @brief End of the first event of the boot. With -wepower_bench the metrics of the event are printed
+ *        as one "BENCH {json}" line and the simulated device powers off, as wp_rev1 does when the energy is gone.
+ *
+ */
+void sim_bench_event_done(void);
+#else
+static inline void sim_bench_event_done(void) { }
+#endif
+
+#endif // __APP_SIM_BENCH__
@@ -0,0 +1,32 @@
+#ifndef __APP_STREAM__
+#define __APP_STREAM__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Callback type for the end of a stream
+ *
+ */
+typedef void (*stream_end_cb_t)(void);
+
+#if (USE_PERIODIC_STREAM)
+/**
+ * @brief Start streaming accelerometer frames on periodic advertising after the burst of an event, if the device type
+ *        streams and the harvest holds VBULK above STREAM_VBULK_START_MV. Frames go out until VBULK falls below
+ *        STREAM_VBULK_STOP_MV, then end_cb is called from the system work queue.
+ *
+ * @param event_counter Event counter of the event the stream follows, part of the nonce of every frame
+ * @param end_cb Called once the stream has stopped
+ * @return true if the stream started, end_cb will be called
+ * @return false if there is no stream, end_cb is not called
+ */
+bool stream_start(uint32_t event_counter, stream_end_cb_t end_cb);
+#else
+static inline bool stream_start(uint32_t event_counter, stream_end_cb_t end_cb) { ARG_UNUSED(event_counter); ARG_UNUSED(end_cb); return false; }
+#endif
+
+#endif // __APP_STREAM__
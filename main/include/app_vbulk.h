@@ -0,0 +1,25 @@
+#ifndef __APP_VBULK__
+#define __APP_VBULK__
+
+#include <stdint.h>
+
+#include "device_config.h"
+
+/**
+ * @brief Measure VBULK with the SAADC, the channel is set up on the first measurement
+ *
+ * @param vbulk_mv Buffer to store VBULK in mV
+ * @return int 0 on success, negative error code otherwise, -ENOTSUP without the SAADC
+ */
+int vbulk_read_mv(uint32_t *vbulk_mv);
+
+/**
+ * @brief Energy released by the storage capacitor while VBULK went from one voltage to another
+ *
+ * @param from_mv VBULK before
+ * @param to_mv VBULK after
+ * @return uint32_t Energy in nJ, 0 if VBULK rose or is unknown
+ */
+uint32_t vbulk_energy_drop_nj(uint32_t from_mv, uint32_t to_mv);
+
+#endif // __APP_VBULK__
@@ -18,6 +18,18 @@
 #include "app_bt.h"
 #include "app_cli.h"
 #include "app_gpio.h"
+#include "app_boot_trace.h"
+#include "app_prebuilt_frame.h"
+#include "app_encrypt.h"
+#include "app_sensor_scheduler.h"
+#include "app_i2c_boot_chain.h"
+#include "app_device_caps.h"
+#include "app_sim_bench.h"
+#include "app_adv_jitter.h"
+#include "app_energy_burst.h"
+#include "app_energy_ledger.h"
+#include "app_report_by_exception.h"
+#include "app_stream.h"
 
 LOG_MODULE_REGISTER(wepower);
 
@@ -31,8 +43,62 @@ static struct k_work_delayable update_frame_work;
 // task to run config_commands.c module
 struct k_work process_command_task;
 
-// used to tell if the pressure sensor was properly triggered
-extern bool is_temp_pressure_sensor_triggered;
+SYS_INIT(init_we_power_board_gpios, POST_KERNEL, BOARD_GPIOS_INIT_PRIORITY);
+
+/**
+ * @brief Start the inter-event sleep if there is a next event, or burn the energy left
+ * 
+ */
+static void schedule_next_event(void)
+{
+    if (fram_data.sleep_between_events)
+        k_work_schedule(&update_frame_work, K_MSEC(fram_data.sleep_between_events));
+    else 
+    {
+        burn_the_energy();
+    }
+}
+
+/**
+ * @brief End of the burst of an event: the burst goes to the FRAM history, then the stream runs while the
+ *        harvest keeps up, then the next event is scheduled
+ * 
+ */
+static void finish_event_burst(void)
+{
+    energy_ledger_end();
+    energy_burst_end();
+    sim_bench_event_done();
+    // The stream frames use the event counter in their nonce, it has to be in FRAM before one is sent
+    if (!app_fram_is_counter_committed() || (stream_start(fram_data.event_counter, schedule_next_event) == false))
+    {
+        schedule_next_event();
+    }
+}
+
+#if (USE_CONTROLLER_BURST)
+/**
+ * @brief Called from the advertising work item once the controller has sent the whole burst.
+ *        Starts inter-event sleep if there is a next event.
+ * 
+ */
+static void adv_burst_complete_handler(void)
+{
+    clear_CN1_6();
+    finish_event_burst();
+}
+#else
+/**
+ * @brief End of the burst, out of the packet timer interrupt as the FRAM is written
+ * 
+ * @param work Work item for the thread
+ */
+static void burst_end_work_fn(struct k_work *work)
+{
+    finish_event_burst();
+}
+
+static K_WORK_DEFINE(burst_end_work, burst_end_work_fn);
 
 /**
  * @brief 20ms packet timer callback, sends work until max packets. Starts inter-event sleep if there is a next event.
@@ -42,7 +108,15 @@ extern bool is_temp_pressure_sensor_triggered;
 static void timer_event_handler(struct k_timer *timer_handler);
 
 K_TIMER_DEFINE(timer_event, timer_event_handler, NULL);
-SYS_INIT(init_we_power_board_gpios, POST_KERNEL, 0);
+
+/**
+ * @brief Arm the packet timer for the next repeat, packet_interval plus the jitter of the policy
+ * 
+ */
+static void start_packet_timer(void)
+{
+    k_timer_start(&timer_event, K_MSEC(adv_jitter_next_interval_ms()), K_NO_WAIT);
+}
 
 /**
  * @brief 20ms packet timer callback, sends work until max packets. Starts inter-event sleep if maximum packets for a single events have been sent
@@ -56,23 +130,93 @@ static void timer_event_handler(struct k_timer *timer_handler)
 
     set_CN1_6();       
 
-    if (TX_Repeat_Counter <= fram_data.event_max_packets) // starts at 0, we send 1 if max is 1 by incrementing after the test.
+    // starts at 0, we send 1 if max is 1 by incrementing after the test. The limit follows the energy left.
+    if (TX_Repeat_Counter <= energy_burst_update())
     {
         manufacture_data[PAYLOAD_TX_REPEAT_COUNTER_INDEX] = TX_Repeat_Counter;
         k_work_submit(&start_advertising_work_item);
+        start_packet_timer();
     }
     else 
     {
         LOG_INF(">>> Sent maximum packets");
         TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
         clear_CN1_6();
-        k_timer_stop(&timer_event);
-		if (fram_data.sleep_between_events)
-			k_work_schedule(&update_frame_work, K_MSEC(fram_data.sleep_between_events));
-        else 
-        {
-            burn_the_energy();
-        }
+        k_work_submit(&burst_end_work);
+    }
+}
+#endif
+
+/**
+ * @brief Start sending the packets of an event. The first packet goes out right now.
+ * 
+ * @param event_counter Event counter sent in the payload, seeds the repeat jitter of the event
+ */
+static void start_event_advertising(uint32_t event_counter)
+{
+    adv_jitter_seed(fram_data.serial_number, event_counter);
+    energy_burst_begin(event_counter);
+#if !(USE_CONTROLLER_BURST)
+    // Trigger the 20ms timer for the following packets
+    start_packet_timer();
+#endif
+    k_work_submit(&start_advertising_work_item);
+    energy_ledger_mark(ENERGY_STAGE_STARTUP);
+    // VBULK at the start of the burst, the first packet does not wait for the SAADC
+    (void)energy_burst_update();
+}
+
+/**
+ * @brief Close an event without a packet, its readings are within the deadbands of the last report
+ * 
+ * @param event_counter Event counter of the event, kept in the burst history
+ */
+static void skip_event_advertising(uint32_t event_counter)
+{
+    energy_burst_begin(event_counter);
+    finish_event_burst();
+}
+
+/**
+ * @brief Configure and trigger the sensors named by a capability mask, one I2C call after the other
+ * 
+ * @param capabilities DEVICE_CAP_* mask, see get_device_capabilities()
+ */
+static void bring_up_sensors(uint8_t capabilities)
+{
+    if (capabilities & DEVICE_CAP_ACCEL)
+    {
+        // configure the IMU,
+        app_accel_config();
+        boot_trace_mark(BOOT_STAGE_ACCEL_CONFIG);
+    }
+
+    if (capabilities & DEVICE_CAP_ACCEL_FIFO)
+    {
+        // The FIFO fills while the FRAM and the controller are serviced
+        (void)app_accel_fifo_start();
+        boot_trace_mark(BOOT_STAGE_ACCEL_CONFIG);
+    }
+
+    if (capabilities & DEVICE_CAP_TEMP_PRESSURE)
+    {
+        // pressure sensor config.  
+        enable_temp_pressure_sensor_interrupt_config ();
+        boot_trace_mark(BOOT_STAGE_TPS_CONFIG);
+    }
+
+    // To save time later, the sensors convert while the FRAM and the controller are serviced
+    if (capabilities & DEVICE_CAP_ACCEL)
+    {
+        (void)sensor_scheduler_trigger(SENSOR_ACCEL);
+    }
+    if (capabilities & DEVICE_CAP_TEMP_PRESSURE)
+    {
+        (void)sensor_scheduler_trigger(SENSOR_TEMP_PRESSURE);
+    }
+    if (capabilities & DEVICE_CAP_SENSORS)
+    {
+        boot_trace_mark(BOOT_STAGE_SENSOR_TRIGGER);
     }
 }
 
@@ -84,9 +228,36 @@ static void timer_event_handler(struct k_timer *timer_handler)
  */
 void update_frame_work_fn(struct k_work *work)
 {
-    update_manufacture_data();
-    // Start event timer
-    k_timer_start(&timer_event, K_MSEC(fram_data.packet_interval), K_MSEC(fram_data.packet_interval));
+    bool is_frame_ready;
+
+    energy_ledger_begin();
+    is_frame_ready = update_manufacture_data();
+    // End of event for the FRAM, the counter and every byte changed by the event go out together.
+    // A counter which is not in FRAM would be sent again with other data after a reset.
+    if (app_fram_flush() != FRAM_SUCCESS)
+    {
+        LOG_ERR("Event counter %d not committed to FRAM, the event is not advertised", fram_data.event_counter);
+        is_frame_ready = false;
+    }
+    energy_ledger_mark(ENERGY_STAGE_PAYLOAD);
+    if (!is_frame_ready || (rbe_get_report() == RBE_REPORT_NONE))
+    {
+        skip_event_advertising(fram_data.event_counter);
+    }
+    else
+    {
+#if (USE_CONTROLLER_BURST)
+        start_event_advertising(fram_data.event_counter);
+#else
+        // Start event timer
+        adv_jitter_seed(fram_data.serial_number, fram_data.event_counter);
+        energy_burst_begin(fram_data.event_counter);
+        start_packet_timer();
+#endif
+    }
+    // Keep the cipher out of the next event, the keystream is ready before the sleep ends
+    prepare_payload_keystream(fram_data.event_counter + 1);
+    prebuild_next_manufacture_data();
 }
 
 
@@ -102,7 +273,10 @@ int main(void)
      * 
      */
 
+    boot_trace_mark(BOOT_STAGE_KERNEL);
+
     uint8_t application_mode = init_comparator_1_vext_and_read_value();
+    boot_trace_mark(BOOT_STAGE_COMPARATOR);
 
 #if (USE_UVLO_KILL_SWITCH)
     /**
@@ -137,64 +311,154 @@ int main(void)
         }
         else
         {
+            bool is_polarity_read = false;
+            bool is_event_advertising_started = false;
+            bool is_prebuilt_frame_loaded = false;
+            uint8_t boot_device_type = DEVICE_TYPE_DEFAULT_VALUE;
+            // Type unknown until it is read, everything is brought up
+            uint8_t boot_capabilities = DEVICE_CAP_SENSORS | DEVICE_CAP_POLARITY;
+
+            energy_ledger_begin();
             disable_uart();
 
-            // configure the IMU,
-            app_accel_config();
+#if (USE_ASYNC_BT_ENABLE)
+            // Bring up the controller while the I2C devices below are serviced
+            (void)initialize_bluetooth();
+#endif
 
-            // pressure sensor config.  
-            enable_temp_pressure_sensor_interrupt_config ();
-            
-            // To save time later, start it early
-            if (TEMP_PRESSURE_SUCCESS == app_temp_pressure_trigger())
+            // Initialize a work item to trigger BLE advertising for each event
+            k_work_init(&start_advertising_work_item, start_advertising_handler);
+
+            // Initialize a delayable work item to update the advertising packet for every event by calling update_manufacture_data()
+            k_work_init_delayable(&update_frame_work, update_frame_work_fn);
+
+#if (USE_CONTROLLER_BURST)
+            register_adv_burst_complete_cb(adv_burst_complete_handler);
+#endif
+
+#if (USE_PREBUILT_FIRST_FRAME)
+            // The previous event built and encrypted this event's first packet, send it before servicing the sensors.
+            if (load_prebuilt_frame() == true)
             {
-                is_temp_pressure_sensor_triggered = true;
+                is_prebuilt_frame_loaded = true;
+                if (get_device_capabilities(fram_data.type) & DEVICE_CAP_POLARITY)
+                {
+                    u8Polarity = read_polarity(fram_data.sleep_after_wake);
+                    is_polarity_read = true;
+                }
+                // The counter of the prebuilt frame is committed first, without FRAM the normal boot takes over
+                if (apply_prebuilt_frame(u8Polarity) == FRAM_SUCCESS)
+                {
+#if !(USE_ASYNC_BT_ENABLE)
+                    (void)initialize_bluetooth();
+#endif
+                    (void)wait_for_bluetooth_ready();
+                    boot_trace_mark(BOOT_STAGE_BT_INIT);
+
+                    toggle_CN_1_6();
+                    boot_trace_mark(BOOT_STAGE_ADV_SUBMIT);
+                    start_event_advertising(fram_data.event_counter);
+                    is_event_advertising_started = true;
+                }
             }
-            else
+#endif
+
+            // Only the peripherals the payload of the device type needs are brought up
+            if (read_boot_device_type(is_prebuilt_frame_loaded, &boot_device_type) == FRAM_SUCCESS)
             {
-                is_temp_pressure_sensor_triggered = false;
+                boot_capabilities = get_device_capabilities(boot_device_type);
             }
+
+#if (USE_I2C_BOOT_CHAIN)
+            // Config and trigger of the sensors the type needs go out back to back while the CPU sleeps, next to the FRAM read
+            // when it has its own bus. The sensors convert while the FRAM and the controller are serviced.
+            int32_t fram_ret = i2c_boot_chain_run(true, boot_capabilities);
+#else
+            bring_up_sensors(boot_capabilities);
+
+            int32_t fram_ret = dump_fram(true);
+#endif
                 
             /**
              * @brief Read FRAM and act accordingly.
              * 
              */
-            if(dump_fram(true) == FRAM_SUCCESS)
+            if(fram_ret == FRAM_SUCCESS)
             {
-                u8Polarity = read_polarity(fram_data.sleep_after_wake);
+                boot_trace_mark(BOOT_STAGE_FRAM_READ);
+
+                // The whole FRAM is the reference, bring up what the early type read missed
+                bring_up_sensors(get_device_capabilities(fram_data.type) & ~boot_capabilities);
+
+                if ((is_polarity_read == false) && (get_device_capabilities(fram_data.type) & DEVICE_CAP_POLARITY))
+                {
+                    u8Polarity = read_polarity(fram_data.sleep_after_wake);
+                    boot_trace_mark(BOOT_STAGE_POLARITY);
+                }
             
                 for(uint8_t i = 0; i < ENCRYPTED_KEY_NUM_BYTES; i++)
                 {
                     ecb_key[i] = fram_data.encrypted_key[i];
                 }
+
+                // One session for the whole boot, every packet reuses it
+                (void)app_encrypt_init();
             }
             else
             {
-                // Reset event counter 
-                fram_data.event_counter = 0;
                 LOG_ERR("Failed to Read from FRAM Device");
                 indicate_error(ERROR_TYPE_FRAM);
                 burn_the_energy();
+
+                // Without the counter and the key from FRAM a payload would replay the keystream of an earlier event,
+                // nothing more is sent. A prebuilt frame already on air ends its burst and no event follows it.
+                fram_data.sleep_between_events = 0;
+                while (1)
+                    k_msleep (10);
             }
         
-            (void)initialize_bluetooth();	
-
-            update_manufacture_data();
+#if !(USE_ASYNC_BT_ENABLE)
+            if (is_event_advertising_started == false)
+            {
+                (void)initialize_bluetooth();	
+            }
+#endif
 
-            LOG_INF("Starting K Worker Tasks");
+            // With the prebuilt frame on air, a measured payload replaces it for the later repeats under the next counter
+            bool is_frame_ready = update_manufacture_data();
+            // End of event for the FRAM, the counter and every byte changed by the event go out together.
+            // A counter which is not in FRAM would be sent again with other data after a reset, the prebuilt
+            // frame on air was committed before its first packet.
+            if (app_fram_flush() != FRAM_SUCCESS)
+            {
+                LOG_ERR("Event counter %d not committed to FRAM, the event is not advertised", fram_data.event_counter);
+                is_frame_ready = false;
+            }
+            boot_trace_mark(BOOT_STAGE_MANUF_DATA);
+            energy_ledger_mark(ENERGY_STAGE_PAYLOAD);
 
-            // Initialize a work item to trigger BLE advertising for each event
-            k_work_init(&start_advertising_work_item, start_advertising_handler);
+            if ((is_event_advertising_started == false) && (!is_frame_ready || (rbe_get_report() == RBE_REPORT_NONE)))
+            {
+                // The prebuilt frame is already on air otherwise, the event is at least a heartbeat
+                skip_event_advertising(fram_data.event_counter);
+            }
+            else if (is_event_advertising_started == false)
+            {
+                // Advertising starts as soon as both the payload and the advertising set are ready
+                (void)wait_for_bluetooth_ready();
+                boot_trace_mark(BOOT_STAGE_BT_INIT);
 
-            // Initialize a delayable work item to update the advertising packet for every event by calling update_manufacture_data()
-            k_work_init_delayable(&update_frame_work, update_frame_work_fn);
+                LOG_INF("Starting K Worker Tasks");
 
-            // Trigger the 20ms timer to start advertising 
-            k_timer_start(&timer_event, K_MSEC(fram_data.packet_interval), K_MSEC(fram_data.packet_interval));
+                // so we don't wait 20ms, send first packet right now.
+                toggle_CN_1_6();
+                boot_trace_mark(BOOT_STAGE_ADV_SUBMIT);
+                start_event_advertising(fram_data.event_counter);
+            }
 
-            // so we don't wait 20ms, send first packet right now.
-            toggle_CN_1_6();
-            k_work_submit(&start_advertising_work_item);// submit the first packet to start advertising instantly
+            // Off the critical path, get the next event's keystream and first packet ready
+            prepare_payload_keystream(fram_data.event_counter + 1);
+            prebuild_next_manufacture_data();
         }
             
         while (1) 
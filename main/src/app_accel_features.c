@@ -0,0 +1,173 @@
+#include "app_accel_features.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "app_types.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+#define CREST_FRACTION_BITS     4
+
+#if (USE_ACCEL_SPECTRUM)
+static const uint16_t spectrum_band_edges_hz[] = SPECTRUM_BAND_EDGES_HZ;
+
+BUILD_ASSERT(ARRAY_SIZE(spectrum_band_edges_hz) == SPECTRUM_PAYLOAD_BANDS + 1, "SPECTRUM_BAND_EDGES_HZ does not match the payload bands");
+BUILD_ASSERT(SPECTRUM_PAYLOAD_BANDS <= SPECTRUM_MAX_BANDS, "Too many spectrum bands");
+BUILD_ASSERT(SPECTRUM_PAYLOAD_PEAKS <= SPECTRUM_MAX_PEAKS, "Too many spectrum peaks");
+BUILD_ASSERT(ACCEL_FIFO_CAPTURE_SAMPLES == SPECTRUM_FFT_SIZE, "The spectrum window is one capture");
+#endif
+
+/**
+ * @brief Value of one axis of a sample
+ *
+ * @param sample Sample
+ * @param axis 0 for X, 1 for Y, 2 for Z
+ * @return int32_t Value of the axis
+ */
+static int32_t axis_value(const accel_data_t *sample, uint8_t axis)
+{
+    switch (axis)
+    {
+        case 0:
+            return sample->x_accel;
+        case 1:
+            return sample->y_accel;
+        default:
+            return sample->z_accel;
+    }
+}
+
+/**
+ * @brief Integer square root, rounded down
+ *
+ * @param value Value
+ * @return uint32_t floor(sqrt(value))
+ */
+static uint32_t isqrt32(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+/**
+ * @brief Compute the per axis mean, RMS, peak and crest factor of a capture, in fixed point
+ *
+ * @param samples Samples of the capture
+ * @param num_samples Number of samples, at least 1
+ * @param features Buffer to store the features
+ */
+void accel_compute_features(const accel_data_t *samples, uint8_t num_samples, accel_features_t *features)
+{
+    memset(features, 0, sizeof(*features));
+
+    if (num_samples == 0)
+    {
+        return;
+    }
+
+    for (uint8_t axis = 0; axis < ACCEL_AXES; axis++)
+    {
+        accel_axis_features_t *axis_features = &features->axis[axis];
+        int32_t sum = 0;
+        uint64_t sum_squares = 0;
+        uint32_t peak = 0;
+        int32_t mean;
+        uint32_t rms;
+
+        for (uint8_t i = 0; i < num_samples; i++)
+        {
+            sum += axis_value(&samples[i], axis);
+        }
+        // Rounded to the nearest, the deviations below are taken from it
+        mean = (sum + ((sum >= 0) ? (num_samples / 2) : -(num_samples / 2))) / num_samples;
+
+        for (uint8_t i = 0; i < num_samples; i++)
+        {
+            int32_t deviation = axis_value(&samples[i], axis) - mean;
+            uint32_t magnitude = (uint32_t)((deviation < 0) ? -deviation : deviation);
+
+            sum_squares += (uint64_t)magnitude * magnitude;
+            peak = MAX(peak, magnitude);
+        }
+
+        // A deviation is below 2^16, its square and the mean of the squares fit 32 bits
+        rms = isqrt32((uint32_t)(sum_squares / num_samples));
+
+        axis_features->mean = (int16_t)mean;
+        axis_features->rms = (uint16_t)MIN(rms, UINT16_MAX);
+        axis_features->peak = (uint16_t)MIN(peak, UINT16_MAX);
+        if (rms != 0)
+        {
+            axis_features->crest_q4 = (uint8_t)MIN((peak << CREST_FRACTION_BITS) / rms, UINT8_MAX);
+        }
+    }
+
+    LOG_INF("Accel features: rms %u %u %u, peak %u %u %u, mean %d %d %d",
+            features->axis[0].rms, features->axis[1].rms, features->axis[2].rms,
+            features->axis[0].peak, features->axis[1].peak, features->axis[2].peak,
+            features->axis[0].mean, features->axis[1].mean, features->axis[2].mean);
+}
+
+#if (USE_ACCEL_SPECTRUM)
+/**
+ * @brief Compute the spectrum of the axis of a capture with the largest RMS: RMS of the SPECTRUM_BAND_EDGES_HZ bands
+ *        and the strongest SPECTRUM_PAYLOAD_PEAKS peaks
+ *
+ * @param samples SPECTRUM_FFT_SIZE samples of the capture
+ * @param features Features of the capture, from accel_compute_features()
+ * @param axis Buffer to store the axis of the spectrum, 0 for X, 1 for Y, 2 for Z
+ * @param spectrum Buffer to store the spectrum
+ * @return int SPECTRUM_SUCCESS or the error of spectrum_analyze()
+ */
+int accel_compute_spectrum(const accel_data_t *samples, const accel_features_t *features, uint8_t *axis,
+                           spectrum_result_t *spectrum)
+{
+    spectrum_config_t config = {
+        .odr_hz = ACCEL_FIFO_ODR_HZ,
+        .num_bands = SPECTRUM_PAYLOAD_BANDS,
+        .num_peaks = SPECTRUM_PAYLOAD_PEAKS,
+    };
+    int16_t axis_samples[SPECTRUM_FFT_SIZE];
+
+    // Only one axis fits the payload, the one which vibrates the most
+    *axis = 0;
+    for (uint8_t i = 1; i < ACCEL_AXES; i++)
+    {
+        if (features->axis[i].rms > features->axis[*axis].rms)
+        {
+            *axis = i;
+        }
+    }
+
+    for (uint8_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        axis_samples[i] = (int16_t)axis_value(&samples[i], *axis);
+    }
+    memcpy(config.band_edges_hz, spectrum_band_edges_hz, sizeof(spectrum_band_edges_hz));
+
+    return spectrum_analyze(axis_samples, &config, spectrum);
+}
+#endif
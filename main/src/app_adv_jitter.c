@@ -0,0 +1,72 @@
+#include "app_adv_jitter.h"
+
+#include <zephyr/kernel.h>
+
+#include "fram.h"
+#include "config_commands.h"
+
+#define ADV_JITTER_SEED_MULTIPLIER  0x9E3779B1U     // Golden ratio, spreads consecutive serial numbers apart
+
+// xorshift32 state of the event, never 0
+static uint32_t jitter_state = 1;
+
+/**
+ * @brief Next value of the xorshift32 sequence of the event
+ *
+ * @return uint32_t Pseudo random value
+ */
+static uint32_t adv_jitter_rand(void)
+{
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+
+    return jitter_state;
+}
+
+/**
+ * @brief Seed the repeat jitter of an event. The same serial number and event counter
+ *        always give the same sequence, so receivers and simulations can replay it.
+ *
+ * @param serial_number Serial number of the device
+ * @param event_counter Event counter sent in the payload of the event
+ */
+void adv_jitter_seed(uint32_t serial_number, uint32_t event_counter)
+{
+    uint32_t seed = (serial_number * ADV_JITTER_SEED_MULTIPLIER) ^ event_counter;
+
+    // Murmur3 finalizer, neighbouring counters of one device give unrelated sequences
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6BU;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35U;
+    seed ^= seed >> 16;
+    jitter_state = (seed != 0) ? seed : 1;
+}
+
+/**
+ * @brief Tell if fram_data.jitter_policy changes the advertising parameters of each start
+ *
+ * @return true if a jitter is set
+ */
+bool is_adv_jitter_enabled(void)
+{
+    return ((fram_data.jitter_policy & JITTER_POLICY_MS_MASK) != 0);
+}
+
+/**
+ * @brief Spacing before the next repeat, fram_data.packet_interval plus a draw up to the jitter of the policy
+ *
+ * @return uint32_t Interval in ms
+ */
+uint32_t adv_jitter_next_interval_ms(void)
+{
+    uint32_t max_jitter_ms = MIN(fram_data.jitter_policy & JITTER_POLICY_MS_MASK, JITTER_POLICY_MAX_MS);
+
+    if (max_jitter_ms == 0)
+    {
+        return fram_data.packet_interval;
+    }
+
+    return fram_data.packet_interval + (adv_jitter_rand() % (max_jitter_ms + 1));
+}
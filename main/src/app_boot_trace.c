@@ -0,0 +1,264 @@
+#include "app_boot_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "fram.h"
+
+#define BOOT_TRACE_MAGIC            0x54425057  // "WPBT" in FRAM byte order
+
+#define BOOT_TRACE_RECORD_ADDR(slot) (FRAM_BOOT_TRACE_ADDR + sizeof(boot_trace_header_t) + ((slot) * sizeof(boot_trace_record_t)))
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief Header of the boot trace ring in FRAM
+ *
+ */
+typedef struct
+{
+    uint32_t magic;                                     // BOOT_TRACE_MAGIC once the ring is initialized
+    uint32_t boot_count;                                // Number of boots written since the last clear
+}boot_trace_header_t;
+
+/**
+ * @brief One traced boot, as stored in the FRAM ring
+ *
+ */
+typedef struct
+{
+    uint32_t boot_index;                                // Boot number, used to order the ring
+    uint32_t stage_end_cycles[BOOT_STAGE_MAX];          // k_cycle_get_32() at the end of each stage, 0 if not reached
+}boot_trace_record_t;
+
+BUILD_ASSERT(BOOT_TRACE_RECORD_ADDR(BOOT_TRACE_RING_SIZE) <= FRAM_BURST_HISTORY_ADDR,
+             "Boot trace ring overlaps the burst history in FRAM");
+
+/**
+ * @brief Names of the boot stages, used for the CLI table
+ *
+ */
+static const char *const BOOT_STAGE_NAME[BOOT_STAGE_MAX] =
+{
+    "kernel",
+    "comparator",
+    "accel config",
+    "tps config",
+    "sensor trigger",
+    "fram read",
+    "polarity",
+    "bt init",
+    "manuf data",
+    "adv submit",
+    "adv start",
+};
+
+// Ring buffer read back for the CLI table, static to keep it off the work queue stack
+static boot_trace_record_t boot_trace_records[BOOT_TRACE_RING_SIZE];
+
+#if (USE_BOOT_TRACE)
+
+// Trace of the current boot, kept in RAM until the first packet is with the controller
+static boot_trace_record_t current_boot;
+
+static void boot_trace_commit_fn(struct k_work *work);
+
+// Work item used to write the trace to FRAM once the first packet has been started
+static K_WORK_DEFINE(boot_trace_commit_work, boot_trace_commit_fn);
+
+/**
+ * @brief Write the trace of the current boot in the next slot of the FRAM ring
+ *
+ * @param work Work item for the thread
+ */
+static void boot_trace_commit_fn(struct k_work *work)
+{
+    boot_trace_header_t header;
+
+    if (app_fram_read_bytes(FRAM_BOOT_TRACE_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the boot trace header");
+        return;
+    }
+
+    if (header.magic != BOOT_TRACE_MAGIC)
+    {
+        header.magic = BOOT_TRACE_MAGIC;
+        header.boot_count = 0;
+    }
+
+    current_boot.boot_index = header.boot_count;
+
+    if (app_fram_write_bytes(BOOT_TRACE_RECORD_ADDR(header.boot_count % BOOT_TRACE_RING_SIZE),
+                             (uint8_t*)&current_boot, sizeof(current_boot)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to write the boot trace");
+        return;
+    }
+
+    header.boot_count++;
+    (void)app_fram_write_bytes(FRAM_BOOT_TRACE_ADDR, (uint8_t*)&header, sizeof(header));
+}
+
+/**
+ * @brief Timestamp the end of a boot stage. Only the first mark of a stage in a boot is kept.
+ *        Marking BOOT_STAGE_ADV_START queues the write of the trace to the FRAM ring.
+ *
+ * @param stage Stage which just ended
+ */
+void boot_trace_mark(boot_stage_t stage)
+{
+    uint32_t now = k_cycle_get_32();
+
+    if ((stage >= BOOT_STAGE_MAX) || (current_boot.stage_end_cycles[stage] != 0))
+    {
+        return;
+    }
+
+    current_boot.stage_end_cycles[stage] = now;
+
+    if (stage == BOOT_STAGE_ADV_START)
+    {
+        k_work_submit(&boot_trace_commit_work);
+    }
+}
+
+/**
+ * @brief Get the timestamp of the end of a boot stage in the current boot
+ *
+ * @param stage Boot stage
+ * @return uint32_t k_cycle_get_32() at the end of the stage, 0 if not reached yet
+ */
+uint32_t boot_trace_get_stage_cycles(boot_stage_t stage)
+{
+    return (stage < BOOT_STAGE_MAX) ? current_boot.stage_end_cycles[stage] : 0;
+}
+
+#endif // USE_BOOT_TRACE
+
+/**
+ * @brief Print the boot trace ring as a table with min/avg/max duration per stage
+ *
+ */
+static void dump_boot_trace(void)
+{
+    boot_trace_header_t header;
+    uint32_t num_records;
+
+    if (app_fram_read_bytes(FRAM_BOOT_TRACE_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the boot trace header");
+        return;
+    }
+
+    if ((header.magic != BOOT_TRACE_MAGIC) || (header.boot_count == 0))
+    {
+        LOG_RAW("No boot traces recorded\n");
+        return;
+    }
+
+    num_records = MIN(header.boot_count, BOOT_TRACE_RING_SIZE);
+    if (app_fram_read_bytes(BOOT_TRACE_RECORD_ADDR(0), (uint8_t*)boot_trace_records,
+                            num_records * sizeof(boot_trace_record_t)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the boot traces");
+        return;
+    }
+
+    LOG_RAW(">> ------- Boot trace, last %d of %d boots, durations in us -------\n", num_records, header.boot_count);
+    LOG_RAW("%-14s %8s %8s %8s %6s\n", "stage", "min", "avg", "max", "boots");
+
+    for (uint8_t stage = 0; stage < BOOT_STAGE_MAX; stage++)
+    {
+        uint32_t min_cycles = UINT32_MAX;
+        uint32_t max_cycles = 0;
+        uint64_t sum_cycles = 0;
+        uint32_t count = 0;
+
+        for (uint32_t record_idx = 0; record_idx < num_records; record_idx++)
+        {
+            const uint32_t *stage_end = boot_trace_records[record_idx].stage_end_cycles;
+            uint32_t stage_start = 0;
+
+            if (stage_end[stage] == 0)
+            {
+                continue;
+            }
+
+            // A stage starts where the stage reached just before it ended, stages are not always in enum order
+            for (uint8_t prev_stage = 0; prev_stage < BOOT_STAGE_MAX; prev_stage++)
+            {
+                if ((prev_stage != stage) &&
+                    (stage_end[prev_stage] != 0) &&
+                    (stage_end[prev_stage] <= stage_end[stage]) &&
+                    (stage_end[prev_stage] > stage_start))
+                {
+                    stage_start = stage_end[prev_stage];
+                }
+            }
+
+            uint32_t duration = stage_end[stage] - stage_start;
+            min_cycles = MIN(min_cycles, duration);
+            max_cycles = MAX(max_cycles, duration);
+            sum_cycles += duration;
+            count++;
+        }
+
+        if (count == 0)
+        {
+            LOG_RAW("%-14s %8s %8s %8s %6d\n", BOOT_STAGE_NAME[stage], "-", "-", "-", 0);
+            continue;
+        }
+
+        LOG_RAW("%-14s %8u %8u %8u %6d\n",
+                BOOT_STAGE_NAME[stage],
+                k_cyc_to_us_floor32(min_cycles),
+                k_cyc_to_us_floor32((uint32_t)(sum_cycles / count)),
+                k_cyc_to_us_floor32(max_cycles),
+                count);
+    }
+
+    for (uint32_t record_idx = 0; record_idx < num_records; record_idx++)
+    {
+        LOG_RAW("boot %d: reset to first packet %u us\n",
+                boot_trace_records[record_idx].boot_index,
+                k_cyc_to_us_floor32(boot_trace_records[record_idx].stage_end_cycles[BOOT_STAGE_ADV_START]));
+    }
+}
+
+/**
+ * @brief Forget every boot recorded in the FRAM ring
+ *
+ */
+static void clear_boot_trace(void)
+{
+    boot_trace_header_t header = {.magic = BOOT_TRACE_MAGIC, .boot_count = 0};
+
+    if (app_fram_write_bytes(FRAM_BOOT_TRACE_ADDR, (uint8_t*)&header, sizeof(header)) == FRAM_SUCCESS)
+    {
+        LOG_RAW("Boot trace cleared\n");
+    }
+}
+
+/**
+ * @brief Handle the boot trace command from the CLI
+ *
+ * @param sub_command Sub command to run (boot_trace_command_t)
+ */
+void handle_boot_trace_command(uint8_t sub_command)
+{
+    switch (sub_command)
+    {
+        case BOOT_TRACE_COMMAND_DUMP:
+            dump_boot_trace();
+            break;
+        case BOOT_TRACE_COMMAND_CLEAR:
+            clear_boot_trace();
+            break;
+        default:
+            LOG_RAW("Unknown boot trace command %d\n", sub_command);
+            break;
+    }
+}
@@ -12,23 +12,31 @@
 #include "app_manuf_data.h"
 #include "app_burn_energy.h"
 #include "app_gpio.h"
+#include "app_boot_trace.h"
+#include "app_adv_jitter.h"
+#include "app_energy_burst.h"
 
 #define BT_UUID_BYTE1   0x50
 #define BT_UUID_BYTE2   0x57
 
 LOG_MODULE_DECLARE(wepower);
 
+/**
+ * @brief Advertising parameters. The set is created with the minimum interval, the interval from
+ *        fram_data.packet_interval is applied once FRAM is read, see wait_for_bluetooth_ready()
+ * 
+ */
 struct bt_le_adv_param adv_param =
 		BT_LE_ADV_PARAM_INIT(
 				     BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_IDENTITY | BT_LE_ADV_OPT_USE_NAME,
-				     BLE_ADV_INTERVAL_MIN,
-				     BLE_ADV_INTERVAL_MAX,
+				     BLE_ADV_INTERVAL_MIN_UNITS,
+				     BLE_ADV_INTERVAL_MIN_UNITS + BLE_ADV_INTERVAL_SPREAD_UNITS,
 				     NULL);
 
 static struct bt_data ad[] = 
 {
 	BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_NO_BREDR),
-    BT_DATA(BT_DATA_MANUFACTURER_DATA, manufacture_data, PAYLOAD_FRAME_LENGTH),
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, manufacture_data, PAYLOAD_FRAME_LENGTH),    // data_len follows manufacture_data_len
 	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_BYTE1, BT_UUID_BYTE2)
 };
 
@@ -36,9 +44,44 @@ static struct bt_le_ext_adv *ext_adv;
 
 struct k_work start_advertising_work_item;
 
+// Called once the controller has sent every packet of the event
+static adv_burst_complete_cb_t adv_burst_complete_cb = NULL;
+
+// Packets the controller reported as sent since boot
+static uint32_t adv_packets_sent = 0;
+
+#if (USE_ASYNC_BT_ENABLE)
+// Given by bt_enable_done_cb() once the controller is up and the advertising set is created
+K_SEM_DEFINE(bt_ready_sem, 0, 1);
+
+// Results of the asynchronous Bluetooth bring up
+static int bt_enable_err = 0;
+static int bt_ready_err = 0;
+#endif
+
+#if (USE_CONTROLLER_BURST)
+/**
+ * @brief End the burst of the event, the set is stopped and the registered callback takes over
+ * 
+ */
+static void end_adv_burst(void)
+{
+    LOG_INF(">>> Sent maximum packets");
+    TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
+    if (adv_burst_complete_cb != NULL)
+    {
+        adv_burst_complete_cb();
+    }
+}
+#endif
+
 /**
  * @brief Callback which is hit after every advertising event
  * 
+ * @note In burst mode this is hit once per chunk of BLE_ADV_BURST_CHUNK_EVENTS packets. The repeat
+ *       counter is advanced by the number of packets the controller sent, the work item measures VBULK
+ *       and queues the next chunk while the energy left allows it. The SAADC is kept off the Bluetooth thread.
+ * 
  * @param instance Insatance for the bluetooth advertising 
  * @param info Information for the advertising event
  */
@@ -46,10 +89,69 @@ static void adv_sent_cb(struct bt_le_ext_adv *instance, struct bt_le_ext_adv_sen
 {	
 	clear_CN1_6();
     LOG_INF("Advertiser[%d] %p sent %d\n", bt_le_ext_adv_get_index(ext_adv), (void*)ext_adv, info->num_sent);
+    adv_packets_sent += info->num_sent;
+
+#if (USE_CONTROLLER_BURST)
+    TX_Repeat_Counter += info->num_sent;
+    k_work_submit(&start_advertising_work_item);
+#endif
 }
 
 static const struct bt_le_ext_adv_cb adv_callback = {.sent = adv_sent_cb,};
 
+/**
+ * @brief Set the advertising interval of the controller
+ * 
+ * @param interval_ms Spacing of the advertising events in ms
+ */
+static void set_adv_interval_ms(uint32_t interval_ms)
+{
+    uint32_t interval = BLE_ADV_MS_TO_INTERVAL(interval_ms);
+
+    if (interval < BLE_ADV_INTERVAL_MIN_UNITS)
+    {
+        LOG_WRN("Packet interval %d ms below advertising minimum, using %d units", interval_ms, BLE_ADV_INTERVAL_MIN_UNITS);
+        interval = BLE_ADV_INTERVAL_MIN_UNITS;
+    }
+
+    adv_param.interval_min = interval;
+    adv_param.interval_max = interval + BLE_ADV_INTERVAL_SPREAD_UNITS;
+}
+
+/**
+ * @brief Set the advertising interval from the packet interval stored in FRAM, so the
+ *        controller spacing matches fram_data.packet_interval
+ * 
+ */
+static void set_adv_interval_from_fram(void)
+{
+    set_adv_interval_ms(fram_data.packet_interval);
+}
+
+/**
+ * @brief Apply fram_data.jitter_policy to the next advertising start: a jittered interval for the
+ *        next controller chunk. Every start keeps the three primary channels, only the timing is random.
+ * 
+ * @note The set is stopped between starts, its parameters can be updated. The packet timer draws the
+ *       jitter itself without USE_CONTROLLER_BURST.
+ * 
+ */
+static void apply_adv_jitter_policy(void)
+{
+#if (USE_CONTROLLER_BURST)
+    int err;
+
+    // Two units started together get different spacings from the second chunk on and drift apart
+    set_adv_interval_ms(adv_jitter_next_interval_ms());
+
+    err = bt_le_ext_adv_update_param(ext_adv, &adv_param);
+    if (err)
+    {
+        LOG_ERR("Failed to apply the jitter policy (err %d)", err);
+    }
+#endif
+}
+
 /**
  * @brief Create a advertising object
  * 
@@ -67,28 +169,76 @@ static int create_advertising(void)
  */
 void start_advertising_handler(struct k_work *work)
 {
+#if (USE_CONTROLLER_BURST)
+    int32_t remaining_packets;
+    uint8_t num_events;
+
+    // VBULK after a chunk tells how many more packets the stored energy affords, the first chunk does not wait for the SAADC
+    if (TX_Repeat_Counter != TX_REPEAT_COUNTER_DEFAULT_VALUE)
+    {
+        (void)energy_burst_update();
+    }
+
+    // The limit can drop below the packets already sent, and 0 events would let the controller advertise without end
+    remaining_packets = (int32_t)energy_burst_get_packet_limit() - TX_Repeat_Counter + 1;
+    if (remaining_packets <= 0)
+    {
+        end_adv_burst();
+        return;
+    }
+    manufacture_data[PAYLOAD_TX_REPEAT_COUNTER_INDEX] = TX_Repeat_Counter;
+
+    // Hand the rest of the event to the controller, in chunks so the repeat counter keeps counting chunk by chunk
+    num_events = MIN(remaining_packets, BLE_ADV_BURST_CHUNK_EVENTS);
+#else
+    uint8_t num_events = BLE_ADV_EVENTS;
+#endif
+
     set_CN1_6();
     clear_CN1_6();
 
     LOG_INF("Manufacturer Data: ");
-    for (uint8_t i = 0; i < PAYLOAD_FRAME_LENGTH; i++){
+    for (uint8_t i = 0; i < manufacture_data_len; i++){
         LOG_RAW("%02X ", manufacture_data[i]);
     }
     LOG_RAW(" \n");
 
     
+    // Parameters first, the advertising data is set on the updated set
+    if (is_adv_jitter_enabled())
+    {
+        apply_adv_jitter_policy();
+    }
+
     LOG_INF("Start_Advertising->Setting Data");
+    ad[1].data_len = manufacture_data_len;
 
 	if (bt_le_ext_adv_set_data(ext_adv, ad, ARRAY_SIZE(ad), NULL, 0)) 
     {
         LOG_ERR("Failed to set advertising data");
 	}
 
-    LOG_INF("Start_Advertising->BLE ADV Start");
-	if (bt_le_ext_adv_start(ext_adv, BT_LE_EXT_ADV_START_PARAM(BLE_ADV_TIMEOUT, BLE_ADV_EVENTS))) 
+    LOG_INF("Start_Advertising->BLE ADV Start, %d events", num_events);
+	if (bt_le_ext_adv_start(ext_adv, BT_LE_EXT_ADV_START_PARAM(BLE_ADV_TIMEOUT, num_events))) 
     {
 		LOG_ERR("Failed to start advertising set \n");
 	}
+    boot_trace_mark(BOOT_STAGE_ADV_START);
+
+#if !(USE_CONTROLLER_BURST)
+    // Measured once the packet is with the controller, the packet timer reads the limit for the next repeat
+    (void)energy_burst_update();
+#endif
+}
+
+/**
+ * @brief Register the function called when the controller has sent the whole event burst
+ * 
+ * @param cb Callback, called from the system work queue
+ */
+void register_adv_burst_complete_cb(adv_burst_complete_cb_t cb)
+{
+    adv_burst_complete_cb = cb;
 }
 
 /**
@@ -112,14 +262,50 @@ int bt_ready(void)
     return err;
 }
 
+#if (USE_ASYNC_BT_ENABLE)
+/**
+ * @brief Ready callback of the asynchronous bt_enable. Creates the advertising set and
+ *        releases wait_for_bluetooth_ready()
+ * 
+ * @param err Error code from bt_enable, 0 if successful
+ */
+static void bt_enable_done_cb(int err)
+{
+    if (err)
+    {
+        LOG_ERR("Bluetooth init failed (err %d)\n", err);
+        bt_enable_err = err;
+    }
+    else
+    {
+        bt_ready_err = bt_ready();
+    }
+
+    k_sem_give(&bt_ready_sem);
+}
+#endif
+
 /**
  * @brief Initialize Bluetooth for WePower Board
  * 
+ * @note With USE_ASYNC_BT_ENABLE this only starts the controller and returns, the caller
+ *       has to call wait_for_bluetooth_ready() before advertising
+ * 
  * @return uint8_t error code, 0 if successful
  */
 uint8_t initialize_bluetooth()
 {
     uint8_t err = 0xFF;
+#if (USE_ASYNC_BT_ENABLE)
+    // Init and run the BLE, bt_enable_done_cb() is called once the controller is up
+    err = bt_enable(bt_enable_done_cb);
+    if (err) 
+    {
+        LOG_ERR("Bluetooth init failed (err %d)\n", err);
+        bt_enable_err = err;
+        k_sem_give(&bt_ready_sem);
+    }
+#else
     // Init and run the BLE
     err = bt_enable(NULL);
     if (err) 
@@ -137,6 +323,182 @@ uint8_t initialize_bluetooth()
         indicate_error(ERROR_TYPE_BT_READY_FAIL);
         burn_the_energy();
     }
+#endif
 
     return err;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Wait until Bluetooth is enabled and the advertising set is created, then apply the
+ *        advertising interval from FRAM. Only applies the interval when bt_enable is synchronous.
+ * 
+ * @note fram_data has to be read before calling this
+ * 
+ * @return uint8_t error code, 0 if successful
+ */
+uint8_t wait_for_bluetooth_ready(void)
+{
+    uint8_t err = 0;
+
+#if (USE_ASYNC_BT_ENABLE)
+
+    if (k_sem_take(&bt_ready_sem, K_MSEC(BT_READY_TIMEOUT_MSEC)) != 0)
+    {
+        LOG_ERR("Timeout waiting for Bluetooth");
+        bt_enable_err = -ETIMEDOUT;
+    }
+
+    if (bt_enable_err)
+    {
+        indicate_error(ERROR_TYPE_BT_ENABLE_FAIL);
+        burn_the_energy();
+        return 0xFF;
+    }
+
+    if (bt_ready_err)
+    {
+        LOG_ERR("Advertising failed to create (err %d)\n", bt_ready_err);
+        indicate_error(ERROR_TYPE_BT_READY_FAIL);
+        burn_the_energy();
+        return 0xFF;
+    }
+#endif
+
+    // The set may be created before FRAM is read, the interval from FRAM is applied here in both modes
+    set_adv_interval_from_fram();
+    err = bt_le_ext_adv_update_param(ext_adv, &adv_param);
+    if (err)
+    {
+        LOG_ERR("Failed to set advertising interval (err %d)", err);
+    }
+
+    return err;
+}
+
+#if (USE_PERIODIC_STREAM)
+/**
+ * @brief Periodic advertising parameters of the stream, the train runs on the same set as the event bursts
+ * 
+ */
+static const struct bt_le_per_adv_param per_adv_param =
+        BT_LE_PER_ADV_PARAM_INIT(BLE_PER_ADV_MS_TO_INTERVAL(STREAM_PER_ADV_INTERVAL_MS),
+                                 BLE_PER_ADV_MS_TO_INTERVAL(STREAM_PER_ADV_INTERVAL_MS),
+                                 BT_LE_PER_ADV_OPT_NONE);
+
+/**
+ * @brief Set the frame sent by the following periodic advertising events
+ * 
+ * @param frame Manufacturer data of the frame
+ * @param frame_len Length of the frame
+ * @return int error code, 0 if successful
+ */
+int update_stream_advertising(uint8_t *frame, uint8_t frame_len)
+{
+    struct bt_data per_ad = BT_DATA(BT_DATA_MANUFACTURER_DATA, frame, frame_len);
+
+    return bt_le_per_adv_set_data(ext_adv, &per_ad, 1);
+}
+
+/**
+ * @brief Start the periodic advertising train with its first frame. The extended advertising runs along at
+ *        STREAM_EXT_ADV_INTERVAL_MS, scanners find the train through its sync info.
+ * 
+ * @note Call once the burst of the event is over, the set is stopped
+ * 
+ * @param frame Manufacturer data of the first frame
+ * @param frame_len Length of the frame
+ * @return int error code, 0 if successful
+ */
+int start_stream_advertising(uint8_t *frame, uint8_t frame_len)
+{
+    int err;
+
+    (void)bt_le_ext_adv_stop(ext_adv);
+
+    set_adv_interval_ms(STREAM_EXT_ADV_INTERVAL_MS);
+    err = bt_le_ext_adv_update_param(ext_adv, &adv_param);
+    if (err == 0)
+    {
+        err = bt_le_per_adv_set_param(ext_adv, &per_adv_param);
+    }
+    if (err == 0)
+    {
+        err = update_stream_advertising(frame, frame_len);
+    }
+    if (err == 0)
+    {
+        err = bt_le_per_adv_start(ext_adv);
+    }
+    if (err == 0)
+    {
+        // No timeout and no event limit, the set runs until stop_stream_advertising()
+        err = bt_le_ext_adv_start(ext_adv, BT_LE_EXT_ADV_START_PARAM(BLE_ADV_TIMEOUT, 0));
+    }
+
+    if (err)
+    {
+        LOG_ERR("Failed to start the periodic advertising stream (err %d)", err);
+        stop_stream_advertising();
+    }
+
+    return err;
+}
+
+/**
+ * @brief Stop the periodic advertising train and the extended advertising along with it. The set is left with
+ *        the interval from FRAM for the next event.
+ * 
+ */
+void stop_stream_advertising(void)
+{
+    int err;
+
+    (void)bt_le_per_adv_stop(ext_adv);
+    (void)bt_le_ext_adv_stop(ext_adv);
+
+    set_adv_interval_from_fram();
+    err = bt_le_ext_adv_update_param(ext_adv, &adv_param);
+    if (err)
+    {
+        LOG_ERR("Failed to set advertising interval (err %d)", err);
+    }
+}
+#endif
+
+/**
+ * @brief Get the number of packets the controller has sent since boot
+ * 
+ * @return uint32_t Number of advertising packets
+ */
+uint32_t get_adv_packets_sent(void)
+{
+    return adv_packets_sent;
+}
+
+/**
+ * @brief Get the number of primary channels the advertising options leave on
+ * 
+ * @return uint8_t Primary channels carrying the ADV_EXT_IND of a packet, 1 to 3
+ */
+uint8_t get_adv_primary_channel_count(void)
+{
+    uint8_t channels = 3;
+
+    channels -= (adv_param.options & BT_LE_ADV_OPT_DISABLE_CHAN_37) ? 1 : 0;
+    channels -= (adv_param.options & BT_LE_ADV_OPT_DISABLE_CHAN_38) ? 1 : 0;
+    channels -= (adv_param.options & BT_LE_ADV_OPT_DISABLE_CHAN_39) ? 1 : 0;
+
+    // The controller refuses to disable all three
+    return MAX(channels, 1);
+}
+
+/**
+ * @brief Tell if the AUX_ADV_IND of a packet goes on the 2M PHY
+ * 
+ * @return true on 2M, false on 1M
+ */
+bool is_adv_aux_phy_2m(void)
+{
+    // Extended advertising uses 2M on the secondary channel unless it is turned off, coded PHY is not used
+    return ((adv_param.options & BT_LE_ADV_OPT_NO_2M) == 0);
+}
@@ -4,7 +4,6 @@
 #include <zephyr/device.h>
 #include <hal/nrf_gpio.h>
 #include <zephyr/logging/log.h>
-#include <nrfx_comp.h>
 
 #include "device_config.h"
 #include "config_commands.h"
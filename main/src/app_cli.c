@@ -5,6 +5,9 @@
 
 #include "fram.h"
 #include "config_commands.h"
+#include "app_boot_trace.h"
+#include "app_energy_burst.h"
+#include "app_energy_ledger.h"
 
 extern command_data_t command_data;
 
@@ -402,6 +405,136 @@ static int set_device_name_handler(const struct shell *sh, size_t argc, char **a
     return 0;
 }
 
+/**
+ * @brief set the CCM MIC length from FRAM
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int set_mic_length_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data,0, sizeof(command_data));
+    command_data.type = COMMAND_TYPE_SET;
+    command_data.field_index = atoi(argv[0]);
+
+    command_data.data[0] = atoi(argv[1]);
+    command_data.data_len = 1U; 
+
+    uint64_t received_value_to_set = strtoull(argv[1], NULL, 10);
+
+    // CCM only defines even MIC lengths from 4 to 16 bytes
+    if ((received_value_to_set == 0) ||
+        ((received_value_to_set >= 4) && (received_value_to_set <= MIC_LEN_MAX_VALUE) && ((received_value_to_set & 0x01) == 0)))
+    {
+        k_work_submit(&process_command_task);
+    }
+    else
+    {
+        shell_print(sh,"\r Received Value out of bounds %lld, use 0 or 4, 6, ... 16\n", received_value_to_set);
+        memset(&command_data,0, sizeof(command_data));
+    }
+    return 0;
+}
+
+/**
+ * @brief set the repeat jitter policy from FRAM
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int set_jitter_policy_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data,0, sizeof(command_data));
+    command_data.type = COMMAND_TYPE_SET;
+    command_data.field_index = atoi(argv[0]);
+
+    command_data.data[0] = atoi(argv[1]);
+    command_data.data_len = 1U; 
+
+    uint64_t received_value_to_set = strtoull(argv[1], NULL, 10);
+
+    if (received_value_to_set <= JITTER_POLICY_MAX_VALUE)
+    {
+        k_work_submit(&process_command_task);
+    }
+    else
+    {
+        shell_print(sh,"\r Received Value out of bounds %lld, use 0 to %d ms\n", received_value_to_set, JITTER_POLICY_MAX_MS);
+        memset(&command_data,0, sizeof(command_data));
+    }
+    return 0;
+}
+
+/**
+ * @brief set the report by exception policy from FRAM
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int set_rbe_policy_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data,0, sizeof(command_data));
+    command_data.type = COMMAND_TYPE_SET;
+    command_data.field_index = atoi(argv[0]);
+
+    command_data.data[0] = atoi(argv[1]);
+    command_data.data_len = 1U; 
+
+    uint64_t received_value_to_set = strtoull(argv[1], NULL, 10);
+
+    // Mode in the low bits, 4 x N for a full report every N events
+    if ((received_value_to_set <= RBE_POLICY_MAX_VALUE) &&
+        ((received_value_to_set & RBE_POLICY_MODE_MASK) <= RBE_MODE_SILENT))
+    {
+        k_work_submit(&process_command_task);
+    }
+    else
+    {
+        shell_print(sh,"\r Received Value out of bounds %lld, use mode 0 off, 1 heartbeat, 2 silent, +4 x N for a full report every N events\n",
+                    received_value_to_set);
+        memset(&command_data,0, sizeof(command_data));
+    }
+    return 0;
+}
+
+/**
+ * @brief set a report by exception deadband from FRAM
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int set_rbe_deadband_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data,0, sizeof(command_data));
+    command_data.type = COMMAND_TYPE_SET;
+    command_data.field_index = atoi(argv[0]);
+    command_data.data[0] = (uint8_t)atoi(argv[1]);
+    command_data.data[1] = atoi(argv[1])>> 8 ;
+
+    command_data.data_len = 2U; 
+
+    uint64_t received_value_to_set = strtoull(argv[1], NULL, 10);
+
+    if (received_value_to_set <= RBE_DEADBAND_MAX_VALUE)
+    {
+        k_work_submit(&process_command_task);
+    }
+    else
+    {
+        shell_print(sh,"\r Received Value out of bounds %lld\n", received_value_to_set);
+        memset(&command_data,0, sizeof(command_data));
+    }
+    return 0;
+}
+
 /*********************************END OF SETTER FUNCTIONS FOR FRAM FIELDS***************************/
 
 /********************************GETTER FUNCTIONS FOR FRAM FIELDS**********************************/
@@ -566,6 +699,75 @@ static int test_command_handler(const struct shell *sh, size_t argc, char **argv
 
 /****************************END OF TEST COMMAND FUNCTIONS ****************************/
 
+/******************************** BOOT TRACE COMMAND FUNCTIONS **********************************/
+
+/**
+ * @brief Handler for the boot trace commands, 0 dumps the table and 1 clears the trace
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int boot_trace_command_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data, 0, sizeof(command_data));
+
+    command_data.type = COMMAND_TYPE_BOOT_TRACE;
+    command_data.field_index = (argc > 1) ? atoi(argv[1]) : BOOT_TRACE_COMMAND_DUMP;
+
+    k_work_submit(&process_command_task);
+
+    return 0;
+}
+
+/****************************END OF BOOT TRACE COMMAND FUNCTIONS ****************************/
+
+/**
+ * @brief Handler for the burst history commands, 0 dumps the packets of the last events and 1 clears the history
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int burst_history_command_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data, 0, sizeof(command_data));
+
+    command_data.type = COMMAND_TYPE_BURST_HISTORY;
+    command_data.field_index = (argc > 1) ? atoi(argv[1]) : BURST_HISTORY_COMMAND_DUMP;
+
+    k_work_submit(&process_command_task);
+
+    return 0;
+}
+
+/****************************END OF BURST HISTORY COMMAND FUNCTIONS ****************************/
+
+/**
+ * @brief Handler for the energy ledger commands, 0 dumps the energy of the last events per stage, 1 clears the ledger
+ *        and 2 prints the cost model
+ * 
+ * @param sh Shell object
+ * @param argc Size of the arguments
+ * @param argv Arguments, to be accessed as tokens
+ * @return int error code
+ */
+static int energy_ledger_command_handler(const struct shell *sh, size_t argc, char **argv)
+{
+    memset(&command_data, 0, sizeof(command_data));
+
+    command_data.type = COMMAND_TYPE_ENERGY_LEDGER;
+    command_data.field_index = (argc > 1) ? atoi(argv[1]) : ENERGY_LEDGER_COMMAND_DUMP;
+
+    k_work_submit(&process_command_task);
+
+    return 0;
+}
+
+/****************************END OF ENERGY LEDGER COMMAND FUNCTIONS ****************************/
+
 /**
  * @brief Initialize the command line interface for receiving commands via UART
  * 
@@ -586,6 +788,12 @@ uint8_t init_command_line_interface()
         SHELL_CMD(9, NULL, "set Encrypted Key.",set_encrypted_key_handler),
         SHELL_CMD(10, NULL, "set TX power in 0.1 dbm.",set_tx_power_handler),
         SHELL_CMD(11, NULL, "set Device Name",set_device_name_handler),
+        SHELL_CMD(12, NULL, "set CCM MIC length, 0 for no MIC.",set_mic_length_handler),
+        SHELL_CMD(13, NULL, "set repeat jitter in ms.",set_jitter_policy_handler),
+        SHELL_CMD(14, NULL, "set report by exception, 0 off, 1 heartbeat, 2 silent, +4 x N for a full report every N events.",set_rbe_policy_handler),
+        SHELL_CMD(15, NULL, "set accel deadband in m/s^2 * 1000.",set_rbe_deadband_handler),
+        SHELL_CMD(16, NULL, "set temperature deadband in C x 10.",set_rbe_deadband_handler),
+        SHELL_CMD(17, NULL, "set pressure deadband in kPa x 16.",set_rbe_deadband_handler),
         SHELL_SUBCMD_SET_END
     );
     SHELL_CMD_REGISTER(s, &set, "Set commands", wrong_format_handler);
@@ -602,6 +810,12 @@ uint8_t init_command_line_interface()
     SHELL_CMD_REGISTER(C, NULL, "Clear commands", clear_fram_handler);
     SHELL_CMD_REGISTER(t, NULL, "Clear commands", test_command_handler);
     SHELL_CMD_REGISTER(T, NULL, "Clear commands", test_command_handler);
+    SHELL_CMD_REGISTER(b, NULL, "Boot trace commands", boot_trace_command_handler);
+    SHELL_CMD_REGISTER(B, NULL, "Boot trace commands", boot_trace_command_handler);
+    SHELL_CMD_REGISTER(h, NULL, "Burst history commands", burst_history_command_handler);
+    SHELL_CMD_REGISTER(H, NULL, "Burst history commands", burst_history_command_handler);
+    SHELL_CMD_REGISTER(e, NULL, "Energy ledger commands", energy_ledger_command_handler);
+    SHELL_CMD_REGISTER(E, NULL, "Energy ledger commands", energy_ledger_command_handler);
 
     #if DT_NODE_HAS_COMPAT(DT_CHOSEN(zephyr_shell_uart), zephyr_cdc_acm_uart)
     const struct device *dev;
@@ -0,0 +1,55 @@
+#include "app_device_caps.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "fram.h"
+#include "config_commands.h"
+#include "device_config.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+#if (USE_ACCEL_FIFO_CAPTURE)
+#define VIBRATION_MONITOR_CAPABILITIES  (DEVICE_CAP_ACCEL_FIFO | DEVICE_CAP_STREAM)
+#else
+#define VIBRATION_MONITOR_CAPABILITIES  (DEVICE_CAP_SENSORS | DEVICE_CAP_STREAM)
+#endif
+
+// What each type sends, see fill_type_dependent_data()
+static const uint8_t DEVICE_CAPABILITIES[DEVICE_TYPE_MAX_VALUE] =
+{
+    [DEVICE_TYPE_LEGACY]            = DEVICE_CAP_SENSORS,
+    [DEVICE_TYPE_BUTTON]            = DEVICE_CAP_SENSORS,
+    [DEVICE_TYPE_VIBRATION_MONITOR] = VIBRATION_MONITOR_CAPABILITIES,
+    [DEVICE_TYPE_TWO_WAY_SWITCH]    = DEVICE_CAP_POLARITY,
+    [DEVICE_TYPE_RELEASE_SENSOR]    = 0,
+};
+
+/**
+ * @brief Get the peripherals the payload of a device type needs
+ *
+ * @param type Device type from FRAM
+ * @return uint8_t DEVICE_CAP_* mask, 0 for unknown types
+ */
+uint8_t get_device_capabilities(uint8_t type)
+{
+    return (type < DEVICE_TYPE_MAX_VALUE) ? DEVICE_CAPABILITIES[type] : 0;
+}
+
+/**
+ * @brief Read the device type without loading the whole FRAM, from the prebuilt frame when it is already loaded
+ *
+ * @param is_prebuilt_frame_loaded fram_data.type was set by load_prebuilt_frame()
+ * @param type Buffer to store the device type
+ * @return int FRAM_SUCCESS or FRAM_ERROR
+ */
+int read_boot_device_type(bool is_prebuilt_frame_loaded, uint8_t *type)
+{
+    if (is_prebuilt_frame_loaded)
+    {
+        *type = fram_data.type;
+        return FRAM_SUCCESS;
+    }
+
+    return app_fram_peek_field(TYPE, type);
+}
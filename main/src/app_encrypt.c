@@ -1,18 +1,197 @@
 #include "app_encrypt.h"
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <zephyr/logging/log.h>
 
 #include "encrypt.h"
 #include "device_config.h"
+#include "app_types.h"
+#include "config_commands.h"
 
 #include "app_manuf_data.h"
 #include "app_gpio.h"
 
 #define ENCRYPT 0
 
+#define CTR_EVENT_COUNTER_OFFSET    offsetof(we_power_data_t, event_counter24)
+#define CTR_EVENT_COUNTER_MAX       0x00FFFFFF  // The counter block and the clear counter bytes hold 24 bits
+#define CCM_NONCE_LENGTH            13
+
 LOG_MODULE_DECLARE(wepower);
 
+#if (PAYLOAD_CIPHER_MODE == PAYLOAD_CIPHER_CTR)
+/**
+ * @brief Keystream block of an event, computed ahead of the event
+ * 
+ */
+typedef struct
+{
+    uint32_t event_counter;                         // Event counter the keystream was computed for
+    bool     is_valid;                              // true once keystream holds a block
+    uint8_t  keystream[PAYLOAD_DATA_SIZE_BYTES];    // AES(counter block), zero over the clear counter bytes
+}payload_keystream_t;
+
+// Keystream of the next event, computed during the inter-event sleep
+static payload_keystream_t next_keystream;
+
+/**
+ * @brief Compute the keystream block of an event.
+ *        Counter block: 'W' 'P' 0 0 | serial number (LE) | event counter 24 bits (LE) | zeros.
+ *        The receiver rebuilds it from the event counter bytes sent in clear.
+ * 
+ * @param event_counter Event counter of the payload
+ * @param keystream     Buffer of PAYLOAD_DATA_SIZE_BYTES for the keystream
+ * @return int          error code from app_encrypt_payload
+ */
+static int compute_keystream(uint32_t event_counter, uint8_t *keystream)
+{
+    uint8_t counter_block[PAYLOAD_DATA_SIZE_BYTES] = {'W', 'P'};
+
+    if (!is_event_counter_usable(event_counter))
+    {
+        return ENCRYPTION_ERROR;
+    }
+
+    memcpy(&counter_block[4], &fram_data.serial_number, sizeof(fram_data.serial_number));
+    counter_block[8]  = (uint8_t)((event_counter & 0x000000FF));
+    counter_block[9]  = (uint8_t)((event_counter & 0x0000FF00)>>8);
+    counter_block[10] = (uint8_t)((event_counter & 0x00FF0000)>>16);
+
+    if (app_encrypt_payload(counter_block, sizeof(counter_block), keystream, PAYLOAD_DATA_SIZE_BYTES) == ENCRYPTION_ERROR)
+    {
+        return ENCRYPTION_ERROR;
+    }
+
+    // The receiver needs the event counter to rebuild the keystream, send it in clear
+    memset(&keystream[CTR_EVENT_COUNTER_OFFSET], 0, EVENT_COUNTER_NUM_BYTES);
+    return ENCRYPTION_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Compute the keystream of an upcoming event, so encrypt_data() only has to XOR.
+ *        Does nothing unless PAYLOAD_CIPHER_MODE is PAYLOAD_CIPHER_CTR.
+ * 
+ * @param event_counter Event counter of the upcoming event
+ */
+void prepare_payload_keystream(uint32_t event_counter)
+{
+#if (PAYLOAD_CIPHER_MODE == PAYLOAD_CIPHER_CTR)
+    next_keystream.is_valid = false;
+    if (compute_keystream(event_counter, next_keystream.keystream) == ENCRYPTION_SUCCESS)
+    {
+        next_keystream.event_counter = event_counter;
+        next_keystream.is_valid = true;
+    }
+#else
+    ARG_UNUSED(event_counter);
+#endif
+}
+
+
+/**
+ * @brief Tell if the payload cipher can send an event counter. The CTR payload stops at the end of its 24 bit
+ *        counter field, a wrapped counter would repeat the keystream of an earlier event. A new key is needed then.
+ * 
+ * @param event_counter Event counter of the payload
+ * @return true if a payload can be sent for the counter
+ */
+bool is_event_counter_usable(uint32_t event_counter)
+{
+#if (PAYLOAD_CIPHER_MODE == PAYLOAD_CIPHER_CTR)
+    return (is_ccm_mic_length(fram_data.mic_len) || (event_counter <= CTR_EVENT_COUNTER_MAX));
+#else
+    ARG_UNUSED(event_counter);
+    return true;
+#endif
+}
+
+/**
+ * @brief Tell if a MIC length from FRAM selects the AES-CCM payload
+ * 
+ * @param mic_len MIC length in bytes
+ * @return true for the even lengths from 4 to 16 bytes defined by CCM
+ */
+bool is_ccm_mic_length(uint8_t mic_len)
+{
+    return ((mic_len >= 4) && (mic_len <= PAYLOAD_CCM_MIC_MAX_LENGTH) && ((mic_len & 0x01) == 0));
+}
+
+/**
+ * @brief Encrypt and authenticate the data with AES-CCM.
+ *        Nonce: event counter (LE) | serial number (LE) | 'W' 'P' 0 0 0
+ * 
+ * @param clear_text_buf     Buffer containing un-encrypted text
+ * @param encrypted_text_buf Buffer containing encrypted text
+ * @param len                Length of the text to encrypt 
+ * @param event_counter      Event counter of the payload
+ * @param aad                Frame bytes sent in clear and covered by the MIC
+ * @param aad_len            Length of aad
+ * @param mic                Buffer for the MIC
+ * @param mic_len            MIC length, see is_ccm_mic_length()
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_CCM or PAYLOAD_ENCRYPTION_STATUS_CLEAR
+ */
+uint8_t encrypt_data_ccm(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter,
+                         uint8_t* aad, uint8_t aad_len, uint8_t* mic, uint8_t mic_len)
+{
+    uint8_t nonce[CCM_NONCE_LENGTH] = {0};
+    uint8_t payload_status = PAYLOAD_ENCRYPTION_STATUS_CCM;
+
+    set_CN1_7();
+    memcpy(&nonce[0], &event_counter, sizeof(event_counter));
+    memcpy(&nonce[4], &fram_data.serial_number, sizeof(fram_data.serial_number));
+    nonce[8] = 'W';
+    nonce[9] = 'P';
+
+    if (app_encrypt_payload_ccm(nonce, sizeof(nonce), aad, aad_len, clear_text_buf, encrypted_text_buf, len, mic, mic_len) == ENCRYPTION_ERROR)
+    {
+        memcpy(encrypted_text_buf, clear_text_buf, PAYLOAD_DATA_SIZE_BYTES);
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+    }
+    clear_CN1_7();
+
+    return payload_status;
+}
+
+/**
+ * @brief Encrypt and authenticate a frame of the periodic advertising stream with AES-CCM.
+ *        Nonce: event counter (LE) | serial number (LE) | 'W' 'S' | frame sequence (LE) | 0,
+ *        the 'S' keeps the stream nonces apart from the event payloads.
+ * 
+ * @param clear_text_buf     Buffer containing un-encrypted samples
+ * @param encrypted_text_buf Buffer containing encrypted samples
+ * @param len                Length of the samples to encrypt
+ * @param event_counter      Event counter of the event the stream follows
+ * @param sequence           Sequence number of the frame in the stream
+ * @param aad                Frame bytes sent in clear and covered by the MIC
+ * @param aad_len            Length of aad
+ * @param mic                Buffer for the MIC
+ * @param mic_len            MIC length, see is_ccm_mic_length()
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_CCM or PAYLOAD_ENCRYPTION_STATUS_CLEAR
+ */
+uint8_t encrypt_stream_data_ccm(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter,
+                                uint16_t sequence, uint8_t* aad, uint8_t aad_len, uint8_t* mic, uint8_t mic_len)
+{
+    uint8_t nonce[CCM_NONCE_LENGTH] = {0};
+    uint8_t payload_status = PAYLOAD_ENCRYPTION_STATUS_CCM;
+
+    set_CN1_7();
+    memcpy(&nonce[0], &event_counter, sizeof(event_counter));
+    memcpy(&nonce[4], &fram_data.serial_number, sizeof(fram_data.serial_number));
+    nonce[8] = 'W';
+    nonce[9] = 'S';
+    memcpy(&nonce[10], &sequence, sizeof(sequence));
+
+    if (app_encrypt_payload_ccm(nonce, sizeof(nonce), aad, aad_len, clear_text_buf, encrypted_text_buf, len, mic, mic_len) == ENCRYPTION_ERROR)
+    {
+        memcpy(encrypted_text_buf, clear_text_buf, len);
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+    }
+    clear_CN1_7();
+
+    return payload_status;
+}
 
 /**
  * @brief Encrypt the data and store in the buffer
@@ -20,24 +199,48 @@ LOG_MODULE_DECLARE(wepower);
  * @param clear_text_buf     Buffer containing un-encrypted text
  * @param encrypted_text_buf Buffer containing encrypted text
  * @param len                Length of the text to encrypt 
+ * @param event_counter      Event counter of the payload, used by the CTR mode
+ * @return uint8_t           Payload status byte, PAYLOAD_ENCRYPTION_STATUS_ENC, PAYLOAD_ENCRYPTION_STATUS_CTR or PAYLOAD_ENCRYPTION_STATUS_CLEAR
  */
-void encrypt_data(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len )
+uint8_t encrypt_data(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t len, uint32_t event_counter)
 {
+    uint8_t payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+
     set_CN1_7();
-#ifdef ENCRYPT
+#if (PAYLOAD_CIPHER_MODE == PAYLOAD_CIPHER_CTR)
+    // Computed during the inter-event sleep, only the first event after boot pays for the cipher here
+    if ((next_keystream.is_valid == false) || (next_keystream.event_counter != event_counter))
+    {
+        prepare_payload_keystream(event_counter);
+    }
+
+    if (next_keystream.is_valid)
+    {
+        for (uint8_t i = 0; i < len; i++)
+        {
+            encrypted_text_buf[i] = clear_text_buf[i] ^ next_keystream.keystream[i];
+        }
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_CTR;
+    }
+    else
+    {
+        memcpy(encrypted_text_buf, clear_text_buf, PAYLOAD_DATA_SIZE_BYTES);
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+    }
+#elif defined(ENCRYPT)
     // Not we want to encrypt the data
     if(app_encrypt_payload(clear_text_buf, len, encrypted_text_buf, len) == ENCRYPTION_ERROR)
     {
         memcpy(encrypted_text_buf, clear_text_buf, PAYLOAD_DATA_SIZE_BYTES);
-        manufacture_data[PAYLOAD_STATUS_BYTE_INDEX] = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
     }
     else
     {
-        manufacture_data[PAYLOAD_STATUS_BYTE_INDEX] = PAYLOAD_ENCRYPTION_STATUS_ENC;
+        payload_status = PAYLOAD_ENCRYPTION_STATUS_ENC;
     }
 #else
-    memcpy(cipher_text, encrypted_text_buf, PAYLOAD_DATA_SIZE_BYTES);
-    manf_data[PAYLOAD_STATUS_BYTE_INDEX] = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
+    memcpy(encrypted_text_buf, clear_text_buf, PAYLOAD_DATA_SIZE_BYTES);
+    payload_status = PAYLOAD_ENCRYPTION_STATUS_CLEAR;
 #endif
     LOG_INF("Payload - Cleartext: ");
     for(int i = 0; i < len; i++)
@@ -53,4 +256,6 @@ void encrypt_data(uint8_t* clear_text_buf, uint8_t* encrypted_text_buf, uint8_t
     }
     LOG_RAW("\n");
     clear_CN1_7();
+
+    return payload_status;
 }
\ No newline at end of file
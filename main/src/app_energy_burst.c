@@ -0,0 +1,358 @@
+#include "app_energy_burst.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "fram.h"
+#include "config_commands.h"
+#include "app_vbulk.h"
+#include "app_manuf_data.h"
+
+#define BURST_HISTORY_MAGIC         0x48455057  // "WPEH" in FRAM byte order
+
+#define BURST_HISTORY_RECORD_ADDR(slot) (FRAM_BURST_HISTORY_ADDR + sizeof(burst_history_header_t) + ((slot) * sizeof(burst_history_record_t)))
+
+#define VBULK_STOP_MV               (VBULK_BROWN_OUT_MV + VBULK_STOP_MARGIN_MV)
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief Header of the burst history ring in FRAM
+ *
+ */
+typedef struct
+{
+    uint32_t magic;                                     // BURST_HISTORY_MAGIC once the ring is initialized
+    uint32_t event_count;                               // Number of events written since the last clear
+}burst_history_header_t;
+
+/**
+ * @brief One event, as stored in the FRAM ring
+ *
+ */
+typedef struct
+{
+    uint32_t event_counter;                             // Event counter sent in the payload
+    uint16_t packets;                                   // Packets the event sent
+    uint16_t packet_target;                             // fram_data.event_max_packets of the event, capped by the report by exception
+    uint16_t vbulk_start_mv;                            // VBULK when the burst started, 0 without the SAADC
+    uint16_t vbulk_end_mv;                              // VBULK when the burst ended, 0 without the SAADC
+}burst_history_record_t;
+
+BUILD_ASSERT(BURST_HISTORY_RECORD_ADDR(ENERGY_BURST_HISTORY_SIZE) <= FRAM_ENERGY_LEDGER_ADDR,
+             "Burst history ring overlaps the energy ledger in FRAM");
+
+// Ring buffer read back for the CLI table, static to keep it off the work queue stack
+static burst_history_record_t burst_history_records[ENERGY_BURST_HISTORY_SIZE];
+
+// Event of the current burst, written to the FRAM ring when the burst ends
+static burst_history_record_t current_event;
+
+// Packets the event may send, read by the advertising callbacks and the packet timer
+static volatile uint16_t packet_limit;
+
+// Packets the report by exception lets the event send, set once per event
+static volatile uint16_t packet_cap = UINT16_MAX;
+
+#if (USE_ENERGY_ADAPTIVE_BURST)
+// VBULK and packets sent at the last measurement
+static uint32_t last_vbulk_mv;
+static uint16_t last_packets_sent;
+
+// Drop of VBULK^2 per packet in mV^2, the stored energy is C/2 * VBULK^2. 0 until a drop has been measured.
+static uint32_t packet_cost_mv2;
+
+/**
+ * @brief Cost of a packet in the last event of the FRAM burst history, the estimate of the event until its own
+ *        burst has been measured
+ *
+ * @return uint32_t Drop of VBULK^2 per packet in mV^2, 0 if no event was recorded with VBULK
+ */
+static uint32_t read_last_packet_cost_mv2(void)
+{
+    burst_history_header_t header;
+    burst_history_record_t record;
+
+    if ((app_fram_read_bytes(FRAM_BURST_HISTORY_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS) ||
+        (header.magic != BURST_HISTORY_MAGIC) || (header.event_count == 0))
+    {
+        return 0;
+    }
+
+    if (app_fram_read_bytes(BURST_HISTORY_RECORD_ADDR((header.event_count - 1) % ENERGY_BURST_HISTORY_SIZE),
+                            (uint8_t*)&record, sizeof(record)) != FRAM_SUCCESS)
+    {
+        return 0;
+    }
+
+    if ((record.packets == 0) || (record.vbulk_end_mv == 0) || (record.vbulk_start_mv <= record.vbulk_end_mv))
+    {
+        return 0;
+    }
+
+    return (((uint32_t)record.vbulk_start_mv * record.vbulk_start_mv) -
+            ((uint32_t)record.vbulk_end_mv * record.vbulk_end_mv)) / record.packets;
+}
+
+/**
+ * @brief Packets the event may send with the energy left above the stop voltage.
+ *        Without a following event the burst goes on while the energy lasts, up to ENERGY_BURST_MAX_PACKETS,
+ *        otherwise it sends at most fram_data.event_max_packets and keeps the rest for the next event.
+ *
+ * @param vbulk_mv VBULK just measured
+ * @param packets_sent Packets of the event sent so far
+ * @return uint16_t Packets the event may send
+ */
+static uint16_t compute_packet_limit(uint32_t vbulk_mv, uint16_t packets_sent)
+{
+    uint32_t max_packets = ENERGY_BURST_MAX_PACKETS;
+    uint32_t affordable;
+
+    if (fram_data.sleep_between_events)
+    {
+        max_packets = MIN(fram_data.event_max_packets, ENERGY_BURST_MAX_PACKETS);
+    }
+
+    if (vbulk_mv <= VBULK_STOP_MV)
+    {
+        return packets_sent;
+    }
+
+    if (packet_cost_mv2 == 0)
+    {
+        // Cost not known yet, the next few packets measure it
+        return MIN(packets_sent + ENERGY_BURST_PROBE_PACKETS, MIN(fram_data.event_max_packets, max_packets));
+    }
+
+    affordable = ((vbulk_mv * vbulk_mv) - (VBULK_STOP_MV * VBULK_STOP_MV)) / packet_cost_mv2;
+    affordable = (affordable > ENERGY_BURST_RESERVE_PACKETS) ? (affordable - ENERGY_BURST_RESERVE_PACKETS) : 0;
+
+    return MIN(packets_sent + affordable, max_packets);
+}
+#endif // USE_ENERGY_ADAPTIVE_BURST
+
+/**
+ * @brief Start the burst of an event, before its first packet is queued. With the SAADC only ENERGY_BURST_PROBE_PACKETS
+ *        packets are allowed until VBULK has been measured.
+ *
+ * @param event_counter Event counter sent in the payload of the event, kept in the burst history
+ */
+void energy_burst_begin(uint32_t event_counter)
+{
+    memset(&current_event, 0, sizeof(current_event));
+    current_event.event_counter = event_counter;
+    current_event.packet_target = MIN(fram_data.event_max_packets, packet_cap);
+    packet_limit = current_event.packet_target;
+
+#if (USE_ENERGY_ADAPTIVE_BURST)
+    // A weak actuation must not lose the first chunk, the rest of the burst waits for the measurement
+    packet_limit = MIN(current_event.packet_target, ENERGY_BURST_PROBE_PACKETS);
+    last_vbulk_mv = 0;
+    last_packets_sent = 0;
+    packet_cost_mv2 = 0;
+#endif
+}
+
+/**
+ * @brief Report the progress of the burst and get the number of packets the event may send.
+ *        From a thread VBULK is measured and the limit follows the energy left above the brown-out,
+ *        from an interrupt the last limit is returned.
+ *
+ * @note The drop per packet also holds the idle drain and the harvester input between two measurements,
+ *       the estimate is what a packet costs in this event.
+ *
+ * @note The packets sent so far are the packets before the one TX_Repeat_Counter numbers,
+ *       TX_Repeat_Counter - TX_REPEAT_COUNTER_DEFAULT_VALUE, whichever context reports them.
+ *
+ * @return uint16_t Packets the event may send, the burst stops once the repeat counter goes beyond it
+ */
+uint16_t energy_burst_update(void)
+{
+    uint16_t packets_sent = TX_Repeat_Counter - TX_REPEAT_COUNTER_DEFAULT_VALUE;
+#if (USE_ENERGY_ADAPTIVE_BURST)
+    uint32_t vbulk_mv;
+    uint32_t cost_mv2;
+#endif
+
+    current_event.packets = packets_sent;
+
+#if (USE_ENERGY_ADAPTIVE_BURST)
+    if (k_is_in_isr())
+    {
+        return packet_limit;
+    }
+
+    if (vbulk_read_mv(&vbulk_mv) != 0)
+    {
+        LOG_ERR("Unable to measure VBULK, the event sends %d packets", current_event.packet_target);
+        packet_limit = current_event.packet_target;
+        return packet_limit;
+    }
+
+    if (current_event.vbulk_start_mv == 0)
+    {
+        current_event.vbulk_start_mv = (uint16_t)vbulk_mv;
+        packet_cost_mv2 = read_last_packet_cost_mv2();
+    }
+
+    if ((last_vbulk_mv != 0) && (packets_sent > last_packets_sent) && (vbulk_mv < last_vbulk_mv))
+    {
+        cost_mv2 = ((last_vbulk_mv * last_vbulk_mv) - (vbulk_mv * vbulk_mv)) / (packets_sent - last_packets_sent);
+        // Average over the chunks, a single measurement is noisy
+        packet_cost_mv2 = (packet_cost_mv2 == 0) ? cost_mv2 : ((3 * packet_cost_mv2) + cost_mv2) / 4;
+    }
+
+    last_vbulk_mv = vbulk_mv;
+    last_packets_sent = packets_sent;
+    // The first packet is queued before the first measurement, it is always sent
+    packet_limit = MIN(compute_packet_limit(vbulk_mv, MAX(packets_sent, TX_REPEAT_COUNTER_DEFAULT_VALUE)), packet_cap);
+#endif
+
+    return packet_limit;
+}
+
+/**
+ * @brief Cap the packets of the event, whatever the energy left. The cap holds for the following events until it is set again.
+ *        Set before energy_burst_begin() it applies to the whole burst, set during the burst the packets already sent stay sent.
+ *
+ * @param max_packets Most packets the event may send, UINT16_MAX for no cap
+ */
+void energy_burst_limit_packets(uint16_t max_packets)
+{
+    packet_cap = max_packets;
+    current_event.packet_target = MIN(current_event.packet_target, max_packets);
+    packet_limit = MIN(packet_limit, max_packets);
+}
+
+/**
+ * @brief Get the number of packets the event may send, as of the last measurement
+ *
+ * @return uint16_t Packets the event may send
+ */
+uint16_t energy_burst_get_packet_limit(void)
+{
+    return packet_limit;
+}
+
+/**
+ * @brief End the burst of the event: VBULK is measured once more and the event is written to the FRAM burst history.
+ *        Must be called from a thread, the FRAM is written.
+ *
+ */
+void energy_burst_end(void)
+{
+    burst_history_header_t header;
+
+#if (USE_ENERGY_ADAPTIVE_BURST)
+    uint32_t vbulk_mv;
+
+    if (vbulk_read_mv(&vbulk_mv) == 0)
+    {
+        current_event.vbulk_end_mv = (uint16_t)vbulk_mv;
+    }
+#endif
+
+    LOG_INF("Event %d sent %d of %d packets, VBULK %d mV to %d mV", current_event.event_counter, current_event.packets,
+            current_event.packet_target, current_event.vbulk_start_mv, current_event.vbulk_end_mv);
+
+    if (app_fram_read_bytes(FRAM_BURST_HISTORY_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the burst history header");
+        return;
+    }
+
+    if (header.magic != BURST_HISTORY_MAGIC)
+    {
+        header.magic = BURST_HISTORY_MAGIC;
+        header.event_count = 0;
+    }
+
+    if (app_fram_write_bytes(BURST_HISTORY_RECORD_ADDR(header.event_count % ENERGY_BURST_HISTORY_SIZE),
+                             (uint8_t*)&current_event, sizeof(current_event)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to write the burst history");
+        return;
+    }
+
+    header.event_count++;
+    (void)app_fram_write_bytes(FRAM_BURST_HISTORY_ADDR, (uint8_t*)&header, sizeof(header));
+}
+
+/**
+ * @brief Print the burst history ring, oldest event first
+ *
+ */
+static void dump_burst_history(void)
+{
+    burst_history_header_t header;
+    uint32_t num_records;
+    uint32_t first_event;
+    burst_history_record_t *record;
+
+    if (app_fram_read_bytes(FRAM_BURST_HISTORY_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the burst history header");
+        return;
+    }
+
+    if ((header.magic != BURST_HISTORY_MAGIC) || (header.event_count == 0))
+    {
+        LOG_RAW("No bursts recorded\n");
+        return;
+    }
+
+    num_records = MIN(header.event_count, ENERGY_BURST_HISTORY_SIZE);
+    if (app_fram_read_bytes(BURST_HISTORY_RECORD_ADDR(0), (uint8_t*)burst_history_records,
+                            num_records * sizeof(burst_history_record_t)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the burst history");
+        return;
+    }
+
+    LOG_RAW(">> ------- Burst history, last %d of %d events -------\n", num_records, header.event_count);
+    LOG_RAW("%10s %8s %8s %10s %10s\n", "event", "packets", "target", "start mV", "end mV");
+
+    first_event = header.event_count - num_records;
+    for (uint32_t event_idx = first_event; event_idx < header.event_count; event_idx++)
+    {
+        record = &burst_history_records[event_idx % ENERGY_BURST_HISTORY_SIZE];
+        LOG_RAW("%10u %8d %8d %10d %10d\n", record->event_counter, record->packets, record->packet_target,
+                record->vbulk_start_mv, record->vbulk_end_mv);
+    }
+}
+
+/**
+ * @brief Forget every event recorded in the FRAM ring
+ *
+ */
+static void clear_burst_history(void)
+{
+    burst_history_header_t header = {.magic = BURST_HISTORY_MAGIC, .event_count = 0};
+
+    if (app_fram_write_bytes(FRAM_BURST_HISTORY_ADDR, (uint8_t*)&header, sizeof(header)) == FRAM_SUCCESS)
+    {
+        LOG_RAW("Burst history cleared\n");
+    }
+}
+
+/**
+ * @brief Handle the burst history command from the CLI
+ *
+ * @param sub_command Sub command to run (burst_history_command_t)
+ */
+void handle_burst_history_command(uint8_t sub_command)
+{
+    switch (sub_command)
+    {
+        case BURST_HISTORY_COMMAND_DUMP:
+            dump_burst_history();
+            break;
+        case BURST_HISTORY_COMMAND_CLEAR:
+            clear_burst_history();
+            break;
+        default:
+            LOG_RAW("Unknown burst history command %d\n", sub_command);
+            break;
+    }
+}
@@ -0,0 +1,432 @@
+#include "app_energy_ledger.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "fram.h"
+#include "encrypt.h"
+#include "i2c_sensors.h"
+#include "app_gpio.h"
+#include "app_bt.h"
+#include "app_manuf_data.h"
+#include "app_vbulk.h"
+
+#define ENERGY_LEDGER_MAGIC         0x4C455057  // "WPEL" in FRAM byte order
+
+#define ENERGY_LEDGER_RECORD_ADDR(slot) (FRAM_ENERGY_LEDGER_ADDR + sizeof(energy_ledger_header_t) + ((slot) * sizeof(energy_ledger_record_t)))
+
+#define ENERGY_AD_OVERHEAD_BYTES    (9)         // Flags AD structure, length and type of the manufacturer data, and the UUID16 AD structure
+
+#define ENERGY_RADIO_1M_US_PER_BYTE (8)
+#define ENERGY_RADIO_2M_US_PER_BYTE (4)         // The 2M preamble is one byte longer, it is added to the frame
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief Header of the energy ledger ring in FRAM
+ *
+ */
+typedef struct
+{
+    uint32_t magic;                                     // ENERGY_LEDGER_MAGIC once the ring is initialized
+    uint32_t event_count;                               // Number of events written since the last clear
+}energy_ledger_header_t;
+
+/**
+ * @brief Measured energy and operations of one stage
+ *
+ */
+typedef struct
+{
+    uint32_t duration_us;                               // Time spent in the stage
+    uint32_t measured_nj;                               // Drop of the energy stored on VBULK, 0 without the SAADC or when VBULK rose
+    uint32_t cpu_us;                                    // CPU active time
+    uint16_t i2c_bytes;                                 // Bytes on the I2C buses
+    uint16_t aes_blocks;                                // AES blocks encrypted
+    uint16_t radio_packets;                             // Advertising packets sent
+    uint16_t gpio_writes;                               // Trace pin writes
+}energy_stage_record_t;
+
+/**
+ * @brief Ledger of one event, as stored in the FRAM ring
+ *
+ */
+typedef struct
+{
+    uint32_t event_counter;                             // Event counter sent in the payload
+    uint16_t vbulk_start_mv;                            // VBULK when the ledger was opened, 0 without the SAADC
+    uint16_t vbulk_end_mv;                              // VBULK at the last mark, 0 without the SAADC
+    uint8_t  tx_dbm_10;                                 // fram_data.tx_dbm_10 of the event, for the radio cost
+    uint8_t  ad_bytes;                                  // Advertising data bytes of a packet, for the radio cost
+    uint8_t  primary_channels;                          // Primary channels of a packet, for the radio cost, 0 in older records is 3
+    uint8_t  aux_us_per_byte;                           // Air time of a byte of the AUX_ADV_IND, 0 in older records is 1M
+    energy_stage_record_t stages[ENERGY_STAGE_MAX];     // Energy and operations of each stage
+}energy_ledger_record_t;
+
+/**
+ * @brief Operation counters and VBULK at the last mark
+ *
+ */
+typedef struct
+{
+    uint32_t cycles;
+    uint32_t vbulk_mv;
+    uint32_t cpu_us;
+    uint32_t i2c_bytes;
+    uint32_t aes_blocks;
+    uint32_t radio_packets;
+    uint32_t gpio_writes;
+}energy_snapshot_t;
+
+/**
+ * @brief Names of the ledger stages, used for the CLI table
+ *
+ */
+static const char *const ENERGY_STAGE_NAME[ENERGY_STAGE_MAX] =
+{
+    "startup",
+    "payload",
+    "burst",
+};
+
+// Ring buffer read back for the CLI table, static to keep it off the work queue stack
+static energy_ledger_record_t energy_ledger_records[ENERGY_LEDGER_RING_SIZE];
+
+/**
+ * @brief Radio TX current at the power of the event, interpolated between 0, +4 and +8 dBm
+ *
+ * @param tx_dbm_10 TX power in 0.1 dBm
+ * @return uint32_t Current in uA
+ */
+static uint32_t radio_tx_current_ua(uint8_t tx_dbm_10)
+{
+    uint32_t dbm_10 = MIN(tx_dbm_10, 80);
+
+    if (dbm_10 <= 40)
+    {
+        return ENERGY_RADIO_TX_0DBM_UA + (((ENERGY_RADIO_TX_4DBM_UA - ENERGY_RADIO_TX_0DBM_UA) * dbm_10) / 40);
+    }
+
+    return ENERGY_RADIO_TX_4DBM_UA + (((ENERGY_RADIO_TX_8DBM_UA - ENERGY_RADIO_TX_4DBM_UA) * (dbm_10 - 40)) / 40);
+}
+
+/**
+ * @brief Modeled energy of one extended advertising packet: an ADV_EXT_IND without AD data on every primary
+ *        channel, then the AUX_ADV_IND with the AD data on one secondary channel, each after a ramp up
+ *
+ * @param tx_dbm_10 TX power in 0.1 dBm
+ * @param ad_bytes Advertising data bytes of the packet
+ * @param primary_channels Primary channels of the packet, 0 for all three
+ * @param aux_us_per_byte Air time of a byte of the AUX_ADV_IND, 0 for the 1M PHY
+ * @return uint32_t Energy in nJ
+ */
+static uint32_t radio_packet_cost_nj(uint8_t tx_dbm_10, uint8_t ad_bytes, uint8_t primary_channels, uint8_t aux_us_per_byte)
+{
+    uint32_t channels = (primary_channels != 0) ? primary_channels : 3;
+    uint32_t us_per_byte = (aux_us_per_byte != 0) ? aux_us_per_byte : ENERGY_RADIO_1M_US_PER_BYTE;
+    uint32_t aux_bytes = ENERGY_RADIO_AUX_FRAME_BYTES + ad_bytes + ((us_per_byte == ENERGY_RADIO_2M_US_PER_BYTE) ? 1 : 0);
+    uint32_t on_air_us = (channels * (ENERGY_RADIO_RAMP_US + (ENERGY_RADIO_1M_US_PER_BYTE * ENERGY_RADIO_EXT_IND_BYTES))) +
+                         ENERGY_RADIO_RAMP_US + (us_per_byte * aux_bytes);
+
+    // us * uA * mV is fJ
+    return (uint32_t)(((uint64_t)on_air_us * radio_tx_current_ua(tx_dbm_10) * ENERGY_RADIO_SUPPLY_MV) / 1000000);
+}
+
+/**
+ * @brief Modeled energy of the operations of a stage
+ *
+ * @param record Ledger of the event, for the radio parameters
+ * @param stage Stage of the event
+ * @return uint32_t Energy in nJ
+ */
+static uint32_t stage_model_nj(const energy_ledger_record_t *record, const energy_stage_record_t *stage)
+{
+    return (stage->i2c_bytes * ENERGY_COST_I2C_BYTE_NJ) +
+           (stage->aes_blocks * ENERGY_COST_AES_BLOCK_NJ) +
+           (stage->cpu_us * ENERGY_COST_CPU_US_NJ) +
+           (stage->gpio_writes * ENERGY_COST_GPIO_TOGGLE_NJ) +
+           (stage->radio_packets * radio_packet_cost_nj(record->tx_dbm_10, record->ad_bytes,
+                                                        record->primary_channels, record->aux_us_per_byte));
+}
+
+#if (USE_ENERGY_LEDGER)
+
+// Ledger of the current event, kept in RAM until the burst ends
+static energy_ledger_record_t current_ledger;
+
+// Counters at the last mark
+static energy_snapshot_t last_snapshot;
+
+static bool is_ledger_open = false;
+
+/**
+ * @brief Read VBULK and every operation counter
+ *
+ * @param snapshot Buffer to store the counters
+ */
+static void take_snapshot(energy_snapshot_t *snapshot)
+{
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    k_thread_runtime_stats_t cpu_stats = {0};
+
+    (void)k_thread_runtime_stats_all_get(&cpu_stats);
+    snapshot->cpu_us = (uint32_t)k_cyc_to_us_floor64(cpu_stats.total_cycles);
+#else
+    snapshot->cpu_us = 0;
+#endif
+
+    if (vbulk_read_mv(&snapshot->vbulk_mv) != 0)
+    {
+        snapshot->vbulk_mv = 0;
+    }
+
+    snapshot->cycles = k_cycle_get_32();
+    snapshot->i2c_bytes = i2c_get_bus_byte_count();
+    snapshot->aes_blocks = app_encrypt_get_block_count();
+    snapshot->radio_packets = get_adv_packets_sent();
+    snapshot->gpio_writes = get_trace_pin_write_count();
+}
+
+/**
+ * @brief Open the ledger of an event: VBULK and the operation counters are the start of its first stage
+ *
+ */
+void energy_ledger_begin(void)
+{
+    memset(&current_ledger, 0, sizeof(current_ledger));
+    take_snapshot(&last_snapshot);
+    current_ledger.vbulk_start_mv = (uint16_t)last_snapshot.vbulk_mv;
+    is_ledger_open = true;
+}
+
+/**
+ * @brief End a stage of the event: VBULK is measured, the time, the energy and the operations since the previous mark
+ *        are added to the stage
+ *
+ * @param stage Stage which just ended
+ */
+void energy_ledger_mark(energy_stage_t stage)
+{
+    energy_snapshot_t now;
+    energy_stage_record_t *record;
+
+    if (!is_ledger_open || (stage >= ENERGY_STAGE_MAX))
+    {
+        return;
+    }
+
+    take_snapshot(&now);
+    record = &current_ledger.stages[stage];
+
+    record->duration_us += k_cyc_to_us_floor32(now.cycles - last_snapshot.cycles);
+    record->measured_nj += vbulk_energy_drop_nj(last_snapshot.vbulk_mv, now.vbulk_mv);
+    record->cpu_us += now.cpu_us - last_snapshot.cpu_us;
+    record->i2c_bytes += now.i2c_bytes - last_snapshot.i2c_bytes;
+    record->aes_blocks += now.aes_blocks - last_snapshot.aes_blocks;
+    record->radio_packets += now.radio_packets - last_snapshot.radio_packets;
+    record->gpio_writes += now.gpio_writes - last_snapshot.gpio_writes;
+
+    current_ledger.vbulk_end_mv = (uint16_t)now.vbulk_mv;
+    last_snapshot = now;
+}
+
+/**
+ * @brief End the burst stage and write the ledger of the event in the next slot of the FRAM ring.
+ *        Must be called from a thread, the FRAM is written.
+ *
+ */
+void energy_ledger_end(void)
+{
+    energy_ledger_header_t header;
+
+    if (!is_ledger_open)
+    {
+        return;
+    }
+
+    energy_ledger_mark(ENERGY_STAGE_BURST);
+    is_ledger_open = false;
+
+    current_ledger.event_counter = fram_data.event_counter;
+    current_ledger.tx_dbm_10 = fram_data.tx_dbm_10;
+    current_ledger.ad_bytes = manufacture_data_len + ENERGY_AD_OVERHEAD_BYTES;
+    current_ledger.primary_channels = get_adv_primary_channel_count();
+    current_ledger.aux_us_per_byte = is_adv_aux_phy_2m() ? ENERGY_RADIO_2M_US_PER_BYTE : ENERGY_RADIO_1M_US_PER_BYTE;
+
+    if (app_fram_read_bytes(FRAM_ENERGY_LEDGER_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the energy ledger header");
+        return;
+    }
+
+    if (header.magic != ENERGY_LEDGER_MAGIC)
+    {
+        header.magic = ENERGY_LEDGER_MAGIC;
+        header.event_count = 0;
+    }
+
+    if (app_fram_write_bytes(ENERGY_LEDGER_RECORD_ADDR(header.event_count % ENERGY_LEDGER_RING_SIZE),
+                             (uint8_t*)&current_ledger, sizeof(current_ledger)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to write the energy ledger");
+        return;
+    }
+
+    header.event_count++;
+    (void)app_fram_write_bytes(FRAM_ENERGY_LEDGER_ADDR, (uint8_t*)&header, sizeof(header));
+}
+
+#endif // USE_ENERGY_LEDGER
+
+/**
+ * @brief Print one energy in uJ with one decimal
+ *
+ * @param energy_nj Energy in nJ
+ */
+static void print_uj(uint32_t energy_nj)
+{
+    LOG_RAW(" %7u.%u", energy_nj / 1000, (energy_nj % 1000) / 100);
+}
+
+/**
+ * @brief Print the ledger of one event, a line per stage and the total
+ *
+ * @param record Ledger of the event
+ */
+static void print_ledger_record(const energy_ledger_record_t *record)
+{
+    energy_stage_record_t total = {0};
+    const energy_stage_record_t *stage;
+    uint32_t packet_nj = radio_packet_cost_nj(record->tx_dbm_10, record->ad_bytes, record->primary_channels,
+                                              record->aux_us_per_byte);
+
+    LOG_RAW("event %u: VBULK %d mV to %d mV, TX %d.%d dBm, %d AD bytes, %d primary channels\n", record->event_counter,
+            record->vbulk_start_mv, record->vbulk_end_mv, record->tx_dbm_10 / 10, record->tx_dbm_10 % 10, record->ad_bytes,
+            (record->primary_channels != 0) ? record->primary_channels : 3);
+    LOG_RAW("%-8s %9s %9s %9s %9s %9s %9s %9s %9s\n", "stage", "time us", "measured", "model",
+            "i2c", "aes", "radio", "cpu", "gpio");
+
+    for (uint8_t stage_idx = 0; stage_idx <= ENERGY_STAGE_MAX; stage_idx++)
+    {
+        stage = (stage_idx < ENERGY_STAGE_MAX) ? &record->stages[stage_idx] : &total;
+
+        LOG_RAW("%-8s %9u", (stage_idx < ENERGY_STAGE_MAX) ? ENERGY_STAGE_NAME[stage_idx] : "total", stage->duration_us);
+        print_uj(stage->measured_nj);
+        print_uj(stage_model_nj(record, stage));
+        print_uj(stage->i2c_bytes * ENERGY_COST_I2C_BYTE_NJ);
+        print_uj(stage->aes_blocks * ENERGY_COST_AES_BLOCK_NJ);
+        print_uj(stage->radio_packets * packet_nj);
+        print_uj(stage->cpu_us * ENERGY_COST_CPU_US_NJ);
+        print_uj(stage->gpio_writes * ENERGY_COST_GPIO_TOGGLE_NJ);
+        LOG_RAW("\n");
+
+        if (stage_idx < ENERGY_STAGE_MAX)
+        {
+            total.duration_us += stage->duration_us;
+            total.measured_nj += stage->measured_nj;
+            total.cpu_us += stage->cpu_us;
+            total.i2c_bytes += stage->i2c_bytes;
+            total.aes_blocks += stage->aes_blocks;
+            total.radio_packets += stage->radio_packets;
+            total.gpio_writes += stage->gpio_writes;
+        }
+    }
+}
+
+/**
+ * @brief Print the energy ledger ring, oldest event first. Energies are in uJ.
+ *
+ */
+static void dump_energy_ledger(void)
+{
+    energy_ledger_header_t header;
+    uint32_t num_records;
+
+    if (app_fram_read_bytes(FRAM_ENERGY_LEDGER_ADDR, (uint8_t*)&header, sizeof(header)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the energy ledger header");
+        return;
+    }
+
+    if ((header.magic != ENERGY_LEDGER_MAGIC) || (header.event_count == 0))
+    {
+        LOG_RAW("No energy ledger recorded\n");
+        return;
+    }
+
+    num_records = MIN(header.event_count, ENERGY_LEDGER_RING_SIZE);
+    if (app_fram_read_bytes(ENERGY_LEDGER_RECORD_ADDR(0), (uint8_t*)energy_ledger_records,
+                            num_records * sizeof(energy_ledger_record_t)) != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to read the energy ledger");
+        return;
+    }
+
+    LOG_RAW(">> ------- Energy ledger, last %d of %d events, energy in uJ -------\n", num_records, header.event_count);
+
+    for (uint32_t event_idx = header.event_count - num_records; event_idx < header.event_count; event_idx++)
+    {
+        print_ledger_record(&energy_ledger_records[event_idx % ENERGY_LEDGER_RING_SIZE]);
+    }
+}
+
+/**
+ * @brief Forget every event recorded in the FRAM ring
+ *
+ */
+static void clear_energy_ledger(void)
+{
+    energy_ledger_header_t header = {.magic = ENERGY_LEDGER_MAGIC, .event_count = 0};
+
+    if (app_fram_write_bytes(FRAM_ENERGY_LEDGER_ADDR, (uint8_t*)&header, sizeof(header)) == FRAM_SUCCESS)
+    {
+        LOG_RAW("Energy ledger cleared\n");
+    }
+}
+
+/**
+ * @brief Print the cost model of the ledger, the packet cost is at the TX power stored in FRAM
+ *
+ */
+static void print_energy_model(void)
+{
+    uint8_t ad_bytes = manufacture_data_len + ENERGY_AD_OVERHEAD_BYTES;
+    uint8_t primary_channels = get_adv_primary_channel_count();
+    uint8_t aux_us_per_byte = is_adv_aux_phy_2m() ? ENERGY_RADIO_2M_US_PER_BYTE : ENERGY_RADIO_1M_US_PER_BYTE;
+
+    LOG_RAW(">> ------- Energy cost model, nJ -------\n");
+    LOG_RAW("I2C byte        %6d\n", ENERGY_COST_I2C_BYTE_NJ);
+    LOG_RAW("AES block       %6d\n", ENERGY_COST_AES_BLOCK_NJ);
+    LOG_RAW("CPU active us   %6d\n", ENERGY_COST_CPU_US_NJ);
+    LOG_RAW("GPIO write      %6d\n", ENERGY_COST_GPIO_TOGGLE_NJ);
+    LOG_RAW("Packet          %6u at %d.%d dBm, %d AD bytes, %d primary channels, AUX on %s\n",
+            radio_packet_cost_nj(fram_data.tx_dbm_10, ad_bytes, primary_channels, aux_us_per_byte),
+            fram_data.tx_dbm_10 / 10, fram_data.tx_dbm_10 % 10, ad_bytes, primary_channels,
+            (aux_us_per_byte == ENERGY_RADIO_2M_US_PER_BYTE) ? "2M" : "1M");
+    LOG_RAW("VBULK storage   %6d uF\n", VBULK_CAPACITANCE_UF);
+}
+
+/**
+ * @brief Handle the energy ledger command from the CLI
+ *
+ * @param sub_command Sub command to run (energy_ledger_command_t)
+ */
+void handle_energy_ledger_command(uint8_t sub_command)
+{
+    switch (sub_command)
+    {
+        case ENERGY_LEDGER_COMMAND_DUMP:
+            dump_energy_ledger();
+            break;
+        case ENERGY_LEDGER_COMMAND_CLEAR:
+            clear_energy_ledger();
+            break;
+        case ENERGY_LEDGER_COMMAND_MODEL:
+            print_energy_model();
+            break;
+        default:
+            LOG_RAW("Unknown energy ledger command %d\n", sub_command);
+            break;
+    }
+}
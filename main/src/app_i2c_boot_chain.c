@@ -0,0 +1,282 @@
+#include "app_i2c_boot_chain.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "i2c_queue.h"
+#include "fram.h"
+#include "accel.h"
+#include "temp_pressure.h"
+#include "config_commands.h"
+
+#include "app_boot_trace.h"
+#include "app_sensor_scheduler.h"
+#include "app_device_caps.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+// The chains and their transactions live until the queue threads are done with them.
+// The sensor chain only holds the steps the device type needs, in step order.
+static i2c_txn_t sensor_txns[BOOT_CHAIN_SENSOR_MAX];
+static boot_chain_step_t sensor_steps[BOOT_CHAIN_SENSOR_MAX];
+static uint8_t num_sensor_txns;
+static i2c_txn_t fram_txn;
+static i2c_chain_t sensor_chain;
+static i2c_chain_t fram_chain;
+
+static boot_chain_report_t last_report;
+
+/**
+ * @brief Accelerometer configured, start its conversion right away
+ *
+ * @param txn Accelerometer configuration transaction
+ */
+static void accel_config_done(i2c_txn_t *txn)
+{
+    boot_trace_mark(BOOT_STAGE_ACCEL_CONFIG);
+    if (txn->result == 0)
+    {
+        accel_trigger_enable();
+        sensor_scheduler_mark_triggered(SENSOR_ACCEL);
+    }
+}
+
+/**
+ * @brief Accelerometer converting continuously, the capture fill time starts now
+ *
+ * @param txn Continuous conversion configuration transaction
+ */
+static void accel_fifo_start_done(i2c_txn_t *txn)
+{
+    boot_trace_mark(BOOT_STAGE_ACCEL_CONFIG);
+    if (txn->result == 0)
+    {
+        app_accel_fifo_mark_started();
+    }
+}
+
+/**
+ * @brief Temperature and pressure sensor DRDY interrupt configured
+ *
+ * @param txn Interrupt configuration transaction
+ */
+static void tps_config_done(i2c_txn_t *txn)
+{
+    ARG_UNUSED(txn);
+    boot_trace_mark(BOOT_STAGE_TPS_CONFIG);
+}
+
+/**
+ * @brief Temperature and pressure sensor one shot started
+ *
+ * @param txn Trigger transaction
+ */
+static void tps_trigger_done(i2c_txn_t *txn)
+{
+    if (txn->result == 0)
+    {
+        sensor_scheduler_mark_triggered(SENSOR_TEMP_PRESSURE);
+    }
+    boot_trace_mark(BOOT_STAGE_SENSOR_TRIGGER);
+}
+
+/**
+ * @brief Add a transaction to the sensor chain
+ *
+ * @param step Step of the transaction
+ * @return i2c_txn_t* Transaction to set up
+ */
+static i2c_txn_t *add_sensor_txn(boot_chain_step_t step)
+{
+    sensor_steps[num_sensor_txns] = step;
+    return &sensor_txns[num_sensor_txns++];
+}
+
+/**
+ * @brief Set up the transactions of both chains
+ *
+ * @param capabilities DEVICE_CAP_* mask, only the sensors it names are configured and triggered
+ */
+static void boot_chain_setup(uint8_t capabilities)
+{
+    i2c_txn_t *txn;
+
+    num_sensor_txns = 0;
+
+    if (capabilities & DEVICE_CAP_ACCEL)
+    {
+        txn = add_sensor_txn(BOOT_CHAIN_ACCEL_CONFIG);
+        app_accel_config_txn(txn);
+        txn->done_cb = accel_config_done;
+    }
+
+    if (capabilities & DEVICE_CAP_ACCEL_FIFO)
+    {
+        txn = add_sensor_txn(BOOT_CHAIN_ACCEL_FIFO_MODE);
+        app_accel_fifo_mode_txn(txn);
+
+        txn = add_sensor_txn(BOOT_CHAIN_ACCEL_FIFO_START);
+        app_accel_fifo_start_txn(txn);
+        txn->done_cb = accel_fifo_start_done;
+    }
+
+    if (capabilities & DEVICE_CAP_TEMP_PRESSURE)
+    {
+        txn = add_sensor_txn(BOOT_CHAIN_TPS_CONFIG);
+        temp_pressure_interrupt_config_txn(txn);
+        txn->done_cb = tps_config_done;
+
+        txn = add_sensor_txn(BOOT_CHAIN_TPS_TRIGGER);
+        app_temp_pressure_trigger_txn(txn);
+        txn->done_cb = tps_trigger_done;
+    }
+
+    // Locks the FRAM until the read is loaded
+    app_fram_bulk_read_txn(&fram_txn);
+}
+
+/**
+ * @brief Copy the result and timing of a transaction into the report
+ *
+ * @param step Step of the transaction
+ * @param txn Transaction which is done
+ */
+static void report_step(boot_chain_step_t step, const i2c_txn_t *txn)
+{
+    last_report.step_mask |= BIT(step);
+    last_report.result[step] = txn->result;
+    last_report.latency_us[step] = txn->latency_us;
+    last_report.busy_us[step] = txn->busy_us;
+    LOG_DBG("Boot chain step %d: result %d, latency %d us, bus %d us", step, txn->result, txn->latency_us, txn->busy_us);
+}
+
+/**
+ * @brief Submit a chain. On error its transactions carry the error code, as if they had failed on the bus.
+ *
+ * @param chain Chain to submit
+ * @param txns Transactions of the chain
+ * @param num_txns Number of transactions
+ * @return int I2C_QUEUE_SUCCESS or negative error code
+ */
+static int boot_chain_submit(i2c_chain_t *chain, i2c_txn_t *txns, uint8_t num_txns)
+{
+    int ret = i2c_queue_submit(chain, txns, num_txns);
+
+    if (ret != I2C_QUEUE_SUCCESS)
+    {
+        for (uint8_t idx = 0; idx < num_txns; idx++)
+        {
+            txns[idx].result = ret;
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Run the sensor chain and the FRAM chain, sleeping until both are done
+ *
+ * @param print Flag to indicate if the FRAM content should be printed
+ * @param capabilities DEVICE_CAP_* mask of the sensors to configure and trigger
+ * @param is_serial Submit the FRAM chain only once the sensor chain is done
+ * @return int32_t FRAM_SUCCESS or FRAM_ERROR
+ */
+static int32_t boot_chain_run(uint8_t print, uint8_t capabilities, bool is_serial)
+{
+    uint32_t start_cycles;
+    int sensor_ret = I2C_QUEUE_SUCCESS;
+    int fram_ret = I2C_QUEUE_SUCCESS;
+    bool is_sensor_chain;
+
+    boot_chain_setup(capabilities);
+    is_sensor_chain = (num_sensor_txns > 0);
+
+    start_cycles = k_cycle_get_32();
+    if (is_sensor_chain)
+    {
+        sensor_ret = boot_chain_submit(&sensor_chain, sensor_txns, num_sensor_txns);
+    }
+    if (is_sensor_chain && is_serial && (sensor_ret == I2C_QUEUE_SUCCESS))
+    {
+        sensor_ret = i2c_queue_wait(&sensor_chain, K_FOREVER);
+        fram_ret = boot_chain_submit(&fram_chain, &fram_txn, 1);
+        if (fram_ret == I2C_QUEUE_SUCCESS)
+        {
+            fram_ret = i2c_queue_wait(&fram_chain, K_FOREVER);
+        }
+    }
+    else
+    {
+        // The CPU sleeps until both chains are on their bus and back
+        fram_ret = boot_chain_submit(&fram_chain, &fram_txn, 1);
+        if (is_sensor_chain && (sensor_ret == I2C_QUEUE_SUCCESS))
+        {
+            sensor_ret = i2c_queue_wait(&sensor_chain, K_FOREVER);
+        }
+        if (fram_ret == I2C_QUEUE_SUCCESS)
+        {
+            fram_ret = i2c_queue_wait(&fram_chain, K_FOREVER);
+        }
+    }
+
+    memset(&last_report, 0, sizeof(last_report));
+    last_report.wall_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+    last_report.is_split_bus = is_sensor_chain && (sensor_txns[0].bus != fram_txn.bus);
+    last_report.is_serial = is_serial;
+    for (uint8_t idx = 0; idx < num_sensor_txns; idx++)
+    {
+        report_step(sensor_steps[idx], &sensor_txns[idx]);
+    }
+    report_step(BOOT_CHAIN_FRAM_READ, &fram_txn);
+
+    if (sensor_ret != I2C_QUEUE_SUCCESS)
+    {
+        LOG_ERR("Boot sensor chain error code (%d)", sensor_ret);
+    }
+    if (fram_ret != I2C_QUEUE_SUCCESS)
+    {
+        LOG_ERR("Boot FRAM chain error code (%d)", fram_ret);
+    }
+    LOG_INF("Boot I2C done in %d us, %d sensor transactions, %s", last_report.wall_us, num_sensor_txns,
+            last_report.is_split_bus ? "two buses" : "one bus");
+
+    return dump_fram_from_txn(&fram_txn, print);
+}
+
+/**
+ * @brief Configure and trigger the sensors a device type needs and read the FRAM, sleeping until it is done.
+ *        The sensor chain and the FRAM chain run in parallel when the devicetree puts them on different buses.
+ *        fram_data is loaded as by dump_fram().
+ *
+ * @param print Flag to indicate if the FRAM content should be printed
+ * @param capabilities DEVICE_CAP_* mask of the sensors to configure and trigger, see get_device_capabilities()
+ * @return int32_t FRAM_SUCCESS or FRAM_ERROR, sensor errors are left to sensor_scheduler_collect()
+ */
+int32_t i2c_boot_chain_run(uint8_t print, uint8_t capabilities)
+{
+    return boot_chain_run(print, capabilities, false);
+}
+
+/**
+ * @brief Same as i2c_boot_chain_run(), with the FRAM chain submitted once the sensor chain is done.
+ *        Takes the time of a one bus layout, used to benchmark the bus layouts.
+ *
+ * @param print Flag to indicate if the FRAM content should be printed
+ * @param capabilities DEVICE_CAP_* mask of the sensors to configure and trigger
+ * @return int32_t FRAM_SUCCESS or FRAM_ERROR
+ */
+int32_t i2c_boot_chain_run_serial(uint8_t print, uint8_t capabilities)
+{
+    return boot_chain_run(print, capabilities, true);
+}
+
+/**
+ * @brief Get the timing of the last boot chains
+ *
+ * @param report Buffer to store the timing
+ */
+void i2c_boot_chain_get_report(boot_chain_report_t *report)
+{
+    *report = last_report;
+}
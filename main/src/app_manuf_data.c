@@ -12,6 +12,8 @@
 
 #include "app_encrypt.h"
 #include "app_sensors.h"
+#include "app_prebuilt_frame.h"
+#include "app_report_by_exception.h"
 
 LOG_MODULE_DECLARE(wepower);
 
@@ -25,7 +27,10 @@ typedef enum
 }fram_data_type_t;
 
 /*                                                             |--------------------------------- --------- ENCRYPTED  DATA -------------------------------- | |-- ID --| status,cnt */
-uint8_t manufacture_data[PAYLOAD_FRAME_LENGTH] = { 0x50, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+uint8_t manufacture_data[PAYLOAD_FRAME_MAX_LENGTH] = { 0x50, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+// Bytes of manufacture_data sent, longer than PAYLOAD_FRAME_LENGTH for AES-CCM frames
+uint8_t manufacture_data_len = PAYLOAD_FRAME_LENGTH;
 
 extern uint8_t u8Polarity;
 
@@ -38,6 +43,9 @@ extern uint8_t u8Polarity;
  * Types 0-2:
                 6 bytes of IMU data, as 16 bit signed fraction of +/-16g.
                 4 bytes of pressure (signed kPa x16) and temperature (signed C x 10).
+ * Type 2 with USE_ACCEL_FIFO_CAPTURE:
+                6 bytes of per axis RMS of a FIFO capture, m/s^2 * 1000.
+                3 bytes of per axis crest factor, Q4.4, and the ODR code of the capture.
  * Type 3:
                 Polarity byte
                  - taken at boot from an external comparator and used by some sensor types to determine switch direction.
@@ -55,36 +63,44 @@ we_power_data_ble_adv_t we_power_data;
  * @brief Used to allow the recipient to guess how many packets were sent in an event.
  * 
  * @note "guess" because some packets will be lost and the last one received may not be the last one sent.
+ *       With USE_CONTROLLER_BURST the packets of a controller chunk all carry the number of the first packet
+ *       of the chunk (1, 11, 21...), the counter steps by BLE_ADV_BURST_CHUNK_EVENTS.
  * 
  */
 uint8_t TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
 
 /**
- * @brief Update the manufacture data
- * 
- * @note only call this ONCE per EventCounter (FRAM[0:3])
+ * @brief Fill the type dependent bytes of the clear payload
  * 
+ * @param payload  Clear payload to fill
+ * @param polarity Polarity byte for the polarity and name type
+ * @param reading  Buffer to store the values measured for the payload
+ * @return true if the payload is a measurement, the reading is set
  */
-void update_manufacture_data(void)
+static bool fill_type_dependent_data(we_power_data_ble_adv_t *payload, uint8_t polarity, sensor_reading_t *reading)
 {
-    LOG_INF(">>> Updating the Manufacturer Data");
-	static uint8_t cipher_text[DATA_SIZE_BYTES];
-   //Get sensor data
 	switch (fram_data.type)
 	{
 		case DATA_TYPE_SENSOR_DATA_0:
 		case DATA_TYPE_SENSOR_DATA_1:
+			measure_sensor_data(payload, reading);
+			return true;
+
 		case DATA_TYPE_SENSOR_DATA_2:
-			measure_sensor_data(&we_power_data);
-			break;
+#if (USE_ACCEL_FIFO_CAPTURE)
+			measure_vibration_features(payload, reading);
+#else
+			measure_sensor_data(payload, reading);
+#endif
+			return true;
 
 		case DATA_TYPE_POLARITY_AND_NAME_9_BYTES: 
-			we_power_data.data_bytes[4] = u8Polarity;
-			memcpy(&we_power_data.data_bytes[5], fram_data.cName, 9);
+			payload->data_bytes[4] = polarity;
+			memcpy(&payload->data_bytes[5], fram_data.cName, 9);
 			break;
 
 		case DATA_TYPE_NAME_10_BYTES: 
-			memcpy(&we_power_data.data_bytes[4], fram_data.cName, 10);
+			memcpy(&payload->data_bytes[4], fram_data.cName, 10);
 			break;
 
 		default: 
@@ -92,25 +108,175 @@ void update_manufacture_data(void)
 			break;
 	}
 
-    // increase the FRAM Event counter and set first four bytes
-	fram_data.event_counter++;
-    app_fram_write_counter(&fram_data);
+	return false;
+}
 
-	we_power_data.data_fields.type = fram_data.type;
-	we_power_data.data_fields.event_counter24[0] = (uint8_t)((fram_data.event_counter & 0x000000FF));
-	we_power_data.data_fields.event_counter24[1] = (uint8_t)((fram_data.event_counter & 0x0000FF00)>>8);
-	we_power_data.data_fields.event_counter24[2] = (uint8_t)((fram_data.event_counter & 0x00FF0000)>>16);
-    we_power_data.data_fields.id.u16 = fram_data.serial_number & 0xFFFF;
+/**
+ * @brief Build a complete advertising frame from a clear payload
+ * 
+ * @param payload       Clear payload, type dependent bytes already filled
+ * @param event_counter Event counter the frame is sent for
+ * @param frame         Buffer of PAYLOAD_FRAME_MAX_LENGTH bytes for the frame, must not be manufacture_data
+ * @return uint8_t      Length of the frame
+ */
+uint8_t build_manufacture_frame(we_power_data_ble_adv_t *payload, uint32_t event_counter, uint8_t *frame)
+{
+	uint8_t cipher_text[DATA_SIZE_BYTES];
+	uint8_t frame_len = PAYLOAD_FRAME_LENGTH;
 
-    // initialize the TX counter
+	payload->data_fields.type = fram_data.type;
+	payload->data_fields.event_counter24[0] = (uint8_t)((event_counter & 0x000000FF));
+	payload->data_fields.event_counter24[1] = (uint8_t)((event_counter & 0x0000FF00)>>8);
+	payload->data_fields.event_counter24[2] = (uint8_t)((event_counter & 0x00FF0000)>>16);
+    payload->data_fields.id.u16 = fram_data.serial_number & 0xFFFF;
+
+    // Clear part of the BLE adv data
+    memcpy(&frame[0],                         manufacture_data,             PAYLOAD_DATA_START_INDEX);
+    memcpy(&frame[PAYLOAD_DEVICE_ID_INDEX],  &(fram_data.serial_number),   PAYLOAD_SERIAL_NUMBER_SIZE);
+    frame[PAYLOAD_TX_REPEAT_COUNTER_INDEX] = TX_REPEAT_COUNTER_DEFAULT_VALUE;
 
-	TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
-	manufacture_data[PAYLOAD_TX_REPEAT_COUNTER_INDEX] = TX_Repeat_Counter;
-   
     // Handle encryption
-    encrypt_data(we_power_data.data_bytes, cipher_text, PAYLOAD_DATA_SIZE_BYTES);
+    if (is_ccm_mic_length(fram_data.mic_len))
+    {
+        // Full counter in clear for the replay check, authenticated with the rest of the clear bytes. The repeat counter changes per packet and is left out.
+        memcpy(&frame[PAYLOAD_CCM_COUNTER_INDEX], &event_counter, PAYLOAD_CCM_COUNTER_SIZE);
+        frame[PAYLOAD_STATUS_BYTE_INDEX] = PAYLOAD_ENCRYPTION_STATUS_CCM;
+
+        uint8_t aad[] = {frame[0], frame[1],
+                         frame[PAYLOAD_DEVICE_ID_INDEX], frame[PAYLOAD_DEVICE_ID_INDEX + 1],
+                         frame[PAYLOAD_STATUS_BYTE_INDEX],
+                         frame[PAYLOAD_CCM_COUNTER_INDEX],     frame[PAYLOAD_CCM_COUNTER_INDEX + 1],
+                         frame[PAYLOAD_CCM_COUNTER_INDEX + 2], frame[PAYLOAD_CCM_COUNTER_INDEX + 3]};
+
+        frame[PAYLOAD_STATUS_BYTE_INDEX] = encrypt_data_ccm(payload->data_bytes, cipher_text, PAYLOAD_DATA_SIZE_BYTES, event_counter,
+                                                            aad, sizeof(aad), &frame[PAYLOAD_CCM_MIC_INDEX], fram_data.mic_len);
+        if (frame[PAYLOAD_STATUS_BYTE_INDEX] == PAYLOAD_ENCRYPTION_STATUS_CCM)
+        {
+            frame_len = PAYLOAD_CCM_MIC_INDEX + fram_data.mic_len;
+        }
+    }
+    else
+    {
+        frame[PAYLOAD_STATUS_BYTE_INDEX] = encrypt_data(payload->data_bytes, cipher_text, PAYLOAD_DATA_SIZE_BYTES, event_counter);
+    }
+
+    memcpy(&frame[PAYLOAD_DATA_START_INDEX], cipher_text, PAYLOAD_DATA_SIZE_BYTES);
+
+    return frame_len;
+}
+
+/**
+ * @brief Update the manufacture data
+ * 
+ * @note only call this ONCE per EventCounter (FRAM[0:3]). When the prebuilt frame is on air a measured payload
+ *       replaces it under the next event counter, the event then ends with a counter two above the last one.
+ * 
+ * @return true if the event has a frame to send, false if the payload cipher can't take the next event counter
+ */
+bool update_manufacture_data(void)
+{
+    LOG_INF(">>> Updating the Manufacturer Data");
+	uint8_t frame[PAYLOAD_FRAME_MAX_LENGTH];
+	uint8_t frame_len;
+	sensor_reading_t reading = {0};
+	bool is_measured;
+	bool is_prebuilt_event = take_prebuilt_frame_event();
+
+   //Get sensor data
+	is_measured = fill_type_dependent_data(&we_power_data, u8Polarity, &reading);
+
+	if (!is_prebuilt_event && !is_event_counter_usable(fram_data.event_counter + 1))
+	{
+		LOG_ERR("Event counter %d is past the payload cipher, a new key is needed", fram_data.event_counter + 1);
+		return false;
+	}
+
+	// The prebuilt frame on air already carries the counter of the event, committed before its first packet
+	if (!is_prebuilt_event)
+	{
+		// increase the FRAM Event counter and set first four bytes
+		fram_data.event_counter++;
+		app_fram_write_counter(&fram_data);
+	}
+
+	// Readings within the deadbands of the last report cut the burst down to a heartbeat or nothing
+	rbe_check_reading(is_measured ? &reading : NULL, fram_data.event_counter);
+
+	if (is_prebuilt_event)
+	{
+		// The prebuilt frame carries the readings of the previous event, the fresh ones replace it for the later
+		// repeats. Another payload under the counter on air would reuse its nonce, so they get the next counter,
+		// committed before they go on air. Without a measurement or without FRAM the prebuilt frame stays.
+		if (!is_measured || !is_event_counter_usable(fram_data.event_counter + 1))
+		{
+			return true;
+		}
+
+		fram_data.event_counter++;
+		if (app_fram_commit_counter(&fram_data) != FRAM_SUCCESS)
+		{
+			// Left pending for the flush, the counter is skipped and never sent
+			LOG_ERR("Event counter %d not committed, the prebuilt frame is sent for the whole event", fram_data.event_counter);
+			return true;
+		}
+
+		frame_len = build_manufacture_frame(&we_power_data, fram_data.event_counter, frame);
+
+		// The burst is on air, the next repeat sends the whole fresh frame with its repeat counter
+		k_sched_lock();
+		frame[PAYLOAD_TX_REPEAT_COUNTER_INDEX] = TX_Repeat_Counter;
+		memcpy(manufacture_data, frame, frame_len);
+		manufacture_data_len = frame_len;
+		k_sched_unlock();
+
+		return true;
+	}
+
+    frame_len = build_manufacture_frame(&we_power_data, fram_data.event_counter, frame);
+
+    // initialize the TX counter
+    TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
+    memcpy(manufacture_data, frame, frame_len);
+    manufacture_data_len = frame_len;
+
+    return true;
+}
+
+/**
+ * @brief Build the first packet of the next event (event counter + 1) and store it in FRAM,
+ *        so the next boot can send it before the sensors and FRAM are serviced
+ * 
+ * @note call after update_manufacture_data(), once the current event is advertising
+ * 
+ */
+void prebuild_next_manufacture_data(void)
+{
+#if (USE_PREBUILT_FIRST_FRAME)
+	we_power_data_ble_adv_t next_payload;
+	sensor_reading_t next_reading;
+	uint8_t next_frames[PREBUILT_FRAME_VARIANTS][PAYLOAD_FRAME_MAX_LENGTH] = {0};
+	uint8_t next_frame_lens[PREBUILT_FRAME_VARIANTS] = {0};
+	uint8_t num_variants;
+
+	if (!is_prebuilt_frame_type(fram_data.type) || !is_event_counter_usable(fram_data.event_counter + 1))
+	{
+		return;
+	}
+
+	// Only the polarity and name payload depends on the polarity read at boot
+	num_variants = (fram_data.type == DATA_TYPE_POLARITY_AND_NAME_9_BYTES) ? PREBUILT_FRAME_VARIANTS : 1;
+
+	for (uint8_t polarity = 0; polarity < num_variants; polarity++)
+	{
+		// Sensor types reuse the values measured for this event, the next event sends them until it has measured
+		memcpy(&next_payload, &we_power_data, sizeof(next_payload));
+		if (fram_data.type == DATA_TYPE_POLARITY_AND_NAME_9_BYTES)
+		{
+			(void)fill_type_dependent_data(&next_payload, polarity, &next_reading);
+		}
+		next_frame_lens[polarity] = build_manufacture_frame(&next_payload, fram_data.event_counter + 1, next_frames[polarity]);
+	}
 
-    // Build the BLE adv data
-    memcpy(&manufacture_data[PAYLOAD_DATA_START_INDEX], cipher_text,                PAYLOAD_DATA_SIZE_BYTES);
-    memcpy(&manufacture_data[PAYLOAD_DEVICE_ID_INDEX],  &(fram_data.serial_number), PAYLOAD_SERIAL_NUMBER_SIZE);
-}
\ No newline at end of file
+	(void)store_prebuilt_frame(fram_data.event_counter + 1, next_frames, next_frame_lens);
+#endif
+}
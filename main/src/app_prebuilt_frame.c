@@ -0,0 +1,175 @@
+#include "app_prebuilt_frame.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/crc.h>
+
+#include "fram.h"
+#include "config_commands.h"
+
+#include "app_manuf_data.h"
+
+#define PREBUILT_FRAME_MAGIC        0x32505057  // "WPP2" in FRAM byte order, the record carries the jitter policy
+#define PREBUILT_FRAME_CRC_SEED     0xFFFF
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief First packet of the next event, as stored in FRAM.
+ *        Holds a copy of the FRAM settings needed to advertise it before dump_fram().
+ * 
+ */
+typedef struct
+{
+    uint32_t magic;                                                 // PREBUILT_FRAME_MAGIC when a frame was stored
+    uint32_t event_counter;                                         // Event counter the frames were built for
+    uint32_t serial_number;                                         // Serial number at build time
+    uint8_t  type;                                                  // Device type at build time
+    uint8_t  packet_interval;                                       // Advertising interval in milliseconds
+    uint16_t event_max_packets;                                     // Maximum number of packet repeats per event
+    uint16_t sleep_between_events;                                  // Minimum sleep time before next event in milliseconds
+    uint16_t sleep_after_wake;                                      // Sleep time before polarity detection in milliseconds
+    uint8_t  jitter_policy;                                         // Repeat jitter
+    uint8_t  frame_lens[PREBUILT_FRAME_VARIANTS];                   // Length of each frame
+    uint8_t  frames[PREBUILT_FRAME_VARIANTS][PAYLOAD_FRAME_MAX_LENGTH]; // Complete frame for each polarity
+    uint16_t crc;                                                   // CRC16-CCITT of all the fields above
+}prebuilt_frame_t;
+
+BUILD_ASSERT(FRAM_PREBUILT_FRAME_ADDR + sizeof(prebuilt_frame_t) <= FRAM_BOOT_TRACE_ADDR,
+             "Prebuilt frame overlaps the boot trace in FRAM");
+
+// Prebuilt frame loaded at boot
+static prebuilt_frame_t prebuilt_frame;
+
+// Set once the prebuilt frame is in manufacture_data, until the event of the frame takes it
+static bool is_prebuilt_frame_on_air = false;
+
+/**
+ * @brief Tell if the first packet of a device type can be built by the previous event
+ * 
+ * @param type Device type from FRAM
+ * @return true if the type sends a prebuilt first packet
+ */
+bool is_prebuilt_frame_type(uint8_t type)
+{
+    return ((type == DEVICE_TYPE_BUTTON) || (type == DEVICE_TYPE_TWO_WAY_SWITCH));
+}
+
+/**
+ * @brief Store the first packet of the next event in FRAM
+ * 
+ * @param event_counter Event counter the frames were built for
+ * @param frames        One complete frame per polarity
+ * @param frame_lens    Length of each frame
+ * @return int FRAM_SUCCESS or FRAM_ERROR
+ */
+int store_prebuilt_frame(uint32_t event_counter, uint8_t frames[PREBUILT_FRAME_VARIANTS][PAYLOAD_FRAME_MAX_LENGTH], uint8_t *frame_lens)
+{
+    prebuilt_frame_t record = {0};
+    int ret;
+
+    record.magic                = PREBUILT_FRAME_MAGIC;
+    record.event_counter        = event_counter;
+    record.serial_number        = fram_data.serial_number;
+    record.type                 = fram_data.type;
+    record.packet_interval      = fram_data.packet_interval;
+    record.event_max_packets    = fram_data.event_max_packets;
+    record.sleep_between_events = fram_data.sleep_between_events;
+    record.sleep_after_wake     = fram_data.sleep_after_wake;
+    record.jitter_policy        = fram_data.jitter_policy;
+    memcpy(record.frame_lens, frame_lens, sizeof(record.frame_lens));
+    memcpy(record.frames, frames, sizeof(record.frames));
+    record.crc = crc16_ccitt(PREBUILT_FRAME_CRC_SEED, (uint8_t*)&record, offsetof(prebuilt_frame_t, crc));
+
+    ret = app_fram_write_bytes(FRAM_PREBUILT_FRAME_ADDR, (uint8_t*)&record, sizeof(record));
+    if (ret != FRAM_SUCCESS)
+    {
+        LOG_ERR("Unable to store the prebuilt frame");
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Read the prebuilt frame stored by the previous event. When it is valid, the fields
+ *        needed to advertise it are copied into fram_data until dump_fram() reads the whole FRAM.
+ * 
+ * @return true if a valid prebuilt frame was loaded
+ */
+bool load_prebuilt_frame(void)
+{
+    if (app_fram_read_bytes(FRAM_PREBUILT_FRAME_ADDR, (uint8_t*)&prebuilt_frame, sizeof(prebuilt_frame)) != FRAM_SUCCESS)
+    {
+        return false;
+    }
+
+    // A power loss during the store leaves a record with a bad CRC, fall back to the normal boot
+    if ((prebuilt_frame.magic != PREBUILT_FRAME_MAGIC) ||
+        (prebuilt_frame.crc != crc16_ccitt(PREBUILT_FRAME_CRC_SEED, (uint8_t*)&prebuilt_frame, offsetof(prebuilt_frame_t, crc))) ||
+        !is_prebuilt_frame_type(prebuilt_frame.type) ||
+        (prebuilt_frame.frame_lens[0] < PAYLOAD_FRAME_LENGTH) || (prebuilt_frame.frame_lens[0] > PAYLOAD_FRAME_MAX_LENGTH) ||
+        (prebuilt_frame.frame_lens[1] > PAYLOAD_FRAME_MAX_LENGTH))
+    {
+        return false;
+    }
+
+    // The previous event may have died before storing its prebuilt frame, never send a stale counter
+    if ((app_fram_read_counter(&fram_data) != FRAM_SUCCESS) ||
+        (prebuilt_frame.event_counter != (fram_data.event_counter + 1)))
+    {
+        return false;
+    }
+
+    fram_data.serial_number        = prebuilt_frame.serial_number;
+    fram_data.type                 = prebuilt_frame.type;
+    fram_data.packet_interval      = prebuilt_frame.packet_interval;
+    fram_data.event_max_packets    = prebuilt_frame.event_max_packets;
+    fram_data.sleep_between_events = prebuilt_frame.sleep_between_events;
+    fram_data.sleep_after_wake     = prebuilt_frame.sleep_after_wake;
+    fram_data.jitter_policy        = prebuilt_frame.jitter_policy;
+
+    return true;
+}
+
+/**
+ * @brief Commit the event counter of the loaded prebuilt frame, then copy the frame into manufacture_data,
+ *        ready for the first packet. A reset during the event never sends the counter again.
+ * 
+ * @param polarity Polarity read at boot, selects the frame variant
+ * @return int FRAM_SUCCESS, or FRAM_ERROR if the counter could not be committed and the frame must not be sent
+ */
+int apply_prebuilt_frame(uint8_t polarity)
+{
+    uint8_t variant = (prebuilt_frame.type == DEVICE_TYPE_TWO_WAY_SWITCH) ? (polarity & 0x01) : 0;
+
+    fram_data.event_counter = prebuilt_frame.event_counter;
+    if (app_fram_commit_counter(&fram_data) != FRAM_SUCCESS)
+    {
+        // The counter stays staged, the normal boot steps past it and the frame is never sent
+        return FRAM_ERROR;
+    }
+
+    memcpy(manufacture_data, prebuilt_frame.frames[variant], prebuilt_frame.frame_lens[variant]);
+    manufacture_data_len = prebuilt_frame.frame_lens[variant];
+    TX_Repeat_Counter = TX_REPEAT_COUNTER_DEFAULT_VALUE;
+    is_prebuilt_frame_on_air = true;
+
+    return FRAM_SUCCESS;
+}
+
+/**
+ * @brief Tell if the current event is the one of the prebuilt frame, only the first call after apply_prebuilt_frame() does
+ * 
+ * @note call once per event, from update_manufacture_data()
+ * 
+ * @return true if the prebuilt frame is on air, its counter is already committed
+ */
+bool take_prebuilt_frame_event(void)
+{
+    bool was_on_air = is_prebuilt_frame_on_air;
+
+    is_prebuilt_frame_on_air = false;
+    return was_on_air;
+}
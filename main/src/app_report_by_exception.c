@@ -0,0 +1,153 @@
+#include "app_report_by_exception.h"
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "fram.h"
+#include "config_commands.h"
+
+#include "app_energy_burst.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+BUILD_ASSERT(SENSOR_READING_VALUES == RBE_LAST_VALUES, "The FRAM keeps one value per value of a reading");
+
+// Decision of the current event, a full report until the first reading is checked
+static rbe_report_t event_report = RBE_REPORT_FULL;
+
+/**
+ * @brief Tell if the policy in FRAM holds back unchanged events. A device without sleep between events is a
+ *        button, each event is a press and is always reported in full.
+ *
+ * @return true if report by exception is built in, its mode is not off and the device sleeps between events
+ */
+static bool is_rbe_enabled(void)
+{
+    return (USE_REPORT_BY_EXCEPTION && (fram_data.sleep_between_events != 0) &&
+            ((fram_data.rbe_policy & RBE_POLICY_MODE_MASK) != RBE_MODE_OFF));
+}
+
+/**
+ * @brief Deadband of a value of a reading, from FRAM
+ *
+ * @param index SENSOR_READING_* index of the value
+ * @return uint16_t Largest change which is not reported
+ */
+static uint16_t get_deadband(uint8_t index)
+{
+    switch (index)
+    {
+        case SENSOR_READING_TEMP:
+            return fram_data.rbe_deadband_temp;
+        case SENSOR_READING_PRESSURE:
+            return fram_data.rbe_deadband_pressure;
+        default:
+            return fram_data.rbe_deadband_accel;
+    }
+}
+
+/**
+ * @brief Tell if a value of the reading moved beyond its deadband since the last full report
+ *
+ * @param reading Reading of the event
+ * @return true if the event has to be reported in full
+ */
+static bool is_reading_changed(const sensor_reading_t *reading)
+{
+    for (uint8_t index = 0; index < SENSOR_READING_VALUES; index++)
+    {
+        if ((reading->valid_mask & BIT(index)) &&
+            (abs((int32_t)reading->value[index] - fram_data.rbe_last_values[index]) > get_deadband(index)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Decide what the event sends from the policy in FRAM
+ *
+ * @param reading Reading of the event, NULL if the payload of the device type has none
+ * @param event_counter Event counter sent in the payload of the event
+ * @return rbe_report_t Decision of the event
+ */
+static rbe_report_t decide_report(const sensor_reading_t *reading, uint32_t event_counter)
+{
+    uint8_t refresh_events = fram_data.rbe_policy >> RBE_POLICY_REFRESH_SHIFT;
+
+    if (!is_rbe_enabled() || (reading == NULL) || (reading->valid_mask == 0))
+    {
+        return RBE_REPORT_FULL;
+    }
+
+    // A periodic full report tells the receiver the device is alive and catches the changes of the other page
+    if ((refresh_events != 0) && ((event_counter % refresh_events) == 0))
+    {
+        return RBE_REPORT_FULL;
+    }
+
+    if (is_reading_changed(reading))
+    {
+        return RBE_REPORT_FULL;
+    }
+
+    return ((fram_data.rbe_policy & RBE_POLICY_MODE_MASK) == RBE_MODE_SILENT) ? RBE_REPORT_NONE : RBE_REPORT_HEARTBEAT;
+}
+
+/**
+ * @brief Compare the reading of the event with the last full report and decide what the event sends.
+ *        A full report keeps the reading in FRAM as the new reference, written by the next app_fram_flush().
+ *        The burst of the event is capped to the packets of the decision, also when it is already on air.
+ *        Without fram_data.sleep_between_events (button) every event is a full report.
+ *
+ * @note call once per event, after the measurement and the event counter step
+ *
+ * @param reading Reading of the event, NULL if the payload of the device type has none
+ * @param event_counter Event counter sent in the payload of the event
+ */
+void rbe_check_reading(const sensor_reading_t *reading, uint32_t event_counter)
+{
+    event_report = decide_report(reading, event_counter);
+
+    switch (event_report)
+    {
+        case RBE_REPORT_HEARTBEAT:
+            LOG_INF("Event %d within the deadbands, heartbeat only", event_counter);
+            energy_burst_limit_packets(1);
+            break;
+
+        case RBE_REPORT_NONE:
+            LOG_INF("Event %d within the deadbands, not advertised", event_counter);
+            energy_burst_limit_packets(0);
+            break;
+
+        default:
+            // Heartbeats keep the old reference, a slow drift adds up until it is reported
+            if (is_rbe_enabled() && (reading != NULL))
+            {
+                for (uint8_t index = 0; index < SENSOR_READING_VALUES; index++)
+                {
+                    if (reading->valid_mask & BIT(index))
+                    {
+                        fram_data.rbe_last_values[index] = reading->value[index];
+                    }
+                }
+                (void)app_fram_write_field(RBE_LAST, (uint8_t*)fram_data.rbe_last_values);
+            }
+            energy_burst_limit_packets(UINT16_MAX);
+            break;
+    }
+}
+
+/**
+ * @brief Get what the current event sends
+ *
+ * @return rbe_report_t Decision of the last rbe_check_reading()
+ */
+rbe_report_t rbe_get_report(void)
+{
+    return event_report;
+}
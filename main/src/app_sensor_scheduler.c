@@ -0,0 +1,274 @@
+#include "app_sensor_scheduler.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "device_config.h"
+#include "app_gpio.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+/**
+ * @brief What the scheduler needs to know about a sensor
+ *
+ */
+typedef struct
+{
+    drdy_pin_t drdy_pin;                // Pin raised when the conversion is done
+    uint32_t   conversion_us;           // Expected time from trigger to DRDY
+    int        timeout_error;           // Error code returned when DRDY never comes
+}sensor_descriptor_t;
+
+static const sensor_descriptor_t SENSORS[SENSOR_MAX] =
+{
+    [SENSOR_ACCEL]         = {DRDY_PIN_IMU, SENSOR_ACCEL_CONVERSION_USEC, ACCEL_DRDY_TIMEOUT},
+    [SENSOR_TEMP_PRESSURE] = {DRDY_PIN_TPS, SENSOR_TEMP_PRESSURE_CONVERSION_USEC, TEMP_PRESSURE_DRDY_TIMEOUT},
+};
+
+// k_cycle_get_32() when each sensor was triggered, valid while is_triggered is set
+static uint32_t trigger_cycles[SENSOR_MAX];
+static bool is_triggered[SENSOR_MAX];
+
+static sensor_schedule_report_t last_report;
+
+/**
+ * @brief Start the conversion of a sensor
+ *
+ * @param sensor Sensor to trigger
+ * @return int 0 on success, error code otherwise
+ */
+static int trigger_sensor(sensor_id_t sensor)
+{
+    int ret = 0;
+
+    switch (sensor)
+    {
+        case SENSOR_ACCEL:
+            accel_trigger_enable();
+            break;
+        case SENSOR_TEMP_PRESSURE:
+            ret = app_temp_pressure_trigger();
+            break;
+        default:
+            ret = -EINVAL;
+            break;
+    }
+
+    if (ret == 0)
+    {
+        sensor_scheduler_mark_triggered(sensor);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Read the result of a sensor which has its data ready. DRDY was seen by k_poll, the read does not
+ *        arm the DRDY interrupt and wait for it again.
+ *
+ * @param sensor Sensor to read
+ * @param accel_data Buffer for the accelerometer data
+ * @param temp_pressure_data Buffer for the temperature and pressure data
+ * @return int error code of the sensor read
+ */
+static int read_sensor(sensor_id_t sensor, accel_data_t *accel_data, temp_pressure_data_t *temp_pressure_data)
+{
+    switch (sensor)
+    {
+        case SENSOR_ACCEL:
+            return app_accel_fetch(accel_data);
+        case SENSOR_TEMP_PRESSURE:
+            return app_temp_pressure_fetch(temp_pressure_data);
+        default:
+            return -EINVAL;
+    }
+}
+
+/**
+ * @brief Give up on a sensor which never raised DRDY
+ *
+ * @param sensor Sensor to cancel
+ */
+static void cancel_sensor(sensor_id_t sensor)
+{
+    disarm_drdy_interrupt(SENSORS[sensor].drdy_pin);
+    if (sensor == SENSOR_ACCEL)
+    {
+        // Ready for the next rising edge, app_accel_fetch() does the same after a read
+        clear_imu_trigger_pin();
+    }
+}
+
+/**
+ * @brief Record that a sensor was triggered outside of the scheduler, e.g. by a transaction of an I2C queue chain.
+ *        The conversion time is counted from this call.
+ *
+ * @param sensor Sensor which is converting
+ */
+void sensor_scheduler_mark_triggered(sensor_id_t sensor)
+{
+    if (sensor < SENSOR_MAX)
+    {
+        trigger_cycles[sensor] = k_cycle_get_32();
+        is_triggered[sensor] = true;
+    }
+}
+
+/**
+ * @brief Trigger the conversion of one sensor, unless it is already converting
+ *
+ * @param sensor Sensor to trigger
+ * @return int 0 on success, error code otherwise
+ */
+int sensor_scheduler_trigger(sensor_id_t sensor)
+{
+    if (sensor >= SENSOR_MAX)
+    {
+        return -EINVAL;
+    }
+
+    return is_triggered[sensor] ? 0 : trigger_sensor(sensor);
+}
+
+/**
+ * @brief Trigger the conversion of every sensor which is not already converting.
+ *        Call as early as possible, the sensors convert while the boot goes on.
+ *
+ */
+void sensor_scheduler_trigger_all(void)
+{
+    for (uint8_t sensor = 0; sensor < SENSOR_MAX; sensor++)
+    {
+        if (!is_triggered[sensor] && (trigger_sensor(sensor) != 0))
+        {
+            LOG_ERR("Unable to trigger sensor %d", sensor);
+        }
+    }
+}
+
+/**
+ * @brief Collect the results of every triggered sensor, in completion order. Sensors not triggered yet are triggered first.
+ *
+ * @param accel_data Buffer to store the accelerometer data, left untouched on error
+ * @param temp_pressure_data Buffer to store the temperature and pressure data, left untouched on error
+ * @return int 0 if every sensor was read, ACCEL_DRDY_TIMEOUT/TEMP_PRESSURE_DRDY_TIMEOUT or error code of the first failing sensor
+ */
+int sensor_scheduler_collect(accel_data_t *accel_data, temp_pressure_data_t *temp_pressure_data)
+{
+    struct k_poll_event events[SENSOR_MAX];
+    uint32_t start_cycles;
+    uint8_t pending = 0;
+    uint8_t completed = 0;
+    int error = 0;
+
+    sensor_scheduler_trigger_all();
+
+    start_cycles = k_cycle_get_32();
+    memset(&last_report, 0, sizeof(last_report));
+    memset(last_report.completion_order, SENSOR_MAX, sizeof(last_report.completion_order));
+
+    for (uint8_t sensor = 0; sensor < SENSOR_MAX; sensor++)
+    {
+        k_poll_event_init(&events[sensor], K_POLL_TYPE_IGNORE, K_POLL_MODE_NOTIFY_ONLY, NULL);
+
+        if (!is_triggered[sensor])
+        {
+            error = (error != 0) ? error : -EIO;
+        }
+        else if (arm_drdy_interrupt(SENSORS[sensor].drdy_pin) != 0)
+        {
+            cancel_sensor(sensor);
+            is_triggered[sensor] = false;
+            error = (error != 0) ? error : -EIO;
+        }
+        else
+        {
+            k_poll_event_init(&events[sensor], K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY,
+                              get_drdy_sem(SENSORS[sensor].drdy_pin));
+            pending |= BIT(sensor);
+        }
+    }
+
+    while (pending)
+    {
+        uint32_t now = k_cycle_get_32();
+        int32_t wait_us = INT32_MAX;
+
+        // Sleep until the first DRDY, or until the closest sensor deadline
+        for (uint8_t sensor = 0; sensor < SENSOR_MAX; sensor++)
+        {
+            if (pending & BIT(sensor))
+            {
+                int32_t remaining_us = (int32_t)(SENSORS[sensor].conversion_us + SENSOR_DRDY_MARGIN_USEC) -
+                                       (int32_t)k_cyc_to_us_floor32(now - trigger_cycles[sensor]);
+                wait_us = MIN(wait_us, MAX(remaining_us, 0));
+            }
+        }
+
+        (void)k_poll(events, SENSOR_MAX, K_USEC(wait_us));
+        now = k_cycle_get_32();
+
+        for (uint8_t sensor = 0; sensor < SENSOR_MAX; sensor++)
+        {
+            uint32_t elapsed_us;
+            int ret;
+
+            if ((pending & BIT(sensor)) == 0)
+            {
+                continue;
+            }
+
+            elapsed_us = k_cyc_to_us_floor32(now - trigger_cycles[sensor]);
+
+            if (events[sensor].state == K_POLL_STATE_SEM_AVAILABLE)
+            {
+                uint32_t read_start_cycles = k_cycle_get_32();
+
+                (void)k_sem_take(get_drdy_sem(SENSORS[sensor].drdy_pin), K_NO_WAIT);
+                ret = read_sensor(sensor, accel_data, temp_pressure_data);
+
+                last_report.conversion_us[sensor] = elapsed_us;
+                last_report.read_us[sensor] = k_cyc_to_us_floor32(k_cycle_get_32() - read_start_cycles);
+                last_report.completion_order[completed++] = sensor;
+            }
+            else if (elapsed_us >= (SENSORS[sensor].conversion_us + SENSOR_DRDY_MARGIN_USEC))
+            {
+                LOG_ERR("Sensor %d DRDY timeout after %d us", sensor, elapsed_us);
+                cancel_sensor(sensor);
+                ret = SENSORS[sensor].timeout_error;
+            }
+            else
+            {
+                events[sensor].state = K_POLL_STATE_NOT_READY;
+                continue;
+            }
+
+            k_poll_event_init(&events[sensor], K_POLL_TYPE_IGNORE, K_POLL_MODE_NOTIFY_ONLY, NULL);
+            pending &= ~BIT(sensor);
+            is_triggered[sensor] = false;
+            error = (error != 0) ? error : ret;
+        }
+    }
+
+    last_report.collect_us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+    for (uint8_t idx = 0; idx < completed; idx++)
+    {
+        uint8_t sensor = last_report.completion_order[idx];
+        last_report.serial_us += SENSORS[sensor].conversion_us + last_report.read_us[sensor];
+    }
+
+    LOG_INF("Sensors collected in %d us, %d us one after the other", last_report.collect_us, last_report.serial_us);
+
+    return error;
+}
+
+/**
+ * @brief Get the timing of the last collect
+ *
+ * @param report Buffer to store the timing
+ */
+void sensor_scheduler_get_report(sensor_schedule_report_t *report)
+{
+    *report = last_report;
+}
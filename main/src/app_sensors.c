@@ -1,37 +1,30 @@
 #include "app_sensors.h"
+#include <string.h>
 #include <zephyr/logging/log.h>
 #include <hal/nrf_gpio.h>
 
 #include "device_config.h"
 #include "temp_pressure.h"
 #include "accel.h"
+#include "config_commands.h"
 #include "app_gpio.h"
+#include "app_sensor_scheduler.h"
+#include "app_accel_features.h"
 
 LOG_MODULE_DECLARE(wepower);
 
-/**
- * @brief This flag indicates if the pressure sensor was properly triggered or not
- * 
- */
-bool is_temp_pressure_sensor_triggered = false;
-
 /**
  * @brief Routine used to measure the sensors data and store it in the buffer
  * 
  * @param we_power_data The pointer to the buffer on which the data is stored
+ * @param reading Buffer to store the values of the measurement
  */
-void measure_sensor_data(we_power_data_ble_adv_t *we_power_data)
+void measure_sensor_data(we_power_data_ble_adv_t *we_power_data, sensor_reading_t *reading)
 {
     accel_data_t accel_data = {0};
     temp_pressure_data_t temp_pressure_data = {0};
 
-    // If pressure sensor was not triggerd, trigger it
     set_CN1_7();
-    if (is_temp_pressure_sensor_triggered == false)
-        is_temp_pressure_sensor_triggered = app_temp_pressure_trigger();
-
-    // trigger accelerometer
-    accel_trigger_enable();
 
     // initialize signed max negative as error codes in sensor data
     accel_data.x_accel = 0x8000;
@@ -41,26 +34,141 @@ void measure_sensor_data(we_power_data_ble_adv_t *we_power_data)
     temp_pressure_data.pressure = 0x8000;
     temp_pressure_data.temp = 0x8000;
 
-    // read accel or error out (data set either way)
-     if ( app_accel_read (&accel_data) != ACCEL_SUCCESS )
-     {
-        LOG_ERR ("Reading Accelerometer Data failed");
-     }
+    // Sensors triggered early in the boot have been converting meanwhile, the others are triggered now.
+    // Each sensor is read as soon as its DRDY rises (data set either way)
+    if (sensor_scheduler_collect(&accel_data, &temp_pressure_data) != 0)
+    {
+        LOG_ERR("Reading sensor data failed");
+    }
  
     we_power_data->data_fields.accel_x.i16 = accel_data.x_accel;
     we_power_data->data_fields.accel_y.i16 = accel_data.y_accel;
     we_power_data->data_fields.accel_z.i16 = accel_data.z_accel;
 
-    // Get temp and pressure or error out
-    is_temp_pressure_sensor_triggered = false;
-    
-    if ( app_temp_pressure_read (&temp_pressure_data) != TEMP_PRESSURE_SUCCESS )
+    we_power_data->data_fields.pressure.i16 = temp_pressure_data.pressure;
+    we_power_data->data_fields.temp.i16 = temp_pressure_data.temp;
+
+    reading->value[SENSOR_READING_ACCEL_X] = accel_data.x_accel;
+    reading->value[SENSOR_READING_ACCEL_Y] = accel_data.y_accel;
+    reading->value[SENSOR_READING_ACCEL_Z] = accel_data.z_accel;
+    reading->value[SENSOR_READING_TEMP] = temp_pressure_data.temp;
+    reading->value[SENSOR_READING_PRESSURE] = temp_pressure_data.pressure;
+    reading->valid_mask = BIT_MASK(SENSOR_READING_VALUES);
+
+    clear_CN1_7();
+}
+
+#if (USE_ACCEL_FIFO_CAPTURE)
+BUILD_ASSERT(sizeof(we_power_vibration_data_t) == DATA_SIZE_BYTES, "Vibration data does not match the payload");
+BUILD_ASSERT(ACCEL_FIFO_CAPTURE_SAMPLES <= ACCEL_FIFO_DEPTH, "Capture larger than the accelerometer FIFO");
+
+#if (USE_ACCEL_SPECTRUM)
+BUILD_ASSERT(sizeof(we_power_spectrum_data_t) == DATA_SIZE_BYTES, "Spectrum data does not match the payload");
+BUILD_ASSERT(ACCEL_FIFO_ODR_CODE < (1 << VIBRATION_AXIS_SHIFT), "ODR code overlaps the axis of the spectrum");
+
+/**
+ * @brief Store the spectrum of a capture in the buffer, in place of its features
+ * 
+ * @param we_power_data The pointer to the buffer on which the data is stored
+ * @param samples Samples of the capture
+ * @param features Features of the capture
+ * @return int SPECTRUM_SUCCESS or the error of the spectrum, the buffer is not changed on error
+ */
+static int fill_vibration_spectrum(we_power_data_ble_adv_t *we_power_data, const accel_data_t *samples,
+                                   const accel_features_t *features)
+{
+    spectrum_result_t spectrum;
+    uint8_t axis = 0;
+    int ret = accel_compute_spectrum(samples, features, &axis, &spectrum);
+
+    if (ret != SPECTRUM_SUCCESS)
     {
-        LOG_ERR("Reading temp and pressure sensor data failed");
+        LOG_ERR("Spectrum of the accelerometer capture failed (err %d)", ret);
+        return ret;
     }
 
-    we_power_data->data_fields.pressure.i16 = temp_pressure_data.pressure;
-    we_power_data->data_fields.temp.i16 = temp_pressure_data.temp;
+    LOG_INF("Accel spectrum of axis %u: bands %u %u %u, peaks %u %u %u Hz", axis,
+            spectrum.band_rms[0], spectrum.band_rms[1], spectrum.band_rms[2],
+            spectrum.peak_bin[0] * ACCEL_FIFO_ODR_HZ / SPECTRUM_FFT_SIZE,
+            spectrum.peak_bin[1] * ACCEL_FIFO_ODR_HZ / SPECTRUM_FFT_SIZE,
+            spectrum.peak_bin[2] * ACCEL_FIFO_ODR_HZ / SPECTRUM_FFT_SIZE);
+
+    for (uint8_t band = 0; band < SPECTRUM_PAYLOAD_BANDS; band++)
+    {
+        we_power_data->spectrum_fields.band_rms[band].u16 = spectrum.band_rms[band];
+    }
+    memcpy(we_power_data->spectrum_fields.peak_bin, spectrum.peak_bin, SPECTRUM_PAYLOAD_PEAKS);
+    we_power_data->spectrum_fields.odr_code = ACCEL_FIFO_ODR_CODE | VIBRATION_PAGE_SPECTRUM | (axis << VIBRATION_AXIS_SHIFT);
+
+    return SPECTRUM_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Routine used to capture the accelerometer FIFO and store the features of the capture in the buffer.
+ *        With USE_ACCEL_SPECTRUM the payloads sent with an odd event counter carry the spectrum of the capture instead.
+ *
+ * @note Called before the event counter step, the measurement goes on air with fram_data.event_counter + 1,
+ *       in the frame of this event or in the prebuilt frame of the next one
+ * 
+ * @param we_power_data The pointer to the buffer on which the data is stored
+ * @param reading Buffer to store the RMS of each axis, set whichever page the buffer carries
+ */
+void measure_vibration_features(we_power_data_ble_adv_t *we_power_data, sensor_reading_t *reading)
+{
+    accel_data_t samples[ACCEL_FIFO_CAPTURE_SAMPLES];
+    accel_features_t features;
+
+    set_CN1_7();
+
+    // No temperature and pressure in a capture, a change is told by the RMS
+    reading->valid_mask = BIT(SENSOR_READING_ACCEL_X) | BIT(SENSOR_READING_ACCEL_Y) | BIT(SENSOR_READING_ACCEL_Z);
+
+    if (app_accel_fifo_read(samples, ACCEL_FIFO_CAPTURE_SAMPLES) != ACCEL_SUCCESS)
+    {
+        LOG_ERR("Reading the accelerometer capture failed");
+
+        // signed max negative as error codes, as for a failed sample
+        we_power_data->vibration_fields.rms_x.u16 = 0x8000;
+        we_power_data->vibration_fields.rms_y.u16 = 0x8000;
+        we_power_data->vibration_fields.rms_z.u16 = 0x8000;
+        memset(features.axis, 0, sizeof(features.axis));
+
+        for (uint8_t axis = 0; axis < ACCEL_AXES; axis++)
+        {
+            reading->value[SENSOR_READING_ACCEL_X + axis] = (int16_t)0x8000;
+        }
+    }
+    else
+    {
+        accel_compute_features(samples, ACCEL_FIFO_CAPTURE_SAMPLES, &features);
+
+        for (uint8_t axis = 0; axis < ACCEL_AXES; axis++)
+        {
+            reading->value[SENSOR_READING_ACCEL_X + axis] = (int16_t)MIN(features.axis[axis].rms, INT16_MAX);
+        }
+
+#if (USE_ACCEL_SPECTRUM)
+        // The receiver gets both pages from two events, the features are sent if the spectrum fails.
+        // The page follows the counter the payload goes on air with, not the counter before the step.
+        if ((((fram_data.event_counter + 1) & 1) != 0) &&
+            (fill_vibration_spectrum(we_power_data, samples, &features) == SPECTRUM_SUCCESS))
+        {
+            clear_CN1_7();
+            return;
+        }
+#endif
+
+        we_power_data->vibration_fields.rms_x.u16 = features.axis[0].rms;
+        we_power_data->vibration_fields.rms_y.u16 = features.axis[1].rms;
+        we_power_data->vibration_fields.rms_z.u16 = features.axis[2].rms;
+    }
+
+    we_power_data->vibration_fields.crest_x = features.axis[0].crest_q4;
+    we_power_data->vibration_fields.crest_y = features.axis[1].crest_q4;
+    we_power_data->vibration_fields.crest_z = features.axis[2].crest_q4;
+    we_power_data->vibration_fields.odr_code = ACCEL_FIFO_ODR_CODE;
 
     clear_CN1_7();
-}
\ No newline at end of file
+}
+#endif
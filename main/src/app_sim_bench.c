@@ -0,0 +1,207 @@
+#include "app_sim_bench.h"
+
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/logging/log.h>
+
+#include "cmdline.h"
+#include "soc.h"
+#include "posix_board_if.h"
+
+#include "fram.h"
+#include "encrypt.h"
+#include "config_commands.h"
+#include "sim_i2c_emul.h"
+
+#include "app_bt.h"
+#include "app_boot_trace.h"
+
+#define SIM_BENCH_ARG_UNSET     (-1)
+
+LOG_MODULE_DECLARE(wepower);
+
+// -wepower_bench, print the metrics of the event and power off at its end
+static bool is_bench_enabled = false;
+
+// -wepower_preset=<n>, provision the FRAM with preset_fram_by_type(n) and power off without running an event
+static int32_t provision_preset = SIM_BENCH_ARG_UNSET;
+
+// -wepower_type=<n>, device type written over the one of the preset when provisioning
+static int32_t provision_type = SIM_BENCH_ARG_UNSET;
+
+// -wepower_serial=<n>, serial number written over the one of the preset, tells the devices of a fleet apart
+static int32_t provision_serial = SIM_BENCH_ARG_UNSET;
+
+// -wepower_interval=<ms>, packet interval written over the one of the preset
+static int32_t provision_interval = SIM_BENCH_ARG_UNSET;
+
+// -wepower_max_packets=<n>, packets per event written over the ones of the preset
+static int32_t provision_max_packets = SIM_BENCH_ARG_UNSET;
+
+// -wepower_jitter=<n>, repeat jitter policy written over the one of the preset
+static int32_t provision_jitter = SIM_BENCH_ARG_UNSET;
+
+/**
+ * @brief Add the command line options of the benchmark
+ *
+ */
+static void sim_bench_add_options(void)
+{
+    static struct args_struct_t bench_options[] =
+    {
+        {
+            .is_switch = true,
+            .option = "wepower_bench",
+            .type = 'b',
+            .dest = (void *)&is_bench_enabled,
+            .descript = "Print a BENCH line with the metrics of the first event and power off at its end",
+        },
+        {
+            .option = "wepower_preset",
+            .name = "preset",
+            .type = 'i',
+            .dest = (void *)&provision_preset,
+            .descript = "Provision the FRAM with this preset (preset_type_t) and power off before the event",
+        },
+        {
+            .option = "wepower_type",
+            .name = "type",
+            .type = 'i',
+            .dest = (void *)&provision_type,
+            .descript = "Device type written over the type of the preset when provisioning",
+        },
+        {
+            .option = "wepower_serial",
+            .name = "serial",
+            .type = 'i',
+            .dest = (void *)&provision_serial,
+            .descript = "Serial number written over the serial number of the preset when provisioning",
+        },
+        {
+            .option = "wepower_interval",
+            .name = "ms",
+            .type = 'i',
+            .dest = (void *)&provision_interval,
+            .descript = "Packet interval written over the packet interval of the preset when provisioning",
+        },
+        {
+            .option = "wepower_max_packets",
+            .name = "packets",
+            .type = 'i',
+            .dest = (void *)&provision_max_packets,
+            .descript = "Packets per event written over the packets of the preset when provisioning",
+        },
+        {
+            .option = "wepower_jitter",
+            .name = "policy",
+            .type = 'i',
+            .dest = (void *)&provision_jitter,
+            .descript = "Repeat jitter policy written over the policy of the preset when provisioning",
+        },
+        ARG_TABLE_ENDMARKER
+    };
+
+    native_add_command_line_opts(bench_options);
+}
+
+NATIVE_TASK(sim_bench_add_options, PRE_BOOT_1, 20);
+
+/**
+ * @brief Provision the FRAM before main() when -wepower_preset is given. The emulated FRAM keeps it
+ *        for the following runs through -fram_file.
+ *
+ * @return int 0
+ */
+static int sim_bench_provision(void)
+{
+    uint8_t type;
+    uint32_t serial_number;
+    uint8_t packet_interval;
+    uint16_t event_max_packets;
+    uint8_t jitter_policy;
+
+    if (provision_preset == SIM_BENCH_ARG_UNSET)
+    {
+        return 0;
+    }
+
+    preset_fram_by_type((uint8_t)provision_preset);
+    if (provision_type != SIM_BENCH_ARG_UNSET)
+    {
+        type = (uint8_t)provision_type;
+        (void)app_fram_write_field(TYPE, &type);
+    }
+    if (provision_serial != SIM_BENCH_ARG_UNSET)
+    {
+        serial_number = (uint32_t)provision_serial;
+        (void)app_fram_write_field(SER_NUM, (uint8_t*)&serial_number);
+    }
+    if (provision_interval != SIM_BENCH_ARG_UNSET)
+    {
+        packet_interval = (uint8_t)provision_interval;
+        (void)app_fram_write_field(EV_INT, &packet_interval);
+    }
+    if (provision_max_packets != SIM_BENCH_ARG_UNSET)
+    {
+        event_max_packets = (uint16_t)provision_max_packets;
+        (void)app_fram_write_field(EV_MAX, (uint8_t*)&event_max_packets);
+    }
+    if (provision_jitter != SIM_BENCH_ARG_UNSET)
+    {
+        jitter_policy = (uint8_t)provision_jitter;
+        (void)app_fram_write_field(JITTER, &jitter_policy);
+    }
+
+    if (app_fram_flush() != FRAM_SUCCESS)
+    {
+        printk("BENCH_PROVISION_FAILED preset %d\n", provision_preset);
+        posix_exit(1);
+    }
+
+    printk("BENCH_PROVISIONED preset %d type %d\n", provision_preset, provision_type);
+    posix_exit(0);
+
+    return 0;
+}
+
+SYS_INIT(sim_bench_provision, APPLICATION, 99);
+
+/**
+ * @brief End of the first event of the boot. With -wepower_bench the metrics of the event are printed
+ *        as one "BENCH {json}" line and the simulated device powers off, as wp_rev1 does when the energy is gone.
+ *
+ */
+void sim_bench_event_done(void)
+{
+    uint32_t now = k_cycle_get_32();
+    uint32_t first_packet_us = k_cyc_to_us_floor32(boot_trace_get_stage_cycles(BOOT_STAGE_ADV_START));
+    uint32_t event_us = k_cyc_to_us_floor32(now);
+    uint32_t packets = get_adv_packets_sent();
+    uint32_t repeat_interval_us = 0;
+    k_thread_runtime_stats_t cpu_stats = {0};
+    sim_i2c_traffic_t traffic;
+
+    if (!is_bench_enabled)
+    {
+        return;
+    }
+
+    if ((packets > 1) && (event_us > first_packet_us))
+    {
+        repeat_interval_us = (event_us - first_packet_us) / (packets - 1);
+    }
+
+    sim_i2c_get_traffic(&traffic);
+    // Busy waits and interrupt handlers only, the simulated CPU takes no time to run code
+    (void)k_thread_runtime_stats_all_get(&cpu_stats);
+
+    printk("BENCH {\"type\":%d,\"serial\":%u,\"event_counter\":%u,\"boot_to_first_packet_us\":%u,\"event_us\":%u,"
+           "\"packets\":%u,\"repeat_interval_us\":%u,\"i2c_transfers\":%u,\"i2c_bytes\":%u,\"i2c_bus_us\":%u,"
+           "\"aes_blocks\":%u,\"cpu_active_us\":%u}\n",
+           fram_data.type, fram_data.serial_number, fram_data.event_counter, first_packet_us, event_us,
+           packets, repeat_interval_us, traffic.transfers, traffic.bytes, traffic.bus_us,
+           app_encrypt_get_block_count(), (uint32_t)k_cyc_to_us_floor64(cpu_stats.total_cycles));
+
+    posix_exit(0);
+}
@@ -0,0 +1,259 @@
+#include "app_stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "accel.h"
+#include "config_commands.h"
+#include "fram.h"
+
+#include "app_bt.h"
+#include "app_device_caps.h"
+#include "app_encrypt.h"
+#include "app_manuf_data.h"
+#include "app_vbulk.h"
+
+LOG_MODULE_DECLARE(wepower);
+
+#if (USE_PERIODIC_STREAM)
+
+/*
+ * Stream frame, manufacturer data of one periodic advertising PDU:
+ * | 0x50 0x57 | ID (2) | status | event counter (4) | sequence (2) | sample count | samples, encrypted | MIC |
+ * Every sample is X, Y, Z as signed 16 bit LE in m/s^2 * 1000. The MIC length is what is left after the samples.
+ */
+#define STREAM_FRAME_DEVICE_ID_INDEX        2
+#define STREAM_FRAME_STATUS_BYTE_INDEX      4
+#define STREAM_FRAME_COUNTER_INDEX          5
+#define STREAM_FRAME_SEQUENCE_INDEX         9
+#define STREAM_FRAME_SAMPLE_COUNT_INDEX     11
+#define STREAM_FRAME_SAMPLES_INDEX          12
+#define STREAM_SAMPLE_SIZE                  (3 * sizeof(int16_t))
+#define STREAM_SAMPLES_SIZE                 (STREAM_SAMPLES_PER_FRAME * STREAM_SAMPLE_SIZE)
+#define STREAM_FRAME_MAX_LENGTH             (STREAM_FRAME_SAMPLES_INDEX + STREAM_SAMPLES_SIZE + PAYLOAD_CCM_MIC_MAX_LENGTH)
+
+BUILD_ASSERT(STREAM_SAMPLES_SIZE <= UINT8_MAX, "Samples of a stream frame exceed one CCM call");
+BUILD_ASSERT(STREAM_SAMPLES_PER_FRAME <= ACCEL_FIFO_DEPTH, "Stream frame larger than the accelerometer FIFO");
+#if defined(CONFIG_BT_CTLR_ADV_DATA_LEN_MAX)
+// Length and type bytes of the AD structure come on top of the frame
+BUILD_ASSERT(STREAM_FRAME_MAX_LENGTH + 2 <= CONFIG_BT_CTLR_ADV_DATA_LEN_MAX, "Stream frame does not fit one periodic advertising PDU");
+#endif
+
+static void stream_frame_work_fn(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(stream_frame_work, stream_frame_work_fn);
+
+// Frame handed to the controller, it is copied by bt_le_per_adv_set_data()
+static uint8_t stream_frame[STREAM_FRAME_MAX_LENGTH];
+
+static stream_end_cb_t stream_end_cb = NULL;
+static uint32_t stream_event_counter = 0;
+static uint16_t stream_sequence = 0;
+static uint32_t stream_vbulk_start_mv = 0;
+
+/**
+ * @brief Tell if the harvest keeps VBULK high enough for one more frame
+ *
+ * @param threshold_mv Lowest VBULK accepted
+ * @return true if the next frame may go out
+ */
+static bool is_harvest_power_available(uint32_t threshold_mv)
+{
+    uint32_t vbulk_mv = 0;
+    int err = vbulk_read_mv(&vbulk_mv);
+
+    if (err == -ENOTSUP)
+    {
+        // No SAADC, a short stream and the UVLO kill switch as the backstop
+        return (stream_sequence < STREAM_FRAMES_WITHOUT_VBULK);
+    }
+
+    if (err)
+    {
+        return false;
+    }
+
+    if (stream_sequence == 0)
+    {
+        stream_vbulk_start_mv = vbulk_mv;
+    }
+
+    return (vbulk_mv >= threshold_mv);
+}
+
+/**
+ * @brief Read STREAM_SAMPLES_PER_FRAME accelerometer samples out of the FIFO, then start the capture of the next frame
+ *
+ * @param samples Buffer of STREAM_SAMPLES_SIZE bytes for the samples
+ * @return int ACCEL_SUCCESS or the error of the FIFO read
+ */
+static int collect_stream_samples(uint8_t *samples)
+{
+    accel_data_t accel_data[STREAM_SAMPLES_PER_FRAME];
+    int ret = app_accel_fifo_read(accel_data, STREAM_SAMPLES_PER_FRAME);
+
+    // The next frame fills the FIFO while this one is on air
+    (void)app_accel_fifo_start();
+
+    if (ret != ACCEL_SUCCESS)
+    {
+        return ret;
+    }
+
+    for (uint8_t i = 0; i < STREAM_SAMPLES_PER_FRAME; i++)
+    {
+        sys_put_le16((uint16_t)accel_data[i].x_accel, &samples[(i * STREAM_SAMPLE_SIZE)]);
+        sys_put_le16((uint16_t)accel_data[i].y_accel, &samples[(i * STREAM_SAMPLE_SIZE) + 2]);
+        sys_put_le16((uint16_t)accel_data[i].z_accel, &samples[(i * STREAM_SAMPLE_SIZE) + 4]);
+    }
+
+    return ACCEL_SUCCESS;
+}
+
+/**
+ * @brief Build the next frame of the stream in stream_frame
+ *
+ * @return uint8_t Length of the frame, 0 if the samples could not be read
+ */
+static uint8_t build_stream_frame(void)
+{
+    uint8_t samples[STREAM_SAMPLES_SIZE];
+    uint8_t mic_len = is_ccm_mic_length(fram_data.mic_len) ? fram_data.mic_len : STREAM_MIC_LENGTH;
+    uint8_t *mic = &stream_frame[STREAM_FRAME_SAMPLES_INDEX + STREAM_SAMPLES_SIZE];
+
+    if (collect_stream_samples(samples) != ACCEL_SUCCESS)
+    {
+        return 0;
+    }
+
+    // Header in clear, authenticated with the samples
+    memcpy(&stream_frame[0], manufacture_data, STREAM_FRAME_DEVICE_ID_INDEX);
+    sys_put_le16((uint16_t)(fram_data.serial_number & 0xFFFF), &stream_frame[STREAM_FRAME_DEVICE_ID_INDEX]);
+    stream_frame[STREAM_FRAME_STATUS_BYTE_INDEX] = PAYLOAD_ENCRYPTION_STATUS_CCM;
+    sys_put_le32(stream_event_counter, &stream_frame[STREAM_FRAME_COUNTER_INDEX]);
+    sys_put_le16(stream_sequence, &stream_frame[STREAM_FRAME_SEQUENCE_INDEX]);
+    stream_frame[STREAM_FRAME_SAMPLE_COUNT_INDEX] = STREAM_SAMPLES_PER_FRAME;
+
+    // One CCM call covers the whole frame, the ECB and CTR payloads only cover one block
+    stream_frame[STREAM_FRAME_STATUS_BYTE_INDEX] = encrypt_stream_data_ccm(samples, &stream_frame[STREAM_FRAME_SAMPLES_INDEX],
+                                                                           STREAM_SAMPLES_SIZE, stream_event_counter, stream_sequence,
+                                                                           stream_frame, STREAM_FRAME_SAMPLES_INDEX, mic, mic_len);
+    if (stream_frame[STREAM_FRAME_STATUS_BYTE_INDEX] != PAYLOAD_ENCRYPTION_STATUS_CCM)
+    {
+        mic_len = 0;
+    }
+
+    return STREAM_FRAME_SAMPLES_INDEX + STREAM_SAMPLES_SIZE + mic_len;
+}
+
+/**
+ * @brief Stop the stream and hand over to the end callback
+ *
+ */
+static void stream_stop(void)
+{
+    uint32_t vbulk_end_mv = 0;
+
+    stop_stream_advertising();
+    // Back to single conversions, the capture of the next frame is not needed
+    (void)app_accel_fifo_stop();
+
+    if (vbulk_read_mv(&vbulk_end_mv) == 0)
+    {
+        LOG_INF("Stream of event %u: %u frames, VBULK %u -> %u mV", stream_event_counter, stream_sequence,
+                stream_vbulk_start_mv, vbulk_end_mv);
+    }
+    else
+    {
+        LOG_INF("Stream of event %u: %u frames", stream_event_counter, stream_sequence);
+    }
+
+    if (stream_end_cb != NULL)
+    {
+        stream_end_cb();
+    }
+}
+
+/**
+ * @brief Send the next frame of the stream, once per periodic advertising interval while the harvest keeps up
+ *
+ * @param work Work item for the thread
+ */
+static void stream_frame_work_fn(struct k_work *work)
+{
+    uint32_t start_ms = k_uptime_get_32();
+    uint32_t elapsed_ms;
+    uint8_t frame_len;
+    int err;
+
+    ARG_UNUSED(work);
+
+    // The sequence is part of the nonce and must not wrap within one event counter
+    if ((stream_sequence == UINT16_MAX) ||
+        !is_harvest_power_available((stream_sequence == 0) ? STREAM_VBULK_START_MV : STREAM_VBULK_STOP_MV))
+    {
+        stream_stop();
+        return;
+    }
+
+    frame_len = build_stream_frame();
+    if (frame_len == 0)
+    {
+        LOG_ERR("Stream stopped, accelerometer read failed");
+        stream_stop();
+        return;
+    }
+
+    err = (stream_sequence == 0) ? start_stream_advertising(stream_frame, frame_len) :
+                                   update_stream_advertising(stream_frame, frame_len);
+    if (err)
+    {
+        LOG_ERR("Stream stopped (err %d)", err);
+        stream_stop();
+        return;
+    }
+    stream_sequence++;
+
+    // The sampling is part of the interval, the frames follow the periodic advertising events
+    elapsed_ms = k_uptime_get_32() - start_ms;
+    k_work_schedule(&stream_frame_work, K_MSEC((elapsed_ms < STREAM_PER_ADV_INTERVAL_MS) ? (STREAM_PER_ADV_INTERVAL_MS - elapsed_ms) : 0));
+}
+
+/**
+ * @brief Start streaming accelerometer frames on periodic advertising after the burst of an event, if the device type
+ *        streams and the harvest holds VBULK above STREAM_VBULK_START_MV. Frames go out until VBULK falls below
+ *        STREAM_VBULK_STOP_MV, then end_cb is called from the system work queue.
+ *
+ * @param event_counter Event counter of the event the stream follows, part of the nonce of every frame
+ * @param end_cb Called once the stream has stopped
+ * @return true if the stream started, end_cb will be called
+ * @return false if there is no stream, end_cb is not called
+ */
+bool stream_start(uint32_t event_counter, stream_end_cb_t end_cb)
+{
+    uint32_t vbulk_mv = 0;
+
+    if ((get_device_capabilities(fram_data.type) & DEVICE_CAP_STREAM) == 0)
+    {
+        return false;
+    }
+
+    // Checked here as well, without the harvest the event goes on as if there were no stream
+    if ((vbulk_read_mv(&vbulk_mv) == 0) && (vbulk_mv < STREAM_VBULK_START_MV))
+    {
+        LOG_INF("No stream, VBULK %u mV", vbulk_mv);
+        return false;
+    }
+
+    stream_event_counter = event_counter;
+    stream_sequence = 0;
+    stream_end_cb = end_cb;
+
+    k_work_schedule(&stream_frame_work, K_NO_WAIT);
+    return true;
+}
+
+#endif
@@ -1,14 +1,32 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <string.h>
 
 #include "fram.h"
+#include "config_commands.h"
 #include "temp_pressure.h"
 #include "accel.h"
 #include "comparator.h"
+#include "encrypt.h"
+#include "device_config.h"
+#include "app_sensor_scheduler.h"
+#include "app_i2c_boot_chain.h"
+#include "app_device_caps.h"
+#include "app_accel_features.h"
+#include "i2c_queue.h"
 
 #define FRAM_TEST_VALUE 33
 #define FRAM_TEST_INDEX 4
 
+#define ENCRYPT_BENCHMARK_ITERATIONS 1000  // The cycle counter is the 32 kHz RTC, whole loops are timed
+#define CCM_BENCHMARK_NONCE_LENGTH   13
+#define CCM_BENCHMARK_AAD_LENGTH     9     // company id, serial, status and 32 bit counter, as in the frame
+
+#define CCM_KAT_MIC_LENGTH           8     // RFC 3610 packet vector #1
+
+#define SPECTRUM_BENCHMARK_ITERATIONS 1000  // The cycle counter is the 32 kHz RTC, the average needs many windows
+#define BENCHMARK_CPU_MHZ             64    // nRF52840 CPU clock
+
 LOG_MODULE_DECLARE(wepower);
 
 typedef enum
@@ -17,6 +35,14 @@ typedef enum
     TEST_TEMP_PRESSURE = 2,
     TEST_ACCELEROMETER = 3,
     TEST_COMPARATOR    = 4,
+    TEST_ENCRYPT_BENCHMARK = 5,
+    TEST_CCM_BENCHMARK     = 6,
+    TEST_FRAM_STATS        = 7,
+    TEST_SENSOR_SCHEDULER  = 8,
+    TEST_I2C_BOOT_CHAIN    = 9,
+    TEST_SPECTRUM_BENCHMARK = 10,
+    TEST_CCM_KNOWN_ANSWER   = 11,
+    TEST_FRAM_MIGRATION     = 12,
 }hw_tests_t;
 
 /**
@@ -28,10 +54,14 @@ static void handle_fram_test_command()
     uint8_t test_value = FRAM_TEST_VALUE;
     uint8_t buffer_to_read_test_value_from_fram = 0;
     uint8_t buffer_to_store_fram_current_value = 0;
+    fram_data_t fram_readback;
 
     app_fram_read_field(FRAM_TEST_INDEX, &buffer_to_store_fram_current_value);
     LOG_RAW("Current value saved in local buffer %d", buffer_to_store_fram_current_value);
     app_fram_write_field(FRAM_TEST_INDEX, &test_value);
+    app_fram_flush();
+    // Read back from the chip, not from the shadow
+    app_fram_read_data(&fram_readback);
     app_fram_read_field(FRAM_TEST_INDEX, &buffer_to_read_test_value_from_fram);
 
     if (buffer_to_read_test_value_from_fram == test_value)
@@ -81,6 +111,394 @@ static void handle_comparator_test_command()
     LOG_RAW("Read Comparator 2 value %d", comparator_sample_value);
 }
 
+/**
+ * @brief Average time of one run of a benchmark loop. k_cycle_get_32() counts the 32 kHz RTC, about 30.5 us,
+ *        a single run is below its resolution so the whole loop is timed.
+ * 
+ * @param loop_cycles k_cycle_get_32() ticks taken by the whole loop
+ * @param iterations Runs in the loop
+ * @return uint32_t Average time of one run in ns
+ */
+static uint32_t benchmark_run_ns(uint32_t loop_cycles, uint32_t iterations)
+{
+    return (uint32_t)((k_cyc_to_us_floor64(loop_cycles) * 1000) / iterations);
+}
+
+/**
+ * @brief Benchmark the payload encryption of the selected backend, session opened per packet
+ *        against the persistent session
+ * 
+ */
+static void handle_encrypt_benchmark_command()
+{
+    uint8_t clear_text[ENCRYPTED_KEY_SIZE] = {0};
+    uint8_t encrypted_text[ENCRYPTED_KEY_SIZE] = {0};
+    uint32_t oneshot_ns = 0;
+    uint32_t persistent_ns = 0;
+    uint32_t init_ns = 0;
+    uint32_t start_cycles = 0;
+
+    // The one-shot runs are timed without the payload session open
+    app_encrypt_deinit();
+
+    start_cycles = k_cycle_get_32();
+    for (uint32_t iteration = 0; iteration < ENCRYPT_BENCHMARK_ITERATIONS; iteration++)
+    {
+        clear_text[0] = (uint8_t)iteration;
+        (void)app_encrypt_payload_oneshot(clear_text, sizeof(clear_text), encrypted_text, sizeof(encrypted_text));
+    }
+    oneshot_ns = benchmark_run_ns(k_cycle_get_32() - start_cycles, ENCRYPT_BENCHMARK_ITERATIONS);
+
+    start_cycles = k_cycle_get_32();
+    for (uint32_t iteration = 0; iteration < ENCRYPT_BENCHMARK_ITERATIONS; iteration++)
+    {
+        if (app_encrypt_init() != ENCRYPTION_SUCCESS)
+        {
+            LOG_RAW("Unable to open the encryption session");
+            return;
+        }
+        app_encrypt_deinit();
+    }
+    init_ns = benchmark_run_ns(k_cycle_get_32() - start_cycles, ENCRYPT_BENCHMARK_ITERATIONS);
+
+    if (app_encrypt_init() != ENCRYPTION_SUCCESS)
+    {
+        LOG_RAW("Unable to open the encryption session");
+        return;
+    }
+
+    start_cycles = k_cycle_get_32();
+    for (uint32_t iteration = 0; iteration < ENCRYPT_BENCHMARK_ITERATIONS; iteration++)
+    {
+        clear_text[0] = (uint8_t)iteration;
+        (void)app_encrypt_payload(clear_text, sizeof(clear_text), encrypted_text, sizeof(encrypted_text));
+    }
+    persistent_ns = benchmark_run_ns(k_cycle_get_32() - start_cycles, ENCRYPT_BENCHMARK_ITERATIONS);
+
+    LOG_RAW("AES-ECB 16 byte block with %s, average of %d runs\n", ENCRYPT_BACKEND_NAME, ENCRYPT_BENCHMARK_ITERATIONS);
+    LOG_RAW("session per packet: %u cycles, %u ns\n",
+            (oneshot_ns * BENCHMARK_CPU_MHZ) / 1000, oneshot_ns);
+    LOG_RAW("persistent session: %u cycles, %u ns (session open and close %u ns)\n",
+            (persistent_ns * BENCHMARK_CPU_MHZ) / 1000, persistent_ns, init_ns);
+    LOG_RAW("session RAM: %d bytes, flash per backend from west build -t rom_report\n", sizeof(encrypt_ctx_t));
+}
+
+/**
+ * @brief Benchmark the AES-CCM payload for every MIC length, to pick the MIC length of a deployment
+ * 
+ */
+static void handle_ccm_benchmark_command()
+{
+    uint8_t nonce[CCM_BENCHMARK_NONCE_LENGTH] = {0};
+    uint8_t aad[CCM_BENCHMARK_AAD_LENGTH] = {0};
+    uint8_t clear_text[ENCRYPTED_KEY_SIZE] = {0};
+    uint8_t encrypted_text[ENCRYPTED_KEY_SIZE] = {0};
+    uint8_t mic[16] = {0};
+    uint32_t ecb_ns = 0;
+    uint32_t start_cycles = 0;
+
+    if (app_encrypt_init() != ENCRYPTION_SUCCESS)
+    {
+        LOG_RAW("Unable to open the encryption session");
+        return;
+    }
+
+    start_cycles = k_cycle_get_32();
+    for (uint32_t iteration = 0; iteration < ENCRYPT_BENCHMARK_ITERATIONS; iteration++)
+    {
+        clear_text[0] = (uint8_t)iteration;
+        (void)app_encrypt_payload(clear_text, sizeof(clear_text), encrypted_text, sizeof(encrypted_text));
+    }
+    ecb_ns = benchmark_run_ns(k_cycle_get_32() - start_cycles, ENCRYPT_BENCHMARK_ITERATIONS);
+
+    LOG_RAW("16 byte payload with %s, average of %d runs\n", ENCRYPT_BACKEND_NAME, ENCRYPT_BENCHMARK_ITERATIONS);
+    LOG_RAW("%-8s %8s %8s %10s\n", "mode", "cycles", "ns", "air bytes");
+    LOG_RAW("%-8s %8u %8u %10d\n", "ECB", (ecb_ns * BENCHMARK_CPU_MHZ) / 1000, ecb_ns, PAYLOAD_FRAME_LENGTH);
+
+    for (uint8_t mic_len = 4; mic_len <= sizeof(mic); mic_len += 2)
+    {
+        uint32_t ccm_ns = 0;
+
+        start_cycles = k_cycle_get_32();
+        for (uint32_t iteration = 0; iteration < ENCRYPT_BENCHMARK_ITERATIONS; iteration++)
+        {
+            memcpy(nonce, &iteration, sizeof(iteration));
+            (void)app_encrypt_payload_ccm(nonce, sizeof(nonce), aad, sizeof(aad),
+                                          clear_text, encrypted_text, sizeof(clear_text), mic, mic_len);
+        }
+        ccm_ns = benchmark_run_ns(k_cycle_get_32() - start_cycles, ENCRYPT_BENCHMARK_ITERATIONS);
+
+        LOG_RAW("CCM-%-4d %8u %8u %10d\n", mic_len, (ccm_ns * BENCHMARK_CPU_MHZ) / 1000, ccm_ns,
+                PAYLOAD_CCM_MIC_INDEX + mic_len);
+    }
+}
+
+/**
+ * @brief Check the AES-CCM payload against RFC 3610 packet vector #1, with the backend of the build.
+ *        The vector key replaces ecb_key for the test, the payload session is opened again with ecb_key after.
+ * 
+ */
+static void handle_ccm_known_answer_command()
+{
+    static const uint8_t kat_key[ENCRYPTED_KEY_SIZE] = {
+        0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF
+    };
+    static const uint8_t kat_nonce[CCM_BENCHMARK_NONCE_LENGTH] = {
+        0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x00, 0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5
+    };
+    static const uint8_t kat_aad[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    static const uint8_t kat_clear_text[] = {
+        0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13,
+        0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E
+    };
+    static const uint8_t kat_encrypted_text[sizeof(kat_clear_text)] = {
+        0x58, 0x8C, 0x97, 0x9A, 0x61, 0xC6, 0x63, 0xD2, 0xF0, 0x66, 0xD0, 0xC2,
+        0xC0, 0xF9, 0x89, 0x80, 0x6D, 0x5F, 0x6B, 0x61, 0xDA, 0xC3, 0x84
+    };
+    static const uint8_t kat_mic[CCM_KAT_MIC_LENGTH] = {0x17, 0xE8, 0xD1, 0x2C, 0xFD, 0xF9, 0x26, 0xE0};
+    uint8_t saved_key[ENCRYPTED_KEY_SIZE];
+    uint8_t clear_text[sizeof(kat_clear_text)];
+    uint8_t encrypted_text[sizeof(kat_clear_text)] = {0};
+    uint8_t mic[CCM_KAT_MIC_LENGTH] = {0};
+    int ret = ENCRYPTION_ERROR;
+
+    memcpy(saved_key, ecb_key, sizeof(saved_key));
+    memcpy(ecb_key, kat_key, sizeof(kat_key));
+    memcpy(clear_text, kat_clear_text, sizeof(clear_text));
+
+    if (app_encrypt_init() == ENCRYPTION_SUCCESS)
+    {
+        ret = app_encrypt_payload_ccm(kat_nonce, sizeof(kat_nonce), kat_aad, sizeof(kat_aad),
+                                      clear_text, encrypted_text, sizeof(clear_text), mic, sizeof(mic));
+    }
+
+    memcpy(ecb_key, saved_key, sizeof(saved_key));
+    if (app_encrypt_init() != ENCRYPTION_SUCCESS)
+    {
+        LOG_RAW("Unable to open the encryption session with the device key again\n");
+    }
+
+    if (ret != ENCRYPTION_SUCCESS)
+    {
+        LOG_RAW("RFC 3610 vector #1 with %s: FAILED, encryption error\n", ENCRYPT_BACKEND_NAME);
+        return;
+    }
+
+    if ((memcmp(encrypted_text, kat_encrypted_text, sizeof(kat_encrypted_text)) != 0) ||
+        (memcmp(mic, kat_mic, sizeof(kat_mic)) != 0))
+    {
+        LOG_RAW("RFC 3610 vector #1 with %s: FAILED\n", ENCRYPT_BACKEND_NAME);
+        LOG_HEXDUMP_INF(encrypted_text, sizeof(encrypted_text), "Encrypted text");
+        LOG_HEXDUMP_INF(mic, sizeof(mic), "MIC");
+        return;
+    }
+
+    LOG_RAW("RFC 3610 vector #1 with %s: PASSED\n", ENCRYPT_BACKEND_NAME);
+}
+
+/**
+ * @brief Check that the fields added after the first FRAM layout get their default when the FRAM
+ * was programmed by an older firmware, and keep a value in range. The FRAM itself is not written.
+ * 
+ */
+static void handle_fram_migration_test_command()
+{
+    fram_data_t erased;
+    fram_data_t in_range;
+    uint8_t erased_fallbacks;
+    uint8_t in_range_fallbacks;
+
+    memset(&erased, 0xFF, sizeof(erased));
+    erased_fallbacks = check_fram_field_ranges(&erased);
+
+    memset(&in_range, 0xFF, sizeof(in_range));
+    in_range.mic_len = MIC_LEN_MAX_VALUE;
+    in_range.jitter_policy = JITTER_POLICY_MAX_VALUE;
+    in_range.rbe_policy = RBE_POLICY_MAX_VALUE;
+    in_range.rbe_deadband_accel = RBE_DEADBAND_MAX_VALUE;
+    in_range.rbe_deadband_temp = RBE_DEADBAND_MIN_VALUE;
+    in_range.rbe_deadband_pressure = RBE_DEADBAND_PRESS_DEFAULT + 1;
+    in_range_fallbacks = check_fram_field_ranges(&in_range);
+
+    if ((erased_fallbacks != 6) ||
+        (erased.mic_len != MIC_LEN_DEFAULT_VALUE) ||
+        (erased.jitter_policy != JITTER_POLICY_DEFAULT_VALUE) ||
+        (erased.rbe_policy != RBE_POLICY_DEFAULT_VALUE) ||
+        (erased.rbe_deadband_accel != RBE_DEADBAND_ACCEL_DEFAULT) ||
+        (erased.rbe_deadband_temp != RBE_DEADBAND_TEMP_DEFAULT) ||
+        (erased.rbe_deadband_pressure != RBE_DEADBAND_PRESS_DEFAULT))
+    {
+        LOG_RAW("FRAM migration of an erased layout: FAILED, %d defaults\n", erased_fallbacks);
+        return;
+    }
+
+    if ((in_range_fallbacks != 0) ||
+        (in_range.mic_len != MIC_LEN_MAX_VALUE) ||
+        (in_range.jitter_policy != JITTER_POLICY_MAX_VALUE) ||
+        (in_range.rbe_policy != RBE_POLICY_MAX_VALUE) ||
+        (in_range.rbe_deadband_accel != RBE_DEADBAND_MAX_VALUE) ||
+        (in_range.rbe_deadband_temp != RBE_DEADBAND_MIN_VALUE) ||
+        (in_range.rbe_deadband_pressure != RBE_DEADBAND_PRESS_DEFAULT + 1))
+    {
+        LOG_RAW("FRAM migration of values in range: FAILED, %d defaults\n", in_range_fallbacks);
+        return;
+    }
+
+    LOG_RAW("FRAM migration: PASSED\n");
+}
+
+/**
+ * @brief Print the I2C traffic to the FRAM. The last event is the last flush, at the end of an event or of a CLI command.
+ * 
+ */
+static void handle_fram_stats_command()
+{
+    fram_stats_t stats;
+
+    app_fram_get_stats(&stats);
+
+    LOG_RAW("%-12s %12s %8s\n", "FRAM I2C", "transactions", "bytes");
+    LOG_RAW("%-12s %12u %8u\n", "last event", stats.last_event.transactions, stats.last_event.bytes);
+    LOG_RAW("%-12s %12u %8u\n", "not flushed", stats.current.transactions, stats.current.bytes);
+    LOG_RAW("%-12s %12u %8u\n", "total", stats.total.transactions, stats.total.bytes);
+}
+
+/**
+ * @brief Trigger every sensor, collect them in completion order and print how much of the acquisition overlapped
+ * 
+ */
+static void handle_sensor_scheduler_test_command()
+{
+    static const char *const SENSOR_NAME[SENSOR_MAX] = {"accel", "temp/press"};
+    accel_data_t accel_data = {0};
+    temp_pressure_data_t temp_pressure_data = {0};
+    sensor_schedule_report_t report;
+    int ret;
+
+    sensor_scheduler_trigger_all();
+    ret = sensor_scheduler_collect(&accel_data, &temp_pressure_data);
+    sensor_scheduler_get_report(&report);
+
+    LOG_RAW("Sensor collect returned %d\n", ret);
+    LOG_RAW("%-6s %-12s %12s %8s\n", "order", "sensor", "conversion", "read");
+    for (uint8_t idx = 0; idx < SENSOR_MAX; idx++)
+    {
+        uint8_t sensor = report.completion_order[idx];
+
+        if (sensor >= SENSOR_MAX)
+        {
+            break;
+        }
+        LOG_RAW("%-6d %-12s %12u %8u\n", idx, SENSOR_NAME[sensor], report.conversion_us[sensor], report.read_us[sensor]);
+    }
+    LOG_RAW("collected in %u us, %u us one after the other, %u us overlapped\n",
+            report.collect_us, report.serial_us,
+            (report.serial_us > report.collect_us) ? (report.serial_us - report.collect_us) : 0);
+}
+
+/**
+ * @brief Read the sensors triggered by the boot chains, so the next run starts clean
+ * 
+ */
+static void collect_i2c_boot_chain_sensors()
+{
+    accel_data_t accel_data = {0};
+    temp_pressure_data_t temp_pressure_data = {0};
+
+    (void)sensor_scheduler_collect(&accel_data, &temp_pressure_data);
+}
+
+/**
+ * @brief Run the boot chains one bus style and with the devicetree bus layout. Print the boot I2C wall time of both,
+ *        the latency and bus time of every transaction and the bus utilisation of the queue.
+ * 
+ */
+static void handle_i2c_boot_chain_test_command()
+{
+    static const char *const STEP_NAME[BOOT_CHAIN_MAX] = {"accel cfg", "fifo mode", "fifo start", "tps cfg", "tps trigger", "fram read"};
+    boot_chain_report_t serial_report;
+    boot_chain_report_t report;
+    i2c_queue_stats_t stats;
+    int32_t serial_ret;
+    int32_t ret;
+
+    serial_ret = i2c_boot_chain_run_serial(false, DEVICE_CAP_SENSORS);
+    i2c_boot_chain_get_report(&serial_report);
+    collect_i2c_boot_chain_sensors();
+
+    i2c_queue_reset_stats();
+    ret = i2c_boot_chain_run(false, DEVICE_CAP_SENSORS);
+    i2c_boot_chain_get_report(&report);
+    i2c_queue_get_stats(&stats);
+    collect_i2c_boot_chain_sensors();
+
+    ret = (serial_ret != 0) ? serial_ret : ret;
+
+    LOG_RAW("Boot chain returned %d, FRAM and sensors on %s\n", ret, report.is_split_bus ? "two buses" : "one bus");
+    LOG_RAW("%-12s %8s %10s %8s\n", "step", "result", "latency", "bus");
+    for (uint8_t step = 0; step < BOOT_CHAIN_MAX; step++)
+    {
+        if ((report.step_mask & BIT(step)) == 0)
+        {
+            LOG_RAW("%-12s %8s\n", STEP_NAME[step], "skipped");
+            continue;
+        }
+        LOG_RAW("%-12s %8d %10u %8u\n", STEP_NAME[step], report.result[step], report.latency_us[step], report.busy_us[step]);
+    }
+    LOG_RAW("%-12s %10s\n", "layout", "boot I2C");
+    LOG_RAW("%-12s %10u\n", "one bus", serial_report.wall_us);
+    LOG_RAW("%-12s %10u\n", report.is_split_bus ? "two buses" : "one bus", report.wall_us);
+    LOG_RAW("queue: %u chains, %u transactions, %u errors, max latency %u us\n",
+            stats.chains, stats.transactions, stats.errors, stats.max_latency_us);
+    LOG_RAW("buses busy %u us of %u us, %u%%\n", stats.busy_us, stats.window_us,
+            stats.window_us ? (uint32_t)(((uint64_t)stats.busy_us * 100) / stats.window_us) : 0);
+}
+
+/**
+ * @brief Handle the command to benchmark the spectrum of a vibration capture: one accelerometer FIFO capture is
+ *        analyzed SPECTRUM_BENCHMARK_ITERATIONS times. scripts/spectrum_bench/run_spectrum_bench.py reads the
+ *        SPECTRUM line from the UART log.
+ * 
+ */
+static void handle_spectrum_benchmark_command()
+{
+#if (USE_ACCEL_SPECTRUM)
+    accel_data_t samples[ACCEL_FIFO_CAPTURE_SAMPLES];
+    accel_features_t features;
+    spectrum_result_t spectrum;
+    uint32_t spectrum_cycles = 0;
+    uint32_t start_cycles = 0;
+    uint64_t spectrum_us = 0;
+    uint8_t axis = 0;
+
+    if (app_accel_fifo_read(samples, ACCEL_FIFO_CAPTURE_SAMPLES) != ACCEL_SUCCESS)
+    {
+        LOG_RAW("Unable to read the accelerometer capture");
+        return;
+    }
+
+    // The features pick the axis, they are not part of the timing
+    accel_compute_features(samples, ACCEL_FIFO_CAPTURE_SAMPLES, &features);
+
+    start_cycles = k_cycle_get_32();
+    for (uint32_t iteration = 0; iteration < SPECTRUM_BENCHMARK_ITERATIONS; iteration++)
+    {
+        (void)accel_compute_spectrum(samples, &features, &axis, &spectrum);
+    }
+    spectrum_cycles = k_cycle_get_32() - start_cycles;
+    spectrum_us = k_cyc_to_us_floor64(spectrum_cycles);
+
+    LOG_RAW("Spectrum of axis %u at %u Hz: bands %u %u %u, peak bins %u %u %u\n", axis, ACCEL_FIFO_ODR_HZ,
+            spectrum.band_rms[0], spectrum.band_rms[1], spectrum.band_rms[2],
+            spectrum.peak_bin[0], spectrum.peak_bin[1], spectrum.peak_bin[2]);
+    LOG_RAW("SPECTRUM %u point %s: %u cycles per window, %u ns\n", SPECTRUM_FFT_SIZE, SPECTRUM_KERNEL_NAME,
+            (uint32_t)((spectrum_us * BENCHMARK_CPU_MHZ) / SPECTRUM_BENCHMARK_ITERATIONS),
+            (uint32_t)((spectrum_us * 1000) / SPECTRUM_BENCHMARK_ITERATIONS));
+#else
+    LOG_RAW("Spectrum not built, USE_ACCEL_SPECTRUM is 0");
+#endif
+}
+
 /**
  * @brief Handle the command to run certain tests
  * 
@@ -110,6 +528,46 @@ void handle_tests_command(uint8_t received_test_number)
             handle_comparator_test_command();
             break;
         }
+        case TEST_ENCRYPT_BENCHMARK:
+        {
+            handle_encrypt_benchmark_command();
+            break;
+        }
+        case TEST_CCM_BENCHMARK:
+        {
+            handle_ccm_benchmark_command();
+            break;
+        }
+        case TEST_FRAM_STATS:
+        {
+            handle_fram_stats_command();
+            break;
+        }
+        case TEST_SENSOR_SCHEDULER:
+        {
+            handle_sensor_scheduler_test_command();
+            break;
+        }
+        case TEST_I2C_BOOT_CHAIN:
+        {
+            handle_i2c_boot_chain_test_command();
+            break;
+        }
+        case TEST_SPECTRUM_BENCHMARK:
+        {
+            handle_spectrum_benchmark_command();
+            break;
+        }
+        case TEST_CCM_KNOWN_ANSWER:
+        {
+            handle_ccm_known_answer_command();
+            break;
+        }
+        case TEST_FRAM_MIGRATION:
+        {
+            handle_fram_migration_test_command();
+            break;
+        }
     default:
         break;
     }
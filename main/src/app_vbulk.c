@@ -0,0 +1,90 @@
+#include "app_vbulk.h"
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#if (USE_VBULK_ADC)
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/adc.h>
+
+#define VBULK_ADC_NODE              DT_CHILD(DT_NODELABEL(adc), channel_1)
+
+static const struct device *const vbulk_adc_dev = DEVICE_DT_GET(DT_NODELABEL(adc));
+static const struct adc_channel_cfg vbulk_channel_cfg = ADC_CHANNEL_CFG_DT(VBULK_ADC_NODE);
+
+static bool is_vbulk_adc_ready = false;
+#endif
+
+/**
+ * @brief Measure VBULK with the SAADC, the channel is set up on the first measurement
+ *
+ * @param vbulk_mv Buffer to store VBULK in mV
+ * @return int 0 on success, negative error code otherwise, -ENOTSUP without the SAADC
+ */
+int vbulk_read_mv(uint32_t *vbulk_mv)
+{
+#if (USE_VBULK_ADC)
+    int16_t sample = 0;
+    int32_t pin_mv;
+    int err;
+    struct adc_sequence sequence =
+    {
+        .channels = BIT(vbulk_channel_cfg.channel_id),
+        .buffer = &sample,
+        .buffer_size = sizeof(sample),
+        .resolution = DT_PROP(VBULK_ADC_NODE, zephyr_resolution),
+    };
+
+    if (!is_vbulk_adc_ready)
+    {
+        if (!device_is_ready(vbulk_adc_dev))
+        {
+            return -ENODEV;
+        }
+        err = adc_channel_setup(vbulk_adc_dev, &vbulk_channel_cfg);
+        if (err)
+        {
+            return err;
+        }
+        is_vbulk_adc_ready = true;
+    }
+
+    err = adc_read(vbulk_adc_dev, &sequence);
+    if (err)
+    {
+        return err;
+    }
+
+    pin_mv = MAX(sample, 0);
+    err = adc_raw_to_millivolts(adc_ref_internal(vbulk_adc_dev), vbulk_channel_cfg.gain, sequence.resolution, &pin_mv);
+    if (err)
+    {
+        return err;
+    }
+
+    *vbulk_mv = ((uint32_t)pin_mv * VBULK_DIVIDER_NUM) / VBULK_DIVIDER_DEN;
+    return 0;
+#else
+    ARG_UNUSED(vbulk_mv);
+    return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Energy released by the storage capacitor while VBULK went from one voltage to another
+ *
+ * @param from_mv VBULK before
+ * @param to_mv VBULK after
+ * @return uint32_t Energy in nJ, 0 if VBULK rose or is unknown
+ */
+uint32_t vbulk_energy_drop_nj(uint32_t from_mv, uint32_t to_mv)
+{
+    if ((from_mv == 0) || (to_mv == 0) || (to_mv >= from_mv))
+    {
+        return 0;
+    }
+
+    // uF * mV^2 is pJ
+    return (uint32_t)(((uint64_t)VBULK_CAPACITANCE_UF * ((from_mv * from_mv) - (to_mv * to_mv))) / (2 * 1000));
+}
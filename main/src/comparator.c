@@ -2,10 +2,12 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
-#include <nrfx_comp.h>
 
 #include "app_burn_energy.h"
 
+#if defined(CONFIG_NRFX_COMP)
+#include <nrfx_comp.h>
+
 #define COMPARATOR_1_VDOWN_VOLTAGE      0.8
 #define COMPARATOR_1_VUP_VOLTAGE        1.0
 #define COMPARATOR_1_REFERENCE_VOLTAGE  1.2
@@ -18,8 +20,15 @@
 
 #define COMPARATOR_INTERRUPT_PRIORITY   5
 
+#else
+// No COMP on the simulated board: VEXT low selects business mode, VBULK stays above the threshold
+#define SIM_COMPARATOR_1_VALUE          0
+#define SIM_COMPARATOR_2_VALUE          1
+#endif
+
 LOG_MODULE_DECLARE(wepower);
 
+#if defined(CONFIG_NRFX_COMP)
 /**
  * @brief Handler for comparator related events
  * 
@@ -148,3 +157,32 @@ uint8_t get_comaprator_2_current_value()
     init_comparator_2_vbulk();
     return nrfx_comp_sample();
 }
+#else
+/**
+ * @brief Initialize the comparator 1 of the module and read the voltage
+ * 
+ * @return uint8_t Initial value from the comparator
+ */
+uint8_t init_comparator_1_vext_and_read_value()
+{
+    return SIM_COMPARATOR_1_VALUE;
+}
+
+/**
+ * @brief Initialize the comparator 2 of the module
+ * 
+ */
+void init_comparator_2_vbulk()
+{
+}
+
+/**
+ * @brief Get the current value of the comparator 2
+ * 
+ * @return uint8_t read value at comparator 2
+ */
+uint8_t get_comaprator_2_current_value()
+{
+    return SIM_COMPARATOR_2_VALUE;
+}
+#endif // CONFIG_NRFX_COMP
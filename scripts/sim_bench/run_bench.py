@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""End to end event pipeline benchmark of the simulated wp_rev1 (nrf52_bsim build).
+
+Every run of zephyr.exe is one event of the device: boot, sensors, FRAM, encryption and the whole
+advertising burst, then the firmware prints one "BENCH {json}" line and powers off. The emulated
+FRAM is kept in a file between runs, so the second and later events take the prebuilt frame path
+as on the board.
+
+For every FRAM preset and device type the FRAM is provisioned once, then --events events are run.
+The first event is reported as "cold", the median of the others as "warm". Results are compared
+with a baseline, the script exits with 1 when a metric got worse by more than the tolerance. With --ci a missing
+baseline is an error too.
+
+The baseline is recorded from a BabbleSim run with --update-baseline and committed as baseline.json next to
+this script. The CI job keeps its results file as an artifact, which can be committed as the baseline as well.
+No baseline is committed yet, the CI job runs without --ci and only reports until there is one.
+
+    west build --build-dir build_sim . --pristine --board nrf52_bsim
+    scripts/sim_bench/run_bench.py --exe build_sim/zephyr/zephyr.exe
+
+Timings are simulated time: I2C transfers take their 400 kHz bus time, the code itself takes none.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+PRESETS = [0, 1, 2, 3, 4]              # preset_type_t
+DEVICE_TYPES = [0, 1, 2, 3, 4]         # DEVICE_TYPE_LEGACY .. DEVICE_TYPE_RELEASE_SENSOR
+FRAM_SIZE = 8192                       # size of fram@50 in boards/nrf52_bsim.overlay
+SIM_LENGTH_US = 30 * 1000 * 1000       # Upper bound of one event, the device normally ends it much earlier
+
+# Metrics compared with the baseline, lower is better. The packet count has to match exactly.
+LOWER_IS_BETTER = ["boot_to_first_packet_us", "event_us", "repeat_interval_us", "i2c_transfers",
+                   "i2c_bytes", "i2c_bus_us", "aes_blocks", "cpu_active_us"]
+EXACT = ["packets"]
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline.json")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--exe", required=True, help="zephyr.exe of the nrf52_bsim build")
+    parser.add_argument("--bsim-out", default=os.environ.get("BSIM_OUT_PATH"), help="BabbleSim output folder, $BSIM_OUT_PATH by default")
+    parser.add_argument("--presets", default=",".join(map(str, PRESETS)), help="comma separated FRAM presets")
+    parser.add_argument("--types", default=",".join(map(str, DEVICE_TYPES)), help="comma separated device types")
+    parser.add_argument("--events", type=int, default=5, help="events per preset and type")
+    parser.add_argument("--output", default="sim_bench_results.json", help="results file")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.05, help="allowed relative regression, 0.05 is 5%%")
+    parser.add_argument("--update-baseline", action="store_true", help="write the results as the new baseline")
+    parser.add_argument("--ci", action="store_true", help="fail when there is no baseline to compare with")
+    args = parser.parse_args()
+
+    if not args.bsim_out:
+        parser.error("--bsim-out or $BSIM_OUT_PATH is needed to run the BabbleSim phy")
+    return args
+
+
+def run_device(args, sim_id, fram_file, device_args, with_phy):
+    """Run zephyr.exe once, next to a phy when the device has to go on air. Returns its stdout."""
+    bin_dir = os.path.join(args.bsim_out, "bin")
+    exe = os.path.abspath(args.exe)
+    device_cmd = [exe, "-s=" + sim_id, "-d=0", "-fram_file=" + fram_file] + device_args
+    phy = None
+
+    if with_phy:
+        phy = subprocess.Popen([os.path.join(bin_dir, "bs_2G4_phy_v1"), "-s=" + sim_id, "-D=1",
+                                "-sim_length=%d" % SIM_LENGTH_US],
+                               cwd=bin_dir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    else:
+        device_cmd.append("-nosim")
+
+    try:
+        result = subprocess.run(device_cmd, cwd=bin_dir, capture_output=True, text=True, timeout=120)
+    finally:
+        if phy is not None:
+            phy.wait(timeout=120)
+
+    if result.returncode != 0:
+        sys.stderr.write(result.stdout + result.stderr)
+        raise RuntimeError("%s exited with %d" % (" ".join(device_cmd), result.returncode))
+    return result.stdout
+
+
+def parse_bench_line(output):
+    for line in output.splitlines():
+        idx = line.find("BENCH {")
+        if idx >= 0:
+            return json.loads(line[idx + len("BENCH "):])
+    raise RuntimeError("no BENCH line in the output of the event")
+
+
+def run_combination(args, preset, device_type):
+    """Provision the FRAM with the preset and type, then run the events. Returns the BENCH records."""
+    sim_id = "wepower_bench_p%d_t%d_%d" % (preset, device_type, os.getpid())
+    records = []
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        fram_file = os.path.join(tmp_dir, "fram.bin")
+        with open(fram_file, "wb") as fram:
+            fram.write(bytes(FRAM_SIZE))
+
+        run_device(args, sim_id, fram_file, ["-wepower_preset=%d" % preset, "-wepower_type=%d" % device_type], False)
+        for _ in range(args.events):
+            records.append(parse_bench_line(run_device(args, sim_id, fram_file, ["-wepower_bench"], True)))
+
+    return records
+
+
+def summarize(records):
+    """First event is cold, the median of the others is warm (prebuilt frame on air before the I2C traffic)."""
+    summary = {"cold": records[0], "events": records}
+    if len(records) > 1:
+        summary["warm"] = {key: statistics.median(rec[key] for rec in records[1:]) for key in records[1]}
+    return summary
+
+
+def compare(results, baseline, tolerance):
+    """List the metrics which got worse than the baseline"""
+    regressions = []
+
+    for combo, summary in results.items():
+        for phase in ("cold", "warm"):
+            ref = baseline.get(combo, {}).get(phase)
+            cur = summary.get(phase)
+            if ref is None or cur is None:
+                continue
+            for key in EXACT:
+                if cur[key] != ref[key]:
+                    regressions.append("%s %s %s: %s, baseline %s" % (combo, phase, key, cur[key], ref[key]))
+            for key in LOWER_IS_BETTER:
+                if cur[key] > ref[key] * (1 + tolerance) and cur[key] > ref[key] + 1:
+                    regressions.append("%s %s %s: %s, baseline %s" % (combo, phase, key, cur[key], ref[key]))
+
+    return regressions
+
+
+def main():
+    args = parse_args()
+    results = {}
+
+    for preset in [int(p) for p in args.presets.split(",")]:
+        for device_type in [int(t) for t in args.types.split(",")]:
+            combo = "preset%d_type%d" % (preset, device_type)
+            results[combo] = summarize(run_combination(args, preset, device_type))
+            cold = results[combo]["cold"]
+            print("%-16s first packet %7d us, event %8d us, %3d packets, %4d I2C transfers, %4d AES blocks, CPU %7d us"
+                  % (combo, cold["boot_to_first_packet_us"], cold["event_us"], cold["packets"],
+                     cold["i2c_transfers"], cold["aes_blocks"], cold["cpu_active_us"]))
+
+    with open(args.output, "w") as out:
+        json.dump(results, out, indent=2, sort_keys=True)
+
+    if args.update_baseline:
+        baseline = {combo: {phase: summary[phase] for phase in ("cold", "warm") if phase in summary}
+                    for combo, summary in results.items()}
+        with open(args.baseline, "w") as out:
+            json.dump(baseline, out, indent=2, sort_keys=True)
+        print("Baseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        if args.ci:
+            print("ERROR: no baseline at %s, run with --update-baseline to create it" % args.baseline)
+            return 1
+        print("WARNING: no baseline at %s, run with --update-baseline to create it" % args.baseline)
+        return 0
+
+    with open(args.baseline) as base:
+        regressions = compare(results, json.load(base), args.tolerance)
+
+    for regression in regressions:
+        print("REGRESSION " + regression)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
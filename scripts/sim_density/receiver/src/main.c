@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#define WEPOWER_UUID16                  0x5750  // BT_UUID_BYTE1/BT_UUID_BYTE2 of the beacon
+#define WEPOWER_FRAME_LENGTH            22      // PAYLOAD_FRAME_LENGTH of the beacon
+#define WEPOWER_DEVICE_ID_INDEX         18      // PAYLOAD_DEVICE_ID_INDEX, 2 least significant bytes of the serial number
+#define WEPOWER_TX_REPEAT_COUNTER_INDEX 21      // PAYLOAD_TX_REPEAT_COUNTER_INDEX
+
+/**
+ * @brief What one advertising report tells about a WePower beacon
+ *
+ */
+typedef struct
+{
+    bool     is_wepower_uuid;           // UUID16 list carries WEPOWER_UUID16
+    bool     has_frame;                 // Manufacturer data is a WePower frame
+    uint16_t device_id;                 // Serial number of the beacon, 2 least significant bytes
+    uint8_t  tx_repeat_counter;         // Number of the first packet of the controller chunk of the event
+}wepower_report_t;
+
+/**
+ * @brief Pick the WePower fields out of one AD structure
+ *
+ * @param data AD structure
+ * @param user_data wepower_report_t to fill
+ * @return bool true to go on with the next AD structure
+ */
+static bool parse_ad(struct bt_data *data, void *user_data)
+{
+    wepower_report_t *report = user_data;
+
+    switch (data->type)
+    {
+        case BT_DATA_UUID16_ALL:
+        case BT_DATA_UUID16_SOME:
+            for (uint8_t idx = 0; (idx + 1) < data->data_len; idx += 2)
+            {
+                if (sys_get_le16(&data->data[idx]) == WEPOWER_UUID16)
+                {
+                    report->is_wepower_uuid = true;
+                }
+            }
+            break;
+        case BT_DATA_MANUFACTURER_DATA:
+            if (data->data_len >= WEPOWER_FRAME_LENGTH)
+            {
+                report->has_frame = true;
+                report->device_id = sys_get_le16(&data->data[WEPOWER_DEVICE_ID_INDEX]);
+                report->tx_repeat_counter = data->data[WEPOWER_TX_REPEAT_COUNTER_INDEX];
+            }
+            break;
+        default:
+            break;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Print every report of a WePower beacon as "RX <time us> <device id> <repeat counter> <rssi>"
+ *
+ * @param info Report information
+ * @param buf Advertising data
+ */
+static void scan_recv_cb(const struct bt_le_scan_recv_info *info, struct net_buf_simple *buf)
+{
+    wepower_report_t report = {0};
+    uint32_t now_us = k_ticks_to_us_floor32(k_uptime_ticks());
+
+    bt_data_parse(buf, parse_ad, &report);
+
+    if (report.is_wepower_uuid && report.has_frame)
+    {
+        printk("RX %u %u %u %d\n", now_us, report.device_id, report.tx_repeat_counter, info->rssi);
+    }
+}
+
+static struct bt_le_scan_cb scan_callbacks =
+{
+    .recv = scan_recv_cb,
+};
+
+/**
+ * @brief Scan without a break on the three primary channels until the simulation ends
+ *
+ * @return int 0
+ */
+int main(void)
+{
+    struct bt_le_scan_param scan_param =
+    {
+        .type = BT_LE_SCAN_TYPE_PASSIVE,
+        .options = BT_LE_SCAN_OPT_NONE,
+        .interval = BT_GAP_SCAN_FAST_INTERVAL,
+        .window = BT_GAP_SCAN_FAST_INTERVAL,
+    };
+    int err;
+
+    err = bt_enable(NULL);
+    if (err)
+    {
+        printk("RX_ERROR bt_enable %d\n", err);
+        return 0;
+    }
+
+    bt_le_scan_cb_register(&scan_callbacks);
+
+    err = bt_le_scan_start(&scan_param, NULL);
+    if (err)
+    {
+        printk("RX_ERROR bt_le_scan_start %d\n", err);
+        return 0;
+    }
+
+    printk("RX_READY\n");
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""BabbleSim density test: delivery of beacon events versus fleet size and burst parameters.
+
+N copies of the nrf52_bsim build of the beacon share the 2.4 GHz channel with one scanning receiver
+(scripts/sim_density/receiver). Every beacon fires one event: it wakes at its arrival time, sends its
+burst and powers off. Arrival times follow the chosen statistics:
+
+    poisson       events arrive at --rate events per second over the fleet
+    uniform       every event arrives at a random time of --window-ms
+    simultaneous  every event arrives at the same time, e.g. one switch waking a whole room
+
+For every fleet size, packet interval, packets per event and jitter policy the script reports the share of events
+the receiver got at least one packet of, the latency from wake up to the first packet received and
+the share of the sent packets received.
+
+    west build --build-dir build_sim . --pristine --board nrf52_bsim
+    west build --build-dir build_rx scripts/sim_density/receiver --pristine --board nrf52_bsim
+    scripts/sim_density/run_density.py --exe build_sim/zephyr/zephyr.exe --receiver-exe build_rx/zephyr/zephyr.exe \\
+        --fleet-sizes 1,10,50,100 --intervals 20 --max-packets 5,10,50
+"""
+
+import argparse
+import concurrent.futures
+import json
+import os
+import random
+import statistics
+import subprocess
+import sys
+import tempfile
+
+FRAM_SIZE = 8192                # size of fram@50 in boards/nrf52_bsim.overlay
+RECEIVER_WARMUP_US = 100000     # receiver scans before the first event may arrive
+EVENT_MARGIN_US = 2000000       # boot of the beacon and end of the simulation after the last burst
+
+
+def parse_list(text):
+    return [int(value) for value in text.split(",")]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--exe", required=True, help="zephyr.exe of the nrf52_bsim build of the beacon")
+    parser.add_argument("--receiver-exe", required=True, help="zephyr.exe of the nrf52_bsim build of the receiver")
+    parser.add_argument("--bsim-out", default=os.environ.get("BSIM_OUT_PATH"), help="BabbleSim output folder, $BSIM_OUT_PATH by default")
+    parser.add_argument("--preset", type=int, default=1, help="FRAM preset of every beacon (preset_type_t)")
+    parser.add_argument("--fleet-sizes", type=parse_list, default=[1, 10, 50, 100], help="comma separated number of beacons")
+    parser.add_argument("--intervals", type=parse_list, default=[20], help="comma separated packet_interval in ms")
+    parser.add_argument("--max-packets", type=parse_list, default=[5, 10, 50], help="comma separated event_max_packets")
+    parser.add_argument("--jitter-policies", type=parse_list, default=[0],
+                        help="comma separated jitter_policy, jitter in ms")
+    parser.add_argument("--arrival", choices=["poisson", "uniform", "simultaneous"], default="poisson")
+    parser.add_argument("--rate", type=float, default=10.0, help="poisson: events per second over the whole fleet")
+    parser.add_argument("--window-ms", type=int, default=1000, help="uniform: time window of the arrivals")
+    parser.add_argument("--runs", type=int, default=1, help="simulations per point, with different seeds")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the first run")
+    parser.add_argument("--jobs", type=int, default=os.cpu_count(), help="beacons provisioned in parallel")
+    parser.add_argument("--output", default="sim_density_results.json", help="results file")
+    args = parser.parse_args()
+
+    if not args.bsim_out:
+        parser.error("--bsim-out or $BSIM_OUT_PATH is needed to run the BabbleSim phy")
+    return args
+
+
+def arrival_times_us(args, fleet_size, rng):
+    """Wake up time of every beacon, from the start of the simulation"""
+    if args.arrival == "poisson":
+        times = []
+        now = 0.0
+        for _ in range(fleet_size):
+            now += rng.expovariate(args.rate)
+            times.append(int(now * 1e6))
+    elif args.arrival == "uniform":
+        times = [rng.randrange(args.window_ms * 1000) for _ in range(fleet_size)]
+    else:
+        times = [0] * fleet_size
+
+    return [RECEIVER_WARMUP_US + time for time in times]
+
+
+def provision(args, bin_dir, fram_file, serial, interval, max_packets, jitter):
+    with open(fram_file, "wb") as fram:
+        fram.write(bytes(FRAM_SIZE))
+    subprocess.run([os.path.abspath(args.exe), "-nosim", "-fram_file=" + fram_file,
+                    "-wepower_preset=%d" % args.preset, "-wepower_serial=%d" % serial,
+                    "-wepower_interval=%d" % interval, "-wepower_max_packets=%d" % max_packets,
+                    "-wepower_jitter=%d" % jitter],
+                   cwd=bin_dir, check=True, capture_output=True, timeout=60)
+
+
+def run_simulation(args, fleet_size, interval, max_packets, jitter, seed):
+    """One simulation of the fleet. Returns one record per event."""
+    bin_dir = os.path.join(args.bsim_out, "bin")
+    sim_id = "wepower_density_%d_%d_%d_%d_%d_%d" % (fleet_size, interval, max_packets, jitter, seed, os.getpid())
+    rng = random.Random(seed)
+    arrivals = arrival_times_us(args, fleet_size, rng)
+    burst_us = (interval + jitter) * 1000 * (max_packets + 1)
+    sim_length_us = max(arrivals) + burst_us + EVENT_MARGIN_US
+    serials = list(range(1, fleet_size + 1))
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        fram_files = [os.path.join(tmp_dir, "fram_%d.bin" % serial) for serial in serials]
+        with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+            list(pool.map(lambda idx: provision(args, bin_dir, fram_files[idx], serials[idx], interval, max_packets, jitter),
+                          range(fleet_size)))
+
+        # Output to files, a full pipe would stall the device and the whole simulation with it
+        receiver_log = os.path.join(tmp_dir, "receiver.log")
+        beacon_logs = [os.path.join(tmp_dir, "beacon_%d.log" % serial) for serial in serials]
+        phy = subprocess.Popen([os.path.join(bin_dir, "bs_2G4_phy_v1"), "-s=" + sim_id, "-D=%d" % (fleet_size + 1),
+                                "-sim_length=%d" % sim_length_us],
+                               cwd=bin_dir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        with open(receiver_log, "w") as log:
+            devices = [subprocess.Popen([os.path.abspath(args.receiver_exe), "-s=" + sim_id, "-d=0"],
+                                        cwd=bin_dir, stdout=log, stderr=subprocess.DEVNULL)]
+        for idx in range(fleet_size):
+            with open(beacon_logs[idx], "w") as log:
+                devices.append(subprocess.Popen([os.path.abspath(args.exe), "-s=" + sim_id, "-d=%d" % (idx + 1),
+                                                 "-start_offset=%d" % arrivals[idx], "-fram_file=" + fram_files[idx],
+                                                 "-wepower_bench"],
+                                                cwd=bin_dir, stdout=log, stderr=subprocess.DEVNULL))
+
+        for device in devices:
+            device.wait()
+        phy.wait()
+
+        with open(receiver_log) as log:
+            receiver_output = log.read()
+        beacon_outputs = []
+        for beacon_log in beacon_logs:
+            with open(beacon_log) as log:
+                beacon_outputs.append(log.read())
+
+    first_rx_us = {}
+    rx_packets = {}
+    for line in receiver_output.splitlines():
+        fields = line.split()
+        if len(fields) == 5 and fields[0] == "RX":
+            # The repeat counter numbers the controller chunk, not the packet, so it can't tell the packets sent.
+            # Every report is one packet received.
+            rx_us, device_id = int(fields[1]), int(fields[2])
+            first_rx_us.setdefault(device_id, rx_us)
+            rx_packets[device_id] = rx_packets.get(device_id, 0) + 1
+
+    events = []
+    for idx, output in enumerate(beacon_outputs):
+        device_id = serials[idx] & 0xFFFF
+        sent = None
+        for line in output.splitlines():
+            pos = line.find("BENCH {")
+            if pos >= 0:
+                sent = json.loads(line[pos + len("BENCH "):])["packets"]
+        events.append({
+            "serial": serials[idx],
+            "arrival_us": arrivals[idx],
+            "packets_sent": sent,
+            "packets_received": rx_packets.get(device_id, 0),
+            "latency_us": (first_rx_us[device_id] - arrivals[idx]) if device_id in first_rx_us else None,
+        })
+
+    return events
+
+
+def percentile(values, share):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(share * len(ordered)))]
+
+
+def summarize(events):
+    delivered = [event for event in events if event["latency_us"] is not None]
+    sent = sum(event["packets_sent"] or 0 for event in events)
+    summary = {
+        "events": len(events),
+        "delivery_probability": len(delivered) / len(events),
+        "packet_delivery_ratio": (sum(event["packets_received"] for event in events) / sent) if sent else 0.0,
+    }
+    if delivered:
+        latencies = [event["latency_us"] for event in delivered]
+        summary.update({
+            "latency_median_us": statistics.median(latencies),
+            "latency_p95_us": percentile(latencies, 0.95),
+            "latency_max_us": max(latencies),
+        })
+    return summary
+
+
+def main():
+    args = parse_args()
+    results = []
+
+    print("%6s %8s %8s %6s %9s %9s %12s %12s" % ("beacons", "interval", "packets", "jitter", "delivered", "pkt ratio",
+                                                  "latency p50", "latency p95"))
+    for fleet_size in args.fleet_sizes:
+        for interval in args.intervals:
+            for max_packets in args.max_packets:
+                for jitter in args.jitter_policies:
+                    events = []
+                    for run in range(args.runs):
+                        events += run_simulation(args, fleet_size, interval, max_packets, jitter, args.seed + run)
+                    summary = summarize(events)
+                    results.append({"fleet_size": fleet_size, "packet_interval": interval,
+                                    "event_max_packets": max_packets, "jitter_policy": jitter, "arrival": args.arrival,
+                                    "summary": summary, "events": events})
+                    print("%6d %8d %8d %6d %9.3f %9.3f %12s %12s" % (fleet_size, interval, max_packets, jitter,
+                                                                    summary["delivery_probability"],
+                                                                    summary["packet_delivery_ratio"],
+                                                                    summary.get("latency_median_us", "-"),
+                                                                    summary.get("latency_p95_us", "-")))
+
+    with open(args.output, "w") as out:
+        json.dump({"arrival": args.arrival, "rate": args.rate, "window_ms": args.window_ms,
+                   "preset": args.preset, "results": results}, out, indent=2)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
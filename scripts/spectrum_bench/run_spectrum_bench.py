@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""Accuracy and speed benchmark of the fixed point spectrum of the vibration monitor (components/spectrum).
+
+components/spectrum/src/spectrum.c is built for the host into a shared library with spectrum_host.c and run on
+synthetic accelerometer windows: tones on and between the bins, harmonics, noise, tiny and full scale vibrations on
+top of gravity. Every window is also analyzed in double precision with the same steps (mean removed, periodic Hann
+window, DFT, one sided power scaled back by 8/3) and the band RMS and the peak bins of the firmware are compared
+with it. The host build runs the portable C of the butterflies, the SIMD build of the board is bit exact with it.
+
+    scripts/spectrum_bench/run_spectrum_bench.py
+    scripts/spectrum_bench/run_spectrum_bench.py --board-log uart.log
+
+Cycles per window on the nRF52840 come from test command 10 of the CLI, which prints a "SPECTRUM ..." line. Give
+the captured UART log with --board-log to add them to the results. The host time per window is only reported, it
+depends on the machine. Results are compared with a baseline, the script exits with 1 when the error got worse
+than the tolerance or a peak moved. With --ci a missing baseline is an error too.
+
+baseline.json next to this script is a host run with --iterations 200 --update-baseline. The errors and peaks
+do not depend on the iterations or the machine, only the host time does and it is not compared.
+"""
+
+import argparse
+import ctypes
+import json
+import math
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+SPECTRUM_DIR = os.path.join(SCRIPT_DIR, "..", "..", "components", "spectrum")
+DEFAULT_BASELINE = os.path.join(SCRIPT_DIR, "baseline.json")
+
+# Defaults of components/device_config/include/device_config.h and app_types.h
+ODR_HZ = 400                            # ACCEL_FIFO_ODR_CODE 7
+BAND_EDGES_HZ = [10, 50, 100, 250]      # SPECTRUM_BAND_EDGES_HZ
+NUM_PEAKS = 3                           # SPECTRUM_PAYLOAD_PEAKS of app_types.h
+GRAVITY = 9806                          # m/s^2 * 1000, the mean of the axis under the sensor
+HANN_POWER_GAIN = 3.0 / 8.0
+
+# Absolute band error allowed on top of the relative one, in m/s^2 * 1000
+ABSOLUTE_ERROR_FLOOR = 2
+# Peaks below this part of the strongest are not reported, SPECTRUM_PEAK_FLOOR_SHIFT of spectrum.c
+PEAK_FLOOR = 1.0 / 16
+
+LOWER_IS_BETTER = ["band_error_max", "band_error_rel"]
+EXACT = ["peak_bins"]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler")
+    parser.add_argument("--iterations", type=int, default=100000, help="windows timed per case")
+    parser.add_argument("--board-log", help="UART log of test command 10 on the board")
+    parser.add_argument("--output", default="spectrum_bench_results.json", help="results file")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.05, help="allowed relative regression, 0.05 is 5%%")
+    parser.add_argument("--max-error", type=float, default=0.03,
+                        help="largest band error allowed, part of the RMS of the window")
+    parser.add_argument("--update-baseline", action="store_true", help="write the results as the new baseline")
+    parser.add_argument("--ci", action="store_true", help="fail when there is no baseline to compare with")
+    return parser.parse_args()
+
+
+def build_library(cc, out_dir):
+    """Build spectrum.c and spectrum_host.c into a shared library. Returns the loaded library."""
+    lib_path = os.path.join(out_dir, "libspectrum_host.so")
+    cmd = [cc, "-std=c11", "-O2", "-Wall", "-Werror", "-shared", "-fPIC",
+           "-I" + os.path.join(SPECTRUM_DIR, "include"),
+           os.path.join(SPECTRUM_DIR, "src", "spectrum.c"), os.path.join(SCRIPT_DIR, "spectrum_host.c"),
+           "-o", lib_path]
+    subprocess.run(cmd, check=True)
+
+    lib = ctypes.CDLL(lib_path)
+    lib.spectrum_host_window_size.restype = ctypes.c_int
+    lib.spectrum_host_analyze.restype = ctypes.c_int
+    lib.spectrum_host_analyze.argtypes = [ctypes.POINTER(ctypes.c_int16), ctypes.c_uint32,
+                                          ctypes.POINTER(ctypes.c_uint16), ctypes.c_uint8, ctypes.c_uint8,
+                                          ctypes.POINTER(ctypes.c_uint16), ctypes.POINTER(ctypes.c_uint8)]
+    lib.spectrum_host_ns_per_window.restype = ctypes.c_double
+    lib.spectrum_host_ns_per_window.argtypes = [ctypes.POINTER(ctypes.c_int16), ctypes.c_uint32,
+                                                ctypes.POINTER(ctypes.c_uint16), ctypes.c_uint8, ctypes.c_uint8,
+                                                ctypes.c_uint32]
+    return lib
+
+
+def quantize(values):
+    return [max(-32768, min(32767, int(round(v)))) for v in values]
+
+
+def tone(size, cycles, amplitude, phase=0.3):
+    return [amplitude * math.sin(2 * math.pi * cycles * n / size + phase) for n in range(size)]
+
+
+def make_cases(size):
+    """Synthetic windows of one axis, gravity on top. Returns {name: samples}."""
+    rng = random.Random(1)
+    triangle_period = 8
+    cases = {
+        "silent": [0.0] * size,
+        "tone_bin2": tone(size, 2, 2000),
+        "tone_bin5": tone(size, 5, 2000),
+        "tone_bin11": tone(size, 11, 2000),
+        "tone_bin4_5": tone(size, 4.5, 2000),
+        "tone_tiny": tone(size, 6, 40),
+        "tone_full_scale": tone(size, 3, 19000),
+        "two_tones": [a + b for a, b in zip(tone(size, 3, 3000), tone(size, 9, 800, 1.1))],
+        "square_bin2": [1500 if math.sin(2 * math.pi * 2 * n / size + 0.1) >= 0 else -1500 for n in range(size)],
+        "noise": [rng.gauss(0, 500) for _ in range(size)],
+        # Triangle of the LIS2DW12 emulator of the simulated board
+        "emul_triangle": [(abs((n % triangle_period) - triangle_period / 2) * 4 * 0x400 / triangle_period) - 0x400
+                          for n in range(size)],
+    }
+    return {name: quantize([GRAVITY + v for v in values]) for name, values in cases.items()}
+
+
+def reference_spectrum(samples, odr_hz, band_edges_hz, num_peaks):
+    """Band RMS and peak bins in double precision, the steps of spectrum.c without the fixed point"""
+    size = len(samples)
+    mean = sum(samples) / size
+    windowed = [(s - mean) * 0.5 * (1 - math.cos(2 * math.pi * n / size)) for n, s in enumerate(samples)]
+    power = [0.0] * (size // 2 + 2)
+
+    for k in range(1, size // 2 + 1):
+        re = sum(w * math.cos(2 * math.pi * k * n / size) for n, w in enumerate(windowed)) / size
+        im = -sum(w * math.sin(2 * math.pi * k * n / size) for n, w in enumerate(windowed)) / size
+        power[k] = (re * re + im * im) * (2 if k < size // 2 else 1) / HANN_POWER_GAIN
+
+    bands = []
+    for lo, hi in zip(band_edges_hz[:-1], band_edges_hz[1:]):
+        bands.append(math.sqrt(sum(power[k] for k in range(1, size // 2 + 1) if lo * size <= k * odr_hz < hi * size)))
+
+    maxima = [k for k in range(1, size // 2 + 1) if power[k] > 0 and power[k] >= power[k - 1] and power[k] > power[k + 1]]
+    maxima.sort(key=lambda k: (-power[k], k))
+    strongest = power[maxima[0]] if maxima else 0
+    peaks = [k for k in maxima[:num_peaks] if power[k] >= strongest * PEAK_FLOOR]
+
+    rms = math.sqrt(sum((s - mean) ** 2 for s in samples) / size)
+    return bands, peaks, rms
+
+
+def run_case(lib, samples, iterations):
+    num_bands = len(BAND_EDGES_HZ) - 1
+    c_samples = (ctypes.c_int16 * len(samples))(*samples)
+    c_edges = (ctypes.c_uint16 * len(BAND_EDGES_HZ))(*BAND_EDGES_HZ)
+    c_bands = (ctypes.c_uint16 * num_bands)()
+    c_peaks = (ctypes.c_uint8 * NUM_PEAKS)()
+
+    ret = lib.spectrum_host_analyze(c_samples, ODR_HZ, c_edges, num_bands, NUM_PEAKS, c_bands, c_peaks)
+    if ret != 0:
+        raise RuntimeError("spectrum_analyze returned %d" % ret)
+    ns_per_window = lib.spectrum_host_ns_per_window(c_samples, ODR_HZ, c_edges, num_bands, NUM_PEAKS, iterations)
+
+    ref_bands, ref_peaks, rms = reference_spectrum(samples, ODR_HZ, BAND_EDGES_HZ, NUM_PEAKS)
+    bands = list(c_bands)
+    peaks = [p for p in c_peaks if p != 0]
+    errors = [abs(b - r) for b, r in zip(bands, ref_bands)]
+
+    return {
+        "band_rms": bands,
+        "band_rms_reference": [round(r, 2) for r in ref_bands],
+        "band_error_max": round(max(errors), 2),
+        "band_error_rel": round(max(errors) / rms, 5) if rms > 0 else 0.0,
+        "peak_bins": peaks,
+        "peak_bins_reference": ref_peaks,
+        "peaks_match": peaks == ref_peaks,
+        "host_ns_per_window": round(ns_per_window, 1),
+    }
+
+
+def parse_board_log(path):
+    """Cycles per window from the SPECTRUM line of test command 10"""
+    with open(path) as log:
+        for line in log:
+            match = re.search(r"SPECTRUM .*?(\d+) cycles per window", line)
+            if match:
+                return int(match.group(1))
+    raise RuntimeError("no SPECTRUM line in %s, run test command 10 on the board" % path)
+
+
+def compare(results, baseline, tolerance):
+    """List the metrics which got worse than the baseline"""
+    regressions = []
+
+    for name, cur in results["cases"].items():
+        ref = baseline.get("cases", {}).get(name)
+        if ref is None:
+            continue
+        for key in EXACT:
+            if cur[key] != ref[key]:
+                regressions.append("%s %s: %s, baseline %s" % (name, key, cur[key], ref[key]))
+        for key in LOWER_IS_BETTER:
+            if cur[key] > ref[key] * (1 + tolerance) and cur[key] > ref[key] + 1:
+                regressions.append("%s %s: %s, baseline %s" % (name, key, cur[key], ref[key]))
+
+    cur_cycles = results.get("board_cycles_per_window")
+    ref_cycles = baseline.get("board_cycles_per_window")
+    if cur_cycles is not None and ref_cycles is not None and cur_cycles > ref_cycles * (1 + tolerance):
+        regressions.append("board_cycles_per_window: %s, baseline %s" % (cur_cycles, ref_cycles))
+
+    return regressions
+
+
+def main():
+    args = parse_args()
+    failures = []
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        lib = build_library(args.cc, tmp_dir)
+        size = lib.spectrum_host_window_size()
+        results = {"odr_hz": ODR_HZ, "band_edges_hz": BAND_EDGES_HZ, "window": size, "cases": {}}
+
+        for name, samples in make_cases(size).items():
+            case = run_case(lib, samples, args.iterations)
+            results["cases"][name] = case
+            print("%-16s bands %-20s ref %-30s err %6.2f (%5.2f%%)  peaks %-12s ref %-12s %7.1f ns"
+                  % (name, case["band_rms"], case["band_rms_reference"], case["band_error_max"],
+                     100 * case["band_error_rel"], case["peak_bins"], case["peak_bins_reference"],
+                     case["host_ns_per_window"]))
+            if not case["peaks_match"]:
+                failures.append("%s peaks %s, reference %s" % (name, case["peak_bins"], case["peak_bins_reference"]))
+            if case["band_error_max"] > ABSOLUTE_ERROR_FLOOR and case["band_error_rel"] > args.max_error:
+                failures.append("%s band error %.2f%% of the RMS" % (name, 100 * case["band_error_rel"]))
+
+    if args.board_log:
+        results["board_cycles_per_window"] = parse_board_log(args.board_log)
+        print("board: %d cycles per window" % results["board_cycles_per_window"])
+
+    with open(args.output, "w") as out:
+        json.dump(results, out, indent=2, sort_keys=True)
+
+    for failure in failures:
+        print("FAIL " + failure)
+
+    if args.update_baseline:
+        baseline = {"cases": {name: {key: case[key] for key in LOWER_IS_BETTER + EXACT}
+                              for name, case in results["cases"].items()}}
+        if "board_cycles_per_window" in results:
+            baseline["board_cycles_per_window"] = results["board_cycles_per_window"]
+        with open(args.baseline, "w") as out:
+            json.dump(baseline, out, indent=2, sort_keys=True)
+        print("Baseline written to %s" % args.baseline)
+        return 1 if failures else 0
+
+    if not os.path.exists(args.baseline):
+        if args.ci:
+            print("ERROR: no baseline at %s, run with --update-baseline to create it" % args.baseline)
+            return 1
+        print("WARNING: no baseline at %s, run with --update-baseline to create it" % args.baseline)
+        return 1 if failures else 0
+
+    with open(args.baseline) as base:
+        regressions = compare(results, json.load(base), args.tolerance)
+
+    for regression in regressions:
+        print("REGRESSION " + regression)
+    return 1 if (failures or regressions) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
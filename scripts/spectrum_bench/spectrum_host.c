@@ -0,0 +1,88 @@
+/*
+ * Host wrapper of components/spectrum for run_spectrum_bench.py, built into a shared library with spectrum.c.
+ * Flat arguments only, the script does not mirror the structs of spectrum.h.
+ */
+#define _POSIX_C_SOURCE 199309L     // clock_gettime() with -std=c11
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "spectrum.h"
+
+/**
+ * @brief Fill a spectrum config from flat arguments
+ *
+ * @param odr_hz Sample rate
+ * @param band_edges_hz num_bands + 1 edges
+ * @param num_bands Number of bands
+ * @param num_peaks Number of peaks
+ * @param config Config to fill
+ */
+static void fill_config(uint32_t odr_hz, const uint16_t *band_edges_hz, uint8_t num_bands, uint8_t num_peaks,
+                        spectrum_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->odr_hz = odr_hz;
+    config->num_bands = num_bands;
+    config->num_peaks = num_peaks;
+    memcpy(config->band_edges_hz, band_edges_hz,
+           ((num_bands < SPECTRUM_MAX_BANDS) ? num_bands + 1 : SPECTRUM_MAX_BANDS + 1) * sizeof(uint16_t));
+}
+
+/**
+ * @brief Size of a window of spectrum_analyze()
+ *
+ * @return int SPECTRUM_FFT_SIZE
+ */
+int spectrum_host_window_size(void)
+{
+    return SPECTRUM_FFT_SIZE;
+}
+
+/**
+ * @brief Run spectrum_analyze() on one window
+ *
+ * @return int Return of spectrum_analyze()
+ */
+int spectrum_host_analyze(const int16_t *samples, uint32_t odr_hz, const uint16_t *band_edges_hz, uint8_t num_bands,
+                          uint8_t num_peaks, uint16_t *band_rms, uint8_t *peak_bin)
+{
+    spectrum_config_t config;
+    spectrum_result_t result;
+    int ret;
+
+    fill_config(odr_hz, band_edges_hz, num_bands, num_peaks, &config);
+    ret = spectrum_analyze(samples, &config, &result);
+    memcpy(band_rms, result.band_rms, num_bands * sizeof(uint16_t));
+    memcpy(peak_bin, result.peak_bin, num_peaks);
+
+    return ret;
+}
+
+/**
+ * @brief Time spectrum_analyze() on one window
+ *
+ * @return double Nanoseconds per window, average of the iterations
+ */
+double spectrum_host_ns_per_window(const int16_t *samples, uint32_t odr_hz, const uint16_t *band_edges_hz,
+                                   uint8_t num_bands, uint8_t num_peaks, uint32_t iterations)
+{
+    spectrum_config_t config;
+    spectrum_result_t result;
+    volatile uint16_t sink = 0;
+    struct timespec start;
+    struct timespec end;
+
+    fill_config(odr_hz, band_edges_hz, num_bands, num_peaks, &config);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t iteration = 0; iteration < iterations; iteration++)
+    {
+        (void)spectrum_analyze(samples, &config, &result);
+        sink += result.band_rms[0];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec)) / iterations;
+}